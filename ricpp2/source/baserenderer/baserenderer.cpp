@@ -41,6 +41,10 @@
 #include "ricpp/ribparser/ribparser.h"
 #endif // _RICPP_RIBPARSER_RIBPARSER_H
 
+#ifndef _RICPP_TOOLS_TRACER_H
+#include "ricpp/tools/tracer.h"
+#endif // _RICPP_TOOLS_TRACER_H
+
 #ifdef _DEBUG
 // #define _TRACE_ARCHIVE
 #define _TRACE
@@ -605,10 +609,27 @@ void CBaseRenderer::hideSurface(const CSurface *s)
 {
 	if ( !s )
 		return;
+	CTraceScope trace("hide");
 	CSurface::const_iterator iter;
 	for ( iter = s->begin(); iter != s->end(); iter++ ) {
 		hide(*iter);
 	}
+
+	CRequestStatistics &stats = renderState()->statistics();
+	if ( stats.enabled() ) {
+		unsigned long long n = 0;
+		for ( iter = s->begin(); iter != s->end(); iter++ ) {
+			const std::vector<IndexType> &sizes = (*iter).sizes();
+			std::vector<IndexType>::const_iterator siter;
+			for ( siter = sizes.begin(); siter != sizes.end(); siter++ ) {
+				if ( (*iter).faceType() == FACETYPE_TRIANGLES )
+					n += (*siter) / 3;
+				else if ( (*iter).faceType() == FACETYPE_TRIANGLESTRIPS && (*siter) > 2 )
+					n += (*siter) - 2;
+			}
+		}
+		stats.triangles(n);
+	}
 }
 
 
@@ -928,6 +949,20 @@ void CBaseRenderer::processRequest(CRManInterfaceCall *aRequest, bool immediatel
 	ExceptRiCPPError ePre, eDo, ePost;
 	
 	bool recorded = false;
+
+	// Timeline of the requests (Control "trace")
+	CTraceScope trace(aRequest->requestName());
+
+	// Statistics, the times include the requests processed by aRequest (e.g. ReadArchive)
+	CRequestStatistics &stats = renderState()->statistics();
+	bool measure = stats.enabled();
+	EnumRequests req = REQ_UNKNOWN, prevReq = REQ_UNKNOWN;
+	unsigned long long tPre = 0, tDo = 0, tPost = 0;
+	if ( measure ) {
+		req = aRequest->interfaceIdx();
+		prevReq = stats.processing(req, aRequest->parameterBytes());
+		tPre = CRequestStatistics::now();
+	}
 	
 	try {
 		
@@ -940,6 +975,9 @@ void CBaseRenderer::processRequest(CRManInterfaceCall *aRequest, bool immediatel
 	} catch ( ... ) {
 		ePre.set(RIE_SYSTEM, RIE_SEVERE, renderState()->printLineNo(__LINE__), renderState()->printName(__FILE__), "Unknown error at preprocessing, 'processRequest(%s)'", noNullStr(aRequest->requestName()));
 	}
+
+	if ( measure )
+		tDo = CRequestStatistics::now();
 	
 	if ( !ePre.isSevere() ) {
 		
@@ -962,6 +1000,9 @@ void CBaseRenderer::processRequest(CRManInterfaceCall *aRequest, bool immediatel
 			}
 		}
 
+		if ( measure )
+			tPost = CRequestStatistics::now();
+
 		if ( !eDo.isSevere() ) {
 			try {
 				
@@ -976,6 +1017,13 @@ void CBaseRenderer::processRequest(CRManInterfaceCall *aRequest, bool immediatel
 			}
 		}
 	}
+
+	if ( measure ) {
+		unsigned long long tEnd = CRequestStatistics::now();
+		if ( !tPost )
+			tPost = tEnd;
+		stats.processed(req, tDo-tPre, tPost-tDo, tEnd-tPost, prevReq);
+	}
 	
 	if ( !recorded && aRequest->deferedDeletion() )
 		renderState()->deferRequest(aRequest);
@@ -1099,6 +1147,8 @@ void CBaseRenderer::readArchiveFromStream(RtString name, IRibParserCallback &aPa
 	std::string oldArchiveName = renderState()->archiveName();
 	long oldLineNo = renderState()->lineNo();
 
+	CTraceScope trace("archive", notEmptyStr(name) ? name : "stdin");
+
 	CRibParser parser(aParserCallback, *renderState(), renderState()->baseUri());
 	renderState()->moveArchiveBegin();
 	try {
@@ -1107,8 +1157,14 @@ void CBaseRenderer::readArchiveFromStream(RtString name, IRibParserCallback &aPa
 			filename = name;
 			renderState()->varSubst(filename, '$');
 		}
-		if ( parser.canParse(name) ) {
-			renderState()->baseUri() = parser.absUri();
+		CTraceScope traceOpen("open archive");
+		bool canParse = parser.canParse(name);
+		traceOpen.end();
+		if ( canParse ) {
+			// Buffers (e.g. "memory:foo") have no directory, relative names
+			// within are resolved like the ones of the reading archive
+			if ( parser.absUri().getScheme() == "file" )
+				renderState()->baseUri() = parser.absUri();
 			bool savCache = renderState()->cacheFileArchives();
 			if ( savCache ) {
 				renderState()->archiveFileBegin(name, macroFactory());
@@ -1305,6 +1361,18 @@ RtVoid CBaseRenderer::end(void)
 		err.set(RIE_SYSTEM, RIE_SEVERE, __LINE__, __FILE__, "Unknown error at '%s'", CRequestInfo::requestName(req));
 	}
 
+	// Writes the statistics of the context (Control "statistics" "file")
+	const CRequestStatistics &stats = renderState()->statistics();
+	if ( !stats.filename().empty() && !stats.write(stats.filename()) ) {
+		ricppErrHandler().handleError(RIE_NOFILE, RIE_ERROR, "Could not write the statistics to '%s'", stats.filename().c_str());
+	}
+
+	// Writes the trace (Control "trace" "file")
+	const std::string &traceFile = renderState()->traceFilename();
+	if ( !traceFile.empty() && !ricppTracer().write(traceFile) ) {
+		ricppErrHandler().handleError(RIE_NOFILE, RIE_ERROR, "Could not write the trace to '%s'", traceFile.c_str());
+	}
+
 	try {
 		renderState()->contextEnd();
 	} catch ( ExceptRiCPPError &e2 ) {
@@ -2593,10 +2661,10 @@ RtVoid CBaseRenderer::trimCurve(RtInt nloops, RtInt ncurves[], RtInt order[], Rt
 
 RtVoid CBaseRenderer::preProcess(CRiIdentity &obj)
 {
-	RtFloat det = renderState()->curTransform().getCTM().determinant();
+	RtFloat det = renderState()->curTransform().determinant();
 	renderState()->curTransform().identity();
 	// Flip normals?
-	if ( det * renderState()->curTransform().getCTM().determinant() < 0 )
+	if ( det * renderState()->curTransform().determinant() < 0 )
 		renderState()->attributes().toggleOrientation();
 	// -------------
 }
@@ -2612,10 +2680,10 @@ RtVoid CBaseRenderer::identity(void)
 
 RtVoid CBaseRenderer::preProcess(CRiTransform &obj)
 {
-	RtFloat det = renderState()->curTransform().getCTM().determinant();
+	RtFloat det = renderState()->curTransform().determinant();
 	renderState()->curTransform().transform(obj.transform());
 	// Flip normals?
-	if ( det * renderState()->curTransform().getCTM().determinant() < 0 )
+	if ( det * renderState()->curTransform().determinant() < 0 )
 		renderState()->attributes().toggleOrientation();
 	// -------------
 }
@@ -2631,10 +2699,10 @@ RtVoid CBaseRenderer::transform(RtMatrix aTransform)
 
 RtVoid CBaseRenderer::preProcess(CRiConcatTransform &obj)
 {
-	RtFloat det = renderState()->curTransform().getCTM().determinant();
+	RtFloat det = renderState()->curTransform().determinant();
 	renderState()->curTransform().concatTransform(obj.transform());
 	// Flip normals?
-	if ( det * renderState()->curTransform().getCTM().determinant() < 0 )
+	if ( det * renderState()->curTransform().determinant() < 0 )
 		renderState()->attributes().toggleOrientation();
 	// -------------
 }
@@ -2692,10 +2760,10 @@ RtVoid CBaseRenderer::rotate(RtFloat angle, RtFloat dx, RtFloat dy, RtFloat dz)
 
 RtVoid CBaseRenderer::preProcess(CRiScale &obj)
 {
-	RtFloat det = renderState()->curTransform().getCTM().determinant();
+	RtFloat det = renderState()->curTransform().determinant();
 	renderState()->curTransform().scale(obj.dx(), obj.dy(), obj.dz());
 	// Flip normals?
-	if (det * renderState()->curTransform().getCTM().determinant() < 0)
+	if (det * renderState()->curTransform().determinant() < 0)
 		renderState()->attributes().toggleOrientation();
 	// -------------
 }
@@ -2711,9 +2779,9 @@ RtVoid CBaseRenderer::scale(RtFloat dx, RtFloat dy, RtFloat dz)
 
 RtVoid CBaseRenderer::preProcess(CRiSkew &obj)
 {
-	// RtFloat det = renderState()->curTransform().getCTM().determinant();
+	// RtFloat det = renderState()->curTransform().determinant();
 	renderState()->curTransform().skew(obj.angle(), obj.dx1(), obj.dy1(), obj.dz1(), obj.dx2(), obj.dy2(), obj.dz2());
-	// if ( det * renderState()->curTransform().getCTM().determinant() < 0 )
+	// if ( det * renderState()->curTransform().determinant() < 0 )
 	//	renderState()->attributes().toggleOrientation();
 }
 
@@ -2756,10 +2824,10 @@ RtVoid CBaseRenderer::coordinateSystem(RtToken space)
 
 RtVoid CBaseRenderer::preProcess(CRiCoordSysTransform &obj)
 {
-	RtFloat det = renderState()->curTransform().getCTM().determinant();
+	RtFloat det = renderState()->curTransform().determinant();
 	renderState()->coordSysTransform(obj.space());
 	// Flip normals?
-	if (det * renderState()->curTransform().getCTM().determinant() < 0)
+	if (det * renderState()->curTransform().determinant() < 0)
 		renderState()->attributes().toggleOrientation();
 	// -------------
 }
@@ -29,6 +29,10 @@
 
 #include "ricpp/baserenderer/trianglerenderer.h"
 
+#ifndef _RICPP_TOOLS_TRACER_H
+#include "ricpp/tools/tracer.h"
+#endif // _RICPP_TOOLS_TRACER_H
+
 using namespace RiCPP;
 
 static const RtInt _TESSELATION = 16;
@@ -172,7 +176,10 @@ RtVoid CTriangleRenderer::triangulate(CTesselator &triObj)
 
 	triObj.flipNormals(flipNormals());
 
-	hideSurface(triObj.tesselate(*pdecl, *ndecl));
+	CTraceScope trace("tessellate");
+	CSurface *surf = triObj.tesselate(*pdecl, *ndecl);
+	trace.end();
+	hideSurface(surf);
 }
 
 RtVoid CTriangleRenderer::triangulate(CRiPolygon &obj)
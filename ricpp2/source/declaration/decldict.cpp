@@ -34,9 +34,28 @@
 #endif // _RICPP_RICPP_RICPPERROR_H
 
 #include <cassert>
+#include <cctype>
 
 using namespace RiCPP;
 
+/** @brief Maximal number of cached lookups, the cache is cleared if exceeded.
+ */
+static const size_t MAX_LOOKUP_CACHE = 4096;
+
+/** @brief Tests if a name can be an inline declaration.
+ *
+ * An inline declaration has at least a type and a name separated
+ * by blanks or an array specifier, plain names are rejected without parsing.
+ */
+static bool maybeInline(const char *var)
+{
+	for ( ; *var; ++var ) {
+		if ( isspace((unsigned char)*var) || *var == '[' )
+			return true;
+	}
+	return false;
+}
+
 CDeclarationDictionary::CDeclarationDictionary()
 : m_active(false)
 {
@@ -50,6 +69,7 @@ void CDeclarationDictionary::clearRemap()
 
 void CDeclarationDictionary::clear()
 {
+	clearLookupCache();
 	clearRemap();
 	m_declOldNewRemap.clear();
 	m_active.clear();
@@ -78,14 +98,49 @@ const CDeclaration *CDeclarationDictionary::find(
 	if ( emptyStr(var) )
 		return 0;
 
+	SLookupKey key(aQualifier, table, var);
+	std::map<SLookupKey, SLookupEntry>::const_iterator i = m_lookupCache.find(key);
+	if ( i != m_lookupCache.end() && (*i).second.matches(aQualifier, table, var) ) {
+		const CDeclaration *d = (*i).second.m_decl;
+		// A color declaration with other color components needs an update
+		if ( !d || !update || d->type() != TYPE_COLOR || d->colorDescr() == curColorDescr )
+			return d;
+	}
+
+	// findUncached() can clear the cache if a color declaration is updated
+	const CDeclaration *d = findUncached(aQualifier, table, var, curColorDescr, update);
+
+	if ( m_lookupCache.size() >= MAX_LOOKUP_CACHE )
+		clearLookupCache();
+
+	SLookupEntry &entry = m_lookupCache[key];
+	entry.m_qualifier = noNullStr(aQualifier);
+	entry.m_table = noNullStr(table);
+	entry.m_var = var;
+	entry.m_decl = d;
+
+	return d;
+}
+
+
+const CDeclaration *CDeclarationDictionary::findUncached(
+	const char *aQualifier,
+	const char *table,
+	const char *var,
+	const CColorDescr &curColorDescr,
+	bool update
+)
+{
 	// Test inline declaration
-	try {
-		CDeclaration d(var, curColorDescr, m_tokenMap);
-		if ( d.isInline() ) {
-			return 0;
+	if ( maybeInline(var) ) {
+		try {
+			CDeclaration d(var, curColorDescr, m_tokenMap);
+			if ( d.isInline() ) {
+				return 0;
+			}
+		} catch ( ExceptRiCPPError & ) {
+			// ok, not an inline declaration
 		}
-	} catch ( ExceptRiCPPError & ) {
-	    // ok, not an inline declaration
 	}
 		
 	const CDeclaration *d = 0;
@@ -181,6 +236,7 @@ const CDeclaration *CDeclarationDictionary::findAndUpdate(
 	if ( !newDecl )
 		throw ExceptRiCPPError(RIE_NOMEM, RIE_SEVERE, __LINE__, __FILE__, "Declaration of %s", token);
 
+	clearLookupCache();
 	m_all.push_back(newDecl);
 	m_active.unregisterObj(decl->token());
 	m_active.registerObj(newDecl->token(), newDecl);
@@ -202,6 +258,7 @@ void CDeclarationDictionary::add(CDeclaration *decl)
 	if ( !decl )
 		return;
 
+	clearLookupCache();
 	m_all.push_back(decl);
 	const CDeclaration *found = m_active.findObj(decl->token());
 	if ( found ) {
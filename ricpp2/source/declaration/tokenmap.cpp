@@ -37,19 +37,158 @@
 
 using namespace RiCPP;
 
+/** @brief Number of slots of a new hash table
+ */
+static const size_t TOKENMAP_INITIAL_SLOTS = 512;
+
+/** @brief Minimal size of a memory block for token names
+ */
+static const size_t TOKENMAP_ARENA_BLOCK = 8192;
+
+
+CTokenMap::STable::STable(size_t numSlots)
+: m_mask(numSlots-1), m_used(0), m_slots(new SSlot[numSlots])
+{
+	for ( size_t i = 0; i < numSlots; ++i ) {
+		m_slots[i].m_hash.store(0, std::memory_order_relaxed);
+		m_slots[i].m_token.store(RI_NULL, std::memory_order_relaxed);
+	}
+}
+
+
+CTokenMap::STable::~STable()
+{
+	delete [] m_slots;
+}
+
+
+CTokenMap::CTokenMap()
+: m_table(new STable(TOKENMAP_INITIAL_SLOTS)), m_arenaPos(0), m_arenaFree(0)
+{
+}
+
+
 void CTokenMap::clear()
 {
-	m_tokenMapper.clear();
-	std::list<const char *>::iterator i;
-	for ( i = m_strList.begin(); i != m_strList.end(); i++ ) {
-		if ( (*i) != 0 )
-			delete [](*i);
+	delete m_table.exchange(new STable(TOKENMAP_INITIAL_SLOTS));
+
+	std::vector<STable *>::iterator ti;
+	for ( ti = m_retired.begin(); ti != m_retired.end(); ti++ ) {
+		delete (*ti);
+	}
+	m_retired.clear();
+
+	std::vector<char *>::iterator i;
+	for ( i = m_arena.begin(); i != m_arena.end(); i++ ) {
+		delete [](*i);
 	}
+	m_arena.clear();
+	m_arenaPos = 0;
+	m_arenaFree = 0;
+
+	m_tokens.clear();
 }
 
 CTokenMap::~CTokenMap()
 {
 	clear();
+	delete m_table.load();
+}
+
+
+size_t CTokenMap::hashName(const char *name)
+{
+	size_t hash = static_cast<size_t>(14695981039346656037ULL);
+	for ( ; *name; ++name ) {
+		hash ^= static_cast<unsigned char>(*name);
+		hash *= static_cast<size_t>(1099511628211ULL);
+	}
+	return hash;
+}
+
+
+RtToken CTokenMap::findIn(const STable &table, size_t hash, const char *name)
+{
+	// The table is never full, an empty slot ends the search
+	for ( size_t i = hash & table.m_mask; ; i = (i+1) & table.m_mask ) {
+		RtToken token = table.m_slots[i].m_token.load(std::memory_order_acquire);
+		if ( token == RI_NULL )
+			return RI_NULL;
+		if ( table.m_slots[i].m_hash.load(std::memory_order_relaxed) == hash && strcmp(token, name) == 0 )
+			return token;
+	}
+}
+
+
+void CTokenMap::insert(size_t hash, RtToken token)
+{
+	STable *table = m_table.load(std::memory_order_relaxed);
+
+	// Keep the load factor below 1/2, the new table is published complete
+	if ( (table->m_used+1) * 2 > table->m_mask+1 ) {
+		STable *newTable = new STable((table->m_mask+1) * 2);
+		for ( size_t i = 0; i <= table->m_mask; ++i ) {
+			RtToken t = table->m_slots[i].m_token.load(std::memory_order_relaxed);
+			if ( t == RI_NULL )
+				continue;
+			size_t h = table->m_slots[i].m_hash.load(std::memory_order_relaxed);
+			size_t j = h & newTable->m_mask;
+			while ( newTable->m_slots[j].m_token.load(std::memory_order_relaxed) != RI_NULL )
+				j = (j+1) & newTable->m_mask;
+			newTable->m_slots[j].m_hash.store(h, std::memory_order_relaxed);
+			newTable->m_slots[j].m_token.store(t, std::memory_order_relaxed);
+		}
+		newTable->m_used = table->m_used;
+		// Concurrent readers can still use the old table
+		m_retired.push_back(table);
+		m_table.store(newTable, std::memory_order_release);
+		table = newTable;
+	}
+
+	size_t i = hash & table->m_mask;
+	for ( ; ; i = (i+1) & table->m_mask ) {
+		RtToken t = table->m_slots[i].m_token.load(std::memory_order_relaxed);
+		if ( t == RI_NULL )
+			break;
+		if ( table->m_slots[i].m_hash.load(std::memory_order_relaxed) == hash && strcmp(t, token) == 0 ) {
+			// Replace a token with the same name
+			table->m_slots[i].m_token.store(token, std::memory_order_release);
+			return;
+		}
+	}
+
+	// Hash first, the token publishes the slot
+	table->m_slots[i].m_hash.store(hash, std::memory_order_relaxed);
+	table->m_slots[i].m_token.store(token, std::memory_order_release);
+	++table->m_used;
+	m_tokens.push_back(token);
+}
+
+
+char *CTokenMap::storeName(const char *name)
+{
+	size_t size = strlen(name)+1;
+	if ( size > m_arenaFree ) {
+		size_t blockSize = size > TOKENMAP_ARENA_BLOCK ? size : TOKENMAP_ARENA_BLOCK;
+		m_arena.push_back(new char[blockSize]);
+		m_arenaPos = m_arena.back();
+		m_arenaFree = blockSize;
+	}
+	char *newtok = m_arenaPos;
+	memcpy(newtok, name, size);
+	m_arenaPos += size;
+	m_arenaFree -= size;
+	return newtok;
+}
+
+
+void CTokenMap::add(RtToken token)
+{
+	if ( emptyStr(token) )
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	insert(hashName(token), token);
 }
 
 
@@ -59,234 +198,234 @@ void CTokenMap::defaultTokens()
 
 		// Standard Tokens
 		
-		m_tokenMapper[CToken(RI_NULL)] = RI_NULL;
-
-		m_tokenMapper[CToken(RI_FRAMEBUFFER)] = RI_FRAMEBUFFER;
-		m_tokenMapper[CToken(RI_FILE)] = RI_FILE;
-
-		m_tokenMapper[CToken(RI_RGB)] = RI_RGB;
-		m_tokenMapper[CToken(RI_RGBA)] = RI_RGBA;
-		m_tokenMapper[CToken(RI_RGBZ)] = RI_RGBZ;
-		m_tokenMapper[CToken(RI_RGBAZ)] = RI_RGBAZ;
-		m_tokenMapper[CToken(RI_A)] = RI_A;
-		m_tokenMapper[CToken(RI_Z)] = RI_Z;
-		m_tokenMapper[CToken(RI_AZ)] = RI_AZ;
-
-		m_tokenMapper[CToken(RI_PERSPECTIVE)] = RI_PERSPECTIVE;
-		m_tokenMapper[CToken(RI_ORTHOGRAPHIC)] = RI_ORTHOGRAPHIC;
-
-		m_tokenMapper[CToken(RI_HIDDEN)] = RI_HIDDEN;
-		m_tokenMapper[CToken(RI_PAINT)] = RI_PAINT;
-
-		m_tokenMapper[CToken(RI_CONSTANT)] = RI_CONSTANT;
-		m_tokenMapper[CToken(RI_SMOOTH)] = RI_SMOOTH;
-
-		m_tokenMapper[CToken(RI_FLATNESS)] = RI_FLATNESS;
-
-		m_tokenMapper[CToken(RI_FOV)] = RI_FOV;
-
-		m_tokenMapper[CToken(RI_AMBIENTLIGHT)] = RI_AMBIENTLIGHT;
-		m_tokenMapper[CToken(RI_POINTLIGHT)] = RI_POINTLIGHT;
-		m_tokenMapper[CToken(RI_DISTANTLIGHT)] = RI_DISTANTLIGHT;
-		m_tokenMapper[CToken(RI_SPOTLIGHT)] = RI_SPOTLIGHT;
-
-		m_tokenMapper[CToken(RI_INTENSITY)] = RI_INTENSITY;
-		m_tokenMapper[CToken(RI_LIGHTCOLOR)] = RI_LIGHTCOLOR;
-		m_tokenMapper[CToken(RI_FROM)] = RI_FROM;
-		m_tokenMapper[CToken(RI_TO)] = RI_TO;
-		m_tokenMapper[CToken(RI_CONEANGLE)] = RI_CONEANGLE;
-		m_tokenMapper[CToken(RI_CONEDELTAANGLE)] = RI_CONEDELTAANGLE;
-		m_tokenMapper[CToken(RI_BEAMDISTRIBUTION)] = RI_BEAMDISTRIBUTION;
-
-		m_tokenMapper[CToken(RI_MATTE)] = RI_MATTE;
-		m_tokenMapper[CToken(RI_METAL)] = RI_METAL;
-		m_tokenMapper[CToken(RI_SHINYMETAL)] = RI_SHINYMETAL;
-		m_tokenMapper[CToken(RI_PLASTIC)] = RI_PLASTIC;
-		m_tokenMapper[CToken(RI_PAINTEDPLASTIC)] = RI_PAINTEDPLASTIC;
-		m_tokenMapper[CToken(RI_KA)] = RI_KA;
-		m_tokenMapper[CToken(RI_KD)] = RI_KD;
-		m_tokenMapper[CToken(RI_KS)] = RI_KS;
-		m_tokenMapper[CToken(RI_ROUGHNESS)] = RI_ROUGHNESS;
-		m_tokenMapper[CToken(RI_KR)] = RI_KR;
-		m_tokenMapper[CToken(RI_TEXTURENAME)] = RI_TEXTURENAME;
-		m_tokenMapper[CToken(RI_SPECULARCOLOR)] = RI_SPECULARCOLOR;
-
-		m_tokenMapper[CToken(RI_DEPTHCUE)] = RI_DEPTHCUE;
-		m_tokenMapper[CToken(RI_FOG)] = RI_FOG;
-
-		m_tokenMapper[CToken(RI_BUMPY)] = RI_BUMPY;
-
-		m_tokenMapper[CToken(RI_MINDISTANCE)] = RI_MINDISTANCE;
-		m_tokenMapper[CToken(RI_MAXDISTANCE)] = RI_MAXDISTANCE;
-		m_tokenMapper[CToken(RI_BACKGROUND)] = RI_BACKGROUND;
-		m_tokenMapper[CToken(RI_DISTANCE)] = RI_DISTANCE;
-		m_tokenMapper[CToken(RI_AMPLITUDE)] = RI_AMPLITUDE;
-
-		m_tokenMapper[CToken(RI_RASTER)] = RI_RASTER;
-		m_tokenMapper[CToken(RI_SCREEN)] = RI_SCREEN;
-		m_tokenMapper[CToken(RI_CAMERA)] = RI_CAMERA;
-		m_tokenMapper[CToken(RI_WORLD)] = RI_WORLD;
-		m_tokenMapper[CToken(RI_OBJECT)] = RI_OBJECT;
-
-		m_tokenMapper[CToken(RI_INSIDE)] = RI_INSIDE;
-		m_tokenMapper[CToken(RI_OUTSIDE)] = RI_OUTSIDE;
-		m_tokenMapper[CToken(RI_LH)] = RI_LH;
-		m_tokenMapper[CToken(RI_RH)] = RI_RH;
-
-		m_tokenMapper[CToken(RI_P)] = RI_P;
-		m_tokenMapper[CToken(RI_PZ)] = RI_PZ;
-		m_tokenMapper[CToken(RI_PW)] = RI_PW;
-		m_tokenMapper[CToken(RI_N)] = RI_N;
-		m_tokenMapper[CToken(RI_NP)] = RI_NP;
-		m_tokenMapper[CToken(RI_CS)] = RI_CS;
-		m_tokenMapper[CToken(RI_OS)] = RI_OS;
-		m_tokenMapper[CToken(RI_S)] = RI_S;
-		m_tokenMapper[CToken(RI_T)] = RI_T;
-		m_tokenMapper[CToken(RI_ST)] = RI_ST;
-
-		m_tokenMapper[CToken(RI_BILINEAR)] = RI_BILINEAR;
-		m_tokenMapper[CToken(RI_BICUBIC)] = RI_BICUBIC;
-
-		m_tokenMapper[CToken(RI_PRIMITIVE)] = RI_PRIMITIVE;
-		m_tokenMapper[CToken(RI_INTERSECTION)] = RI_INTERSECTION;
-		m_tokenMapper[CToken(RI_UNION)] = RI_UNION;
-		m_tokenMapper[CToken(RI_DIFFERENCE)] = RI_DIFFERENCE;
-
-		m_tokenMapper[CToken(RI_PERIODIC)] = RI_PERIODIC;
-		m_tokenMapper[CToken(RI_NONPERIODIC)] = RI_NONPERIODIC;
-		m_tokenMapper[CToken(RI_CLAMP)] = RI_CLAMP;
-		m_tokenMapper[CToken(RI_BLACK)] = RI_BLACK;
-
-		m_tokenMapper[CToken(RI_IGNORE)] = RI_IGNORE;
-		m_tokenMapper[CToken(RI_PRINT)] = RI_PRINT;
-		m_tokenMapper[CToken(RI_ABORT)] = RI_ABORT;
-		m_tokenMapper[CToken(RI_HANDLER)] = RI_HANDLER;
+		// The empty name is RI_NULL, see findCreate()
+
+		add(RI_FRAMEBUFFER);
+		add(RI_FILE);
+
+		add(RI_RGB);
+		add(RI_RGBA);
+		add(RI_RGBZ);
+		add(RI_RGBAZ);
+		add(RI_A);
+		add(RI_Z);
+		add(RI_AZ);
+
+		add(RI_PERSPECTIVE);
+		add(RI_ORTHOGRAPHIC);
+
+		add(RI_HIDDEN);
+		add(RI_PAINT);
+
+		add(RI_CONSTANT);
+		add(RI_SMOOTH);
+
+		add(RI_FLATNESS);
+
+		add(RI_FOV);
+
+		add(RI_AMBIENTLIGHT);
+		add(RI_POINTLIGHT);
+		add(RI_DISTANTLIGHT);
+		add(RI_SPOTLIGHT);
+
+		add(RI_INTENSITY);
+		add(RI_LIGHTCOLOR);
+		add(RI_FROM);
+		add(RI_TO);
+		add(RI_CONEANGLE);
+		add(RI_CONEDELTAANGLE);
+		add(RI_BEAMDISTRIBUTION);
+
+		add(RI_MATTE);
+		add(RI_METAL);
+		add(RI_SHINYMETAL);
+		add(RI_PLASTIC);
+		add(RI_PAINTEDPLASTIC);
+		add(RI_KA);
+		add(RI_KD);
+		add(RI_KS);
+		add(RI_ROUGHNESS);
+		add(RI_KR);
+		add(RI_TEXTURENAME);
+		add(RI_SPECULARCOLOR);
+
+		add(RI_DEPTHCUE);
+		add(RI_FOG);
+
+		add(RI_BUMPY);
+
+		add(RI_MINDISTANCE);
+		add(RI_MAXDISTANCE);
+		add(RI_BACKGROUND);
+		add(RI_DISTANCE);
+		add(RI_AMPLITUDE);
+
+		add(RI_RASTER);
+		add(RI_SCREEN);
+		add(RI_CAMERA);
+		add(RI_WORLD);
+		add(RI_OBJECT);
+
+		add(RI_INSIDE);
+		add(RI_OUTSIDE);
+		add(RI_LH);
+		add(RI_RH);
+
+		add(RI_P);
+		add(RI_PZ);
+		add(RI_PW);
+		add(RI_N);
+		add(RI_NP);
+		add(RI_CS);
+		add(RI_OS);
+		add(RI_S);
+		add(RI_T);
+		add(RI_ST);
+
+		add(RI_BILINEAR);
+		add(RI_BICUBIC);
+
+		add(RI_PRIMITIVE);
+		add(RI_INTERSECTION);
+		add(RI_UNION);
+		add(RI_DIFFERENCE);
+
+		add(RI_PERIODIC);
+		add(RI_NONPERIODIC);
+		add(RI_CLAMP);
+		add(RI_BLACK);
+
+		add(RI_IGNORE);
+		add(RI_PRINT);
+		add(RI_ABORT);
+		add(RI_HANDLER);
 
 		// Additional tokens
 
-		m_tokenMapper[CToken(RI_CATMULL_CLARK)] = RI_CATMULL_CLARK;
-		m_tokenMapper[CToken(RI_HOLE)] = RI_HOLE;
-		m_tokenMapper[CToken(RI_CREASE)] = RI_CREASE;
-		m_tokenMapper[CToken(RI_CORNER)] = RI_CORNER;
-		m_tokenMapper[CToken(RI_INTERPOLATEBOUNDARY)] = RI_INTERPOLATEBOUNDARY;
-		m_tokenMapper[CToken(RI_FACEINTERPOLATEBOUNDARY)] = RI_FACEINTERPOLATEBOUNDARY;
+		add(RI_CATMULL_CLARK);
+		add(RI_HOLE);
+		add(RI_CREASE);
+		add(RI_CORNER);
+		add(RI_INTERPOLATEBOUNDARY);
+		add(RI_FACEINTERPOLATEBOUNDARY);
 		
-		m_tokenMapper[CToken(RI_VERTEXEDIT)] = RI_VERTEXEDIT;
-		m_tokenMapper[CToken(RI_EDGEEDIT)] = RI_EDGEEDIT;
-		m_tokenMapper[CToken(RI_FACEEDIT)] = RI_FACEEDIT;
-		m_tokenMapper[CToken(RI_ADD)] = RI_ADD;
-		m_tokenMapper[CToken(RI_SET)] = RI_SET;
-		m_tokenMapper[CToken(RI_VALUE)] = RI_VALUE;
-		m_tokenMapper[CToken(RI_SHARPNESS)] = RI_SHARPNESS;
-		m_tokenMapper[CToken(RI_ATTRIBUTES)] = RI_ATTRIBUTES;
+		add(RI_VERTEXEDIT);
+		add(RI_EDGEEDIT);
+		add(RI_FACEEDIT);
+		add(RI_ADD);
+		add(RI_SET);
+		add(RI_VALUE);
+		add(RI_SHARPNESS);
+		add(RI_ATTRIBUTES);
 		
-		m_tokenMapper[CToken(RI_ORIGIN)] = RI_ORIGIN;
-		m_tokenMapper[CToken(RI_NAME)] = RI_NAME;
-
-		m_tokenMapper[CToken(RI_COMMENT)] = RI_COMMENT;
-		m_tokenMapper[CToken(RI_STRUCTURE)] = RI_STRUCTURE;
-		m_tokenMapper[CToken(RI_VERBATIM)] = RI_VERBATIM;
-
-		m_tokenMapper[CToken(RI_LINEAR)] = RI_LINEAR;
-		m_tokenMapper[CToken(RI_CUBIC)] = RI_CUBIC;
-
-		m_tokenMapper[CToken(RI_WIDTH)] = RI_WIDTH;
-		m_tokenMapper[CToken(RI_CONSTANTWIDTH)] = RI_CONSTANTWIDTH;
-
-		m_tokenMapper[CToken(RI_DISPXRES)] = RI_DISPXRES;
-		m_tokenMapper[CToken(RI_DISPYRES)] = RI_DISPYRES;
-		m_tokenMapper[CToken(RI_PIXELASPECT)] = RI_PIXELASPECT;
-
-		m_tokenMapper[CToken(RI_CURRENT)] = RI_CURRENT;
-		m_tokenMapper[CToken(RI_EYE)] = RI_EYE;
-		m_tokenMapper[CToken(RI_SHADER)] = RI_SHADER;
-		m_tokenMapper[CToken(RI_NDC)] = RI_NDC;
-
-		m_tokenMapper[CToken(RI_FILEPOINTER)] = RI_FILEPOINTER;
-		m_tokenMapper[CToken(RI_MEMORY)] = RI_MEMORY;
-
-		m_tokenMapper[CToken(RI_ARCHIVE)] = RI_ARCHIVE;
-		m_tokenMapper[CToken(RI_DRAFT)] = RI_DRAFT;
-		m_tokenMapper[CToken(RI_REALISTIC)] = RI_REALISTIC;
-
-		m_tokenMapper[CToken(RI_FLOAT)] = RI_FLOAT;
-		m_tokenMapper[CToken(RI_INTEGER)] = RI_INTEGER;
-		m_tokenMapper[CToken(RI_STRING)] = RI_STRING;
-		m_tokenMapper[CToken(RI_POINT)] = RI_POINT;
-		m_tokenMapper[CToken(RI_VECTOR)] = RI_VECTOR;
-		m_tokenMapper[CToken(RI_NORMAL)] = RI_NORMAL;
-		m_tokenMapper[CToken(RI_HPOINT)] = RI_HPOINT;
-		m_tokenMapper[CToken(RI_MATRIX)] = RI_MATRIX;
-		m_tokenMapper[CToken(RI_COLOR)] = RI_COLOR;
-
-		m_tokenMapper[CToken(RI_UNIFORM)] = RI_UNIFORM;
-		m_tokenMapper[CToken(RI_VARYING)] = RI_VARYING;
-		m_tokenMapper[CToken(RI_VERTEX)] = RI_VERTEX;
-		m_tokenMapper[CToken(RI_FACEVARYING)] = RI_FACEVARYING;
-		m_tokenMapper[CToken(RI_FACEVERTEX)] = RI_FACEVERTEX;
-
-		m_tokenMapper[CToken(RI_HANDLEID)] = RI_HANDLEID;
-
-		m_tokenMapper[CToken(RI_PROJECTION)] = RI_PROJECTION;
-		m_tokenMapper[CToken(RI_IMAGER)] = RI_IMAGER;
-		m_tokenMapper[CToken(RI_DISPLAY)] = RI_DISPLAY;
-		m_tokenMapper[CToken(RI_HIDER)] = RI_HIDER;
-		m_tokenMapper[CToken(RI_OPTION)] = RI_OPTION;
-		m_tokenMapper[CToken(RI_LIGHT_SOURCE)] = RI_LIGHT_SOURCE;
-		m_tokenMapper[CToken(RI_AREA_LIGHT_SOURCE)] = RI_AREA_LIGHT_SOURCE;
-		m_tokenMapper[CToken(RI_SURFACE)] = RI_SURFACE;
-		m_tokenMapper[CToken(RI_ATMOSPHERE)] = RI_ATMOSPHERE;
-		m_tokenMapper[CToken(RI_INTERIOR)] = RI_INTERIOR;
-		m_tokenMapper[CToken(RI_EXTERIOR)] = RI_EXTERIOR;
-		m_tokenMapper[CToken(RI_DISPLACEMENT)] = RI_DISPLACEMENT;
-		m_tokenMapper[CToken(RI_DEFORMATION)] = RI_DEFORMATION;
-		m_tokenMapper[CToken(RI_ATTRIBUTE)] = RI_ATTRIBUTE;
-		m_tokenMapper[CToken(RI_TEXTURE)] = RI_TEXTURE;
-		m_tokenMapper[CToken(RI_CONTROL)] = RI_CONTROL;
-		m_tokenMapper[CToken(RI_BEGIN)] = RI_BEGIN;
-		m_tokenMapper[CToken(RI_RESOURCE)] = RI_RESOURCE;
+		add(RI_ORIGIN);
+		add(RI_NAME);
+
+		add(RI_COMMENT);
+		add(RI_STRUCTURE);
+		add(RI_VERBATIM);
+
+		add(RI_LINEAR);
+		add(RI_CUBIC);
+
+		add(RI_WIDTH);
+		add(RI_CONSTANTWIDTH);
+
+		add(RI_DISPXRES);
+		add(RI_DISPYRES);
+		add(RI_PIXELASPECT);
+
+		add(RI_CURRENT);
+		add(RI_EYE);
+		add(RI_SHADER);
+		add(RI_NDC);
+
+		add(RI_FILEPOINTER);
+		add(RI_MEMORY);
+
+		add(RI_ARCHIVE);
+		add(RI_DRAFT);
+		add(RI_REALISTIC);
+
+		add(RI_FLOAT);
+		add(RI_INTEGER);
+		add(RI_STRING);
+		add(RI_POINT);
+		add(RI_VECTOR);
+		add(RI_NORMAL);
+		add(RI_HPOINT);
+		add(RI_MATRIX);
+		add(RI_COLOR);
+
+		add(RI_UNIFORM);
+		add(RI_VARYING);
+		add(RI_VERTEX);
+		add(RI_FACEVARYING);
+		add(RI_FACEVERTEX);
+
+		add(RI_HANDLEID);
+
+		add(RI_PROJECTION);
+		add(RI_IMAGER);
+		add(RI_DISPLAY);
+		add(RI_HIDER);
+		add(RI_OPTION);
+		add(RI_LIGHT_SOURCE);
+		add(RI_AREA_LIGHT_SOURCE);
+		add(RI_SURFACE);
+		add(RI_ATMOSPHERE);
+		add(RI_INTERIOR);
+		add(RI_EXTERIOR);
+		add(RI_DISPLACEMENT);
+		add(RI_DEFORMATION);
+		add(RI_ATTRIBUTE);
+		add(RI_TEXTURE);
+		add(RI_CONTROL);
+		add(RI_BEGIN);
+		add(RI_RESOURCE);
 		
-		m_tokenMapper[CToken(RI_FRAME)] = RI_FRAME;
+		add(RI_FRAME);
 
-		m_tokenMapper[CToken(RI_DEVIATION)] = RI_DEVIATION;
-		m_tokenMapper[CToken(RI_TESSELATION)] = RI_TESSELATION;
+		add(RI_DEVIATION);
+		add(RI_TESSELATION);
 
-		m_tokenMapper[CToken(RI_POINTS)] = RI_POINTS;
-		m_tokenMapper[CToken(RI_LINES)] = RI_LINES;
+		add(RI_POINTS);
+		add(RI_LINES);
 
-		m_tokenMapper[CToken(RI_SENSE)] = RI_SENSE;
+		add(RI_SENSE);
 
-		m_tokenMapper[CToken(RI_DELAYED_READ_ARCHIVE)] = RI_DELAYED_READ_ARCHIVE;
-		m_tokenMapper[CToken(RI_RUN_PROGRAM)] = RI_RUN_PROGRAM;
-		m_tokenMapper[CToken(RI_DYNAMIC_LOAD)] = RI_DYNAMIC_LOAD;
-		m_tokenMapper[CToken(RI_FREE)] = RI_FREE;
+		add(RI_DELAYED_READ_ARCHIVE);
+		add(RI_RUN_PROGRAM);
+		add(RI_DYNAMIC_LOAD);
+		add(RI_FREE);
 
-		m_tokenMapper[CToken(RI_GAUSSIAN)] = RI_GAUSSIAN;
-		m_tokenMapper[CToken(RI_BOX)] = RI_BOX;
-		m_tokenMapper[CToken(RI_TRIANGLE)] = RI_TRIANGLE;
-		m_tokenMapper[CToken(RI_SINC)] = RI_SINC;
+		add(RI_GAUSSIAN);
+		add(RI_BOX);
+		add(RI_TRIANGLE);
+		add(RI_SINC);
 
-		m_tokenMapper[CToken(RI_BEZIER)] = RI_BEZIER;
-		m_tokenMapper[CToken(RI_B_SPLINE)] = RI_B_SPLINE;
-		m_tokenMapper[CToken(RI_CATMULL_ROM)] = RI_CATMULL_ROM;
-		m_tokenMapper[CToken(RI_HERMITE)] = RI_HERMITE;
-		m_tokenMapper[CToken(RI_POWER)] = RI_POWER;
+		add(RI_BEZIER);
+		add(RI_B_SPLINE);
+		add(RI_CATMULL_ROM);
+		add(RI_HERMITE);
+		add(RI_POWER);
 
-		m_tokenMapper[CToken(RI_RESTART)] = RI_RESTART;
+		add(RI_RESTART);
 		
-		m_tokenMapper[CToken(RI_TEAPOT)] = RI_TEAPOT;
+		add(RI_TEAPOT);
 
-		m_tokenMapper[CToken(RI_BUMP)] = RI_BUMP;
-		m_tokenMapper[CToken(RI_SHADOW)] = RI_SHADOW;
-		m_tokenMapper[CToken(RI_LAT_LONG_ENVIRONMENT)] = RI_LAT_LONG_ENVIRONMENT;
-		m_tokenMapper[CToken(RI_CUBE_FACE_ENVIRONMENT)] = RI_CUBE_FACE_ENVIRONMENT;
-		m_tokenMapper[CToken(RI_BRICK_MAP)] = RI_BRICK_MAP;
+		add(RI_BUMP);
+		add(RI_SHADOW);
+		add(RI_LAT_LONG_ENVIRONMENT);
+		add(RI_CUBE_FACE_ENVIRONMENT);
+		add(RI_BRICK_MAP);
 
-		m_tokenMapper[CToken(RI_INT)] = RI_INT;
-		m_tokenMapper[CToken(RI_NULL_LIT)] = RI_NULL_LIT;
-		m_tokenMapper[CToken(RI_UNKNOWN)] = RI_UNKNOWN;
+		add(RI_INT);
+		add(RI_NULL_LIT);
+		add(RI_UNKNOWN);
 		
-		m_tokenMapper[CToken(RI_EMPTY)] = RI_NULL;	
+		// RI_EMPTY is RI_NULL as well, see findCreate()
 	} catch (...) {
 		// If there was an error, a token was not created.
 		throw ExceptRiCPPError(RIE_NOMEM, RIE_SEVERE, __LINE__, __FILE__, "Could not initialize tokenmap");
@@ -300,56 +439,43 @@ RtToken CTokenMap::findCreate(const char *name)
 	if ( !name )
 		return RI_NULL;
 
-	const_iterator iter;
-	char *newtok = 0;
+	RtToken token = find(name);
+	if ( token != RI_NULL || !*name )
+		return token;
 
-	if ( (iter = m_tokenMapper.find(name)) == m_tokenMapper.end() ) {
-		
-		// Trim leading and trailing blanks
-		std::string aName = name;
-		trimBoth(aName);
-		name = aName.c_str();
-
-		if ( (iter = m_tokenMapper.find(name)) == m_tokenMapper.end() ) {
-			try {
-				size_t size = strlen(name)+1;
-				newtok = new char[size];
-				if ( newtok ) {
-#if defined _MSC_VER
-					strcpy_s(newtok, size, name);
-#else
-					strcpy(newtok, name);
-#endif
-					m_strList.push_back(newtok);
-					m_tokenMapper[CToken(newtok)] = newtok;
-				}
-
-			} catch(...) {
-				// If there was an error, the token was not created. Handled by the next few lines.
-			}
-
-			iter = m_tokenMapper.find(CToken(name));
-			if ( iter == m_tokenMapper.end() ) {
-				if ( newtok )
-					delete[] newtok;
-				throw ExceptRiCPPError(RIE_NOMEM, RIE_SEVERE, __LINE__, __FILE__, "Could not create token \"%s\"", name);
-			}
-		}
+	// Trim leading and trailing blanks
+	std::string aName = name;
+	trimBoth(aName);
+	if ( aName.empty() )
+		return RI_NULL;
+	name = aName.c_str();
+
+	size_t hash = hashName(name);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Another thread can have created the token meanwhile
+	token = findIn(*m_table.load(std::memory_order_acquire), hash, name);
+	if ( token != RI_NULL )
+		return token;
+
+	try {
+		char *newtok = storeName(name);
+		insert(hash, newtok);
+		token = newtok;
+	} catch(...) {
+		// If there was an error, the token was not created.
+		throw ExceptRiCPPError(RIE_NOMEM, RIE_SEVERE, __LINE__, __FILE__, "Could not create token \"%s\"", name);
 	}
 
-	return iter->second;
+	return token;
 }
 
 
 RtToken CTokenMap::find(const char *name) const
 {
-	if ( !name )
-		return RI_NULL;
-
-	const_iterator iter;
-	if ( (iter = m_tokenMapper.find(CToken(name))) == m_tokenMapper.end() ) {
+	if ( emptyStr(name) )
 		return RI_NULL;
-	}
 
-	return iter->second;
+	return findIn(*m_table.load(std::memory_order_acquire), hashName(name), name);
 }
@@ -39,9 +39,44 @@
 #endif // _RICPP_TOOLS_FILEPATH_H
 
 #include <iostream>
+#include <map>
+#include <cstdio>
 
 using namespace RiCPP;
 
+static const size_t MAX_LOOKUP_CACHE = 1024;
+static std::map<std::string, bool> s_lookupCache;
+
+bool CDynLib::fileExists(const char *path)
+{
+	if ( !path || !path[0] )
+		return false;
+
+	std::map<std::string, bool>::const_iterator iter = s_lookupCache.find(path);
+	if ( iter != s_lookupCache.end() )
+		return (*iter).second;
+
+	FILE *f = 0;
+#if defined _MSC_VER
+	if ( 0 != fopen_s(&f, path, "r") )
+		f = 0;
+#else
+	f = fopen(path, "r");
+#endif
+	if ( f )
+		fclose(f);
+
+	if ( s_lookupCache.size() >= MAX_LOOKUP_CACHE )
+		s_lookupCache.clear();
+	s_lookupCache[path] = f != 0;
+	return f != 0;
+}
+
+void CDynLib::clearLookupCache()
+{
+	s_lookupCache.clear();
+}
+
 CDynLib::CDynLib(const char *aLibname, const char *aSearchpath, long int aVersion)
 	: m_useCount(0), m_version(aVersion), m_libname(aLibname), m_libpath(""), m_searchpath(':', aSearchpath, true)
 {
@@ -113,7 +113,6 @@ const char *CMacDynLib::findLib() {
 
 	m_libpath = "";
 
-	FILE *f = 0;
 	std::string strlibpath = "";
 	if ( !m_searchpath.empty() ) {
 		CStringList::const_iterator i = m_searchpath.begin();
@@ -127,8 +126,7 @@ const char *CMacDynLib::findLib() {
 			// std::cerr << "findLib() strlibpath:" << strlibpath.c_str() << std::endl;
 			CFilepath p(strlibpath.c_str());
 			// std::cerr << "findLib() p.fullpath():" << p.fullpath() << std::endl;
-			if ( 0 != (f=fopen(p.fullpath(), "r")) ) {
-				fclose(f);
+			if ( fileExists(p.fullpath()) ) {
 				m_libpath = p.fullpath();
 				// std::cerr << "findLib() m_libpath:" << m_libpath.c_str() << std::endl;
 			}
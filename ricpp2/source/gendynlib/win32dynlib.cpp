@@ -123,17 +123,8 @@ const char *CWin32DynLib::findLib() {
 				if ( strlibpath[strlibpath.size()-1] != '/' )
 					strlibpath += "/";
 			strlibpath += dllname;
-			FILE *f = NULL;
 			CFilepath p(strlibpath.c_str());
-			if (
-#if defined _MSC_VER
-					(0 == fopen_s(&f, p.fullpath(), "r"))
-#else
-					0 != (f = fopen(p.fullpath(), "r"))
-#endif
-				)
-			{
-				fclose(f);
+			if ( fileExists(p.fullpath()) ) {
 				m_libpath = p.fullpath();
 				break;
 			}
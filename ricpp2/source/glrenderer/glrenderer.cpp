@@ -27,6 +27,11 @@
  *  @brief Implementation of a context to do some draft OpenGL rendering
  */
 
+#if !defined _WIN32 && !defined GL_GLEXT_PROTOTYPES
+// Declares the buffer object functions of OpenGL 1.5
+#define GL_GLEXT_PROTOTYPES
+#endif
+
 #include "ricpp/glrenderer/glrenderer.h"
 
 #ifndef _RICPP_RICONTEXT_RIMACRO_H
@@ -34,6 +39,7 @@
 #endif // _RICPP_RICONTEXT_RIMACRO_H
 
 #include <iostream>
+#include <cstdio>
 
 using namespace RiCPP;
 
@@ -47,6 +53,11 @@ using namespace RiCPP;
 
 #define _OPENGL_TRANSFORM
 
+#if defined GL_VERSION_1_5 && !defined _WIN32
+// Vertex buffer objects can be used, display lists otherwise
+#define _OPENGL_VBO
+#endif
+
 static const bool _DRAWNORMALS = false;
 static const bool _USESTRIPS = false;
 
@@ -74,11 +85,18 @@ CGLRenderer::CGLRenderer() : m_validGL(false), m_drawNormals(_DRAWNORMALS)
 	RI_QUAL_SCREEN = RI_NULL;
 	RI_DRAW_NORMALS = RI_NULL;
 	RI_QUAL_DRAW_NORMALS = RI_NULL;
+	RI_RETAINED = RI_NULL;
+	RI_QUAL_RETAINED = RI_NULL;
 	m_autoScreen = true;
+	m_hasVBO = false;
+	m_retainedMode = RETAINED_AUTO;
+	m_worldCount = 0;
 }
 
 CGLRenderer::~CGLRenderer()
 {
+	if ( valid() )
+		clearRetained();
 }
 
 void CGLRenderer::defaultDeclarations()
@@ -92,6 +110,9 @@ void CGLRenderer::defaultDeclarations()
 
 	RI_DRAW_NORMALS = renderState()->tokFindCreate("draw-normals");
 	RI_QUAL_DRAW_NORMALS = renderState()->declare("Attribute:glrenderer:draw-normals",  "integer",  true);	
+
+	RI_RETAINED = renderState()->tokFindCreate("retained");
+	RI_QUAL_RETAINED = renderState()->declare("Control:glrenderer:retained",  "string",  true);	
 }
 
 void CGLRenderer::clearScreen()
@@ -187,6 +208,184 @@ void CGLRenderer::drawNormals(const std::vector<RtFloat> &p, const std::vector<R
 		glDepthMask(GL_FALSE);
 }
 
+void CGLRenderer::drawElements(const CFace &f, bool fromBuffer)
+{
+	// The indices are read from the bound element array buffer or from client memory
+	GLenum mode;
+	switch ( f.faceType() ) {
+		case FACETYPE_TRIANGLES:
+			mode = GL_TRIANGLES;
+		break;
+
+		case FACETYPE_TRIANGLESTRIPS:
+			mode = GL_TRIANGLE_STRIP;
+		break;
+
+		default:
+			// std::cout << "# *** Unhandled face type" << std::endl;
+		return;
+	}
+
+	// std::cout << "# *** Size of indices: " << f.indices().size() << std::endl;
+	IndexType sizeCnt = 0;
+	for ( std::vector<IndexType>::const_iterator siter = f.sizes().begin(); siter != f.sizes().end(); siter++ ) {
+		if ( fromBuffer )
+			glDrawElements(mode, (*siter), GL_UNSIGNED_INT, reinterpret_cast<const GLvoid *>(sizeCnt * sizeof(IndexType)));
+		else
+			glDrawElements(mode, (*siter), GL_UNSIGNED_INT, &f.indices()[sizeCnt]);
+		sizeCnt += (*siter);
+	}
+}
+
+bool CGLRenderer::retainFace(SRetainedFace &r, const CFace &f, const std::vector<RtFloat> &p, const std::vector<RtFloat> *n, bool useVBO)
+{
+#if defined _OPENGL_VBO
+	if ( useVBO ) {
+		GLsizeiptr pSize = static_cast<GLsizeiptr>(p.size() * sizeof(RtFloat));
+		GLsizeiptr nSize = n ? static_cast<GLsizeiptr>(n->size() * sizeof(RtFloat)) : 0;
+
+		glGenBuffers(1, &r.m_vertexBuffer);
+		glGenBuffers(1, &r.m_indexBuffer);
+		if ( !r.m_vertexBuffer || !r.m_indexBuffer ) {
+			releaseRetained(r);
+			return false;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, r.m_vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, pSize + nSize, 0, GL_STATIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, pSize, &p[0]);
+		if ( n )
+			glBufferSubData(GL_ARRAY_BUFFER, pSize, nSize, &(*n)[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.m_indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(f.indices().size() * sizeof(IndexType)), &f.indices()[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		r.m_normalOffset = static_cast<size_t>(pSize);
+		r.m_hasNormals = n != 0;
+		return true;
+	}
+#endif
+
+	r.m_displayList = glGenLists(1);
+	if ( !r.m_displayList )
+		return false;
+
+	// The client arrays are read while compiling, the colors are not part of the list
+	glDisableClientState(GL_COLOR_ARRAY);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, &p[0]);
+	if ( n ) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, &(*n)[0]);
+	} else {
+		glDisableClientState(GL_NORMAL_ARRAY);
+	}
+
+	glNewList(r.m_displayList, GL_COMPILE);
+	drawElements(f, false);
+	glEndList();
+
+	r.m_hasNormals = n != 0;
+	return true;
+}
+
+bool CGLRenderer::drawRetained(const CFace &f, const std::vector<RtFloat> &p, const std::vector<RtFloat> *n, const std::vector<RtFloat> *colors)
+{
+	if ( m_retainedMode == RETAINED_OFF || p.empty() || f.indices().empty() )
+		return false;
+
+	bool useVBO = m_hasVBO && m_retainedMode == RETAINED_AUTO;
+
+	// A face is retained if it is drawn the second time, faces drawn once are not uploaded
+	std::pair<TypeRetainedFaces::iterator, bool> ins = m_retainedFaces.insert(TypeRetainedFaces::value_type(f.serial(), SRetainedFace()));
+	SRetainedFace &r = (*ins.first).second;
+	r.m_lastWorld = m_worldCount;
+	if ( ins.second )
+		return false;
+
+	if ( !r.m_vertexBuffer && !r.m_displayList ) {
+		// Display lists would contain the colors per vertex
+		if ( colors && !useVBO )
+			return false;
+		if ( !retainFace(r, f, p, n, useVBO) )
+			return false;
+	}
+
+	if ( r.m_displayList ) {
+		if ( colors )
+			return false;
+		glCallList(r.m_displayList);
+		return true;
+	}
+
+#if defined _OPENGL_VBO
+	glBindBuffer(GL_ARRAY_BUFFER, r.m_vertexBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+	if ( r.m_hasNormals ) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, reinterpret_cast<const GLvoid *>(r.m_normalOffset));
+	} else {
+		glDisableClientState(GL_NORMAL_ARRAY);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if ( colors ) {
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(3, GL_FLOAT, 0, &(*colors)[0]);
+	} else {
+		glDisableClientState(GL_COLOR_ARRAY);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.m_indexBuffer);
+	drawElements(f, true);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void CGLRenderer::releaseRetained(SRetainedFace &r)
+{
+#if defined _OPENGL_VBO
+	if ( r.m_vertexBuffer )
+		glDeleteBuffers(1, &r.m_vertexBuffer);
+	if ( r.m_indexBuffer )
+		glDeleteBuffers(1, &r.m_indexBuffer);
+#endif
+	if ( r.m_displayList )
+		glDeleteLists(r.m_displayList, 1);
+
+	r.m_vertexBuffer = 0;
+	r.m_indexBuffer = 0;
+	r.m_displayList = 0;
+}
+
+void CGLRenderer::sweepRetained()
+{
+	// Releases the faces not drawn within the current world block, their geometry has changed
+	TypeRetainedFaces::iterator iter = m_retainedFaces.begin();
+	while ( iter != m_retainedFaces.end() ) {
+		if ( (*iter).second.m_lastWorld != m_worldCount ) {
+			releaseRetained((*iter).second);
+			m_retainedFaces.erase(iter++);
+		} else {
+			++iter;
+		}
+	}
+}
+
+void CGLRenderer::clearRetained()
+{
+	for ( TypeRetainedFaces::iterator iter = m_retainedFaces.begin(); iter != m_retainedFaces.end(); iter++ ) {
+		releaseRetained((*iter).second);
+	}
+	m_retainedFaces.clear();
+}
+
 void CGLRenderer::hide(const CFace &f)
 {
 	const TemplPrimVar<RtFloat> *pptr = f.floats(RI_P);
@@ -219,15 +418,11 @@ void CGLRenderer::hide(const CFace &f)
 	setCullFace();
 	setColor();
 
-	// vertexArray
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_FLOAT, 0, &(*pp)[0]);
-	
-	// normalArray
+	// normals per vertex or a normal for the face
+	const std::vector<RtFloat> *normals = 0;
 	if ( np ) {
-		if ( np->size() == np->size() ) {
-			glEnableClientState(GL_NORMAL_ARRAY);
-			glNormalPointer(GL_FLOAT, 0, &(*np)[0]);
+		if ( np->size() == pp->size() ) {
+			normals = np;
 			glEnable(GL_LIGHTING);
 			glEnable(GL_LIGHT0);
 		} else if ( np->size() == 3 ) {
@@ -251,40 +446,40 @@ void CGLRenderer::hide(const CFace &f)
 		getCs(pcSurf->declaration().colorDescr(), renderState()->options().gain(), renderState()->options().gamma(), pcSurf->values(), cs);
 	}
 
+	const std::vector<RtFloat> *colors = 0;
 	if ( cs.size() == 3 ) {
 		RtFloat alpha = opacityToAlpha(attributes().opacity());
 		glColor4f(cs[0], cs[1], cs[2], alpha);		
 	} else if ( cs.size() == pp->size() ) {
-		glEnableClientState(GL_COLOR_ARRAY);
-		glColorPointer(3, GL_FLOAT, 0, &cs[0]);
+		colors = &cs;
 		if ( replayMode()  ) 
 			glDepthMask(GL_TRUE);
 	}
 
-	// Draw vertices
-	// std::cout << "# *** Size of indices: " << f.indices().size() << std::endl;
-	IndexType sizeCnt = 0;
-	switch ( f.faceType() ) {
-		case FACETYPE_TRIANGLES: {
-			for ( std::vector<IndexType>::const_iterator siter = f.sizes().begin(); siter != f.sizes().end(); siter++ ) {
-				glDrawElements(GL_TRIANGLES, (*siter), GL_UNSIGNED_INT, &f.indices()[sizeCnt]);
-				sizeCnt += (*siter);
-			}
-		}
-		break;
-			
-		case FACETYPE_TRIANGLESTRIPS: {
-			for ( std::vector<IndexType>::const_iterator siter = f.sizes().begin(); siter != f.sizes().end(); siter++ ) {
-				glDrawElements(GL_TRIANGLE_STRIP, (*siter), GL_UNSIGNED_INT, &f.indices()[sizeCnt]);
-				sizeCnt += (*siter);
-			}
-		}
-		break;
-			
-		default:
-			// std::cout << "# *** Unhandled face type" << std::endl;
-		break;
+#if defined _OPENGL_TRANSFORM
+	// Positions and normals are in object space and can be retained
+	if ( drawRetained(f, *pp, normals, colors) )
+		return;
+#endif
+
+	// vertexArray
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, &(*pp)[0]);
+	
+	// normalArray
+	if ( normals ) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, &(*normals)[0]);
 	}
+
+	// colorArray
+	if ( colors ) {
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(3, GL_FLOAT, 0, &(*colors)[0]);
+	}
+
+	// Draw vertices
+	drawElements(f, false);
 	
 	// reset state
 	/*
@@ -381,6 +576,17 @@ void CGLRenderer::initGLContext()
 #else
 	m_validGL = true;
 #endif
+
+#if defined _OPENGL_VBO
+	// Vertex buffer objects are core since OpenGL 1.5
+	if ( m_validGL && !m_hasVBO ) {
+		const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+		int major = 0, minor = 0;
+		if ( version && sscanf(version, "%d.%d", &major, &minor) == 2 ) {
+			m_hasVBO = major > 1 || (major == 1 && minor >= 5);
+		}
+	}
+#endif
 }
 
 void CGLRenderer::setColor()
@@ -696,6 +902,24 @@ RtVoid CGLRenderer::doProcess(CRiControl &obj)
 						m_autoScreen = true;
 					}
 				}
+			} else if ( (*i).var() == RI_RETAINED ) {
+				std::string mode;
+				if ( (*i).get(0, mode) ) {
+					EnumRetainedMode newMode = m_retainedMode;
+					if ( mode == std::string("auto") ) {
+						newMode = RETAINED_AUTO;
+					} else if ( mode == std::string("displaylists") ) {
+						newMode = RETAINED_DISPLAYLISTS;
+					} else if ( mode == std::string("off") ) {
+						newMode = RETAINED_OFF;
+					}
+					if ( newMode != m_retainedMode ) {
+						// Retained faces are rebuilt in the new mode
+						if ( valid() )
+							clearRetained();
+						m_retainedMode = newMode;
+					}
+				}
 			}
 		}
 	}
@@ -704,6 +928,7 @@ RtVoid CGLRenderer::doProcess(CRiControl &obj)
 RtVoid CGLRenderer::doProcess(CRiWorldBegin &obj)
 {
 	TypeParent::doProcess(obj);
+	++m_worldCount;
 
 	if ( m_autoScreen )
 		clearScreen();
@@ -733,6 +958,7 @@ RtVoid CGLRenderer::doProcess(CRiWorldEnd &obj)
 	glDepthMask(GL_FALSE);
 
 	replayDelayed();
+	sweepRetained();
 	
 	glDisable(GL_ALPHA_TEST);
 	glDisable(GL_BLEND);
@@ -69,6 +69,66 @@ class CDeclarationDictionary
 	
 	CTokenMap m_tokenMap;              ///< Registered tokens
 
+	/** @brief Key of the lookup cache, addresses of qualifier, table and variable name.
+	 *
+	 * The names are normally tokens, so their addresses identify them.
+	 */
+	struct SLookupKey {
+		const char *m_qualifier; ///< Qualifier as passed to find()
+		const char *m_table;     ///< Table as passed to find()
+		const char *m_var;       ///< Variable name as passed to find()
+
+		inline SLookupKey(const char *aQualifier, const char *aTable, const char *aVar)
+		: m_qualifier(aQualifier), m_table(aTable), m_var(aVar)
+		{
+		}
+
+		inline bool operator<(const SLookupKey &key) const
+		{
+			if ( m_var != key.m_var )
+				return m_var < key.m_var;
+			if ( m_table != key.m_table )
+				return m_table < key.m_table;
+			return m_qualifier < key.m_qualifier;
+		}
+	};
+
+	/** @brief Cached result of a lookup.
+	 *
+	 * The strings are kept to verify a hit, because the address of
+	 * a name that is not a token can be reused for a different name.
+	 */
+	struct SLookupEntry {
+		std::string m_qualifier;   ///< Copy of the qualifier
+		std::string m_table;       ///< Copy of the table
+		std::string m_var;         ///< Copy of the variable name
+		const CDeclaration *m_decl; ///< Resolved declaration, 0 for not found or inline declarations
+
+		inline SLookupEntry() : m_decl(0) {}
+
+		inline bool matches(const char *aQualifier, const char *aTable, const char *aVar) const
+		{
+			return m_var == aVar && m_table == noNullStr(aTable) && m_qualifier == noNullStr(aQualifier);
+		}
+	};
+
+	/** @brief Resolved declarations of find().
+	 *
+	 * Cleared, whenever the active declarations change.
+	 */
+	std::map<SLookupKey, SLookupEntry> m_lookupCache;
+
+	/** @brief Searches a declaration without using the lookup cache.
+	 * @see find(const char *, const char *, const char *, const CColorDescr &, bool)
+	 */
+	const CDeclaration *findUncached(
+		const char *aQualifier,
+		const char *table,
+		const char *var,
+		const CColorDescr &curColorDescr,
+		bool update
+	);
+
 public:
 	/** @brief Const iterator for the elements.
 	 */
@@ -122,6 +182,9 @@ public:
 	 *  <li> var </li>
 	 *  </ol>
 	 *
+	 *  The results (also for inline declarations and unknown names) are cached
+	 *  until the active declarations change.
+	 *
 	 * @param aQualifier The qualifer
 	 * @param table The table
 	 * @param var The stripped name of the variable
@@ -220,6 +283,10 @@ public:
 	CDeclarationDictionary &assignRemap(const CDeclarationDictionary &declDict);
 	CDeclaration *remapDecl(const CDeclaration *oldDecl);
 	void clearRemap();
+
+	/** @brief Clears the cache of the resolved declarations of find().
+	 */
+	inline void clearLookupCache() { m_lookupCache.clear(); }
 }; // CDeclarationDictionary
 
 } // namespace RiCPP
@@ -34,30 +34,111 @@
 #include "ricpp/declaration/token.h"
 #endif // _RICPP_DECLARATION_TOKEN_H
 
-#include <map>
+#include <atomic>
 #include <list>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace RiCPP {
 
 /** @brief A tokenmap to create unique tokens for strings.
+ *
+ *  The tokens are kept in an open addressing hash table (linear probing)
+ *  with the hash values of the names stored in the slots. The names of
+ *  created tokens are stored in memory blocks (arena) that are freed
+ *  with the map.
+ *
+ *  find() and the lookup part of findCreate() do not lock, they can be called
+ *  concurrently by several threads. The creation of new tokens is serialized by
+ *  a mutex. A table that was replaced by a larger one is kept until the map is
+ *  cleared, so concurrent readers never see freed memory. clear(), begin(), end()
+ *  and size() must not be used while other threads create tokens.
+ *
  *  @see CToken
  */
 class CTokenMap {
-	std::map<CToken, RtToken> m_tokenMapper; ///< @brief Maps a token name to its id
-	std::list<const char *> m_strList;       ///< @brief List of strings to delete at destructor
+	/** @brief Slot of the hash table.
+	 */
+	struct SSlot {
+		std::atomic<size_t> m_hash;    ///< @brief Hash value of the token name
+		std::atomic<RtToken> m_token;  ///< @brief Token (is also the name), RI_NULL if the slot is empty
+	};
+
+	/** @brief Hash table, the number of slots is a power of 2.
+	 */
+	struct STable {
+		size_t m_mask;    ///< @brief Number of slots - 1
+		size_t m_used;    ///< @brief Number of used slots
+		SSlot *m_slots;   ///< @brief The slots
+
+		/** @brief Creates an empty table.
+		 * @param numSlots Number of slots, must be a power of 2
+		 */
+		STable(size_t numSlots);
+
+		/** @brief Destructor, frees the slots.
+		 */
+		~STable();
+	};
+
+	std::atomic<STable *> m_table;      ///< @brief Current hash table, read without locking
+	std::vector<STable *> m_retired;    ///< @brief Replaced hash tables, freed by clear()
+	std::vector<RtToken> m_tokens;      ///< @brief Tokens in the order of their creation
+	std::vector<char *> m_arena;        ///< @brief Memory blocks of the token names
+	char *m_arenaPos;                   ///< @brief Next free char in the last memory block
+	size_t m_arenaFree;                 ///< @brief Free chars in the last memory block
+	std::mutex m_mutex;                 ///< @brief Serializes the creation of tokens
+
+	/** @brief Calculates the hash value of a name (FNV-1a).
+	 * @param name The name, not 0.
+	 * @return Hash value of @a name.
+	 */
+	static size_t hashName(const char *name);
+
+	/** @brief Searches a token in a table.
+	 * @param table The table to search.
+	 * @param hash Hash value of @a name.
+	 * @param name The name of the token.
+	 * @return The token, RI_NULL if not found.
+	 */
+	static RtToken findIn(const STable &table, size_t hash, const char *name);
+
+	/** @brief Inserts a token, the mutex must be locked.
+	 *
+	 *  An existing token with the same name is replaced.
+	 *
+	 * @param hash Hash value of @a token.
+	 * @param token The token to insert.
+	 */
+	void insert(size_t hash, RtToken token);
+
+	/** @brief Copies a name to the memory blocks, the mutex must be locked.
+	 * @param name The name to copy.
+	 * @return The copy of the name.
+	 */
+	char *storeName(const char *name);
+
+	/** @brief Adds a static token, used by defaultTokens().
+	 * @param token Token to add.
+	 */
+	void add(RtToken token);
+
+	CTokenMap(const CTokenMap &);             ///< @brief Not copyable
+	CTokenMap &operator=(const CTokenMap &);  ///< @brief Not assignable
 
 public:
-	/** @brief Const iterator for the token maps.
+	/** @brief Const iterator for the tokens.
 	 */
-	typedef std::map<CToken, RtToken>::const_iterator const_iterator;
+	typedef std::vector<RtToken>::const_iterator const_iterator;
 
 	/** @brief Size type of the map.
 	 */
-	typedef std::map<CToken, RtToken>::size_type size_type;
+	typedef std::vector<RtToken>::size_type size_type;
 
 	/** @brief Standard Constructor, empty map
 	 */
-	inline CTokenMap() {}
+	CTokenMap();
 
 	/** @brief Default Ri Tokens
 	 * 
@@ -71,12 +152,15 @@ public:
 	 */
 	~CTokenMap();
 
+	/** @brief Removes all tokens.
+	 */
 	void clear();
-	CTokenMap &operator=(const CTokenMap &aMap);
 
 	/** @brief Searches for a token and creates one, if the token name was not found.
 	 *
 	 *  To create a new token you can call: myToken = myMap.findCreate("tokenString");
+	 *  Leading and trailing blanks of a new token name are removed. The empty
+	 *  name is the token RI_NULL.
 	 *
 	 *  @param name A pointer to a token name, the name is copied to a new memory area,
 	 *  if a token for the string did not already exist.
@@ -93,19 +177,19 @@ public:
 	RtToken find(const char *name) const;
 	
 	/** @brief Gets the const iterator.
-	 *  @return const_iterator for the token map.
+	 *  @return const_iterator for the tokens.
 	 */
-	inline const const_iterator begin() const { return m_tokenMapper.begin(); }
+	inline const const_iterator begin() const { return m_tokens.begin(); }
 
 	/** @brief Gets the end const iterator.
-	 *  @return End condition for const_iterator for the token map.
+	 *  @return End condition for const_iterator for the tokens.
 	 */
-	inline const const_iterator end() const { return m_tokenMapper.end(); }
+	inline const const_iterator end() const { return m_tokens.end(); }
 
 	/** @brief Gets the size of the token map.
 	 *  @return Size of the token map.
 	 */
-	inline size_type size() const { return m_tokenMapper.size(); }
+	inline size_type size() const { return m_tokens.size(); }
 }; // CTokenMap
 
 } // namespace RiCPP
@@ -128,7 +128,24 @@ namespace RiCPP {
 		 * @return Used by load() to check if the library is loaded, independend of the m_useCount
 		 */
 		virtual bool isLoaded() const = 0;
+
+		/** @brief Tests if a file can be opened for reading.
+		 *
+		 *  The results are memoized, also for files that do not exist, so
+		 *  searching the same pathes again (e.g. on network drives) does not
+		 *  touch the file system.
+		 *
+		 *  @param path Full path of the file.
+		 *  @return true, if the file exists.
+		 */
+		static bool fileExists(const char *path);
 	public:
+		/** @brief Clears the memoized results of fileExists().
+		 *
+		 *  Called if a search path is changed.
+		 */
+		static void clearLookupCache();
+
 		/** @brief Object creation.
 		 *  
 		 * (done by CDynLibFactory) initialises the members
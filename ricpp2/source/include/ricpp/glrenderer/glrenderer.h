@@ -45,27 +45,67 @@
 #include <OpenGL/OpenGL.h>
 #endif
 
+#include <map>
+
 namespace RiCPP {
 
 #define GLRENDERER_NAME "glrenderer"
 #define GLRENDERERCREATOR_NAME "glrenderercreator"
 
 /** @brief Rendering context that does some draft GL rendering
+ *
+ *  Faces drawn again (e.g. if a viewer replays an archive for each
+ *  redisplay) are retained in GL objects, vertex buffer objects if the
+ *  GL context supports them (OpenGL 1.5), display lists otherwise.
+ *  Retained faces not drawn within a world block are released at its end.
+ *  The mode is set by Control "glrenderer" "retained" "auto" | "displaylists" | "off".
  */
 class CGLRenderer : public CTriangleRenderer {
 protected:
 	typedef CTriangleRenderer TypeParent;
 	
 private:
+	/** @brief Modes to retain the faces in GL objects.
+	 */
+	enum EnumRetainedMode {
+		RETAINED_OFF = 0,     ///< Faces are drawn from client memory.
+		RETAINED_AUTO,        ///< Vertex buffer objects if supported, display lists otherwise.
+		RETAINED_DISPLAYLISTS ///< Display lists.
+	};
+
+	/** @brief GL objects of a retained face.
+	 */
+	struct SRetainedFace {
+		GLuint m_vertexBuffer;     ///< Buffer object with the positions followed by the normals, 0 if not used.
+		GLuint m_indexBuffer;      ///< Buffer object with the indices, 0 if not used.
+		GLuint m_displayList;      ///< Display list, 0 if not used.
+		size_t m_normalOffset;     ///< Offset of the normals in m_vertexBuffer.
+		bool m_hasNormals;         ///< Normals per vertex are retained.
+		unsigned long m_lastWorld; ///< Number of the world block the face was drawn last.
+		inline SRetainedFace() :
+			m_vertexBuffer(0), m_indexBuffer(0), m_displayList(0),
+			m_normalOffset(0), m_hasNormals(false), m_lastWorld(0)
+		{
+		}
+	};
+
+	typedef std::map<unsigned long, SRetainedFace> TypeRetainedFaces; ///< Retained faces by CFace::serial().
+
 	RtToken RI_GLRENDERER;
 	RtToken RI_SCREEN;
 	RtToken RI_QUAL_SCREEN;
 	RtToken RI_DRAW_NORMALS;
 	RtToken RI_QUAL_DRAW_NORMALS;
+	RtToken RI_RETAINED;
+	RtToken RI_QUAL_RETAINED;
 	
 	bool m_validGL; ///< Valid GL Context found or created in initGLContext()
 	bool m_drawNormals; ///< Drawing normals for tests
 	bool m_autoScreen; // clear screen and flush at Worldbegin/End
+	bool m_hasVBO; ///< GL context supports vertex buffer objects, set in initGLContext()
+	EnumRetainedMode m_retainedMode; ///< Mode to retain the faces.
+	unsigned long m_worldCount; ///< Number of world blocks started.
+	TypeRetainedFaces m_retainedFaces; ///< Faces retained in GL objects.
 	
 	inline bool valid() const { return m_validGL; }
 	inline void valid(bool setValid) { m_validGL = setValid; }
@@ -84,6 +124,13 @@ private:
 	void drawNormals(const std::vector<RtFloat> &p, const std::vector<RtFloat> &n);
 	void setTransformToCamera();
 
+	void drawElements(const CFace &f, bool fromBuffer);
+	bool retainFace(SRetainedFace &r, const CFace &f, const std::vector<RtFloat> &p, const std::vector<RtFloat> *n, bool useVBO);
+	bool drawRetained(const CFace &f, const std::vector<RtFloat> &p, const std::vector<RtFloat> *n, const std::vector<RtFloat> *colors);
+	void releaseRetained(SRetainedFace &r);
+	void sweepRetained();
+	void clearRetained();
+
 protected:
 	virtual void defaultDeclarations();
 
@@ -52,6 +52,7 @@
 #endif
 
 #include <map>
+#include <mutex>
 #include <cstdarg>
 
 namespace RiCPP {
@@ -77,6 +78,15 @@ void RiCPPRoot(IRi *aRoot);
   */
 RtInt RiCPPGetArgs(va_list marker, RtToken **tokens, RtPointer **params);
 
+/** @brief Mutex that guards the maps of the slots.
+ *
+ *  The slots (CFilterSlot, CErrorHandlerSlot, ...) are shared by all threads
+ *  that use the C binding.
+ *
+ *  @return The mutex of the slot maps
+ */
+std::mutex &RiCPPSlotMutex();
+
 /** @brief Calls the IRi::beginV() routine
  *
  *  riprog and ridynload implement the normal RiBegin() and additional
@@ -123,6 +133,7 @@ public:
 		else if ( function == RiSincFilter )
 			return ri ? ri->sincFilter() : CSincFilter::func;
 
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		ms_filters[function] = CFilterSlot(function);
 		return ms_filters[function];
 	}
@@ -174,6 +185,7 @@ public:
 			return ri ? ri->errorIgnore() : CIgnoreErrorHandler::func();
 
 		// Use the C function if not a standard handler
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		ms_errorHandlers[function] = CErrorHandlerSlot(function);
 		return ms_errorHandlers[function];
 	}
@@ -216,6 +228,7 @@ public:
 	inline virtual const IArchiveCallback &singleton() const { return *this; }
 	inline static const IArchiveCallback &getSingleton(RtArchiveCallback function)
 	{
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		ms_callbacks[function] = CArchiveCallbackSlot(function);
 		return ms_callbacks[function];
 	}
@@ -260,11 +273,13 @@ public:
 	inline virtual ISubdivData &singleton() { return *this; }
 	inline static ISubdivData &getSingleton(RtPointer theData)
 	{
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		ms_data[theData] = CSubdivDataSlot(theData);
 		return ms_data[theData];
 	}
 
 	inline static bool erase(RtPointer theData) {
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		bool found = ms_data.find(theData) != ms_data.end();
 		ms_data.erase(theData);
 		return found;
@@ -300,6 +315,7 @@ public:
 		else if ( function == RiProcDynamicLoad )
 			return ri ? ri->procDynamicLoad() : CProcDynamicLoad::func;
 
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		ms_procs[function] = CSubdivFuncSlot(function);
 		return ms_procs[function];
 	}
@@ -353,6 +369,7 @@ public:
 		if ( function == RiProcFree )
 			return ri ? ri->procFree() : CProcFree::func;
 
+		std::lock_guard<std::mutex> lock(RiCPPSlotMutex());
 		ms_procs[function] = CFreeFuncSlot(function);
 		return ms_procs[function];
 	}
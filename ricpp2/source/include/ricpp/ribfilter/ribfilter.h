@@ -42,8 +42,12 @@
 #include "ricpp/ricpp/riroot.h"
 #endif // _RICPP_RICPP_RIROOT_H
 
+#include <typeinfo>
+
 namespace RiCPP {
 
+class CRibFilterList;
+
 /** @brief Root class for RIB filters and stub for CRiCPPBridge
  */
 class CRibFilter : public IRiRoot, public IPlugin {
@@ -51,9 +55,14 @@ class CRibFilter : public IRiRoot, public IPlugin {
 	friend class CRibFilterList;
 
 	IRiRoot *m_next; ///< Next filter to call, can also point to the frontend.
+	CRibFilterList *m_list; ///< List of the filter, is notified if the state of the filter changes.
 	bool m_suspended; ///< Rib requests are suspended until resume() is called
 	bool m_enabled[N_REQUESTS]; ///< Used to disable/enable selected requests
 
+	/** @brief The state of the filter has changed, the list has to update its dispatch table.
+	 */
+	void changed();
+
 	/** @brief beginV() is not a RIB request.
 	 */
 	inline RtContextHandle beginV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[]) { return illContextHandle; }
@@ -100,7 +109,7 @@ public:
 	/** @brief Constructor, enables all requests
 	 */
 	inline CRibFilter()
-		: m_next(0), m_suspended(false)
+		: m_next(0), m_list(0), m_suspended(false)
 	{
 		for ( int i = 0; i < N_REQUESTS; ++i )
 			m_enabled[i] = true;
@@ -138,11 +147,11 @@ public:
 
 	/** @brief Stop the transfering of RIB calls until resume().
 	 */
-	inline virtual void suspend() { m_suspended = true; }
+	inline virtual void suspend() { m_suspended = true; changed(); }
 
 	/** @brief Continue the transfering of RIB calls.
 	 */
-	inline virtual void resume() { m_suspended = false; }
+	inline virtual void resume() { m_suspended = false; changed(); }
 
 	/** @brief Tests if a certain command is enabled.
 	 *  @param req Number of a request (REQ_...-constant)
@@ -159,12 +168,25 @@ public:
 	/** @brief Enables a certain command.
 	 *  @param req Number of the request (REQ_...-constant) to enable.
 	 */
-	inline virtual void enable(EnumRequests req) { m_enabled[req] = true; }
+	inline virtual void enable(EnumRequests req) { m_enabled[req] = true; changed(); }
 
 	/** @brief Disables a certain command.
 	 *  @param req Number of the request (REQ_...-constant) to disable.
 	 */
-	inline virtual void disable(EnumRequests req) { m_enabled[req] = false; }
+	inline virtual void disable(EnumRequests req) { m_enabled[req] = false; changed(); }
+
+	/** @brief Tests if the filter only forwards a certain request.
+	 *
+	 *  A forwarding filter calls callee() with the unchanged request, if
+	 *  canCall() is true. CRibFilterList skips these filters if they can call
+	 *  the request; their state is read again only after suspend(), resume(),
+	 *  enable() or disable(). The plain CRibFilter forwards all requests,
+	 *  derived filters can overwrite this function for the requests they don't change.
+	 *
+	 *  @param req Number of a request (REQ_...-constant)
+	 *  @return true, the filter only forwards the request.
+	 */
+	inline virtual bool forwarding(EnumRequests req) const { return typeid(*this) == typeid(CRibFilter); }
 
 	/** @brief Interface that is called.
 	 *  @return Pointer to the RenderMan interrface that is called by this filter.
@@ -36,23 +36,701 @@
 
 namespace RiCPP {
 
+/** @brief Calls the RIB filters of a CRibFilterList.
+ *
+ *  A request is called directly at the first filter that handles it,
+ *  filters that would only forward the request are skipped (see
+ *  CRibFilter::forwarding()). The table of the handlers is filled by
+ *  CRibFilterList::updateDispatch(), if the list or the state of one of
+ *  its filters changes.
+ */
+class CRibFilterDispatch : public IRiRoot {
+	friend class CRibFilterList;
+
+	IRiRoot *m_first; ///< First filter of the list, called for the requests that are not part of the RIB binding.
+	IRiRoot *m_handler[N_REQUESTS]; ///< Interface called first for a request (REQ_...-constant).
+
+	/** @brief Constructor, the table is filled by the list.
+	 */
+	inline CRibFilterDispatch() : m_first(0)
+	{
+		for ( int i = 0; i < N_REQUESTS; ++i )
+			m_handler[i] = 0;
+	}
+
+	/** @brief beginV() is not a RIB request.
+	 */
+	inline RtContextHandle beginV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[]) { return illContextHandle; }
+
+	/** @brief end() is not a RIB request.
+	 */
+	inline RtVoid end(void) {}
+
+public:
+	/** @brief Virtual destructor
+	 */
+	inline virtual ~CRibFilterDispatch() {}
+
+	/** @brief Interface that is called first for a request.
+	 *  @param req Number of a request (REQ_...-constant)
+	 *  @return Pointer to the first filter, that does not only forward @a req, or to the frontend.
+	 */
+	inline IRiRoot *handler(EnumRequests req) const { return m_handler[req]; }
+
+	/* ********************************************************************* */
+	/** @defgroup ricpp_ridispatch Dispatched ri calls
+	 *  @{
+	 */
+	inline virtual RtToken declare(RtToken aName, RtString declaration)
+	{
+		return m_handler[REQ_DECLARE]->declare(aName, declaration);
+	}
+
+ 	inline virtual RtVoid errorHandler(const IErrorHandler &handler)
+	{
+		m_handler[REQ_ERROR_HANDLER]->errorHandler(handler);
+	}
+
+	inline virtual RtInt lastError()
+	{
+		return m_first->lastError();
+	}
+
+	inline virtual RtVoid synchronize(RtToken aName)
+	{
+		m_handler[REQ_SYNCHRONIZE]->synchronize(aName);
+	}
+
+	inline virtual RtVoid system(RtString cmd)
+	{
+		m_handler[REQ_SYSTEM]->system(cmd);
+	}
+
+    inline virtual RtVoid controlV(RtToken aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		// Control is not a part of the RIB binding, the first filter decides.
+		m_first->controlV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid version()
+	{
+		m_handler[REQ_VERSION]->version();
+	}
+
+	inline virtual RtVoid resourceV(RtToken handle, RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_RESOURCE]->resourceV(handle, type, n, tokens, params);
+	}
+
+	inline virtual RtVoid frameBegin(RtInt number)
+	{
+		m_handler[REQ_FRAME_BEGIN]->frameBegin(number);
+	}
+
+	inline virtual RtVoid frameEnd(void)
+	{
+		m_handler[REQ_FRAME_END]->frameEnd();
+	}
+
+	inline virtual RtVoid worldBegin(void)
+	{
+		m_handler[REQ_WORLD_BEGIN]->worldBegin();
+	}
+
+	inline virtual RtVoid worldEnd(void)
+	{
+		m_handler[REQ_WORLD_END]->worldEnd();
+	}
+
+	inline virtual RtVoid attributeBegin(void)
+	{
+		m_handler[REQ_ATTRIBUTE_BEGIN]->attributeBegin();
+	}
+	
+	inline virtual RtVoid attributeEnd(void)
+	{
+		m_handler[REQ_ATTRIBUTE_END]->attributeEnd();
+	}
+
+	inline virtual RtVoid transformBegin(void)
+	{
+		m_handler[REQ_TRANSFORM_BEGIN]->transformBegin();
+	}
+
+	inline virtual RtVoid transformEnd(void)
+	{
+		m_handler[REQ_TRANSFORM_END]->transformEnd();
+	}
+
+	inline virtual RtVoid solidBegin(RtToken type)
+	{
+		m_handler[REQ_SOLID_BEGIN]->solidBegin(type);
+	}
+
+	inline virtual RtVoid solidEnd(void)
+	{
+		m_handler[REQ_SOLID_END]->solidEnd();
+	}
+
+	inline virtual RtObjectHandle objectBegin(RtString aName)
+	{
+		return m_handler[REQ_OBJECT_BEGIN]->objectBegin(aName);
+	}
+
+	inline virtual RtVoid objectEnd(void)
+	{
+		m_handler[REQ_OBJECT_END]->objectEnd();
+	}
+
+    inline virtual RtVoid objectInstance(RtObjectHandle handle)
+	{
+		m_handler[REQ_OBJECT_INSTANCE]->objectInstance(handle);
+	}
+    
+    inline virtual RtVoid motionBeginV(RtInt N, RtFloat times[])
+	{
+		m_handler[REQ_MOTION_BEGIN]->motionBeginV(N, times);
+	}
+
+	inline virtual RtVoid motionEnd(void)
+	{
+		m_handler[REQ_MOTION_END]->motionEnd();
+	}
+
+	inline virtual RtVoid resourceBegin(void)
+	{
+		m_handler[REQ_RESOURCE_BEGIN]->resourceBegin();
+	}
+
+	inline virtual RtVoid resourceEnd(void)
+	{
+		m_handler[REQ_RESOURCE_END]->resourceEnd();
+	}
+
+	inline virtual RtArchiveHandle archiveBeginV(RtToken aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		return m_handler[REQ_ARCHIVE_BEGIN]->archiveBeginV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid archiveEnd(void)
+	{
+		m_handler[REQ_ARCHIVE_END]->archiveEnd();
+	}
+
+	inline virtual RtVoid format(RtInt xres, RtInt yres, RtFloat aspect)
+	{
+		m_handler[REQ_FORMAT]->format(xres, yres, aspect);
+	}
+
+	inline virtual RtVoid frameAspectRatio(RtFloat aspect)
+	{
+		m_handler[REQ_FRAME_ASPECT_RATIO]->frameAspectRatio(aspect);
+	}
+
+	inline virtual RtVoid screenWindow(RtFloat left, RtFloat right, RtFloat bot, RtFloat top)
+	{
+		m_handler[REQ_SCREEN_WINDOW]->screenWindow(left, right, bot, top);
+	}
+
+    inline virtual RtVoid cropWindow(RtFloat xmin, RtFloat xmax, RtFloat ymin, RtFloat ymax)
+	{
+		m_handler[REQ_CROP_WINDOW]->cropWindow(xmin, xmax, ymin, ymax);
+	}
+
+    inline virtual RtVoid projectionV(RtToken aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_PROJECTION]->projectionV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid clipping(RtFloat hither, RtFloat yon)
+	{
+		m_handler[REQ_CLIPPING]->clipping(hither, yon);
+	}
+
+	inline virtual RtVoid clippingPlane(RtFloat x, RtFloat y, RtFloat z, RtFloat nx, RtFloat ny, RtFloat nz)
+	{
+		m_handler[REQ_CLIPPING_PLANE]->clippingPlane(x, y, z, nx, ny, nz);
+	}
+
+	inline virtual RtVoid depthOfField(RtFloat fstop, RtFloat focallength, RtFloat focaldistance)
+	{
+		m_handler[REQ_DEPTH_OF_FIELD]->depthOfField(fstop, focallength, focaldistance);
+	}
+
+	inline virtual RtVoid shutter(RtFloat smin, RtFloat smax)
+	{
+		m_handler[REQ_SHUTTER]->shutter(smin, smax);
+	}
+
+	inline virtual RtVoid pixelVariance(RtFloat variation)
+	{
+		m_handler[REQ_PIXEL_VARIANCE]->pixelVariance(variation);
+	}
+
+    inline virtual RtVoid pixelSamples(RtFloat xsamples, RtFloat ysamples)
+	{
+		m_handler[REQ_PIXEL_SAMPLES]->pixelSamples(xsamples, ysamples);
+	}
+
+	inline virtual RtVoid pixelFilter(const IFilterFunc &function, RtFloat xwidth, RtFloat ywidth)
+	{
+		m_handler[REQ_PIXEL_FILTER]->pixelFilter(function, xwidth, ywidth);
+	}
+
+    inline virtual RtVoid exposure(RtFloat gain, RtFloat gamma)
+	{
+		m_handler[REQ_EXPOSURE]->exposure(gain, gamma);
+	}
+
+    inline virtual RtVoid imagerV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_IMAGER]->imagerV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid quantize(RtToken type, RtInt one, RtInt qmin, RtInt qmax, RtFloat ampl)
+	{
+		m_handler[REQ_QUANTIZE]->quantize(type, one, qmin, qmax, ampl);
+	}
+
+	inline virtual RtVoid displayChannelV(RtString channel, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_DISPLAY_CHANNEL]->displayChannelV(channel, n, tokens, params);
+	}
+
+	inline virtual RtVoid displayV(RtString aName, RtToken type, RtString mode, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_DISPLAY]->displayV(aName, type, mode, n, tokens, params);
+	}
+
+    inline virtual RtVoid hiderV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_HIDER]->hiderV(type, n, tokens, params);
+	}
+
+    inline virtual RtVoid colorSamples(RtInt N, RtFloat nRGB[], RtFloat RGBn[])
+	{
+		m_handler[REQ_COLOR_SAMPLES]->colorSamples(N, nRGB, RGBn);
+	}
+
+    inline virtual RtVoid relativeDetail(RtFloat relativedetail)
+	{
+		m_handler[REQ_RELATIVE_DETAIL]->relativeDetail(relativedetail);
+	}
+
+    inline virtual RtVoid cameraV(RtToken aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_CAMERA]->cameraV(aName, n, tokens, params);
+	}
+	
+    inline virtual RtVoid optionV(RtToken aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_OPTION]->optionV(aName, n, tokens, params);
+	}
+	
+    inline virtual RtLightHandle lightSourceV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		return m_handler[REQ_LIGHT_SOURCE]->lightSourceV(aName, n, tokens, params);
+	}
+
+	inline virtual RtLightHandle areaLightSourceV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		return m_handler[REQ_AREA_LIGHT_SOURCE]->areaLightSourceV(aName, n, tokens, params);
+	}
+	
+    inline virtual RtVoid attributeV(RtToken aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_ATTRIBUTE]->attributeV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid color(RtColor Cs)
+	{
+		m_handler[REQ_COLOR]->color(Cs);
+	}
+
+	inline virtual RtVoid opacity(RtColor Os)
+	{
+		m_handler[REQ_OPACITY]->opacity(Os);
+	}
+
+	inline virtual RtVoid surfaceV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_SURFACE]->surfaceV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid atmosphereV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_ATMOSPHERE]->atmosphereV(aName, n, tokens, params);
+	}
+
+    inline virtual RtVoid interiorV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_INTERIOR]->interiorV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid exteriorV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_EXTERIOR]->exteriorV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid illuminate(RtLightHandle light, RtBoolean onoff)
+	{
+		m_handler[REQ_ILLUMINATE]->illuminate(light, onoff);
+	}
+
+    inline virtual RtVoid displacementV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_DISPLACEMENT]->displacementV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid textureCoordinates(RtFloat s1, RtFloat t1, RtFloat s2, RtFloat t2, RtFloat s3, RtFloat t3, RtFloat s4, RtFloat t4)
+	{
+		m_handler[REQ_TEXTURE_COORDINATES]->textureCoordinates(s1, t1, s2, t2, s3, t3, s4, t4);
+	}
+
+    inline virtual RtVoid shadingRate(RtFloat size)
+	{
+		m_handler[REQ_SHADING_RATE]->shadingRate(size);
+	}
+
+	inline virtual RtVoid shadingInterpolation(RtToken type)
+	{
+		m_handler[REQ_SHADING_INTERPOLATION]->shadingInterpolation(type);
+	}
+
+    inline virtual RtVoid matte(RtBoolean onoff)
+	{
+		m_handler[REQ_MATTE]->matte(onoff);
+	}
+
+	inline virtual RtVoid bound(RtBound bound)
+	{
+		m_handler[REQ_BOUND]->bound(bound);
+	}
+
+	inline virtual RtVoid detail(RtBound bound)
+	{
+		m_handler[REQ_DETAIL]->detail(bound);
+	}
+
+	inline virtual RtVoid detailRange(RtFloat minvis, RtFloat lowtran, RtFloat uptran, RtFloat maxvis)
+	{
+		m_handler[REQ_DETAIL_RANGE]->detailRange(minvis, lowtran, uptran, maxvis);
+	}
+
+    inline virtual RtVoid geometricApproximation(RtToken type, RtFloat value)
+	{
+		m_handler[REQ_GEOMETRIC_APPROXIMATION]->geometricApproximation(type, value);
+	}
+
+	inline virtual RtVoid geometricRepresentation(RtToken type)
+	{
+		m_handler[REQ_GEOMETRIC_REPRESENTATION]->geometricRepresentation(type);
+	}
+
+	inline virtual RtVoid orientation(RtToken anOrientation)
+	{
+		m_handler[REQ_ORIENTATION]->orientation(anOrientation);
+	}
+
+	inline virtual RtVoid reverseOrientation(void)
+	{
+		m_handler[REQ_REVERSE_ORIENTATION]->reverseOrientation();
+	}
+
+	inline virtual RtVoid sides(RtInt nsides)
+	{
+		m_handler[REQ_SIDES]->sides(nsides);
+	}
+
+    inline virtual RtVoid basis(RtBasis ubasis, RtInt ustep, RtBasis vbasis, RtInt vstep)
+	{
+		m_handler[REQ_BASIS]->basis(ubasis, ustep, vbasis, vstep);
+	}
+
+    inline virtual RtVoid trimCurve(RtInt nloops, RtInt ncurves[], RtInt order[], RtFloat knot[], RtFloat amin[], RtFloat amax[], RtInt n[], RtFloat u[], RtFloat v[], RtFloat w[])
+	{
+		m_handler[REQ_TRIM_CURVE]->trimCurve(nloops, ncurves, order, knot, amin, amax, n, u, v, w);
+	}
+
+	inline virtual RtVoid identity(void)
+	{
+		m_handler[REQ_IDENTITY]->identity();
+	}
+
+	inline virtual RtVoid transform(RtMatrix aTransform)
+	{
+		m_handler[REQ_TRANSFORM]->transform(aTransform);
+	}
+
+	inline virtual RtVoid concatTransform(RtMatrix aTransform)
+	{
+		m_handler[REQ_CONCAT_TRANSFORM]->concatTransform(aTransform);
+	}
+
+	inline virtual RtVoid perspective(RtFloat fov)
+	{
+		m_handler[REQ_PERSPECTIVE]->perspective(fov);
+	}
+
+	inline virtual RtVoid translate(RtFloat dx, RtFloat dy, RtFloat dz)
+	{
+		m_handler[REQ_TRANSLATE]->translate(dx, dy, dz);
+	}
+
+	inline virtual RtVoid rotate(RtFloat angle, RtFloat dx, RtFloat dy, RtFloat dz)
+	{
+		m_handler[REQ_ROTATE]->rotate(angle, dx, dy, dz);
+	}
+
+	inline virtual RtVoid scale(RtFloat dx, RtFloat dy, RtFloat dz)
+	{
+		m_handler[REQ_SCALE]->scale(dx, dy, dz);
+	}
+
+    inline virtual RtVoid skew(RtFloat angle, RtFloat dx1, RtFloat dy1, RtFloat dz1, RtFloat dx2, RtFloat dy2, RtFloat dz2)
+	{
+		m_handler[REQ_SKEW]->skew(angle, dx1, dy1, dz1, dx2, dy2, dz2);
+	}
+
+	inline virtual RtVoid deformationV(RtString aName, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_DEFORMATION]->deformationV(aName, n, tokens, params);
+	}
+
+	inline virtual RtVoid scopedCoordinateSystem(RtToken space)
+	{
+		m_handler[REQ_SCOPED_COORDINATE_SYSTEM]->scopedCoordinateSystem(space);
+	}
+
+	inline virtual RtVoid coordinateSystem(RtToken space)
+	{
+		m_handler[REQ_COORDINATE_SYSTEM]->coordinateSystem(space);
+	}
+
+	inline virtual RtVoid coordSysTransform(RtToken space)
+	{
+		m_handler[REQ_COORD_SYS_TRANSFORM]->coordSysTransform(space);
+	}
+
+	inline virtual RtPoint *transformPoints(RtToken fromspace, RtToken tospace, RtInt npoints, RtPoint points[])
+	{
+		return m_handler[REQ_TRANSFORM_POINTS]->transformPoints(fromspace, tospace, npoints, points);
+	}
+
+    inline virtual RtVoid polygonV(RtInt nvertices, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_POLYGON]->polygonV(nvertices, n, tokens, params);
+	}
+
+	inline virtual RtVoid generalPolygonV(RtInt nloops, RtInt nverts[], RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_GENERAL_POLYGON]->generalPolygonV(nloops, nverts, n, tokens, params);
+	}
+
+	inline virtual RtVoid pointsPolygonsV(RtInt npolys, RtInt nverts[], RtInt verts[], RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_POINTS_POLYGONS]->pointsPolygonsV(npolys, nverts, verts, n, tokens, params);
+	}
+
+    inline virtual RtVoid pointsGeneralPolygonsV(RtInt npolys, RtInt nloops[], RtInt nverts[], RtInt verts[], RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_POINTS_GENERAL_POLYGONS]->pointsGeneralPolygonsV(npolys, nloops, nverts, verts, n, tokens, params);
+	}
+
+	inline virtual RtVoid patchV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_PATCH]->patchV(type, n, tokens, params);
+	}
+
+	inline virtual RtVoid patchMeshV(RtToken type, RtInt nu, RtToken uwrap, RtInt nv, RtToken vwrap, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_PATCH_MESH]->patchMeshV(type, nu, uwrap, nv, vwrap, n, tokens, params);
+	}
+
+    inline virtual RtVoid nuPatchV(RtInt nu, RtInt uorder, RtFloat uknot[], RtFloat umin, RtFloat umax, RtInt nv, RtInt vorder, RtFloat vknot[], RtFloat vmin, RtFloat vmax,  RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_NU_PATCH]->nuPatchV(nu, uorder, uknot, umin, umax, nv, vorder, vknot, vmin, vmax, n, tokens, params);
+	}
+
+	inline virtual RtVoid subdivisionMeshV(RtToken scheme, RtInt nfaces, RtInt nvertices[], RtInt vertices[], RtInt ntags, RtToken tags[], RtInt nargs[], RtInt intargs[], RtFloat floatargs[],  RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_SUBDIVISION_MESH]->subdivisionMeshV(scheme, nfaces, nvertices, vertices, ntags, tags, nargs, intargs, floatargs, n, tokens, params);
+	}
+
+	inline virtual RtVoid hierarchicalSubdivisionMeshV(RtToken scheme, RtInt nfaces, RtInt nvertices[], RtInt vertices[], RtInt ntags, RtToken tags[], RtInt nargs[], RtInt intargs[], RtFloat floatargs[],  RtToken stringargs[],  RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_HIERARCHICAL_SUBDIVISION_MESH]->hierarchicalSubdivisionMeshV(scheme, nfaces, nvertices, vertices, ntags, tags, nargs, intargs, floatargs, stringargs, n, tokens, params);
+	}
+
+	inline virtual RtVoid sphereV(RtFloat radius, RtFloat zmin, RtFloat zmax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_SPHERE]->sphereV(radius, zmin, zmax, thetamax, n, tokens, params);
+	}
+
+    inline virtual RtVoid coneV(RtFloat height, RtFloat radius, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_CONE]->coneV(height, radius, thetamax, n, tokens, params);
+	}
+
+	inline virtual RtVoid cylinderV(RtFloat radius, RtFloat zmin, RtFloat zmax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_CYLINDER]->cylinderV(radius, zmin, zmax, thetamax, n, tokens, params);
+	}
+
+    inline virtual RtVoid hyperboloidV(RtPoint point1, RtPoint point2, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_HYPERBOLOID]->hyperboloidV(point1, point2, thetamax, n, tokens, params);
+	}
+
+    inline virtual RtVoid paraboloidV(RtFloat rmax, RtFloat zmin, RtFloat zmax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_PARABOLOID]->paraboloidV(rmax, zmin, zmax, thetamax, n, tokens, params);
+	}
+
+    inline virtual RtVoid diskV(RtFloat height, RtFloat radius, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_DISK]->diskV(height, radius, thetamax, n, tokens, params);
+	}
+
+	inline virtual RtVoid torusV(RtFloat majorrad, RtFloat minorrad, RtFloat phimin, RtFloat phimax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_TORUS]->torusV(majorrad, minorrad, phimin, phimax, thetamax, n, tokens, params);
+	}
+
+    inline virtual RtVoid pointsV(RtInt npts, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_POINTS]->pointsV(npts, n, tokens, params);
+	}
+
+    inline virtual RtVoid curvesV(RtToken type, RtInt ncurves, RtInt nverts[], RtToken wrap, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_CURVES]->curvesV(type, ncurves, nverts, wrap, n, tokens, params);
+	}
+
+	inline virtual RtVoid blobbyV(RtInt nleaf, RtInt ncode, RtInt code[], RtInt nflt, RtFloat flt[], RtInt nstr, RtString str[], RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_BLOBBY]->blobbyV(nleaf, ncode, code, nflt, flt, nstr, str, n, tokens, params);
+	}
+
+	inline virtual RtVoid procedural(RtPointer data, RtBound bound, ISubdivFunc &subdivfunc, IFreeFunc *freefunc)
+	{
+		// Need finer grane - delayed rib reading may be allowed, but not to run programs
+
+		if ( subdivfunc.name() == RI_DELAYED_READ_ARCHIVE ) {
+			m_handler[REQ_PROC_DELAYED_READ_ARCHIVE]->procedural(data, bound, subdivfunc, freefunc);
+			return;
+		}
+
+		if ( subdivfunc.name() == RI_RUN_PROGRAM ) {
+			m_handler[REQ_PROC_RUN_PROGRAM]->procedural(data, bound, subdivfunc, freefunc);
+			return;
+		}
+
+		if ( subdivfunc.name() == RI_DYNAMIC_LOAD ) {
+			m_handler[REQ_PROC_DYNAMIC_LOAD]->procedural(data, bound, subdivfunc, freefunc);
+			return;
+		}
+
+		// All the rest
+		m_handler[REQ_PROCEDURAL]->procedural(data, bound, subdivfunc, freefunc);
+	}
+
+	inline virtual RtVoid geometryV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_GEOMETRY]->geometryV(type, n, tokens, params);
+	}
+
+	inline virtual RtVoid makeTextureV(RtString pic, RtString tex, RtToken swrap, RtToken twrap, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_MAKE_TEXTURE]->makeTextureV(pic, tex, swrap, twrap, filterfunc, swidth, twidth, n, tokens, params);
+	}
+
+	inline virtual RtVoid makeBumpV(RtString pic, RtString tex, RtToken swrap, RtToken twrap, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_MAKE_BUMP]->makeBumpV(pic, tex, swrap, twrap, filterfunc, swidth, twidth, n, tokens, params);
+	}
+
+	inline virtual RtVoid makeLatLongEnvironmentV(RtString pic, RtString tex, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_MAKE_LAT_LONG_ENVIRONMENT]->makeLatLongEnvironmentV(pic, tex, filterfunc, swidth, twidth, n, tokens, params);
+	}
+
+    inline virtual RtVoid makeCubeFaceEnvironmentV(RtString px, RtString nx, RtString py, RtString ny, RtString pz, RtString nz, RtString tex, RtFloat fov, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_MAKE_CUBE_FACE_ENVIRONMENT]->makeCubeFaceEnvironmentV(px, nx, py, ny, pz, nz, tex, fov, filterfunc, swidth, twidth, n, tokens, params);
+	}
+
+    inline virtual RtVoid makeShadowV(RtString pic, RtString tex, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_MAKE_SHADOW]->makeShadowV(pic, tex, n, tokens, params);
+	}
+
+    inline virtual RtVoid makeBrickMapV(RtInt nNames, RtString ptcnames[], RtString bkmname, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_MAKE_SHADOW]->makeBrickMapV(nNames, ptcnames, bkmname, n, tokens, params);
+	}
+
+	inline virtual RtVoid archiveRecordV(RtToken type, RtString line)
+	{
+		m_handler[REQ_ARCHIVE_RECORD]->archiveRecordV(type, line);
+	}
+
+	inline virtual RtVoid readArchiveV(RtString aName, const IArchiveCallback *callback, RtInt n, RtToken tokens[], RtPointer params[])
+	{
+		m_handler[REQ_READ_ARCHIVE]->readArchiveV(aName, callback, n, tokens, params);
+	}
+
+	inline virtual RtVoid ifBegin(RtString expr)
+	{
+		m_handler[REQ_IF_BEGIN]->ifBegin(expr);
+	}
+
+	inline virtual RtVoid elseIfBegin(RtString expr)
+	{
+		m_handler[REQ_ELSE_IF]->elseIfBegin(expr);
+	}
+
+	inline virtual RtVoid elseBegin(void)
+	{
+		m_handler[REQ_ELSE]->elseBegin();
+	}
+
+	inline virtual RtVoid ifEnd(void)
+	{
+		m_handler[REQ_IF_END]->ifEnd();
+	}
+
+	/// @}
+}; // CRibFilterDispatch
+
 /** @brief List to manage RIB filters.
  *  @see CRibFilter
  */
 class CRibFilterList {
 	friend class CRiCPPBridge;
+	friend class CRibFilter;
 
-	IRiRoot *m_ri; ///< Interface routines of the frontend that are called at last.
+	CRibFilter *m_ri; ///< Last filter, calls the interface routines of the frontend.
 	std::list<CRibFilter *>m_filters; ///< List of filters.
 	TemplPluginHandler<CRibFilter> m_pluginHandler; ///< Plugin handler to register filters in memory.
+	CRibFilterDispatch m_dispatch; ///< Calls the first filter that handles a request.
 
-	/** @brief Sets the RenderMan interface.
-	 *  @param ri Pointer to the interface, that will be called.
+	/** @brief Sets the last filter.
+	 *  @param ri Pointer to the last filter, that calls the frontend.
 	 */
-	inline CRibFilterList(IRiRoot *ri) {
+	inline CRibFilterList(CRibFilter *ri) {
 		m_ri = ri;
+		if ( m_ri )
+			m_ri->m_list = this;
+		updateDispatch();
 	}
 
+	/** @brief Fills the dispatch table.
+	 *
+	 *  Called if a filter is added or removed and if the state of a filter changes.
+	 */
+	void updateDispatch();
+
 	/** @brief Gets a new filter.
 	 *  @param name Name of the filter (registered or dynamic library).
 	 */
@@ -68,7 +746,15 @@ class CRibFilterList {
 	bool deleteFilterPlugin(CRibFilter *aFilter);
 
 public:
-	inline virtual ~CRibFilterList() {}
+	inline virtual ~CRibFilterList()
+	{
+		// The filters are not deleted here, but the list is not notified anymore
+		for ( std::list<CRibFilter *>::iterator i = m_filters.begin(); i != m_filters.end(); i++ ) {
+			(*i)->m_list = 0;
+		}
+		if ( m_ri )
+			m_ri->m_list = 0;
+	}
 	
 	/** @brief First interface that is called.
 	 *
@@ -87,6 +773,16 @@ public:
 		return m_ri;
 	}
 
+	/** @brief Interface that calls the filters.
+	 *
+	 *  Calls each request at the first filter, that does not only forward
+	 *  it, or directly at the frontend.
+	 *  @return Interface that calls the filters, used by the parser.
+	 */
+	inline IRiRoot &dispatch() {
+		return m_dispatch;
+	}
+
 	/** @brief Adds a new filter instance in front of the others.
 	 *
 	 *  @param aFilter Filter to add.
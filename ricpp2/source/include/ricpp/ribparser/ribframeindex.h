@@ -0,0 +1,252 @@
+#ifndef _RICPP_RIBPARSER_RIBFRAMEINDEX_H
+#define _RICPP_RIBPARSER_RIBFRAMEINDEX_H
+
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+/** @file ribframeindex.h
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Frame index for random access to the frames of rib streams.
+ *
+ *  The frame index stores the positions of the frame blocks of an ASCII
+ *  rib stream and, for zipped streams, the access points to resume
+ *  inflating (CInflateIndex). CRibParser uses the index to parse only
+ *  the selected frames (and the rib code outside of the frames) by
+ *  seeking over the others. The index can be stored beside the rib file
+ *  (file name + ".ribidx") to be reused, see CRenderState::storeFrameIndex().
+ */
+
+#ifndef _RICPP_RIBASE_RICPPTYPES_H
+#include "ricpp/ribase/ricpptypes.h"
+#endif // _RICPP_RIBASE_RICPPTYPES_H
+
+#ifndef _RICPP_STREAMS_BACKBUFFER_H
+#include "ricpp/streams/backbuffer.h"
+#endif // _RICPP_STREAMS_BACKBUFFER_H
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace RiCPP {
+
+	/** @brief Selection of frames by their frame numbers.
+	 *
+	 *  Positive and negative lists of frame numbers have the form
+	 *  "n,n-m,n-,-n" (-n is 1-n). A frame is selected, if it is
+	 *  member of the positive list (or no positive list is given) and
+	 *  not member of the negative list. Lists can be added several times.
+	 */
+	class CRibFrameSelection {
+		/** @brief Closed range of frame numbers.
+		 */
+		struct SRange {
+			RtInt m_first; ///< First frame number.
+			RtInt m_last;  ///< Last frame number.
+		};
+
+		bool m_hasFrames;               ///< A positive list is given.
+		std::vector<SRange> m_frames;   ///< The positive list.
+		std::vector<SRange> m_excluded; ///< The negative list.
+
+		static bool parseList(const char *list, std::vector<SRange> &ranges);
+		static bool member(const std::vector<SRange> &ranges, RtInt frameNo);
+
+	public:
+		/** @brief Maximal number of frames of a positive list to track by wantedFrames().
+		 */
+		static const unsigned long MAX_WANTED;
+
+		/** @brief Constructor, selects all frames.
+		 */
+		inline CRibFrameSelection() : m_hasFrames(false) {}
+
+		/** @brief Clears the lists, all frames are selected.
+		 */
+		void clear();
+
+		/** @brief Adds a positive list.
+		 *  @param list The list, an empty list selects no frames.
+		 *  @return false, syntax error in @a list.
+		 */
+		bool frames(const char *list);
+
+		/** @brief Adds a negative list.
+		 *  @param list The list.
+		 *  @return false, syntax error in @a list.
+		 */
+		bool excludeFrames(const char *list);
+
+		/** @brief Tests if frames are selected at all.
+		 *  @return true, a positive or negative list has been added.
+		 */
+		inline bool active() const
+		{
+			return m_hasFrames || !m_excluded.empty();
+		}
+
+		/** @brief Tests if a frame is selected.
+		 *  @param frameNo The frame number.
+		 *  @return true, the frame is selected.
+		 */
+		bool selected(RtInt frameNo) const;
+
+		/** @brief Counts the frames of a positive list that are selected.
+		 *
+		 *  If all of these frames are found, the frames that follow
+		 *  need not to be parsed.
+		 *
+		 *  @return Number of selected frames, 0 if no positive list is given, if
+		 *          it is open (n-) or if it contains more than MAX_WANTED frames.
+		 */
+		unsigned long wantedFrames() const;
+	}; // CRibFrameSelection
+
+	/** @brief Stream buffer reading a number of bytes of another stream buffer.
+	 *
+	 *  Used to parse a part of a rib stream.
+	 */
+	class CRibRangeStreambuf : public std::streambuf {
+		std::streambuf *m_source;     ///< The stream buffer read.
+		std::streamoff m_remaining;   ///< Number of bytes left to read.
+		std::vector<char> m_buffer;   ///< Get area.
+	protected:
+		virtual int_type underflow();
+	public:
+		/** @brief Constructor.
+		 *  @param source The stream buffer, positioned at the start of the range.
+		 *  @param size Number of bytes to read.
+		 */
+		CRibRangeStreambuf(std::streambuf &source, std::streamoff size);
+	}; // CRibRangeStreambuf
+
+	/** @brief Positions of the frames of an ASCII rib stream.
+	 */
+	class CRibFrameIndex {
+	public:
+		/** @brief Position of a frame block (at archive level 0).
+		 */
+		struct SFrame {
+			RtInt m_number;         ///< Frame number of FrameBegin.
+			std::streamoff m_begin; ///< Position of FrameBegin.
+			long m_beginLine;       ///< Line of FrameBegin.
+			std::streamoff m_end;   ///< Position behind FrameEnd (end of the stream if missing).
+			long m_endLine;         ///< Line of the position m_end.
+		};
+
+		/** @brief Part of the stream to parse.
+		 */
+		struct SRange {
+			std::streamoff m_begin; ///< Start of the part.
+			std::streamoff m_end;   ///< End of the part (exclusive).
+			long m_line;            ///< Line at m_begin.
+		};
+
+		/** @brief Default minimal distance of the access points into zipped streams (1MB).
+		 */
+		static const std::streamoff DEFAULT_SPAN;
+
+	private:
+		std::vector<SFrame> m_frames;  ///< The frames in the sequence of the stream.
+		std::streamoff m_prologueEnd;  ///< End of the rib code in front of the first frame.
+		std::streamoff m_length;       ///< Length of the (unzipped) stream.
+		long m_lastLine;               ///< Line at the end of the stream.
+		CInflateIndex m_inflateIndex;  ///< Access points for zipped streams.
+
+		static bool fileStat(const std::string &filename, std::streamoff &size, long &mtime);
+
+	public:
+		/** @brief Constructor.
+		 *  @param span Minimal distance of the access points into zipped streams.
+		 */
+		CRibFrameIndex(std::streamoff span = DEFAULT_SPAN);
+
+		/** @brief Clears the index.
+		 */
+		void clear();
+
+		/** @brief Gets the frames.
+		 *  @return The frames in the sequence of the stream.
+		 */
+		inline const std::vector<SFrame> &frames() const { return m_frames; }
+
+		/** @brief Gets the end of the rib code in front of the first frame.
+		 *  @return Position of the first FrameBegin, length() if there are no frames.
+		 */
+		inline std::streamoff prologueEnd() const { return m_prologueEnd; }
+
+		/** @brief Gets the length of the stream.
+		 *  @return Length of the (unzipped) stream.
+		 */
+		inline std::streamoff length() const { return m_length; }
+
+		/** @brief Gets the access points for zipped streams.
+		 *  @return The access points, to be used by CFrontStreambuf::inflateIndex().
+		 */
+		inline CInflateIndex &inflateIndex() { return m_inflateIndex; }
+
+		/** @brief Builds the index by scanning a stream from its current position to the end.
+		 *
+		 *  The stream is scanned for FrameBegin, FrameEnd, ArchiveBegin and ArchiveEnd
+		 *  outside of comments and strings. If @a sb is a CFrontStreambuf with
+		 *  inflateIndex() set, the access points are recorded while scanning.
+		 *
+		 *  @param sb Stream buffer positioned at the start of the rib stream.
+		 *  @return false, the stream contains binary encoded rib, the index is cleared.
+		 */
+		bool build(std::streambuf &sb);
+
+		/** @brief Gets the parts of the stream to parse for selected frames.
+		 *
+		 *  The parts contain the rib code in front of, between and after the
+		 *  frames and the selected frames. Adjacent parts are merged. If all
+		 *  frames of a positive list are found, the parts that follow are omitted.
+		 *
+		 *  @param selection The selected frames.
+		 *  @retval ranges The parts in the sequence of the stream.
+		 */
+		void ranges(const CRibFrameSelection &selection, std::vector<SRange> &ranges) const;
+
+		/** @brief Gets the name of the index file of a rib file.
+		 *  @param filename Name of the rib file.
+		 *  @return Name of the index file (@a filename + ".ribidx").
+		 */
+		static std::string indexFilename(const std::string &filename);
+
+		/** @brief Loads the index of a rib file.
+		 *  @param filename Name of the rib file.
+		 *  @return false, there is no index file or it is out of date, the index is cleared.
+		 */
+		bool load(const std::string &filename);
+
+		/** @brief Stores the index of a rib file.
+		 *  @param filename Name of the rib file.
+		 *  @return false, the index file could not be written.
+		 */
+		bool save(const std::string &filename) const;
+	}; // CRibFrameIndex
+} // namespace RiCPP
+
+#endif // _RICPP_RIBPARSER_RIBFRAMEINDEX_H
@@ -0,0 +1,508 @@
+#ifndef _RICPP_RIBPARSER_RIBLEXER_H
+#define _RICPP_RIBPARSER_RIBLEXER_H
+
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file riblexer.h
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Parallel and asynchronous lexers for ASCII rib streams.
+ *
+ *  A rib stream is split into chunks at lines starting with a request
+ *  identifier. The chunks are lexed concurrently (CRibParallelLexer) or
+ *  in a reading thread (CRibAsyncLexer) into CRibLexedRequest buffers,
+ *  the requests are called in sequence by CRibParser.
+ *  If a chunk cannot be lexed (e.g. a line break inside a string
+ *  or binary encoded content) the parser falls back to sequential parsing,
+ *  starting at this chunk.
+ */
+
+#ifndef _RICPP_RIBPARSER_RIBPARSER_H
+#include "ricpp/ribparser/ribparser.h"
+#endif // _RICPP_RIBPARSER_RIBPARSER_H
+
+#include <streambuf>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace RiCPP {
+
+	/** @brief Comment found while lexing, called after its request.
+	 */
+	class CRibLexedComment {
+	public:
+		std::string m_comment; ///< Text of the comment (without '#' or '##').
+		bool m_isStructured;   ///< Comment is structured comment (##).
+		long m_lineNo;         ///< Line (relative to the chunk) where the comment was found.
+	}; // CRibLexedComment
+
+	/** @brief Error message found while lexing, reported before its request is called.
+	 *
+	 *  Lexing is done concurrently, the error handler of the front end is not
+	 *  thread safe. Therefore the messages are stored and reported in sequence.
+	 */
+	class CRibLexedMessage {
+	public:
+		RtInt m_code;        ///< Error code (RIE_...).
+		RtInt m_severity;    ///< Severity (RIE_WARNING, RIE_ERROR, ...).
+		long m_lineNo;       ///< Line (relative to the chunk) where the error occured.
+		std::string m_text;  ///< Message following "Line %ld, File \"%s\"".
+	}; // CRibLexedMessage
+
+	/** @brief Typed request buffer, a request with its lexed parameters.
+	 *
+	 *  An empty request name is used for the comments at the beginning of
+	 *  a stream, in front of the first request.
+	 */
+	class CRibLexedRequest {
+	public:
+		std::string m_request;                    ///< Request identifier (e.g. "Sphere").
+		long m_lineNo;                            ///< Line (relative to the chunk) where lexing of the request ended.
+		unsigned long m_offset;                   ///< Offset (relative to the chunk) of the request identifier.
+		std::vector<CRibParameter> m_parameters;  ///< The parameters of the request.
+		std::vector<CRibLexedComment> m_comments; ///< Comments found after the request identifier.
+		std::vector<CRibLexedMessage> m_messages; ///< Errors found while lexing the parameters.
+
+		inline CRibLexedRequest() : m_lineNo(0), m_offset(0) {}
+	}; // CRibLexedRequest
+
+
+	/** @brief Lexes a chunk of an ASCII rib stream.
+	 *
+	 *  Mirrors the ASCII part of CRibParser::nextToken(). Numbers are
+	 *  converted and strings are interned here, RIB string variables are
+	 *  not substituted (this depends on the render state and is done while
+	 *  calling the request). Line numbers are relative to the start of the chunk.
+	 *  The chunk is assumed to start outside of a string or an array, the
+	 *  boundaries are not checked (see CRibParallelLexer::findChunks()).
+	 */
+	class CRibChunkLexer {
+		const char *m_begin;      ///< Start of the chunk.
+		const char *m_pos;        ///< Current read position.
+		const char *m_end;        ///< End of the chunk.
+		bool m_isLast;            ///< Chunk is the last one, the end is the end of the stream.
+		bool m_eof;               ///< End of the chunk is reached.
+		bool m_valid;             ///< Chunk could be lexed, assumption about its start and end hold.
+
+		long m_lineNo;            ///< Newlines found so far.
+		unsigned char m_lastChar; ///< The character read before to recognize \\r\\n \\n\\r.
+		bool m_hasPutBack;        ///< One character put back.
+		unsigned char m_putBack;  ///< The character that has been put back.
+
+		int m_braketDepth;        ///< Braket [] nesting depth.
+		std::string m_token;      ///< Current token.
+		unsigned long m_tokenOffset; ///< Offset of the current identifier.
+		CTokenMap *m_tokens;      ///< Token map to intern the strings, 0 if strings are copied.
+
+		std::vector<CRibLexedRequest> m_requests; ///< The requests lexed, the first one is used for leading comments.
+
+		bool getchar(unsigned char &c);
+		void putback(unsigned char c);
+
+		void message(RtInt code, RtInt severity, const char *text, char c = 0);
+		void handleComment(bool isStructured);
+		void handleString();
+		void handleNumber(bool isInteger);
+		void handleRequest();
+		void handleArrayStart();
+		void handleArrayEnd();
+		void finishRequest();
+		bool nextToken();
+
+	public:
+		/** @brief Constructor, empty chunk.
+		 */
+		CRibChunkLexer();
+
+		/** @brief Lexes a chunk.
+		 *
+		 *  @param begin Start of the chunk, if not the first chunk, it starts with a request identifier.
+		 *  @param end End of the chunk, points behind the last character.
+		 *  @param isLast true, if the chunk ends the stream.
+		 *  @param tokens Token map to intern the strings, 0 if strings are copied.
+		 *  @return true, if the chunk could be lexed (valid()).
+		 */
+		bool lex(const char *begin, const char *end, bool isLast, CTokenMap *tokens = 0);
+
+		/** @brief Chunk was lexed successfully.
+		 *
+		 *  @return false if a binary encoded value was found or the
+		 *          chunk ends inside a string.
+		 */
+		inline bool valid() const { return m_valid; }
+
+		/** @brief Marks the chunk as not lexed, it has to be parsed sequentially.
+		 */
+		inline void invalidate() { m_valid = false; m_requests.clear(); }
+
+		/** @brief Number of the line breaks within the chunk.
+		 *
+		 *  @return Number of the line breaks within the chunk.
+		 */
+		inline long lines() const { return m_lineNo; }
+
+		/** @brief The lexed requests.
+		 *
+		 *  @return The lexed requests, first element holds the comments in front of the first request.
+		 */
+		inline std::vector<CRibLexedRequest> &requests() { return m_requests; }
+	}; // CRibChunkLexer
+
+
+	/** @brief Read only stream buffer for a memory block.
+	 *
+	 *  Used to parse a rib stream sequentially from memory, if it could
+	 *  not be lexed in parallel.
+	 */
+	class CRibMemoryStreambuf : public std::streambuf {
+	public:
+		/** @brief Constructor, empty get area.
+		 */
+		inline CRibMemoryStreambuf()
+		{
+		}
+
+		/** @brief Initializes the get area.
+		 *
+		 *  @param data The memory block (not copied).
+		 *  @param size Size of @a data.
+		 */
+		inline CRibMemoryStreambuf(char *data, std::streamsize size)
+		{
+			setg(data, data, data+size);
+		}
+
+		/** @brief Sets the get area.
+		 *
+		 *  @param data The memory block (not copied).
+		 *  @param size Size of @a data.
+		 */
+		inline void assign(char *data, std::streamsize size)
+		{
+			setg(data, data, data+size);
+		}
+	}; // CRibMemoryStreambuf
+
+
+	/** @brief Read only stream buffer, reads a memory block followed by another stream buffer.
+	 *
+	 *  Used to continue parsing sequentially, if a part of a stream that
+	 *  has already been read could not be lexed asynchronously.
+	 */
+	class CRibPrefixStreambuf : public std::streambuf {
+		std::vector<char> m_prefix; ///< The memory block to read first.
+		std::vector<char> m_buffer; ///< Buffer for the data read from m_next.
+		std::streambuf *m_next;     ///< Stream buffer to read after the prefix.
+	protected:
+		virtual int_type underflow();
+	public:
+		/** @brief Constructor, empty get area.
+		 */
+		inline CRibPrefixStreambuf() : m_next(0)
+		{
+		}
+
+		/** @brief Sets the data.
+		 *
+		 *  @param prefix The memory block to read first, the content is taken (@a prefix is empty afterwards).
+		 *  @param next Stream buffer to read after the prefix, can be 0.
+		 */
+		void assign(std::vector<char> &prefix, std::streambuf *next);
+	}; // CRibPrefixStreambuf
+
+
+	/** @brief Source of lexed chunks, the requests are called by CRibParser.
+	 */
+	class IRibLexedSource {
+	public:
+		inline virtual ~IRibLexedSource() {}
+
+		/** @brief Gets the next lexed chunk, the former chunk is freed.
+		 *
+		 *  Throws ExceptRiCPPError if the stream could not be read.
+		 *
+		 *  @return The next chunk or 0 at the end of the stream. If the chunk is
+		 *          not valid, the stream has to be parsed sequentially using rest().
+		 */
+		virtual CRibChunkLexer *nextChunk() = 0;
+
+		/** @brief The stream starting at the chunk that could not be lexed.
+		 *
+		 *  @return Stream buffer to parse the rest of the stream sequentially.
+		 */
+		virtual std::streambuf *rest() = 0;
+
+		/** @brief Stops lexing, frees the chunks.
+		 */
+		virtual void stop() = 0;
+	}; // IRibLexedSource
+
+
+	/** @brief Threads shared by the parallel lexers.
+	 *
+	 *  The threads are kept after a rib stream has been lexed and are used
+	 *  again for the next one (e.g. the archives read by a rib file). A task
+	 *  is run by an idle thread, a new thread is created if all are busy,
+	 *  so the tasks of nested lexers do not wait for each other.
+	 */
+	class CRibLexerThreads {
+		std::mutex m_mutex;                    ///< Guards the tasks.
+		std::condition_variable m_cond;        ///< Signals a new task or the end.
+		std::deque<std::function<void()> > m_tasks; ///< Tasks waiting for a thread.
+		std::vector<std::thread> m_threads;    ///< All threads.
+		unsigned long m_idle;                  ///< Number of threads waiting for a task.
+		bool m_stop;                           ///< Threads end.
+
+		void work();
+
+		CRibLexerThreads(const CRibLexerThreads &);            // not implemented
+		CRibLexerThreads &operator=(const CRibLexerThreads &); // not implemented
+
+	public:
+		/** @brief Constructor, no threads.
+		 */
+		CRibLexerThreads();
+
+		/** @brief Destructor, ends and joins the threads.
+		 */
+		~CRibLexerThreads();
+
+		/** @brief The threads of the process.
+		 *
+		 *  @return The threads used by all CRibParallelLexer.
+		 */
+		static CRibLexerThreads &instance();
+
+		/** @brief Runs a task by an idle or a new thread.
+		 *
+		 *  @param task The task.
+		 *  @return false, if there was no idle thread and no thread could be created.
+		 */
+		bool run(const std::function<void()> &task);
+	}; // CRibLexerThreads
+
+
+	/** @brief Splits a rib stream into chunks and lexes them concurrently.
+	 *
+	 *  The chunks are lexed by worker tasks run by CRibLexerThreads, at
+	 *  most a window of chunks in advance of the chunk currently used by
+	 *  the parser to limit the memory needed by the lexed requests.
+	 */
+	class CRibParallelLexer : public IRibLexedSource {
+		char *m_data;                          ///< The rib stream.
+		unsigned long m_size;                  ///< Size of the rib stream.
+		std::vector<unsigned long> m_starts;   ///< Start offsets of the chunks.
+		std::vector<CRibChunkLexer> m_chunks;  ///< The lexed chunks in the order of the stream.
+		std::vector<bool> m_lexed;             ///< Chunk has been lexed.
+		unsigned long m_nextChunk;             ///< Next chunk to lex.
+		unsigned long m_released;              ///< Number of chunks released by the parser.
+		unsigned long m_window;                ///< Number of chunks that can be lexed in advance.
+		unsigned long m_current;               ///< Number of chunks handed out by nextChunk().
+		CTokenMap *m_tokens;                   ///< Token map to intern the strings.
+		bool m_stop;                           ///< Stop lexing.
+		CRibMemoryStreambuf m_restBuf;         ///< Stream buffer returned by rest().
+
+		std::mutex m_mutex;                    ///< Guards the state of the chunks.
+		std::condition_variable m_cond;        ///< Signals a lexed or a released chunk or a finished worker.
+		unsigned int m_workers;                ///< Number of workers started, 0 if the chunks are lexed by the parser.
+		unsigned int m_running;                ///< Number of workers not yet finished.
+
+		void run();
+		CRibChunkLexer &chunk(unsigned long idx);
+		void release(unsigned long idx);
+
+		CRibParallelLexer(const CRibParallelLexer &);            // not implemented
+		CRibParallelLexer &operator=(const CRibParallelLexer &); // not implemented
+
+	public:
+		/** @brief Default minimal size of a chunk (256KB).
+		 */
+		static const unsigned long DEFAULT_CHUNK_SIZE;
+
+		/** @brief Minimal number of chunks (of the minimal size) of a stream worth lexing in parallel.
+		 *
+		 *  Smaller streams are parsed sequentially, the threads would not pay off.
+		 */
+		static const unsigned long MIN_PARALLEL_CHUNKS;
+
+		/** @brief Constructor, no chunks.
+		 */
+		CRibParallelLexer();
+
+		/** @brief Destructor, stops the workers.
+		 */
+		virtual ~CRibParallelLexer();
+
+		/** @brief Finds the chunk boundaries.
+		 *
+		 *  A chunk boundary is a line starting with a letter (a request identifier).
+		 *  The boundaries are found without lexing, strings are not recognized:
+		 *  a line of a multi-line string starting with a letter can be taken
+		 *  as boundary. The chunk ending inside the string is not valid then
+		 *  (CRibChunkLexer::valid()) and the parser continues sequentially
+		 *  at its start.
+		 *
+		 *  @param data The rib stream.
+		 *  @param size Size of @a data.
+		 *  @param minChunkSize Minimal size of a chunk.
+		 *  @retval starts Start offsets of the chunks, first is 0.
+		 */
+		static void findChunks(
+			const char *data, unsigned long size,
+			unsigned long minChunkSize,
+			std::vector<unsigned long> &starts);
+
+		/** @brief Starts lexing a rib stream using the threads of CRibLexerThreads.
+		 *
+		 *  @param data The rib stream, must be valid until stop() is called.
+		 *  @param size Size of @a data.
+		 *  @param nThreads Number of workers to use.
+		 *  @param minChunkSize Minimal size of a chunk.
+		 *  @param tokens Token map to intern the strings (shared by the threads), 0 if strings are copied.
+		 */
+		void start(char *data, unsigned long size, unsigned int nThreads, unsigned long minChunkSize = DEFAULT_CHUNK_SIZE, CTokenMap *tokens = 0);
+
+		/** @brief Offset of the chunk returned by the last call of nextChunk().
+		 *
+		 *  @return Offset of the current chunk in the rib stream.
+		 */
+		unsigned long chunkStart() const;
+
+		virtual CRibChunkLexer *nextChunk();
+		virtual std::streambuf *rest();
+		virtual void stop();
+	}; // CRibParallelLexer
+
+
+	/** @brief Splits an ASCII rib stream held in memory at its frame blocks.
+	 */
+	class CRibFrameSplitter {
+	public:
+		/** @brief State left by the requests of a segment.
+		 *
+		 *  The state of a frame block is restored at its end, except the
+		 *  handle numbers and the declarations (m_globals).
+		 */
+		struct SSegmentHandles {
+			unsigned long m_lights;  ///< Number of LightSource and AreaLightSource requests.
+			unsigned long m_objects; ///< Number of ObjectBegin requests.
+			std::vector<unsigned long> m_globals; ///< Start and end offsets of the Declare requests, the declarations stay valid after the frame block.
+			bool m_exact;            ///< false, the segment reads archives or contains conditionals, the state it leaves is not known without processing it.
+			inline SSegmentHandles() : m_lights(0), m_objects(0), m_exact(true) {}
+		};
+
+		/** @brief Finds the segments of a rib stream outside and inside of frame blocks.
+		 *
+		 *  A frame segment starts at a FrameBegin request and ends in front of the
+		 *  request following the corresponding FrameEnd. Frame blocks within
+		 *  inline archives are not taken.
+		 *
+		 *  @param data The rib stream.
+		 *  @param size Size of @a data.
+		 *  @param nThreads Number of threads used to lex the stream.
+		 *  @retval bounds Start offsets of the segments followed by @a size. Segments
+		 *          with an even index are outside of frame blocks, the ones with an odd
+		 *          index are frame blocks. There is always a last (maybe empty) segment
+		 *          outside of a frame block.
+		 *  @retval handles If not 0, filled with the state left by
+		 *          each segment (one element less than @a bounds).
+		 *  @return false, the stream could not be lexed (e.g. binary encoded), @a bounds
+		 *          contains a single segment.
+		 */
+		static bool split(char *data, unsigned long size, unsigned int nThreads, std::vector<unsigned long> &bounds, std::vector<SSegmentHandles> *handles = 0);
+	}; // CRibFrameSplitter
+
+
+	/** @brief Reads and lexes a rib stream in a separate thread.
+	 *
+	 *  The stream is read in blocks, each block up to its last line starting
+	 *  with a request identifier is lexed as one chunk. The chunks are passed
+	 *  to the parser by a bounded queue, the reading thread waits if the
+	 *  queue is full. So reading and lexing overlaps the processing of the
+	 *  requests.
+	 *
+	 *  Only reading and lexing are done by the thread. The requests are
+	 *  still called and rendered by the thread of the parser, because each
+	 *  interface call depends on the render state changed by the calls before
+	 *  (and a GL context is bound to its thread).
+	 */
+	class CRibAsyncLexer : public IRibLexedSource {
+		std::streambuf *m_in;                  ///< The rib stream.
+		unsigned long m_maxQueued;             ///< Maximal number of chunks in the queue.
+		std::deque<CRibChunkLexer *> m_queue;  ///< Lexed chunks, not yet used by the parser.
+		CRibChunkLexer *m_current;             ///< Chunk used by the parser.
+		CTokenMap *m_tokens;                   ///< Token map to intern the strings.
+		std::vector<char> m_rest;              ///< Data of a chunk that could not be lexed.
+		CRibPrefixStreambuf m_restBuf;         ///< Stream buffer returned by rest().
+		bool m_done;                           ///< Reading thread finished.
+		bool m_stop;                           ///< Stop reading.
+		bool m_hasError;                       ///< An error occured while reading.
+		ExceptRiCPPError m_error;              ///< The error occured while reading.
+
+		std::mutex m_mutex;                    ///< Guards the queue.
+		std::condition_variable m_cond;        ///< Signals a change of the queue.
+		std::thread m_thread;                  ///< The reading thread.
+
+		void run();
+		void join();
+
+		CRibAsyncLexer(const CRibAsyncLexer &);            // not implemented
+		CRibAsyncLexer &operator=(const CRibAsyncLexer &); // not implemented
+
+	public:
+		/** @brief Size of the blocks read (64KB).
+		 */
+		static const unsigned long BLOCK_SIZE;
+
+		/** @brief Maximal size of a chunk (1MB), if there is no line starting with a letter the rest of the stream is parsed sequentially.
+		 */
+		static const unsigned long MAX_CHUNK_SIZE;
+
+		/** @brief Constructor, no stream.
+		 */
+		CRibAsyncLexer();
+
+		/** @brief Destructor, stops the thread.
+		 */
+		virtual ~CRibAsyncLexer();
+
+		/** @brief Starts reading and lexing.
+		 *
+		 *  @param in The rib stream, must not be used until stop() or rest() is called.
+		 *  @param maxQueued Maximal number of lexed chunks waiting for the parser.
+		 *  @param tokens Token map to intern the strings, 0 if strings are copied.
+		 */
+		void start(std::streambuf *in, unsigned long maxQueued, CTokenMap *tokens = 0);
+
+		virtual CRibChunkLexer *nextChunk();
+		virtual std::streambuf *rest();
+		virtual void stop();
+	}; // CRibAsyncLexer
+
+} // namespace RiCPP
+
+#endif // _RICPP_RIBPARSER_RIBLEXER_H
@@ -38,6 +38,13 @@
 #include "ricpp/ribparser/ribparsercallback.h"
 #endif // _RICPP_RIBPARSER_RIBPARSERCALLBACK_H
 
+#ifndef _RICPP_RIBPARSER_RIBFRAMEINDEX_H
+#include "ricpp/ribparser/ribframeindex.h"
+#endif // _RICPP_RIBPARSER_RIBFRAMEINDEX_H
+
+#include <set>
+#include <unordered_map>
+
 namespace RiCPP {
 
 	/** @brief Container class for one parameter (array) read by the parser (RIB)
@@ -51,16 +58,71 @@ namespace RiCPP {
 		EnumBasicTypes m_typeID; ///< Type of value.
 		bool    m_isArray;       ///< Parameter is array yes/no.
 
-		std::vector <RtFloat>     m_vFloat;  ///< Values are Floats.
-		std::vector <RtInt>       m_vInt;    ///< Values are Integers.
-		std::deque  <std::string> m_vString; ///< Values are Strings.
+		std::shared_ptr<std::vector<RtFloat> > m_vFloat; ///< Values are Floats, shared by copies and offered blocks.
+		std::shared_ptr<std::vector<RtInt> >   m_vInt;   ///< Values are Integers, shared by copies and offered blocks.
+		std::vector<RtToken> m_vString;  ///< Values are Strings, interned tokens or strings of m_ownedStrings.
+		std::shared_ptr<std::deque<std::string> > m_ownedStrings; ///< Strings without a token of their own, shared by copies.
+
+		static const std::vector<RtFloat> ms_noFloats; ///< Empty float values.
+		static const std::vector<RtInt> ms_noInts;     ///< Empty integer values.
+
+		/** @brief Gets the float values.
+		 *  @return The float values, empty if there are none.
+		 */
+		inline const std::vector<RtFloat> &floats() const
+		{
+			return m_vFloat ? *m_vFloat : ms_noFloats;
+		}
+
+		/** @brief Gets the integer values.
+		 *  @return The integer values, empty if there are none.
+		 */
+		inline const std::vector<RtInt> &ints() const
+		{
+			return m_vInt ? *m_vInt : ms_noInts;
+		}
 
-		/** @brief Value container, used if parameter is an array of string.
+		/** @brief Gets the float values to change them.
+		 *
+		 *  The values are copied first, if they are shared.
 		 *
-		 *  Pointers to the strings of m_vString, m_vString is not changed
-		 *  after a value is read (so pointers stay valid).
+		 *  @return The writeable float values.
 		 */
-		std::vector<const char *> *m_cstrVector;
+		inline std::vector<RtFloat> &writeFloats()
+		{
+			if ( !m_vFloat )
+				m_vFloat.reset(new std::vector<RtFloat>);
+			else if ( m_vFloat.use_count() > 1 )
+				m_vFloat.reset(new std::vector<RtFloat>(*m_vFloat));
+			return *m_vFloat;
+		}
+
+		/** @brief Gets the integer values to change them.
+		 *
+		 *  The values are copied first, if they are shared.
+		 *
+		 *  @return The writeable integer values.
+		 */
+		inline std::vector<RtInt> &writeInts()
+		{
+			if ( !m_vInt )
+				m_vInt.reset(new std::vector<RtInt>);
+			else if ( m_vInt.use_count() > 1 )
+				m_vInt.reset(new std::vector<RtInt>(*m_vInt));
+			return *m_vInt;
+		}
+
+		/** @brief Gets the string to store for a string value.
+		 *
+		 *  The string is interned in @a tokens. Strings that cannot be
+		 *  interned unchanged (the token map trims blanks and has no empty
+		 *  token) or if there is no token map are copied to m_ownedStrings.
+		 *
+		 *  @param v The string value.
+		 *  @param tokens Token map to intern the string, can be 0.
+		 *  @return Pointer to the stored string.
+		 */
+		RtToken storeString(const char *v, CTokenMap *tokens);
 
 		void freeValue();			///< Clears m_vFloat, m_vInt, m_vString.
 
@@ -155,7 +217,7 @@ namespace RiCPP {
 				// do not return
 			}
 			if ( m_typeID == BASICTYPE_UNKNOWN || m_typeID == BASICTYPE_FLOAT ) {
-				m_vFloat.push_back(v);
+				writeFloats().push_back(v);
 				m_typeID = BASICTYPE_FLOAT;
 				return true;
 			}
@@ -163,6 +225,31 @@ namespace RiCPP {
 		}
 
 
+		/** @brief Appends float values to an array.
+		 *
+		 *  Like setFloat(), but space for @a n floats is appended
+		 *  at once. The values have to be filled in by the caller.
+		 *
+		 *  @param n Number of float values.
+		 *  @return Pointer to the first appended float, 0 if the parameter
+		 *          contains strings.
+		 */
+		inline RtFloat *appendFloats(size_t n)
+		{
+			if ( m_typeID == BASICTYPE_INTEGER ) {
+				convertIntToFloat();
+				m_typeID = BASICTYPE_FLOAT;
+			}
+			if ( m_typeID != BASICTYPE_UNKNOWN && m_typeID != BASICTYPE_FLOAT ) {
+				return 0;
+			}
+			m_typeID = BASICTYPE_FLOAT;
+			std::vector<RtFloat> &values = writeFloats();
+			size_t start = values.size();
+			values.resize(start + n);
+			return n ? &values[start] : 0;
+		}
+
 		/** @brief Sets a single integer value (appends if isArray()).
 		 *
 		 *  Converts v to a float if needed (array contains floats,
@@ -174,11 +261,11 @@ namespace RiCPP {
 		inline bool setInt(RtInt v)
 		{
 			if ( m_typeID == BASICTYPE_FLOAT ) {
-				m_vFloat.push_back((RtFloat)v);
+				writeFloats().push_back((RtFloat)v);
 				return true;
 			}
 			if ( m_typeID == BASICTYPE_UNKNOWN || m_typeID == BASICTYPE_INTEGER ) {
-				m_vInt.push_back(v);
+				writeInts().push_back(v);
 				m_typeID = BASICTYPE_INTEGER;
 				return true;
 			}
@@ -190,12 +277,13 @@ namespace RiCPP {
 		 *  Strings cannot be mixed with any other type.
 		 *
 		 *  @param v The string value to be set.
+		 *  @param tokens Token map to intern the string, 0 to copy it.
 		 *  @return true, value could be set or false, otherwise.
 		 */
-		inline bool setString(const char *v)
+		inline bool setString(const char *v, CTokenMap *tokens = 0)
 		{
 			if ( m_typeID == BASICTYPE_UNKNOWN || m_typeID == BASICTYPE_STRING ) {
-				m_vString.push_back(v);
+				m_vString.push_back(storeString(v, tokens));
 				m_typeID = BASICTYPE_STRING;
 				return true;
 			}
@@ -224,15 +312,15 @@ namespace RiCPP {
 		inline bool getFloat(RtFloat &v) const
 		{
 			if ( m_typeID == BASICTYPE_INTEGER ) {
-				if ( m_vInt.empty() )
+				if ( ints().empty() )
 					return false;
-				v = (RtFloat)m_vInt[0];
+				v = (RtFloat)ints()[0];
 				return true;
 			}
 			if ( m_typeID == BASICTYPE_FLOAT ) {
-				if ( m_vFloat.empty() )
+				if ( floats().empty() )
 					return false;
-				v = m_vFloat[0];
+				v = floats()[0];
 				return true;
 			}
 			return false;
@@ -246,15 +334,15 @@ namespace RiCPP {
 		inline bool getInt(RtInt &v) const
 		{
 			if ( m_typeID == BASICTYPE_INTEGER ) {
-				if ( m_vInt.empty() )
+				if ( ints().empty() )
 					return false;
-				v = m_vInt[0];
+				v = ints()[0];
 				return true;
 			}
 			if ( m_typeID == BASICTYPE_FLOAT ) {
-				if ( m_vFloat.empty() )
+				if ( floats().empty() )
 					return false;
-				v = (RtInt)m_vFloat[0];
+				v = (RtInt)floats()[0];
 				return true;
 			}
 			return false;
@@ -269,7 +357,23 @@ namespace RiCPP {
 		{
 			if ( m_typeID != BASICTYPE_STRING )
 				return false;
-			v = m_vString.empty() ? NULL : m_vString[0].c_str();
+			v = m_vString.empty() ? NULL : m_vString[0];
+			return true;
+		}
+
+		/** @brief Replaces the first string value.
+		 *
+		 *  Used to substitute RIB string variables after lexing.
+		 *
+		 *  @param v The new string value.
+		 *  @param tokens Token map to intern the string, 0 to copy it.
+		 *  @return true, value has been replaced, false if there is no string value.
+		 */
+		inline bool replaceString(const char *v, CTokenMap *tokens = 0)
+		{
+			if ( m_typeID != BASICTYPE_STRING || m_vString.empty() )
+				return false;
+			m_vString[0] = storeString(v, tokens);
 			return true;
 		}
 
@@ -279,6 +383,15 @@ namespace RiCPP {
 		 */
 		size_t getCard() const;
 
+		/** @brief Offers the numeric values for adoption by CParameter::set().
+		 *
+		 *  Called for the values of a token-value list, the parameter lists of
+		 *  the render state share the values instead of copying them.
+		 *
+		 *  @see CParameterValueBlocks
+		 */
+		void offerValue();
+
 		/** @brief Converts float values to integer values.
 		 *
 		 *  Sometimes integers are needed,
@@ -377,6 +490,7 @@ namespace RiCPP {
 
 		inline void clear()
 		{
+			CParameterValueBlocks::withdraw();
 			m_parameters.clear();
 			m_tokenList.clear();
 			m_valueList.clear();
@@ -388,6 +502,15 @@ namespace RiCPP {
 			m_parameters.push_back(p);
 		}
 
+		/** @brief Exchanges the parameters with already lexed ones.
+		 *
+		 *  @param params Parameters to use, gets the former parameters.
+		 */
+		inline void swapParameters(std::vector<CRibParameter> &params)
+		{
+			m_parameters.swap(params);
+		}
+
 		inline CRibParameter &back()
 		{
 			return m_parameters.back();
@@ -500,6 +623,126 @@ namespace RiCPP {
 	}; // CRibRequest
 
 
+	/** @brief Maps the handle numbers and names of a RIB file to the handles of the backend.
+	 *
+	 *  RIB writers usually number their handles sequentially, numbers are
+	 *  looked up in a dense vector. Negative and widely spread numbers
+	 *  go to a map. Names are interned as tokens by the parser and looked
+	 *  up by their token in a hash map.
+	 */
+	template<typename HandleType> class TemplRibHandleMap {
+		/** @brief Slot of the dense vector.
+		 */
+		struct SSlot {
+			HandleType m_handle; ///< Handle bound to the number.
+			bool m_bound;        ///< Handle is bound.
+			inline SSlot() : m_handle(0), m_bound(false) {}
+		};
+
+		std::vector<SSlot> m_dense;                    ///< Numbers 0 to size-1.
+		std::map<long, HandleType> m_sparse;           ///< Numbers outside the dense vector.
+		std::unordered_map<RtToken, HandleType> m_tokens; ///< Names, by token.
+		std::map<std::string, HandleType> m_names;     ///< Names without a token of their own (empty or blanks).
+
+		/** @brief Numbers that are stored in the dense vector.
+		 *
+		 *  The vector grows at most to about twice its size at a time.
+		 */
+		inline bool isDense(long number) const
+		{
+			return number >= 0 && static_cast<size_t>(number) < m_dense.size()*2 + 1024;
+		}
+
+	public:
+		/** @brief Binds a handle to a number.
+		 */
+		inline void bind(long number, HandleType handle)
+		{
+			if ( !isDense(number) ) {
+				m_sparse[number] = handle;
+				return;
+			}
+			if ( static_cast<size_t>(number) >= m_dense.size() )
+				m_dense.resize(static_cast<size_t>(number)+1);
+			m_dense[number].m_handle = handle;
+			m_dense[number].m_bound = true;
+		}
+
+		/** @brief Gets the handle bound to a number.
+		 *
+		 *  @retval handle The handle found.
+		 *  @param number Handle number.
+		 *  @return true, handle found.
+		 */
+		inline bool get(HandleType &handle, long number) const
+		{
+			if ( number >= 0 && static_cast<size_t>(number) < m_dense.size() ) {
+				if ( !m_dense[number].m_bound )
+					return false;
+				handle = m_dense[number].m_handle;
+				return true;
+			}
+			typename std::map<long, HandleType>::const_iterator i = m_sparse.find(number);
+			if ( i == m_sparse.end() )
+				return false;
+			handle = (*i).second;
+			return true;
+		}
+
+		/** @brief Binds a handle to a name.
+		 *
+		 *  @param token Token of the name, RI_NULL if the name has none of its own.
+		 *  @param name The name.
+		 *  @param handle The handle.
+		 */
+		inline void bind(RtToken token, const char *name, HandleType handle)
+		{
+			if ( token )
+				m_tokens[token] = handle;
+			else
+				m_names[noNullStr(name)] = handle;
+		}
+
+		/** @brief Gets the handle bound to a name.
+		 *
+		 *  @retval handle The handle found.
+		 *  @param token Token of the name, RI_NULL if the name has none of its own.
+		 *  @param name The name.
+		 *  @return true, handle found.
+		 */
+		inline bool get(HandleType &handle, RtToken token, const char *name) const
+		{
+			if ( token ) {
+				typename std::unordered_map<RtToken, HandleType>::const_iterator i = m_tokens.find(token);
+				if ( i == m_tokens.end() )
+					return false;
+				handle = (*i).second;
+				return true;
+			}
+			if ( m_names.empty() )
+				return false;
+			typename std::map<std::string, HandleType>::const_iterator i = m_names.find(noNullStr(name));
+			if ( i == m_names.end() )
+				return false;
+			handle = (*i).second;
+			return true;
+		}
+
+		/** @brief Removes all bindings.
+		 */
+		inline void clear()
+		{
+			m_dense.clear();
+			m_sparse.clear();
+			m_tokens.clear();
+			m_names.clear();
+		}
+	}; // TemplRibHandleMap
+
+
+	class IRibLexedSource;
+	class CRibChunkLexer;
+
 	/** @brief The Rib parser object.
 	 *
 	 *  This class implements the parsing part of the RIB binding. RIB
@@ -510,34 +753,25 @@ namespace RiCPP {
 		typedef long RibHandleNumber; ///< Representation of a handle number in a RIB file.
 
 	private:
-		typedef std::map<RibHandleNumber, RtLightHandle> NUM2LIGHT;	  ///< Maps a long to a light handle.
-		typedef std::map<std::string, RtLightHandle> STR2LIGHT;       ///< Maps a string to a light handle.
-		typedef std::map<RibHandleNumber, RtObjectHandle> NUM2OBJECT; ///< Maps a long to an object handle.
-		typedef std::map<std::string, RtObjectHandle> STR2OBJECT;     ///< Maps a string to an object handle.
-		// typedef std::map<RibHandleNumber, RtArchiveHandle> NUM2ARCHIVE; // Maps a long to an archive handle.
-		typedef std::map<std::string, RtArchiveHandle> STR2ARCHIVE;     ///< Maps a string to an archive handle.
+		typedef TemplRibHandleMap<RtLightHandle> LIGHTHANDLES;     ///< Maps numbers and names to light handles.
+		typedef TemplRibHandleMap<RtObjectHandle> OBJECTHANDLES;   ///< Maps numbers and names to object handles.
+		typedef TemplRibHandleMap<RtArchiveHandle> ARCHIVEHANDLES; ///< Maps names to archive handles.
 
-		typedef std::map<RibHandleNumber, std::string> NUM2STRING;    ///< Maps an integer to a string to encode string tokens.
+		typedef std::map<RibHandleNumber, CRibParameter> NUM2STRING;  ///< Maps an integer to a (interned) string to encode string tokens.
 
 		typedef std::string TOKENTYPE; ///< Type of the token parsed
 
-		//! Maps number to object handle
-		NUM2OBJECT m_mapObjectHandle;
-
-		//! Maps name to object handle
-		STR2OBJECT m_mapObjectStrHandle;
-
-		//! Maps number to light handle
-		NUM2LIGHT m_mapLightHandle;
+		//! Interned names of the string handles
+		CTokenMap m_handleNames;
 
-		//! Maps name to light handle
-		STR2LIGHT m_mapLightStrHandle;
+		//! Maps number and name to object handle
+		OBJECTHANDLES m_objectHandles;
 
-		// Maps number to archive handle
-		// NUM2ARCHIVE m_mapArchiveHandle;
+		//! Maps number and name to light handle
+		LIGHTHANDLES m_lightHandles;
 
 		//! Maps name to archive handle
-		STR2ARCHIVE m_mapArchiveStrHandle;
+		ARCHIVEHANDLES m_archiveHandles;
 
 		//! @brief Frontnd values the parser needs to know.
 		IRibParserCallback *m_parserCallback;
@@ -583,17 +817,22 @@ namespace RiCPP {
 		NUM2STRING m_stringMap;                      ///< Map of string tokens
 
 		/** @brief Request handler for each token (e.g. "Sphere")
+		 *
+		 *  A function local static, it is constructed and destructed once also if
+		 *  the parser is linked to an executable and to a plugin loaded by it.
+		 *
+		 *  @return Map request token -> request handler.
 		 */
-		static std::map<std::string, CRibRequest *> s_requestMap;
+		static std::map<std::string, CRibRequest *> &requestMap();
 
-		/** @brief Calls the handler routine for a request token using s_requestMap.
+		/** @brief Calls the handler routine for a request token using requestMap().
 		 *
 		 *  @param request The string of request token
 		 *  @return False, no CRibRequest handler found for @a request. True, handler found and called.
 		 */
 		bool call(const std::string &request);
 
-		/** @brief Initializes s_requestMap.
+		/** @brief Initializes requestMap().
 		 */
 		void initRequestMap();
 
@@ -663,8 +902,58 @@ namespace RiCPP {
 
 		int nextToken();
 		int parseNextCall();
+		int callNextLexed();
+		void parseRequests();
+		void parseLexed(IRibLexedSource &source);
 		void parseFile();
 
+		/** @brief Requests lexed in parallel or asynchronously, 0 if parsing sequentially.
+		 */
+		IRibLexedSource *m_lexedSource;
+		CRibChunkLexer *m_lexedChunk; ///< Current chunk of m_lexedSource.
+		size_t m_lexedRequest; ///< Next request to call of the current chunk.
+		long m_lexedLineBase;  ///< Line number of the start of the current chunk.
+
+		/** @brief Frames selected by the parameters "frames" and "excludeframes" of ReadArchive.
+		 */
+		CRibFrameSelection m_frameSelection;
+		bool m_selectFrames;           ///< Requests of frames not selected are skipped by call() (no frame index).
+		bool m_skipFrame;              ///< Requests of the current frame are skipped.
+		bool m_inFrame;                ///< Inside a frame block at archive level 0 (m_selectFrames).
+		RtInt m_frameNo;               ///< Number of the current frame (m_selectFrames).
+		int m_frameArchiveDepth;       ///< Archive nesting (m_selectFrames).
+		unsigned long m_wantedFrames;  ///< Number of frames of a positive list, 0 if unknown (m_selectFrames).
+		std::set<RtInt> m_framesFound; ///< Selected frames found (m_selectFrames).
+		bool m_stopParsing;            ///< All frames of the positive list are found, parsing stops.
+
+		/** @brief Tests if a request is called if frames are selected.
+		 *
+		 *  Tracks FrameBegin/FrameEnd and ArchiveBegin/ArchiveEnd to skip the
+		 *  requests of frames not selected, sets m_stopParsing if all frames
+		 *  of a positive list are found.
+		 *
+		 *  @param request The request (e.g. "FrameBegin").
+		 *  @return true, call the request.
+		 */
+		bool selectRequest(const std::string &request);
+
+		/** @brief Parses the selected frames using a frame index.
+		 *
+		 *  The index is loaded from the index file or built by scanning
+		 *  the rib stream (and stored to the index file).
+		 *
+		 *  @return false, there is no index (e.g. standard input or binary rib),
+		 *          the stream is positioned at its start.
+		 */
+		bool parseFrameIndex();
+
+		/** @brief Parses a part of the rib stream.
+		 *
+		 *  @param range The part to parse.
+		 *  @return false, the stream could not be positioned.
+		 */
+		bool parseRange(const CRibFrameIndex::SRange &range);
+
 		/** @brief List of parameters currently parsed.
 		 */
 		CParameterList m_parameterList;
@@ -692,17 +981,54 @@ namespace RiCPP {
 		 *  @return Next character to examine.
 		 */
 		unsigned char getchar();
+
+		/** @brief Gets the next byte of binary data from the input stream.
+		 *
+		 *  Unlike getchar(), the byte is not examined (no line counting,
+		 *  no conversion of carriage returns).
+		 *
+		 *  @return Next byte.
+		 */
+		unsigned char getbyte();
+
+		/** @brief Reads a block of binary data from the input stream.
+		 *
+		 *  Used for binary encoded arrays, the bytes are not examined
+		 *  (no line counting).
+		 *
+		 *  @param buf Destination of the bytes.
+		 *  @param n Number of bytes to read.
+		 *  @return false, EOF reached before @a n bytes are read.
+		 */
+		bool getBytes(unsigned char *buf, unsigned long n);
 		
+		/** @brief Interns the name of a handle.
+		 *
+		 *  Lookups use m_handleNames.find(), names without a token of their own
+		 *  are not found there.
+		 *
+		 *  @param name Name of the handle.
+		 *  @return Token of the name, RI_NULL if the name has no token of its own
+		 *          (empty or with leading or trailing blanks).
+		 */
+		RtToken handleToken(const char *name);
+
+		/** @brief Token map to intern the string values.
+		 *
+		 *  @return The token map of the render state, 0 if there is no render state.
+		 */
+		inline CTokenMap *stringTokens()
+		{
+			return m_renderState ? &m_renderState->tokenMap() : 0;
+		}
+
 		/** @brief Clears the handle maps at the start of the parsing.
 		 */
 		inline void clearHandleMaps()
 		{
-			m_mapLightHandle.clear();
-			m_mapLightStrHandle.clear();
-			m_mapObjectHandle.clear();
-			m_mapObjectStrHandle.clear();
-			// m_mapArchiveHandle.clear();
-			m_mapArchiveStrHandle.clear();
+			m_lightHandles.clear();
+			m_objectHandles.clear();
+			m_archiveHandles.clear();
 		}
 
 		virtual bool bindObjectHandle(RtObjectHandle handle, RtInt number);
@@ -755,6 +1081,17 @@ namespace RiCPP {
 			m_lineNo = 0;
 			m_hasPutBack = false;
 			m_putBack = 0;
+			m_lexedSource = 0;
+			m_lexedChunk = 0;
+			m_lexedRequest = 0;
+			m_lexedLineBase = 1;
+			m_selectFrames = false;
+			m_skipFrame = false;
+			m_inFrame = false;
+			m_frameNo = 0;
+			m_frameArchiveDepth = 0;
+			m_wantedFrames = 0;
+			m_stopParsing = false;
 			m_request.init(*this);
 			initRequestMap();
 		}
@@ -856,6 +1193,11 @@ namespace RiCPP {
 		virtual bool canParse(RtString name);
 
 		/** @brief Parses a resource (already opend by canParse())
+		 *
+		 *  The string parameters "frames" and "excludeframes" select frames
+		 *  by positive and negative lists (@see CRibFrameSelection), the rib code
+		 *  outside of the frames is parsed as well. If the resource is a file,
+		 *  a frame index is used to skip the frames not selected.
 		 *
 		 *  @param callback The callback for comments (@see IRiCPP::readArchiveV())
 		 *  @param params   Parameters of IRiCPP::readArchiveV()
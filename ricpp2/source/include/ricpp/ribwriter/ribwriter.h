@@ -42,6 +42,8 @@
 #include "ricpp/ricontext/ribelements.h"
 #endif // _RICPP_RICONTEXT_RIBELEMENTS_H
 
+#include <sstream>
+
 namespace RiCPP {
 
 #define RIBWRITER_NAME "ribwriter"
@@ -59,6 +61,27 @@ protected:
 	typedef CBaseRenderer TypeParent;
 	
 private:
+	/** @brief Ignores the requests written, used to write requests only to compare them.
+	 */
+	class CNoRequestNotification : public IRequestNotification {
+	public:
+		inline virtual void requestWritten(EnumRequests aRequest) {}
+	};
+
+	/** @brief A primitive written before, used to deduplicate geometry.
+	 */
+	struct SDedupEntry {
+		unsigned long m_count;     ///< Number of occurrences.
+		unsigned long long m_size; ///< Bytes written for the first occurrence.
+		std::string m_rib;         ///< ASCII RIB of the primitive, compared to detect hash collisions.
+		std::string m_handle;      ///< Object handle, empty if the object is not defined yet.
+		inline SDedupEntry() : m_count(0), m_size(0) {}
+	};
+
+	/** @brief Key of a primitive, two 64 bit hashes of its ASCII RIB.
+	 */
+	typedef std::pair<unsigned long long, unsigned long long> TypeDedupKey;
+
 	CRibElementsWriter *m_writer;
 	CFrontStreambuf *m_buffer;
 	std::string m_cmd;
@@ -78,6 +101,12 @@ private:
 	RtToken RI_QUAL_INDENT_STRING;
 	RtToken RI_QUAL_SUPPRESS_OUTPUT;
 	RtToken RI_QUAL_BINARY_OUTPUT;
+	RtToken RI_QUAL_FIXEDPOINT_ABS;
+	RtToken RI_QUAL_FIXEDPOINT_REL;
+	RtToken RI_QUAL_FIXEDPOINT_VARS;
+	RtToken RI_QUAL_DEDUP;
+	RtToken RI_QUAL_SPLIT_ARCHIVES;
+	RtToken RI_QUAL_SPLIT_PREFIX;
 
 	RtToken RI_POSTPONE_PROCEDURALS;
 	RtToken RI_POSTPONE_OBJECTS;
@@ -89,6 +118,12 @@ private:
 	RtToken RI_INDENT_STRING;
 	RtToken RI_SUPPRESS_OUTPUT;
 	RtToken RI_BINARY_OUTPUT;
+	RtToken RI_FIXEDPOINT_ABS;
+	RtToken RI_FIXEDPOINT_REL;
+	RtToken RI_FIXEDPOINT_VARS;
+	RtToken RI_DEDUP;
+	RtToken RI_SPLIT_ARCHIVES;
+	RtToken RI_SPLIT_PREFIX;
 
 	bool m_suppressOutput;
 	bool m_controlSuppressOutput;
@@ -109,6 +144,94 @@ private:
 	std::string m_indentString;
 
 	bool m_binary;
+	RtFloat m_fixedPointAbs;        ///< Absolute error bound of fixed-point float arrays in binary RIB (0 not used)
+	RtFloat m_fixedPointRel;        ///< Relative error bound of fixed-point float arrays in binary RIB (0 not used)
+	std::string m_fixedPointVars;   ///< Parameters written as fixed-point float arrays, separated by blanks
+
+	/** @brief Sets the binary and fixed-point settings of a new or changed m_writer.
+	 */
+	void setupWriter();
+
+	RtInt m_dedupMinSize;    ///< Minimal size (bytes of ASCII RIB) of a deduplicated primitive, 0 no deduplication
+	std::map<TypeDedupKey, SDedupEntry> m_dedupEntries; ///< Primitives written in the current world block
+	unsigned long m_dedupObjects;   ///< Number of objects defined by deduplication
+	unsigned long m_dedupInstances; ///< Number of primitives replaced by ObjectInstance
+	long long m_dedupSaved;         ///< Bytes saved by deduplication
+	CNoRequestNotification m_noNotification; ///< Notification of the writer used for comparison
+
+	/** @brief Writes a primitive, repeated ones are replaced by object instances.
+	 *
+	 *  The third occurrence of an identical primitive (request and parameters)
+	 *  within a world block is written as object definition
+	 *  (ObjectBegin/ObjectEnd) and instanced, all following occurrences are
+	 *  only instanced. The object is only defined, if the primitive is larger
+	 *  than the object requests, so that the next instance pays back the
+	 *  definition. The instance is written at the place of the primitive,
+	 *  so attributes and transformations are the same. The RIB of each
+	 *  candidate is kept until the end of the world block, identical hashes
+	 *  of different primitives are written as they are.
+	 *
+	 *  @param obj The primitive.
+	 *  @param canInstance false, if the primitive depends on attributes bound
+	 *         at the object definition (like the basis of bicubic patches).
+	 *  @return false, the primitive was not written.
+	 */
+	bool writeDeduplicated(const CRManInterfaceCall &obj, bool canInstance = true);
+
+	/** @brief Reports the bytes saved by deduplication.
+	 */
+	void reportDeduplication();
+
+	RtInt m_splitMinSize;        ///< Minimal size (bytes) of an attribute block written to an archive, 0 no splitting
+	std::string m_splitPrefix;   ///< Prefix of the archive files, empty: derived from the output file
+	std::string m_outputName;    ///< Name of the output file, empty for stdout
+	CRibElementsWriter *m_splitMainWriter; ///< Writer of the main RIB while an attribute block is buffered by m_writer, 0 no block is buffered
+	std::stringbuf m_splitBuffer;          ///< Buffered attribute block
+	CMatrix3D m_splitInverse;    ///< Maps world to object space of the buffered block
+	bool m_splitValid;           ///< The buffered block can be written to an archive
+	bool m_splitHasBound;        ///< m_splitBound contains the bound of at least one primitive
+	RtBound m_splitBound;        ///< Bound of the primitives of the buffered block in its object space
+	std::vector<TypeDedupKey> m_splitDedupKeys; ///< Deduplicated objects defined within the buffered block
+	unsigned long m_splitNumber;   ///< Number of the last archive of the current frame
+	unsigned long m_splitArchives; ///< Number of archives written
+	unsigned long long m_splitBytes; ///< Bytes written to archives
+
+	/** @brief Starts to buffer a top level attribute block (AttributeBegin in the world block).
+	 */
+	void beginSplit();
+
+	/** @brief Tests a request of the buffered attribute block.
+	 *
+	 *  The bounds of the primitives are added to m_splitBound. Requests
+	 *  that cannot be moved to an archive (e.g. lights, motion blocks,
+	 *  declarations, unbounded primitives) prevent the splitting.
+	 *
+	 *  @param aRequest Request to test.
+	 */
+	void testSplit(const CRManInterfaceCall &aRequest);
+
+	/** @brief Ends the buffered attribute block.
+	 *
+	 *  The block is either written to an archive and replaced by a
+	 *  Procedural "DelayedReadArchive" with its bound, or it is written
+	 *  to the main RIB.
+	 *
+	 *  @param toArchive false, the block is written to the main RIB.
+	 */
+	void endSplit(bool toArchive);
+
+	/** @brief Writes an attribute block to a new archive file.
+	 *
+	 *  @param rib The attribute block.
+	 *  @retval filename Name of the archive file, relative to the directory of the main RIB
+	 *          if the archive is located there.
+	 *  @return true, the archive is written.
+	 */
+	bool writeSplitArchive(const std::string &rib, std::string &filename);
+
+	/** @brief Reports the attribute blocks written to archives.
+	 */
+	void reportSplitArchives();
 
 	bool willExecuteMacro(RtString name);
 
@@ -140,6 +263,10 @@ protected:
 	bool postTestValid() const;
 	void writePrefix(bool isArchiveRecord=false);
 
+	/** @brief Processes a request, buffers the attribute blocks to split (control split-archives).
+	 */
+	virtual void processRequest(CRManInterfaceCall *aRequest, bool immediatly = false);
+
 public:
 
 	CRibWriter();
@@ -39,6 +39,7 @@
 #endif //_RICPP_TOOLS_INLINETOOLS_H
 
 #include <vector>
+#include <unordered_map>
 
 namespace RiCPP {
 
@@ -104,34 +105,67 @@ private:
 	CTokenMap m_tokens;           ///< RtToken as handles
 	std::string m_prefix;         ///< Prefix for the tokens
 
-	inline typename TypeHandleStack::const_reverse_iterator rfind(RtToken tok, bool toMark) const
+	typedef std::vector<size_t> TypePositions;
+
+	std::unordered_map<RtToken, TypePositions> m_index; ///< Stack positions (ascending) of the objects of a handle.
+	TypePositions m_marks;                              ///< Stack positions (ascending) of the markers.
+
+	/** @brief Finds the stack position of the top most object with handle @a tok.
+	 *
+	 *  @param tok Handle of the object.
+	 *  @param toMark Search only above the top most marker.
+	 *  @param pos Position found.
+	 *  @return true, object found.
+	 */
+	inline bool rfind(RtToken tok, bool toMark, size_t &pos) const
 	{
-		typename TypeHandleStack::const_reverse_iterator i;
+		typename std::unordered_map<RtToken, TypePositions>::const_iterator i = m_index.find(tok);
+		if ( i == m_index.end() )
+			return false;
+		pos = (*i).second.back();
+		return !(toMark && !m_marks.empty() && pos < m_marks.back());
+	}
 
-		for( i = m_stack.rbegin(); i != m_stack.rend(); i++ ) {
-			if ( (*i) && (*i)->handle() == tok )
-				break;
-			if ( !(*i) && toMark )
-				return m_stack.rend();
-		}
+	/** @brief Pushes an object or a marker (0).
+	 */
+	inline void push(ValueType *v)
+	{
+		if ( v )
+			m_index[v->handle()].push_back(m_stack.size());
+		else
+			m_marks.push_back(m_stack.size());
+		m_stack.push_back(v);
+	}
 
-		return i;
+	/** @brief Pops the top most object or marker (0).
+	 */
+	inline ValueType *pop()
+	{
+		ValueType *v = back();
+		m_stack.pop_back();
+		if ( v ) {
+			typename std::unordered_map<RtToken, TypePositions>::iterator i = m_index.find(v->handle());
+			(*i).second.pop_back();
+			if ( (*i).second.empty() )
+				m_index.erase(i);
+		} else {
+			m_marks.pop_back();
+		}
+		return v;
 	}
 
-	inline typename TypeHandleStack::reverse_iterator rfind(RtToken tok, bool toMark)
+	/** @brief Rebuilds the positions after an object was removed inside the stack.
+	 */
+	inline void reindex()
 	{
-		/** @todo use the typename TypeHandleStack::const_reverse_iterator rfind() with const away cast
-		 */
-		typename TypeHandleStack::reverse_iterator i;
-		
-		for( i = m_stack.rbegin(); i != m_stack.rend(); i++ ) {
-			if ( (*i) && (*i)->handle() == tok )
-				break;
-			if ( !(*i) && toMark )
-				return m_stack.rend();
+		m_index.clear();
+		m_marks.clear();
+		for ( size_t pos = 0; pos < m_stack.size(); ++pos ) {
+			if ( m_stack[pos] )
+				m_index[m_stack[pos]->handle()].push_back(pos);
+			else
+				m_marks.push_back(pos);
 		}
-		
-		return i;
 	}
 
 public:
@@ -139,7 +173,7 @@ public:
 		m_maxHandleIdx(0),
 		m_prefix(noNullStr(prefix))
 	{
-		m_stack.push_back(0);
+		push(0);
 	}
 	
 	inline ~TemplHandleStack()
@@ -196,9 +230,9 @@ public:
 
 	inline ValueType *find(RtToken tok, bool toMark=false)
 	{
-		typename TypeHandleStack::reverse_iterator i = rfind(tok, toMark);
-		if ( i != m_stack.rend() )
-			return (*i);
+		size_t pos;
+		if ( rfind(tok, toMark, pos) )
+			return m_stack[pos];
 		return 0;
 	}
 
@@ -209,9 +243,9 @@ public:
 
 	inline const ValueType *find(RtToken tok, bool toMark=false) const
 	{
-		typename TypeHandleStack::const_reverse_iterator i = rfind(tok, toMark);
-		if ( i != m_stack.rend() )
-			return (*i);
+		size_t pos;
+		if ( rfind(tok, toMark, pos) )
+			return m_stack[pos];
 		return 0;
 	}
 
@@ -222,10 +256,11 @@ public:
 
 	inline bool deleteObject(RtToken tok, bool toMark=false)
 	{
-		typename TypeHandleStack::const_reverse_iterator i = rfind(tok, toMark);
-		if ( i != m_stack.rend() ) {
-			delete (*i);
-			m_stack.erase(i);
+		size_t pos;
+		if ( rfind(tok, toMark, pos) ) {
+			delete m_stack[pos];
+			m_stack.erase(m_stack.begin()+pos);
+			reindex();
 			return true;
 		}
 		return false;
@@ -245,7 +280,7 @@ public:
 
 		RtToken tok = newHandle(o->handle());
 		o->handle(tok);
-		m_stack.push_back(o);
+		push(o);
 		return tok; 
 	}
 
@@ -259,20 +294,19 @@ public:
 		}
 
 		o->handle(handle);
-		m_stack.push_back(o);
+		push(o);
 		return handle; 
 	}
 
 	inline void mark()
 	{
-		m_stack.push_back(0);
+		push(0);
 	}
 	
 	inline void clearToMark()
 	{
 		while ( !m_stack.empty() ) {
-			ValueType *v = back();
-			m_stack.pop_back();
+			ValueType *v = pop();
 			if ( v == 0 ) {
 				return;
 			}
@@ -283,8 +317,7 @@ public:
 	inline void clear()
 	{
 		while ( !m_stack.empty() ) {
-			ValueType *v = back();
-			m_stack.pop_back();
+			ValueType *v = pop();
 			if ( v != 0 ) {
 				delete v;
 			}
@@ -295,8 +328,7 @@ public:
 	{
 		result.clear();
 		while ( !m_stack.empty() ) {
-			ValueType *v = back();
-			m_stack.pop_back();
+			ValueType *v = pop();
 			if ( v == 0 ) {
 				return;
 			}
@@ -308,6 +340,17 @@ public:
 	{
 		return m_maxHandleIdx;
 	}
+
+	/** @brief Skips handle numbers, as if @a n handles were created.
+	 *
+	 *  Used if a part of a stream is processed in a separate context.
+	 *
+	 *  @param n Number of handles to skip.
+	 */
+	inline void skipHandles(unsigned long n)
+	{
+		m_maxHandleIdx += n;
+	}
 	
 	inline bool empty() const {
 		typename TypeHandleStack::const_iterator i = m_stack.begin();
@@ -35,12 +35,65 @@
 #endif // _RICPP_DECLARATION_DECLDICT_H
 
 #include <cassert>
+#include <memory>
 
 namespace RiCPP {
 	
 	class CBicubicVectors;
 	class CUVBSplineBasis;
 	
+	/** @brief Shared, immutable block of integer parameter values.
+	 */
+	typedef std::shared_ptr<const std::vector<RtInt> > IntBlock_type;
+
+	/** @brief Shared, immutable block of float parameter values.
+	 */
+	typedef std::shared_ptr<const std::vector<RtFloat> > FloatBlock_type;
+
+	// ------------------------------------------------------------------------
+	/** @brief Value blocks offered for adoption by CParameter::set().
+	 *
+	 *  A producer of parameter values (e.g. the RIB parser) can offer the blocks
+	 *  holding the values it passes as RtPointer to an interface call. CParameter::set()
+	 *  shares an offered block instead of copying the values, if the data pointer and the
+	 *  number of values match. The offers are thread local, the producer withdraws
+	 *  them after the interface call.
+	 */
+	class CParameterValueBlocks {
+	public:
+		/** @brief Offers a block of integer values.
+		 *
+		 *  @param block The block, must not be changed while offered or shared.
+		 */
+		static void offer(const IntBlock_type &block);
+
+		/** @brief Offers a block of float values.
+		 *
+		 *  @param block The block, must not be changed while offered or shared.
+		 */
+		static void offer(const FloatBlock_type &block);
+
+		/** @brief Withdraws all offers of the current thread.
+		 */
+		static void withdraw();
+
+		/** @brief Finds an offered block of integer values.
+		 *
+		 *  @param data Pointer to the first value.
+		 *  @param n Number of values.
+		 *  @return The block starting at @a data with @a n values, empty if there is none.
+		 */
+		static IntBlock_type findInts(RtPointer data, unsigned long n);
+
+		/** @brief Finds an offered block of float values.
+		 *
+		 *  @param data Pointer to the first value.
+		 *  @param n Number of values.
+		 *  @return The block starting at @a data with @a n values, empty if there is none.
+		 */
+		static FloatBlock_type findFloats(RtPointer data, unsigned long n);
+	}; // CParameterValueBlocks
+
 	// ------------------------------------------------------------------------
 	/** @brief Class to store a parameter value with its declaration.
 	 *
@@ -51,6 +104,8 @@ namespace RiCPP {
 	 *  descriptor has been changed and the value type is color.
 	 *
 	 *  A parameter can be either a vector of integer, flaot or string values.
+	 *  Integer and float values are kept in shared immutable blocks, copies of
+	 *  a parameter share them.
 	 */
 	class CParameter {
 	private:
@@ -58,11 +113,14 @@ namespace RiCPP {
 		IndexType m_position;               ///< Original position within a parameter list.
 		std::string m_parameterName;        ///< Parametername as found in list
 		
-		std::vector<RtInt> m_ints;          ///< Container for integer values.
-		std::vector<RtFloat> m_floats;      ///< Container for float values.
+		IntBlock_type m_ints;               ///< Container for integer values.
+		FloatBlock_type m_floats;           ///< Container for float values.
 		std::vector<std::string> m_strings; ///< Container for string values.
 		std::vector<RtString> m_stringPtrs; ///< Containter for the pointers to the string values.
 
+		static const std::vector<RtInt> ms_noInts;     ///< Empty values for ints().
+		static const std::vector<RtFloat> ms_noFloats; ///< Empty values for floats().
+
 		/** @brief Fills the m_stringPtrs with pointers to the c-strings of m_strings.
 		 */
 		void copyStringPtr();
@@ -97,6 +155,16 @@ namespace RiCPP {
 			assign(param);
 		}
 
+		/** @brief Move constructor, takes over the values and the declaration.
+		 *
+		 *  @param param Parameter to move, is empty afterwards
+		 */
+		inline CParameter(CParameter &&param) noexcept
+			: m_declaration(0), m_position(0)
+		{
+			take(param);
+		}
+
 		/** @brief Copy constructor for remapping
 		 *
 		 *  @param param Parameter to copy
@@ -188,6 +256,19 @@ namespace RiCPP {
 		 */
 		CParameter &operator=(const CParameter &p);
 
+		/** @brief Move assignment, takes over the values and the declaration.
+		 *
+		 *  @param p The parameter to move, is empty afterwards.
+		 *  @return *this
+		 */
+		CParameter &operator=(CParameter &&p) noexcept;
+
+		/** @brief Takes over the contents of a parameter.
+		 *
+		 *  @param p The parameter to take, is empty afterwards.
+		 */
+		void take(CParameter &p) noexcept;
+
 		/** @brief Assigns a parameter to this object and remaps the declarations to a new dictonary
 		 *
 		 *  Used to copy a parameter (of controls, options) from the frontend to the backend.
@@ -418,7 +499,7 @@ namespace RiCPP {
 		 *
 		 *  @return Integer values.
 		 */
-		inline const std::vector<RtInt> &ints() const { return m_ints; }
+		inline const std::vector<RtInt> &ints() const { return m_ints ? *m_ints : ms_noInts; }
 
 		/** @brief Gets the float values.
 		 *
@@ -426,7 +507,19 @@ namespace RiCPP {
 		 *
 		 *  @return Float values.
 		 */
-		inline const std::vector<RtFloat> &floats() const { return m_floats; }
+		inline const std::vector<RtFloat> &floats() const { return m_floats ? *m_floats : ms_noFloats; }
+
+		/** @brief Gets the shared block of the integer values.
+		 *
+		 *  @return Block of the integer values, empty if there are none.
+		 */
+		inline const IntBlock_type &intBlock() const { return m_ints; }
+
+		/** @brief Gets the shared block of the float values.
+		 *
+		 *  @return Block of the float values, empty if there are none.
+		 */
+		inline const FloatBlock_type &floatBlock() const { return m_floats; }
 
 		/** @brief Gets the string values.
 		 *
@@ -482,21 +575,19 @@ namespace RiCPP {
 	// ------------------------------------------------------------------------
 	/** @brief Stores a list of parameters.
 	 *
-	 *  Used to store the token/value pairs of a ri request.
+	 *  Used to store the token/value pairs of a ri request. The parameters
+	 *  are kept in a flat vector, a ri request has only a few of them, so they
+	 *  are searched linearly. Pointers to parameters are invalidated
+	 *  if the list is changed.
 	 */
 	class CParameterList {
 	public:
-		typedef std::list<CParameter>::iterator iterator;             ///< Iterator for parameters.
-		typedef std::list<CParameter>::const_iterator const_iterator; ///< Constant iterator for parameters.
-		typedef std::list<CParameter>::size_type size_type;           ///< Type for the size of the parameter list.
+		typedef std::vector<CParameter>::iterator iterator;             ///< Iterator for parameters.
+		typedef std::vector<CParameter>::const_iterator const_iterator; ///< Constant iterator for parameters.
+		typedef std::vector<CParameter>::size_type size_type;           ///< Type for the size of the parameter list.
 
 	private:
-		/** @brief Type to map tokens to their parameters.
-		 */
-		typedef std::map<RtToken, CParameter *> Map_type;
-		
-		std::list<CParameter> m_params;    ///< List of parameters
-		Map_type m_paramMap;               ///< Maps tokens to their parameters in m_params.
+		std::vector<CParameter> m_params;  ///< List of parameters
 		std::vector<RtToken> m_tokenPtr;   ///< Vector of the tokens for ri token/value parameters.
 		std::vector<RtPointer> m_paramPtr; ///< Pointer to the values for ri token/value parameters.
 		
@@ -523,6 +614,14 @@ namespace RiCPP {
 		{
 			assign(params);
 		}
+
+		/** Move constructor.
+		 *  @param params Parameterlist to move, is empty afterwards
+		 */
+		inline CParameterList(CParameterList &&params)
+		{
+			take(params);
+		}
 		
 		/** @brief Copy constructor, remaps
 		 *  
@@ -572,6 +671,19 @@ namespace RiCPP {
 		 */
 		CParameterList &operator=(const CParameterList &params);
 
+		/** @brief Move assignment.
+		 *
+		 *  @param params Parameter list to move, is empty afterwards.
+		 *  @return *this
+		 */
+		CParameterList &operator=(CParameterList &&params);
+
+		/** @brief Takes over the parameters of a list.
+		 *
+		 *  @param params Parameter list to take, is empty afterwards.
+		 */
+		void take(CParameterList &params);
+
 		/** @brief Assigns a parameterlist to this object and remaps the declarations to a new dictonary
 		 *
 		 *  Used to copy a parameterlist (of controls, options) from the frontend to the backend.
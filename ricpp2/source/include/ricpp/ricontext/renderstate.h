@@ -66,6 +66,14 @@
 #include "ricpp/ricontext/inputstate.h"
 #endif // _RICPP_RICONTEXT_INPUTSTATE_H
 
+#ifndef _RICPP_RICONTEXT_REQUESTSTATS_H
+#include "ricpp/ricontext/requeststats.h"
+#endif // _RICPP_RICONTEXT_REQUESTSTATS_H
+
+#ifndef _RICPP_TOOLS_TRACER_H
+#include "ricpp/tools/tracer.h"
+#endif // _RICPP_TOOLS_TRACER_H
+
 #ifndef _RICPP_RICPP_VARSUBST_H
 #include "ricpp/ricpp/varsubst.h"
 #endif // _RICPP_RICPP_VARSUBST_H
@@ -112,6 +120,13 @@ namespace RiCPP {
 		long m_lineNo;                                 ///< Current line number in the file, -1 if not available.
 
 		bool m_cacheFileArchives;                      ///< Cache archive files
+		RtInt m_parallelLexing;                        ///< Number of threads to lex rib files (0, 1: sequential parsing)
+		RtInt m_parallelLexingChunk;                   ///< Minimal size in bytes of a rib file chunk lexed by a thread
+		RtInt m_asyncParsing;                          ///< Number of lexed chunks queued by the reading thread (0: sequential parsing)
+		bool m_storeFrameIndex;                        ///< Store the frame index of a rib file beside the file
+
+		CRequestStatistics m_statistics;               ///< Statistics of the requests (Control "statistics")
+		std::string m_traceFilename;                   ///< The trace is written to this file at the end of the context (Control "trace" "file"), empty: not written
 
 		std::vector<RtToken> m_solidTypes;             ///< Stack with the nested types of solid blocks (if currently opened solid block)
 
@@ -233,7 +248,195 @@ namespace RiCPP {
 		
 		void contextReset();
 
-		/** @brief Parser for RIB if-expression.
+		/** @brief Compiled RIB if-expression.
+		 *
+		 * The expression string of an IfBegin or ElseIfBegin is compiled once
+		 * by CIfExprParser into a small tree of nodes, which is evaluated
+		 * against the current options and attributes each time the same string
+		 * is used again (see CRenderState::eval()). The evaluation follows the
+		 * interpreting parser exactly, including which operand slot a value is
+		 * written to, and does not need to scan the string again.
+		 */
+		class CIfExpr {
+		public:
+			/** @brief Kinds of nodes and binary operators.
+			 */
+			enum EnumOpcode {
+				OP_CONST = 0,   ///< Number, true, false or quoted string (m_value).
+				OP_VAR,         ///< Variable $name (m_name).
+				OP_CALCVAR,     ///< Variable with a calculated name $(expr), name is m_args[0].
+				OP_DEFINED,     ///< defined(name) (m_name).
+				OP_STRLIST,     ///< Sequence of variables or strings (m_args), appended to the first one.
+				OP_CONCAT,      ///< concat(expr, expr) (m_args).
+				OP_NEGATE,      ///< Unary '-' or '!' of m_args[0].
+				OP_CHAIN,       ///< m_args[0] m_ops[1] m_args[1] m_ops[2] m_args[2] ..., left associative.
+
+				OP_LOG_OR,      ///< '||'
+				OP_LOG_AND,     ///< '&&'
+				OP_OR,          ///< '|'
+				OP_XOR,         ///< '^'
+				OP_AND,         ///< '&'
+				OP_EQ,          ///< '=='
+				OP_NEQ,         ///< '!='
+				OP_GT,          ///< '>'
+				OP_GE,          ///< '>='
+				OP_LT,          ///< '<'
+				OP_LE,          ///< '<='
+				OP_MATCH,       ///< '=~'
+				OP_ADD,         ///< '+'
+				OP_SUB,         ///< '-'
+				OP_MUL,         ///< '*'
+				OP_DIV,         ///< '/'
+				OP_POW          ///< '**'
+			};
+
+			/** @brief A node of the expression tree, children are indices of m_nodes.
+			 */
+			struct SNode {
+				EnumOpcode m_opcode;            ///< Kind of the node.
+				CValue m_value;              ///< Value of a constant.
+				std::string m_name;          ///< Name of a variable.
+				std::vector<size_t> m_args;  ///< Operands.
+				std::vector<EnumOpcode> m_ops;  ///< Binary operators of a chain, m_ops[0] is not used.
+				inline SNode(EnumOpcode anOpcode) : m_opcode(anOpcode) {}
+			};
+
+			static const size_t npos = static_cast<size_t>(-1); ///< No node.
+
+		private:
+			std::string m_source;       ///< The expression string (key of the cache).
+			std::vector<SNode> m_nodes; ///< All nodes, the root is m_root.
+			size_t m_root;              ///< Root node, npos if the expression is empty.
+			bool m_valid;               ///< false, if the expression could not be parsed.
+
+			bool evalNode(const CRenderState &state, size_t aNode, CValue &val) const;
+
+		public:
+			inline CIfExpr(RtString aSource)
+				: m_source(noNullStr(aSource)), m_root(npos), m_valid(false)
+			{
+			}
+
+			inline const char *source() const { return m_source.c_str(); }
+
+			inline size_t newNode(EnumOpcode anOpcode)
+			{
+				m_nodes.push_back(SNode(anOpcode));
+				return m_nodes.size()-1;
+			}
+
+			inline SNode &node(size_t aNode) { return m_nodes[aNode]; }
+
+			/** @brief Appends a binary operator and its right operand to a chain.
+			 *
+			 * @param aChain Chain of the current operator level, npos if
+			 * not yet created. The chain is created with @a aNode as the first operand.
+			 * @param aNode Left operand, set to @a aChain.
+			 * @param anOpcode The binary operator.
+			 * @param anOperand The right operand.
+			 */
+			inline void appendOperand(size_t &aChain, size_t &aNode, EnumOpcode anOpcode, size_t anOperand)
+			{
+				if ( aChain == npos ) {
+					aChain = newNode(OP_CHAIN);
+					m_nodes[aChain].m_args.push_back(aNode);
+					m_nodes[aChain].m_ops.push_back(OP_CHAIN);
+					aNode = aChain;
+				}
+				m_nodes[aChain].m_args.push_back(anOperand);
+				m_nodes[aChain].m_ops.push_back(anOpcode);
+			}
+
+			inline void root(size_t aNode, bool isValid)
+			{
+				m_root = aNode;
+				m_valid = isValid;
+			}
+
+			/** @brief Evaluates the expression.
+			 *
+			 * @param state Render state to get the variables from.
+			 * @return false, if the expression is false, a variable was not
+			 * found or the expression string was not valid.
+			 */
+			bool eval(const CRenderState &state) const;
+		}; // CIfExpr
+
+		/** @brief Compares the expression strings of the cache of compiled if-expressions.
+		 */
+		struct SIfExprLess {
+			inline bool operator()(const char *s1, const char *s2) const
+			{
+				return strcmp(s1, s2) < 0;
+			}
+		};
+
+		static const size_t MAX_IFEXPR_CACHE = 1024; ///< Cache of compiled if-expressions is cleared, if it grows beyond this size.
+		typedef std::map<const char *, CIfExpr *, SIfExprLess> TypeIfExprCache; ///< Compiled if-expressions by their strings.
+		mutable TypeIfExprCache m_ifExprCache; ///< Compiled if-expressions, owns the CIfExpr, keys are CIfExpr::source().
+
+		void clearIfExprCache() const;
+
+		/** @brief Forwards the lookups of varSubst() to the render state and notes if the state supplied a value.
+		 *
+		 * Expansions using values of the state (attributes, options, frame number) are not memoized.
+		 */
+		class CVarSubstQuery : public IVarSubstCallback {
+			const CRenderState &m_state; ///< Render state to query.
+		public:
+			mutable bool m_usedState; ///< true, if getValue() found a value in the state.
+
+			inline CVarSubstQuery(const CRenderState &aState) : m_state(aState), m_usedState(false) {}
+
+			inline virtual bool getValue(CValue &p, const char *identifier) const
+			{
+				if ( !m_state.getValue(p, identifier) )
+					return false;
+				m_usedState = true;
+				return true;
+			}
+
+			inline virtual bool getEnvValue(CValue &p, const char *identifier) const
+			{
+				return m_state.getEnvValue(p, identifier);
+			}
+		}; // CVarSubstQuery
+
+		static const size_t MAX_VARSUBST_CACHE = 1024; ///< Caches of varSubst() are cleared, if they grow beyond this size.
+		typedef std::map<std::string, std::string> TypeVarSubstCache; ///< Expanded strings by variable character, pathes and source string.
+		mutable TypeVarSubstCache m_varSubstCache; ///< Memoized expansions of varSubst() that did not use values of the render state.
+		typedef std::map<std::string, std::pair<bool, std::string> > TypeEnvValueCache; ///< Values of environment variables by name, false if not set.
+		mutable TypeEnvValueCache m_envValueCache; ///< Memoized lookups of getEnvValue(), including the ones of unset variables.
+		unsigned long m_searchPathGeneration; ///< Incremented if Option "searchpath" is set.
+		mutable unsigned long m_varSubstSearchPathGeneration; ///< m_searchPathGeneration of the content of the varSubst() caches.
+		mutable unsigned long m_varSubstEnvGeneration; ///< CEnv::generation() of the content of the varSubst() caches.
+		unsigned long m_valueGeneration; ///< Incremented if option() or attribute() add a variable, it may be found in the state now.
+		mutable unsigned long m_varSubstValueGeneration; ///< m_valueGeneration of the content of m_varSubstCache.
+
+		void clearVarSubstCache() const;
+
+		/** @brief Tests if @a params contain a variable that is not yet a value of @a values.
+		 *
+		 *  @param values Options or attributes.
+		 *  @param name Name of the option or attribute.
+		 *  @param params Parameters that will be set.
+		 *  @return true, if a new variable will be set.
+		 */
+		bool addsValue(const COptionsBase &values, RtToken name, const CParameterList &params) const;
+
+		/** @brief Clears the caches of varSubst() if the search path, the environment or
+		 * (only m_varSubstCache) options and attributes have been changed.
+		 */
+		void validateVarSubstCache() const;
+
+		/** @brief Clears the caches of varSubst() if an environment variable
+		 *  of m_envValueCache has been changed without CEnv::changed().
+		 *
+		 *  Called at the beginning of frames and world blocks.
+		 */
+		void checkEnvValueCache() const;
+
+		/** @brief Compiler for RIB if-expressions (see CIfExpr).
 		 *
 		 * The grammer of the if-expression, white spaces (wss) between the tokens are omitted.
 		 *
@@ -295,9 +498,6 @@ namespace RiCPP {
 		 *
 		 */
 		class CIfExprParser : protected CRecursiveDescentParser {
-		private:
-			const CRenderState *m_outer;
-
 		protected:
 			/** @brief Identifier
 			 */
@@ -418,147 +618,173 @@ namespace RiCPP {
 			 */
 			bool calcvar(
 				const unsigned char **str,
-				std::string &resul,
-				CValue &valt) const;
+				std::string &result,
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Variable.
 			 */
 			bool var(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Variable or string.
 			 */
 			bool varstr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Sequence of variables or strings.
 			 */
 			bool varstrlist(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Literal or variable (sequence of variables).
 			 */
 			bool litvar(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Expression.
 			 */
 			bool expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Expression with logical or.
 			 */
 			bool log_or_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Expression with logical and.
 			 */
 			bool log_and_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Expression with bitwise inclusive or.
 			 */
 			bool incl_or_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Expression with bitwise exclusive or.
 			 */
 			bool excl_or_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Expression with bitwise and.
 			 */
 			bool and_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Equal/not equal comparsion.
 			 */
 			bool eq_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Relational expression.
 			 */
 			bool rel_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief String matches pattern.
 			 */
 			bool match_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Addition/subtraction
 			 */
 			bool add_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Multiplication/division
 			 */
 			bool mul_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Power
 			 */
 			bool pow_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Unary expression
 			 */
 			bool unary_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Primary expression
 			 */
 			bool primary_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 
 			/** @brief Complete expresion of a RIB if request, terminated by 0
 			 */
 			bool if_expr(
 				const unsigned char **str,
 				std::string &result,
-				CValue &val) const;
+				CIfExpr &prog,
+				size_t &aNode) const;
 		public:
-			inline CIfExprParser(const CRenderState &outer)
+			inline CIfExprParser()
 			{
-				m_outer = &outer;
 			}
-			bool parse(RtString expr) const;
+
+			/** @brief Compiles an if-expression.
+			 *
+			 * @param expr The expression string.
+			 * @retval prog The compiled expression, marked as invalid if
+			 * @a expr could not be parsed.
+			 */
+			void compile(RtString expr, CIfExpr &prog) const;
 		}; // CIfExprParser
 
 		// Additional Tokens
@@ -570,12 +796,49 @@ namespace RiCPP {
 		RtToken RI_LOAD_TRANSFORM;       ///< Token "load-transform" for state control (candidade for Resource)
 		RtToken RI_QUAL_LOAD_TRANSFORM;  ///< Qualified Token "Control:state:load-transform" for control
 		RtToken RI_PRE_CAMERA;           ///< Token "pre-camera" for state control
+		RtToken RI_SKIP_LIGHT_HANDLES;   ///< Token "skip-light-handles" for state control
+		RtToken RI_QUAL_SKIP_LIGHT_HANDLES; ///< Qualified Token "Control:state:skip-light-handles" for control
+		RtToken RI_SKIP_OBJECT_HANDLES;  ///< Token "skip-object-handles" for state control
+		RtToken RI_QUAL_SKIP_OBJECT_HANDLES; ///< Qualified Token "Control:state:skip-object-handles" for control
+		RtToken RI_BASE_DIRECTORY;       ///< Token "base-directory" for state control
+		RtToken RI_QUAL_BASE_DIRECTORY;  ///< Qualified Token "Control:state:base-directory" for control
 		
 		RtToken RI_CACHE_FILE_ARCHIVES; ///< Token "cache-file-archives" for control
+		RtToken RI_PARALLEL_LEXING;     ///< Token "parallel-lexing" for control
+		RtToken RI_PARALLEL_LEXING_CHUNK; ///< Token "parallel-lexing-chunk" for control
+		RtToken RI_ASYNC_PARSING;       ///< Token "async-parsing" for control
+		RtToken RI_STORE_FRAME_INDEX;   ///< Token "store-frame-index" for control
 		RtToken RI_VARSUBST;            ///< Token "varsubst" for option
+		RtToken RI_SEARCHPATH;          ///< Token "searchpath" for option
 		
 		RtToken RI_QUAL_CACHE_FILE_ARCHIVES; ///< Qualified Token "Control:rib:cache-file-archives" for control
+		RtToken RI_QUAL_PARALLEL_LEXING;     ///< Qualified Token "Control:rib:parallel-lexing" for control
+		RtToken RI_QUAL_PARALLEL_LEXING_CHUNK; ///< Qualified Token "Control:rib:parallel-lexing-chunk" for control
+		RtToken RI_QUAL_ASYNC_PARSING;       ///< Qualified Token "Control:rib:async-parsing" for control
+		RtToken RI_QUAL_STORE_FRAME_INDEX;   ///< Qualified Token "Control:rib:store-frame-index" for control
 		RtToken RI_QUAL_VARSUBST;            ///< Token "Option:rib:varsubst" for option
+
+		RtToken RI_STATISTICS;               ///< Token "statistics" for control
+		RtToken RI_STATISTICS_ENABLE;        ///< Token "enable" for statistics control
+		RtToken RI_STATISTICS_RESET;         ///< Token "reset" for statistics control
+		RtToken RI_STATISTICS_FILE;          ///< Token "file" for statistics control
+		RtToken RI_STATISTICS_DUMP;          ///< Token "dump" for statistics control
+		RtToken RI_QUAL_STATISTICS_ENABLE;   ///< Qualified Token "Control:statistics:enable" for control
+		RtToken RI_QUAL_STATISTICS_RESET;    ///< Qualified Token "Control:statistics:reset" for control
+		RtToken RI_QUAL_STATISTICS_FILE;     ///< Qualified Token "Control:statistics:file" for control
+		RtToken RI_QUAL_STATISTICS_DUMP;     ///< Qualified Token "Control:statistics:dump" for control
+
+		RtToken RI_TRACE;                    ///< Token "trace" for control
+		RtToken RI_TRACE_ENABLE;             ///< Token "enable" for trace control
+		RtToken RI_TRACE_CLEAR;              ///< Token "clear" for trace control
+		RtToken RI_TRACE_SIZE;               ///< Token "size" for trace control
+		RtToken RI_TRACE_FILE;               ///< Token "file" for trace control
+		RtToken RI_TRACE_DUMP;               ///< Token "dump" for trace control
+		RtToken RI_QUAL_TRACE_ENABLE;        ///< Qualified Token "Control:trace:enable" for control
+		RtToken RI_QUAL_TRACE_CLEAR;         ///< Qualified Token "Control:trace:clear" for control
+		RtToken RI_QUAL_TRACE_SIZE;          ///< Qualified Token "Control:trace:size" for control
+		RtToken RI_QUAL_TRACE_FILE;          ///< Qualified Token "Control:trace:file" for control
+		RtToken RI_QUAL_TRACE_DUMP;          ///< Qualified Token "Control:trace:dump" for control
 		
 	public:
 
@@ -787,6 +1050,7 @@ namespace RiCPP {
 
 		virtual bool exists(RtString identifier) const;
 		virtual bool getValue(CValue &p, RtString identifier) const;
+		virtual bool getEnvValue(CValue &p, RtString identifier) const;
 		virtual std::string &varSubst(std::string &aStr, char varId, RtString stdPath=RI_NULL, RtString curPath=RI_NULL) const;
 		virtual std::string &varSubst(std::string &aStr, RtString stdPath=RI_NULL, RtString curPath=RI_NULL) const;
 		virtual bool eval(RtString expr) const;
@@ -1090,6 +1354,75 @@ namespace RiCPP {
 		virtual inline bool cacheFileArchives() const { return m_cacheFileArchives; }
 		virtual inline void cacheFileArchives(bool cache) { m_cacheFileArchives = cache; }
 
+		/** @brief Number of threads used to lex a rib file.
+		 *
+		 *  Set by Control "rib" "parallel-lexing" [n]. Values less than 2
+		 *  (default 0) select the sequential parser. Files smaller than a few
+		 *  chunks (see parallelLexingChunk()) are parsed sequentially, too.
+		 *
+		 *  @return Number of threads used to lex a rib file.
+		 */
+		virtual inline RtInt parallelLexing() const { return m_parallelLexing; }
+		virtual inline void parallelLexing(RtInt nThreads) { m_parallelLexing = nThreads; }
+
+		/** @brief Minimal size of a chunk of a rib file lexed by one thread.
+		 *
+		 *  Set by Control "rib" "parallel-lexing-chunk" [bytes].
+		 *
+		 *  @return Minimal size in bytes of a chunk.
+		 */
+		virtual inline RtInt parallelLexingChunk() const { return m_parallelLexingChunk; }
+		virtual inline void parallelLexingChunk(RtInt size) { m_parallelLexingChunk = size; }
+
+		/** @brief Number of lexed chunks the reading thread can queue.
+		 *
+		 *  Set by Control "rib" "async-parsing" [n]. If greater than 0, a rib file
+		 *  is read and lexed by a separate thread while the requests are processed,
+		 *  the thread waits if n chunks are waiting. The requests are processed
+		 *  by the calling thread. Default 0 selects the sequential parser,
+		 *  parallelLexing() takes precedence.
+		 *
+		 *  @return Maximal number of queued chunks.
+		 */
+		virtual inline RtInt asyncParsing() const { return m_asyncParsing; }
+		virtual inline void asyncParsing(RtInt nChunks) { m_asyncParsing = nChunks; }
+
+		/** @brief Stores the frame index of a rib file beside the file (filename.ribidx).
+		 *
+		 *  Set by Control "rib" "store-frame-index" [1]. An existing index is
+		 *  always used, it is only written if enabled (default 0), so reading
+		 *  does not write to the directories of the rib files.
+		 *
+		 *  @return true, if the frame index is stored.
+		 */
+		virtual inline bool storeFrameIndex() const { return m_storeFrameIndex; }
+		virtual inline void storeFrameIndex(bool store) { m_storeFrameIndex = store; }
+
+		/** @brief Statistics of the requests.
+		 *
+		 *  Collected if enabled by Control "statistics" "enable" 1. Control
+		 *  "statistics" "dump" "filename" writes the statistics collected so
+		 *  far, "file" "filename" writes them at the end of the context
+		 *  (".csv" as CSV, else JSON, "-" JSON to the standard error stream),
+		 *  "reset" 1 clears them.
+		 *
+		 *  @return Statistics of the requests.
+		 */
+		inline CRequestStatistics &statistics() { return m_statistics; }
+		inline const CRequestStatistics &statistics() const { return m_statistics; }
+
+		/** @brief File to write the trace to at the end of the context.
+		 *
+		 *  Tracing of the module (ricppTracer()) is enabled by Control "trace" "enable" 1,
+		 *  "size" n sets the number of events per thread, "clear" 1 discards
+		 *  the events, "dump" "filename" writes the trace (Chrome trace event
+		 *  format, "-" the standard error stream), "file" "filename" writes it at
+		 *  the end of this context.
+		 *
+		 *  @return Name of the file, empty if the trace is not written.
+		 */
+		inline const std::string &traceFilename() const { return m_traceFilename; }
+
 		/** @brief Processes a declarations.
 		 *
 		 *  Processes a single declaration. The declaration is entered
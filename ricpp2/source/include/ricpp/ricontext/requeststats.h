@@ -0,0 +1,180 @@
+#ifndef _RICPP_RICONTEXT_REQUESTSTATS_H
+#define _RICPP_RICONTEXT_REQUESTSTATS_H
+
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file requeststats.h
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Declaration of the per request statistics (calls, parameters, times, triangles)
+ */
+
+#ifndef RICPP_RICPP_REQUESTS_H
+#include "ricpp/ricpp/requests.h"
+#endif // RICPP_RICPP_REQUESTS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace RiCPP {
+
+/** @brief Statistics of the requests of a rendering context.
+ *
+ *  The statistics are collected per request type (EnumRequests), if enabled
+ *  (Control "statistics" "enable" 1). If disabled, only the flag
+ *  is tested. Times are wall clock times in nanoseconds, the
+ *  times of the requests include the times of the requests they
+ *  replay (e.g. ObjectInstance and ReadArchive).
+ */
+class CRequestStatistics {
+public:
+	/** @brief Statistics of one request type.
+	 */
+	struct SRequestStats {
+		unsigned long long m_calls;      ///< Number of calls.
+		unsigned long long m_paramBytes; ///< Bytes of the parameter values (floats, integers and strings).
+		unsigned long long m_triangles;  ///< Number of triangles tessellated.
+		unsigned long long m_parseTime;  ///< Time to parse the request (RIB).
+		unsigned long long m_preTime;    ///< Time of preProcess().
+		unsigned long long m_doTime;     ///< Time of doProcess().
+		unsigned long long m_postTime;   ///< Time of postProcess().
+	};
+
+private:
+	bool m_enabled;              ///< Statistics are collected.
+	std::string m_filename;      ///< Statistics are written to this file at the end of the context, empty: not written.
+	SRequestStats m_stats[N_REQUESTS]; ///< Statistics per request type.
+	EnumRequests m_current;      ///< Request currently processed (gets the triangles).
+	unsigned long long m_pendingParseTime; ///< Parse time of the request not yet processed.
+
+public:
+	/** @brief Constructor, statistics are disabled.
+	 */
+	CRequestStatistics();
+
+	/** @brief Gets the current time.
+	 *  @return Time in nanoseconds.
+	 */
+	inline static unsigned long long now()
+	{
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/** @brief Tests if the statistics are collected.
+	 */
+	inline bool enabled() const { return m_enabled; }
+
+	/** @brief Enables or disables the collection of the statistics.
+	 */
+	inline void enabled(bool isEnabled) { m_enabled = isEnabled; }
+
+	/** @brief Gets the name of the file written at the end of the context.
+	 */
+	inline const std::string &filename() const { return m_filename; }
+
+	/** @brief Sets the name of the file written at the end of the context.
+	 *
+	 *  @param aFilename Name of the file, "-" for the standard error stream,
+	 *         empty: not written. A file with the extension ".csv"
+	 *         is written as CSV, all others as JSON.
+	 */
+	inline void filename(const std::string &aFilename) { m_filename = aFilename; }
+
+	/** @brief Clears the statistics.
+	 */
+	void reset();
+
+	/** @brief Gets the statistics of a request type.
+	 */
+	inline const SRequestStats &stats(EnumRequests req) const { return m_stats[req]; }
+
+	/** @brief Adds parse time to the request parsed next.
+	 *  @param t Time in nanoseconds.
+	 */
+	inline void parsed(unsigned long long t) { m_pendingParseTime += t; }
+
+	/** @brief Counts a request at the start of its processing.
+	 *
+	 *  @param req The request.
+	 *  @param paramBytes Bytes of its parameter values.
+	 *  @return The request processed before (to restore by processed()).
+	 */
+	inline EnumRequests processing(EnumRequests req, unsigned long long paramBytes)
+	{
+		SRequestStats &s = m_stats[req];
+		++s.m_calls;
+		s.m_paramBytes += paramBytes;
+		s.m_parseTime += m_pendingParseTime;
+		m_pendingParseTime = 0;
+		EnumRequests prev = m_current;
+		m_current = req;
+		return prev;
+	}
+
+	/** @brief Adds the processing times at the end of a request.
+	 *
+	 *  @param req The request.
+	 *  @param pre Time of preProcess().
+	 *  @param doTime Time of doProcess().
+	 *  @param post Time of postProcess().
+	 *  @param prev Request processed before, returned by processing().
+	 */
+	inline void processed(EnumRequests req, unsigned long long pre, unsigned long long doTime, unsigned long long post, EnumRequests prev)
+	{
+		SRequestStats &s = m_stats[req];
+		s.m_preTime += pre;
+		s.m_doTime += doTime;
+		s.m_postTime += post;
+		m_current = prev;
+	}
+
+	/** @brief Adds tessellated triangles to the request currently processed.
+	 */
+	inline void triangles(unsigned long long n) { m_stats[m_current].m_triangles += n; }
+
+	/** @brief Writes the statistics as JSON object.
+	 *  @param out Stream to write to.
+	 */
+	void writeJSON(std::ostream &out) const;
+
+	/** @brief Writes the statistics as CSV table with header.
+	 *  @param out Stream to write to.
+	 */
+	void writeCSV(std::ostream &out) const;
+
+	/** @brief Writes the statistics to a file.
+	 *
+	 *  @param aFilename Name of the file, "-" for the standard error stream.
+	 *         A file with the extension ".csv" is written as CSV,
+	 *         all others as JSON.
+	 *  @return false, the file could not be opened.
+	 */
+	bool write(const std::string &aFilename) const;
+}; // CRequestStatistics
+
+} // namespace RiCPP
+
+#endif // _RICPP_RICONTEXT_REQUESTSTATS_H
@@ -75,6 +75,7 @@ class CAttributesResource : public CResource
 protected:
 	CAttributes *m_attributes;
 
+	static const CParameter *getParameter(const CParameterList &parameters, RtString aName);
 	virtual RtToken getOperation(const std::string &anOperation);
 	virtual RtToken getSubset(const std::string &aSubset);
 	virtual void operate(IRiContext &ri, RtToken operation, RtToken subset);
@@ -40,6 +40,8 @@
 
 #include <streambuf>
 #include <map>
+#include <vector>
+#include <string>
 
 
 namespace RiCPP {
@@ -60,18 +62,32 @@ public:
  *
  *  The stream uses an initialized TemplFrontStreambuf<char> object as
  *  buffer. The buffer has to be opened before passed to the constructor,
- *  it has also to be closed by the caller.
+ *  it has also to be closed by the caller (after the writer is deleted).
+ *
+ *  The elements are formatted into an own buffer, that is written to the
+ *  stream buffer if it is full, by flush() and by the destructor. New lines
+ *  do not flush. Floats are written in ascii with the shortest
+ *  representation that reads back to the same value.
  *
  *  Binary RIB can encode double precision and fixed-point numbers. However,
  *  double precision will not be used, because RiCPP (C-binding also) only uses
- *  single precision floating point numbers. Fixed-point numbers are
- *  neither used, nor implemented by this object.
+ *  single precision floating point numbers. Fixed-point numbers are used for
+ *  integers and, if enabled by fixedPoint(), for the float arrays of
+ *  selected parameters (like "P", "N", "st") to shrink binary RIB.
  *
  *  @see TemplFrontStreambuf
  */
 class CRibElementsWriter {
 private:
-	std::ostream m_ostream; ///< RIB output stream.
+	/** @brief Size of the output buffer.
+	 */
+	static const unsigned long OUT_BUFFER_SIZE = 65536;
+
+	std::basic_streambuf<char, std::char_traits<char> > *m_ribout; ///< RIB output stream buffer.
+	std::vector<char> m_outBuffer; ///< Formatted output, not yet written to m_ribout.
+	char *m_outPos; ///< Next write position in m_outBuffer.
+	char *m_outEnd; ///< End of m_outBuffer.
+	unsigned long long m_bytesFlushed; ///< Number of bytes written to m_ribout.
 	bool m_ascii; ///< true, indicates that ascii-data should be written. False, binary data.
 	unsigned char m_reqEncoding[N_REQUESTS]; ///< Elements indicate (value!=0), that a request is defined.
 	std::map<std::string, RtInt> m_stringTokens; ///< Elements indicate, that a string token is defined
@@ -79,6 +95,25 @@ private:
 	bool m_firstRequestWritten; ///< Gets true after first real request is written to suppress header
 	IRequestNotification &m_notify;  ///< Notify request
 	unsigned long m_linecnt; ///< line counter
+	RtFloat m_fixedAbs; ///< Absolute error bound of fixed-point arrays, 0 if not used.
+	RtFloat m_fixedRel; ///< Error bound of fixed-point arrays relative to their largest magnitude, 0 if not used.
+	std::vector<std::string> m_fixedVars; ///< Names of the parameters written as fixed-point arrays.
+
+	/** @brief Puts a character or byte to the output buffer.
+	 *  @param c Character to put.
+	 */
+	inline void put(char c)
+	{
+		if ( m_outPos == m_outEnd )
+			flush();
+		*m_outPos++ = c;
+	}
+
+	/** @brief Puts characters or bytes to the output buffer.
+	 *  @param cs Characters to put.
+	 *  @param n Number of characters.
+	 */
+	void put(const char *cs, unsigned long n);
 
 	/** @brief Puts a binary encoded number (string length, RtInt) to the stream.
 	 */
@@ -88,10 +123,38 @@ private:
 	 */
 	void putStringTokenNum(unsigned char code, unsigned long tok);
 
+	/** @brief Puts a binary encoded fixed-point number to the stream.
+	 *
+	 *  The number is @a aValue / 256^@a d. The smallest number of bytes
+	 *  (at least @a d) is used.
+	 *
+	 *  @param aValue Value (32 bit signed).
+	 *  @param d Number of bytes after the decimal point (0..3).
+	 */
+	void putFixedValue(long aValue, unsigned char d);
+
+	/** @brief Puts a float array as binary encoded fixed-point numbers.
+	 *
+	 *  The number of bytes after the decimal point is chosen for the whole
+	 *  array to meet the error bounds m_fixedAbs and m_fixedRel.
+	 *
+	 *  @param length Length of @a floats.
+	 *  @param floats Array of floats to put out.
+	 *  @return false, the array was not written because fixed-point numbers
+	 *          cannot meet the bounds or are not shorter than floats.
+	 */
+	bool putFixedArray(unsigned long length, const float *floats);
+
 	/** @brief Puts a binary encoded IEEE float to the stream.
 	 */
 	void putBinValue(float aFloat);
 
+	/** @brief Puts binary encoded IEEE floats (array elements) to the stream.
+	 *
+	 *  The floats are converted to big endian directly into the output buffer.
+	 */
+	void putBinValues(unsigned long length, const float *floats);
+
 	/** @brief Puts a binary encoded double precision IEEE float to the stream.
 	 */
 	void putBinValue(double aFloat);
@@ -103,9 +166,26 @@ public:
 	CRibElementsWriter(std::basic_streambuf<char, std::char_traits<char> > *ribout, IRequestNotification &notify);
 	// CRibElementsWriter(TemplFrontStreambuf<char> *ribout, IRequestNotification &notify);
 
-	/** @brief Destructor, doesn't close the stream (because it is not opened by a CRibElementsWriter).
+	/** @brief Destructor, writes the buffered output but doesn't close the
+	 *  stream (because it is not opened by a CRibElementsWriter).
 	 */
-	inline ~CRibElementsWriter() {}
+	inline ~CRibElementsWriter()
+	{
+		flush();
+	}
+
+	/** @brief Writes the buffered output to the stream buffer.
+	 *
+	 *  The stream buffer itself is not flushed.
+	 */
+	void flush();
+
+	/** @brief Gets the number of bytes written so far (including the buffered ones).
+	 */
+	inline unsigned long long bytesWritten() const
+	{
+		return m_bytesFlushed + (unsigned long long)(m_outPos - &m_outBuffer[0]);
+	}
 
 	/** @brief test if there is already a request written.
 	 *
@@ -115,6 +195,24 @@ public:
 	{
 		return m_firstRequestWritten;
 	}
+
+	/** @brief Continues the output of another writer.
+	 *
+	 *  Takes over the ascii mode and the fixed-point settings of @a writer. The
+	 *  header is suppressed and new string tokens are numbered after the ones of
+	 *  @a writer, so the output can be inserted into the output of @a writer
+	 *  by putRaw() or written to a separate archive.
+	 *
+	 *  @param writer Writer to continue.
+	 */
+	void continueFrom(const CRibElementsWriter &writer);
+
+	/** @brief Puts preformatted RIB (e.g. the output of another writer) to the stream.
+	 *
+	 *  @param cs Bytes to put out.
+	 *  @param n Number of bytes.
+	 */
+	void putRaw(const char *cs, unsigned long n);
 	
 	/** @brief Gets the current line counter
 	 *  @return the current line counter
@@ -139,7 +237,37 @@ public:
 		m_ascii = isAscii;
 	}
 
-	/** @brief Puts out a new line character (in ascii mode only).
+	/** @brief Sets the error bounds of fixed-point float arrays (binary mode only).
+	 *
+	 *  The float arrays of the parameters set by fixedPointVars() are
+	 *  written as fixed-point numbers, if they meet the bounds and are
+	 *  shorter than IEEE floats.
+	 *
+	 *  @param absError Absolute error bound, 0 if not used.
+	 *  @param relError Error bound relative to the largest magnitude of
+	 *         an array, 0 if not used.
+	 */
+	inline void fixedPoint(RtFloat absError, RtFloat relError)
+	{
+		m_fixedAbs = absError > 0 ? absError : 0;
+		m_fixedRel = relError > 0 ? relError : 0;
+	}
+
+	/** @brief Sets the parameters written as fixed-point float arrays.
+	 *
+	 *  @param vars Names of the parameters separated by blanks
+	 *         (default "P N st").
+	 */
+	void fixedPointVars(const char *vars);
+
+	/** @brief Tests if a parameter is written as fixed-point float array.
+	 *
+	 *  @param var Name of the parameter (e.g. "P").
+	 *  @return true, fixed-point arrays are enabled and used for @a var.
+	 */
+	bool fixedPointVar(const char *var) const;
+
+	/** @brief Puts out a new line character (in ascii mode only), doesn't flush.
 	 */
 	void putNewLine();
 
@@ -169,6 +297,9 @@ public:
 	void putChars(const char *cs);
 
 	/** @brief Puts out a comment line, started with '#' and terminated by endl.
+	 *
+	 *  RI_VERBATIM text is put out as it is (no '#', no endl).
+	 *
 	 *  @param type Type of the comment (RI_COMMENT, RI_STRUCTURE, RI_VERBATIM)
 	 *  @param cs Character string to put out (without the first '#').
 	 */
@@ -190,6 +321,15 @@ public:
 	 */
 	void putArray(unsigned long length, const float *floats);
 
+	/** @brief Puts out the float values of a parameter.
+	 *
+	 *  Fixed-point numbers are used, if enabled for @a var.
+	 *
+	 *  @param var Name of the parameter.
+	 *  @param floats Vector of floats to put out.
+	 */
+	void putParameterArray(const char *var, const std::vector<float> &floats);
+
 	/** @brief Puts out a vector of double precision floats.
 	 *  @param floats Vector of double precision floats to put out.
 	 */
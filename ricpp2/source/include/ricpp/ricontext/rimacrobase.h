@@ -226,18 +226,22 @@ namespace RiCPP {
 			ribWriter.putNewLine();
 		}
 
-		/*  @brief Query if bounds are available.
+		/** @brief Query if bounds are available.
 		 *  @return true, if bounds are available
 		 *  @see getBounds()
 		 */
-		// inline virtual bool boundable() const { return false; }
+		inline virtual bool boundable() const { return false; }
 
-		/*  @brief Gets the bounds, if available.
-		 *  @todo Implement bounds.
+		/** @brief Gets the bounds in object space, if available.
 		 *  @retval bounds The bounderies of the object representated.
 		 *  @see boundable()
 		 */
-		// inline virtual void getBounds(RtBound bounds) const {}
+		inline virtual void getBounds(RtBound bounds) const {}
+
+		/** @brief Gets the size of the parameter values (used for statistics).
+		 *  @return Bytes of the floats, integers and strings of the parameter list.
+		 */
+		inline virtual unsigned long long parameterBytes() const { return 0; }
 		// inline virtual void setBounds(const RtBound bounds) {}
 		
 		inline virtual bool deferedDeletion() const { return m_deferedDeletion; }
@@ -538,14 +542,24 @@ namespace RiCPP {
 		 */
 		inline virtual RtInt faceVertices() const  { return parameters().parameterClasses().faceVertices(); }
 		
-		/*  @brief Gets the bounds, by bounding parameter RI_P, RI_PW
+		/** @brief Tests if the bounds can be taken from the parameter RI_P or RI_PW
+		 *
+		 *  The control points of RI_PW need positive weights.
+		 *
+		 *  @return true, if RI_P or RI_PW can be bounded.
+		 */
+		bool boundableByVertices() const;
+
+		/** @brief Gets the bounds, by bounding parameter RI_P, RI_PW
 		 *
 		 *  The boundable() must be implemented by the appropriate class.
 		 *
 		 *  @retval bounds The bounderies of the object representated.
 		 *  @see boundable()
 		 */
-		// virtual void getBounds(RtBound bounds) const;
+		virtual void getBounds(RtBound bounds) const;
+
+		virtual unsigned long long parameterBytes() const;
 	}; // CVarParamRManInterfaceCall
 }
 
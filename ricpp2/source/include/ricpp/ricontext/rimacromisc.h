@@ -1466,6 +1466,13 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_PROCEDURAL; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			memcpy(bounds, m_bound, sizeof(RtBound));
+		}
+
 		inline virtual void process(IRiRoot &ri)
 		{
 			assert(subdivFunc());
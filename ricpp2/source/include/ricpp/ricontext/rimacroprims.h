@@ -38,6 +38,8 @@
 #include "ricpp/ricontext/polygon.h"
 #endif // _RICPP_RICONTEXT_POLYGON_H
 
+#include <cmath>
+
 namespace RiCPP {
 
 	// ----------------------------------------------------------------------------
@@ -133,6 +135,8 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_POLYGON; }
 
+		inline virtual bool boundable() const { return boundableByVertices(); }
+
 		/** @brief Gets the number of vertices.
 		 *
 		 *  @return The number of vertices.
@@ -297,6 +301,8 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_GENERAL_POLYGON; }
 
+		inline virtual bool boundable() const { return boundableByVertices(); }
+
 		/** @brief Gets the number of loops.
 		 *
 		 *  @return The number of loops.
@@ -512,6 +518,8 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_POINTS_POLYGONS; }
 
+		inline virtual bool boundable() const { return boundableByVertices(); }
+
 		/** @brief Gets the number of loops.
 		 *
 		 *  @return The number of loops.
@@ -751,6 +759,8 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_POINTS_GENERAL_POLYGONS; }
 
+		inline virtual bool boundable() const { return boundableByVertices(); }
+
 		/** @brief Gets the number of the positions.
 		 *
 		 *  @return The number of the positions.
@@ -1026,6 +1036,11 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_PATCH; }
 
+		/** @brief Bilinear patches are inside the bounds of their vertices,
+		 *  bicubic ones only for some bases.
+		 */
+		inline virtual bool boundable() const { return m_type != RI_BICUBIC && boundableByVertices(); }
+
 		/** @brief Gets the type of the attribute as atomized string.
 		 *
 		 *  @return The type of the attribute as atomized string.
@@ -1220,6 +1235,11 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_PATCH_MESH; }
 
+		/** @brief Bilinear patches are inside the bounds of their vertices,
+		 *  bicubic ones only for some bases.
+		 */
+		inline virtual bool boundable() const { return m_type != RI_BICUBIC && boundableByVertices(); }
+
 		/** @brief Get the type of the mesh.
 		 *
 		 * @return The type of the mesh, either RI_BILINEAR or RI_BICUBIC.
@@ -1477,6 +1497,8 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_NU_PATCH; }
 
+		inline virtual bool boundable() const { return boundableByVertices(); }
+
 		/** @brief Gets the number of segments for the NURBS patch.
 		 *
 		 *  @return The number of segments for the NURBS patch.
@@ -1812,6 +1834,8 @@ namespace RiCPP {
 		}
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_SUBDIVISION_MESH; }
+
+		inline virtual bool boundable() const { return boundableByVertices(); }
 		
 		/** @brief Sets the values of the member variables.
 		 *
@@ -2129,6 +2153,8 @@ namespace RiCPP {
 		}
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_HIERARCHICAL_SUBDIVISION_MESH; }
+
+		inline virtual bool boundable() const { return boundableByVertices(); }
 		
 		/** @brief Sets the values of the member variables.
 		 *
@@ -2447,6 +2473,17 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_SPHERE; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			RtFloat r = (RtFloat)fabs(radius());
+			bounds[0] = bounds[2] = -r;
+			bounds[1] = bounds[3] = r;
+			bounds[4] = clamp(tmin(zMin(), zMax()), -r, r);
+			bounds[5] = clamp(tmax(zMin(), zMax()), -r, r);
+		}
+
 		/** @brief Gets the radius of the sphere.
 		 *
 		 *  @return The radius of the sphere.
@@ -2702,6 +2739,17 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_CONE; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			RtFloat r = (RtFloat)fabs(radius());
+			bounds[0] = bounds[2] = -r;
+			bounds[1] = bounds[3] = r;
+			bounds[4] = tmin(height(), (RtFloat)0);
+			bounds[5] = tmax(height(), (RtFloat)0);
+		}
+
 		/** @brief Gets the height of the cone.
 		 *
 		 *  @return The height of the cone.
@@ -2936,6 +2984,17 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_CYLINDER; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			RtFloat r = (RtFloat)fabs(radius());
+			bounds[0] = bounds[2] = -r;
+			bounds[1] = bounds[3] = r;
+			bounds[4] = tmin(zMin(), zMax());
+			bounds[5] = tmax(zMin(), zMax());
+		}
+
 		/** @brief Gets the radius of the cylinder.
 		 *
 		 *  @return The radius of the cylinder.
@@ -3197,6 +3256,19 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_HYPERBOLOID; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			// The distance to the z axis is largest at one of the end points
+			RtFloat r = (RtFloat)tmax(sqrt(point1()[0]*point1()[0] + point1()[1]*point1()[1]),
+			                         sqrt(point2()[0]*point2()[0] + point2()[1]*point2()[1]));
+			bounds[0] = bounds[2] = -r;
+			bounds[1] = bounds[3] = r;
+			bounds[4] = tmin(point1()[2], point2()[2]);
+			bounds[5] = tmax(point1()[2], point2()[2]);
+		}
+
 		/** @brief Gets the first point of the line to sweep.
 		 *
 		 *  @retval aPoint1 First point of the line to sweep to get a hyperbolid.
@@ -3467,6 +3539,17 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_PARABOLOID; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			RtFloat r = (RtFloat)fabs(rMax());
+			bounds[0] = bounds[2] = -r;
+			bounds[1] = bounds[3] = r;
+			bounds[4] = tmin(zMin(), zMax());
+			bounds[5] = tmax(zMin(), zMax());
+		}
+
 		/** @brief Gets the maximal radius of the paraboloid.
 		 *
 		 *  @return The maximal radius of the paraboloid.
@@ -3722,6 +3805,16 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_DISK; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			RtFloat r = (RtFloat)fabs(radius());
+			bounds[0] = bounds[2] = -r;
+			bounds[1] = bounds[3] = r;
+			bounds[4] = bounds[5] = height();
+		}
+
 		/** @brief Gets the distance (z) from origin of the disk.
 		 *
 		 *  @return The distance (z) from origin of the disk.
@@ -3965,6 +4058,18 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_TORUS; }
 
+		inline virtual bool boundable() const { return true; }
+
+		inline virtual void getBounds(RtBound bounds) const
+		{
+			RtFloat r = (RtFloat)fabs(minorRad());
+			RtFloat R = (RtFloat)fabs(majorRad()) + r;
+			bounds[0] = bounds[2] = -R;
+			bounds[1] = bounds[3] = R;
+			bounds[4] = -r;
+			bounds[5] = r;
+		}
+
 		/** @brief Gets the major radius (center of the ring).
 		 *
 		 *  @return The major radius (center of the ring).
@@ -4234,6 +4339,9 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_POINTS; }
 
+		inline virtual bool boundable() const { return boundableByVertices(); }
+		virtual void getBounds(RtBound bounds) const;
+
 		/** @brief Gets the number of points.
 		 *
 		 *  @return Number of points.
@@ -4391,6 +4499,12 @@ namespace RiCPP {
 
 		inline virtual EnumRequests interfaceIdx() const { return REQ_CURVES; }
 
+		/** @brief Linear curves are inside the bounds of their vertices (and width),
+		 *  cubic ones only for some bases.
+		 */
+		inline virtual bool boundable() const { return m_type != RI_CUBIC && boundableByVertices(); }
+		virtual void getBounds(RtBound bounds) const;
+
 
 		/** @brief Gets the type of the curves.
 		 *
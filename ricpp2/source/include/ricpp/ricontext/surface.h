@@ -38,6 +38,7 @@
 #include "ricpp/ricpp/ricpperror.h"
 #endif // _RICPP_RICPP_RICPPERROR_H
 #include <list>
+#include <atomic>
 
 namespace RiCPP {
 
@@ -128,8 +129,22 @@ private:
 	std::map<RtToken, TemplPrimVar<RtInt> > m_ints;
 	std::map<RtToken, TemplPrimVar<std::string> > m_strings;
 
+	unsigned long m_serial; ///< Unique number of the face, copies share it.
+	static std::atomic<unsigned long> ms_nextSerial; ///< Next value of m_serial.
+
 public:	
-	inline CFace(IndexType aTessU=0, IndexType aTessV=0, EnumFaceTypes aFaceType=FACETYPE_UNKNOWN) : m_tessU(aTessU), m_tessV(aTessV), m_faceType(aFaceType) {}
+	inline CFace(IndexType aTessU=0, IndexType aTessV=0, EnumFaceTypes aFaceType=FACETYPE_UNKNOWN) : m_tessU(aTessU), m_tessV(aTessV), m_faceType(aFaceType), m_serial(ms_nextSerial++) {}
+
+	/** @brief Unique number of the face.
+	 *
+	 *  The faces of a surface are not changed after they are tessellated,
+	 *  renderers can use the number as key to retain data of the face.
+	 *  Clearing the face gives it a new number.
+	 *
+	 *  @return Unique number of the face.
+	 */
+	inline unsigned long serial() const { return m_serial; }
+
 	inline TemplPrimVar<RtFloat> &reserveFloats(const CDeclaration &decl)
 	{
 		TemplPrimVar<RtFloat> &r = m_floats[decl.token()];
@@ -272,6 +287,7 @@ public:
 	
 	inline void clearIndices()
 	{
+		m_serial = ms_nextSerial++;
 		m_faceType = FACETYPE_UNKNOWN;
 		m_indices.clear();
 		m_sizes.clear();
@@ -45,6 +45,53 @@ namespace RiCPP {
 	 */
 	class CTransformation {
 		friend class CTransformationFactory;
+
+	public:
+		/** @brief Classes of transformation matrices.
+		 *
+		 *  The class of the composite transformation matrix is tracked to
+		 *  take fast paths for composition, inversion and determinants.
+		 *  Matrices use the row vector convention of the RenderMan interface,
+		 *  the translation is found in the last row.
+		 */
+		enum EnumMatrixClass {
+			MATRIX_IDENTITY = 0, ///< Identity matrix.
+			MATRIX_TRANSLATE,    ///< Translation only.
+			MATRIX_SCALE,        ///< Scaling along the axes, may be translated.
+			MATRIX_RIGID,        ///< Rotation, may be translated.
+			MATRIX_AFFINE,       ///< Any affine matrix.
+			MATRIX_PROJECTIVE    ///< Any matrix (e.g. perspective).
+		};
+
+		/** @brief Classifies a matrix.
+		 *  @param m The matrix.
+		 *  @return The class of @a m.
+		 */
+		static EnumMatrixClass classify(const RtMatrix m);
+
+		/** @brief Class of a product of two matrices.
+		 *  @param c1 Class of the first matrix.
+		 *  @param c2 Class of the second matrix.
+		 *  @return Class of the product of matrices of the classes @a c1 and @a c2.
+		 */
+		static EnumMatrixClass combine(EnumMatrixClass c1, EnumMatrixClass c2);
+
+		/** @brief Inverts a matrix of a known class.
+		 *  @param m The matrix.
+		 *  @param c Class of @a m.
+		 *  @retval inv The inverse of @a m.
+		 *  @return false, if @a m is singular.
+		 */
+		static bool invert(const RtMatrix m, EnumMatrixClass c, RtMatrix inv);
+
+		/** @brief Determinant of a matrix of a known class.
+		 *  @param m The matrix.
+		 *  @param c Class of @a m.
+		 *  @return The determinant of @a m.
+		 */
+		static RtFloat determinant(const RtMatrix m, EnumMatrixClass c);
+
+	private:
 		
 		//! Space type of the coordinate system (current, world, camera, screen, raster, etc.)
 		RtToken m_spaceType;
@@ -301,10 +348,16 @@ namespace RiCPP {
 		CMatrix3D m_CTM;
 		CMatrix3D m_CTM_onMotionStart;
 		
-		//! Inverse of the composit transformation matrix
-		CMatrix3D m_inverseCTM;
+		//! Inverse of the composit transformation matrix, valid if not m_inverseStale
+		mutable CMatrix3D m_inverseCTM;
 		CMatrix3D m_inverseCTM_onMotionStart;
 
+		//! true, m_inverseCTM has to be calculated from m_CTM at its next use
+		mutable bool m_inverseStale;
+
+		//! Class of the composit transformation matrix
+		EnumMatrixClass m_ctmClass;
+
 		
 		//! Defered transformations (motion block)
 		std::vector<IMovedTransform *> m_deferedTrans;
@@ -312,6 +365,23 @@ namespace RiCPP {
 		const CMotionState *m_motionState;
 
 		void clear();
+
+		/** @brief Calculates the inverse of the CTM, if it is stale.
+		 */
+		void validateInverse() const;
+
+		/** @brief The inverse of the CTM can be calculated lazily.
+		 *
+		 *  The inverse of projective matrices (perspective) and the
+		 *  inverse after a singular matrix are concatenated at once as
+		 *  before, the inverse is not stale then.
+		 *
+		 *  @return true, if the inverse is calculated lazily.
+		 */
+		inline bool lazyInverse() const
+		{
+			return m_isValid && m_ctmClass != MATRIX_PROJECTIVE;
+		}
 	public:
 		/** @brief Constructor, matrices are set to identity.
 		 */
@@ -321,7 +391,9 @@ namespace RiCPP {
 		 */
 		inline CTransformation(const CTransformation &rt) :
 			m_storeCounter(0),
-			m_dirty(true)
+			m_dirty(true),
+			m_inverseStale(false),
+			m_ctmClass(MATRIX_IDENTITY)
 		{
 			*this = rt;
 		}
@@ -374,16 +446,31 @@ namespace RiCPP {
 			return m_CTM;
 		}
 
+		/** @brief The inverse of the CTM, calculated at the first use after a change of the CTM.
+		 */
 		inline CMatrix3D &getInverseCTM()
 		{
+			validateInverse();
 			return m_inverseCTM;
 		}
 
 		inline const CMatrix3D &getInverseCTM() const
 		{
+			validateInverse();
 			return m_inverseCTM;
 		}
 
+		/** @brief Class of the CTM.
+		 */
+		inline EnumMatrixClass ctmClass() const { return m_ctmClass; }
+
+		/** @brief Determinant of the CTM.
+		 */
+		inline RtFloat determinant() const
+		{
+			return determinant(m_CTM.getMatrix(), m_ctmClass);
+		}
+
 		inline bool isValid() const { return m_isValid; }
 
 		virtual void reset();
@@ -7,13 +7,22 @@
 
 namespace RiCPP {
 
+	extern bool getEnvValue(CValue &p, const char *identifier);
+	extern bool hasVarSubst(const std::string &aStr, char varId='$', const char *stdPath=0, const char *curPath=0);
+
 	class IVarSubstCallback {
 	public:
 		inline virtual ~IVarSubstCallback() {}
 		virtual bool getValue(CValue &p, const char *identifier) const = 0;
+
+		/** @brief Looks up an environment variable, can be overwritten to memoize the values.
+		 */
+		inline virtual bool getEnvValue(CValue &p, const char *identifier) const
+		{
+			return RiCPP::getEnvValue(p, identifier);
+		}
 	};
 
-	extern bool getEnvValue(CValue &p, const char *identifier);
 	extern std::string &varSubst(std::string &aStr, char varId='$', const IVarSubstCallback *cb=0, const char *stdPath=0, const char *curPath=0);
 	extern std::string &varSubst(std::string &aStr, const char *fromVarm, char varId='$', const IVarSubstCallback *cb=0, const char *stdPath=0, const char *curPath=0);
 }
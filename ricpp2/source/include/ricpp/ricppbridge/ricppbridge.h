@@ -42,7 +42,12 @@
 #include "ricpp/ricontext/options.h"
 #endif // _RICPP_RICONTEXT_OPTIONS_H
 
+#include <atomic>
 #include <cstdarg>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace RiCPP {
 
@@ -62,6 +67,11 @@ namespace RiCPP {
  *
  * Normally only a single instance of CRiCPPBridge is used. However didn't want to
  * restrict it to be a singleton.
+ *
+ * The current context is kept per thread. Several threads can use the same bridge
+ * at the same time if each thread renders into its own context (a thread must not
+ * use a context that is current in another thread). beginV(), end(), context()
+ * and the options and declarations outside a context are serialized.
  */
 class CRiCPPBridge : public IRi, protected IRibParserCallback
 {
@@ -77,12 +87,6 @@ private:
 	 */
 	const IErrorHandler *m_curErrorHandler;
 	
-	/** @brief Number of last error occured.
-	 *
-	 *  The last error number (RIE_...)  occured, stored by CRiCPPBridgeErrorHandler::handleErrorV()
-	 */
-	RtInt m_lastError;
-	
 	/** @brief Options written ouside any rendering context and standard declarations.
 	 */
 	CDeclarationDictionary m_declDict;
@@ -169,17 +173,6 @@ private:
 
 	friend class CRiCPPBridgeErrorHandler;
 
-	/** @defgroup ricpp_tokenlist Tokenlist cache 
-	 * @brief Stores the token-parameter list.
-	 *
-	 * Used to store the token-parameter list of the current
-	 * interface call with variable parameters.
-	 */
-	//@{
-	std::vector<RtToken> m_tokens;		///<< The tokens of the parameter list of an interface call
-	std::vector<RtPointer> m_params;	///<< The values of the parameter list of an interface call
-	//@}
-
 	/** @brief Standard Rib filter.
 	 *
 	 *  Used by m_ribFilterList to hook in other Rib filters, Options can
@@ -240,24 +233,42 @@ protected:
 
 	/**  @brief Gets the rib filter functions called by the parser.
 	*
+	 *   The requests are dispatched to the first filter that handles them.
+	 *
 	 *   @return The rib filter functions called by the parser.
 	 */
 	inline virtual IRiRoot &ribFilter()
 	{
-		return firstRibFilter();
+		return m_ribFilterList.dispatch();
 	}
 
 	/** @brief Extracts all token-value pairs of an (...) interface call
 	 *
-	 *  The pairs are stored in m_tokens, m_params
+	 *  The pairs are stored in SThreadState::m_tokens, SThreadState::m_params of
+	 *  the calling thread, they can be accessed by varTokens() and varParams().
 	 *
 	 *  @param token First token of the token-value list
 	 *  @param marker va_start() marker
 	 *  @return Number of token value pairs found
-	 *  @see m_tokens, m_params
 	 */
 	RtInt getTokens(RtToken token, va_list marker);
 
+	/** @brief Tokens found by the last getTokens() of the thread.
+	 *  @return C array of tokens.
+	 */
+	inline RtToken *varTokens()
+	{
+		return &threadState().m_tokens[0];
+	}
+
+	/** @brief Parameters found by the last getTokens() of the thread.
+	 *  @return C array of parameter pointers.
+	 */
+	inline RtPointer *varParams()
+	{
+		return &threadState().m_params[0];
+	}
+
 	/** @brief Gets the frontend for RI-Calls (as used in procedurals)
 	 *
 	 *  @return Frontend for RI-calls
@@ -496,6 +507,81 @@ protected:
 		}
 	}; // class CContext
 
+	/** @brief State of the bridge per thread.
+	 *
+	 *  Each thread has its own current context, scratch vectors for the
+	 *  token-parameter lists of the interface calls with variable parameters
+	 *  and last error. The states are created by threadState() at the first call
+	 *  of a thread, they are deleted when the thread exits (see SThreadBridges)
+	 *  or with the bridge.
+	 */
+	struct SThreadState {
+		RtContextHandle m_ctxHandle;     ///< Current context handle of the thread.
+		CContext m_curCtx;               ///< Current creator, context pair of the thread, a copy of CContextManagement::m_ctxMap[m_ctxHandle].
+		RtInt m_lastError;               ///< Last error number (RIE_...) of the thread, stored by CRiCPPBridgeErrorHandler::handleErrorV().
+		std::vector<RtToken> m_tokens;   ///< The tokens of the parameter list of an interface call
+		std::vector<RtPointer> m_params; ///< The values of the parameter list of an interface call
+
+		/** @brief Initializes the state, no current context.
+		 */
+		inline SThreadState() : m_ctxHandle(illContextHandle), m_lastError(RIE_NOERROR) {}
+	}; // struct SThreadState
+
+	unsigned long m_id; ///< Unique number of the bridge (not reused), key of the thread local cache.
+	std::mutex m_threadMutex; ///< Guards m_threadStates.
+	std::map<std::thread::id, SThreadState *> m_threadStates; ///< States of the threads that used the bridge.
+
+	static std::atomic<unsigned long> ms_nextId; ///< Next value of m_id.
+	static thread_local unsigned long ms_cachedId; ///< m_id of the bridge last used by the thread.
+	static thread_local SThreadState *ms_cachedState; ///< State of the thread in the bridge last used.
+
+	/** @brief The bridges a thread has a state in, thread local.
+	 *
+	 *  The destructor is called when the thread exits, it removes the states
+	 *  of the thread from the bridges still existing. So the states of finished
+	 *  threads do not pile up and a new thread getting the id of a finished
+	 *  one starts without a current context.
+	 */
+	struct SThreadBridges {
+		std::vector<unsigned long> m_ids; ///< m_id of the bridges.
+		~SThreadBridges();
+	}; // struct SThreadBridges
+
+	static thread_local SThreadBridges ms_threadBridges; ///< The bridges used by the thread.
+	static thread_local bool ms_threadExiting; ///< ms_threadBridges is destroyed, the states are not registered anymore.
+
+	/** @brief Guards bridges().
+	 *  @return The mutex.
+	 */
+	static std::mutex &bridgesMutex();
+
+	/** @brief The existing bridges.
+	 *  @return Map of the m_id to the bridges.
+	 */
+	static std::map<unsigned long, CRiCPPBridge *> &bridges();
+
+	/** @brief Deletes the state of the calling thread.
+	 */
+	void removeThreadState();
+
+	/** @brief Finds or creates the state of the calling thread, fills the cache.
+	 *  @return State of the calling thread.
+	 */
+	SThreadState &findThreadState();
+
+	/** @brief Gets the state of the calling thread.
+	 *
+	 *  The state of the bridge used last by the thread is cached thread locally.
+	 *
+	 *  @return State of the calling thread.
+	 */
+	inline SThreadState &threadState()
+	{
+		if ( ms_cachedId == m_id )
+			return *ms_cachedState;
+		return findThreadState();
+	}
+
 	/** @brief Context Management, maps frontend to backend (instance is m_ctxMgmt).
 	 *
 	 *  A RtContextHandle is mapped to a CContext, the backend context creator/rendering context pairs.
@@ -508,10 +594,16 @@ protected:
 	 */
 	class CContextManagement {
 		RtContextHandle m_nextCtxHandle; ///< Next value for context handle (counts 1 upwarts), deleted handles are not reused.
-		RtContextHandle m_ctxHandle;     ///< Current context handle of the frontend.
-		CContext m_curCtx;               ///< Current creator, context pair of the backend, it is a copy of m_ctxMap[m_ctxHandle] for faster access
 		std::map<RtContextHandle, CContext> m_ctxMap; ///< Maps used frontend context handles to its backend CContext context creator/rendering context pair.
 
+		/** @brief Serializes the creation, switching and ending of contexts.
+		 *
+		 *  Guards m_ctxMap, m_nextCtxHandle, the renderer loader and the context creators,
+		 *  a context creator is shared by the contexts of all threads. Recursive, because
+		 *  the error handlers called while a context begins or ends can call the bridge.
+		 */
+		std::recursive_mutex m_mutex;
+
 		CRiCPPBridge *m_outer; ///< Bridge that contains the context manager.
 
 		/** @brief Loader for backends.
@@ -526,8 +618,9 @@ protected:
 		 *  illContextHandle, the handle that represents the bridge itself cannot be removed.
 		 *
 		 * @param handle The RtContextHandle as key, illContextHandle is not removed.
+		 * @param ts State of the calling thread
 		 */
-		void removeContext(RtContextHandle handle);
+		void removeContext(RtContextHandle handle, SThreadState &ts);
 
 		/** @brief Adds a new CContext instance.
 		 *
@@ -535,7 +628,7 @@ protected:
 		 *  with the frontend handle as key. The handle is the number m_nextCtxHandle.
 		 *  m_nextCtxHandle is also increased at the end of this method to
 		 *  serve as the next handle.
-		 *	m_ctxHandle, the current context handle, is set by the calling function
+		 *	The current context handle of the thread is set by the calling function
 		 *  beginV() to refer the new context.
 		 *
 		 * @param ctx A backend context creator/rendering context pair, to be stored
@@ -573,9 +666,18 @@ protected:
 		 *  client can call requests until end(). But since it
 		 *  is aborted no renderering and error handling will be done.
 		 */
-		inline void abort()
+		void abort();
+
+		/** @brief Mutex that serializes the context management.
+		 *
+		 *  Also used by the bridge to guard its options and declarations
+		 *  outside the contexts, they are copied by beginV().
+		 *
+		 *  @return The mutex of the context management
+		 */
+		inline std::recursive_mutex &mutex()
 		{
-			m_curCtx.abort();
+			return m_mutex;
 		}
 
 		/** @brief Begins a new context.
@@ -618,7 +720,7 @@ protected:
 		 */
 		inline RtContextHandle getContext() const
 		{
-			return m_ctxHandle;
+			return m_outer->threadState().m_ctxHandle;
 		}
 
 		/** @brief Test if the context handle is in the map.
@@ -628,6 +730,7 @@ protected:
 		 */
 		inline bool isContext(RtContextHandle handle)
 		{
+			std::lock_guard<std::recursive_mutex> lock(m_mutex);
 			return m_ctxMap.find(handle) != m_ctxMap.end();
 		}
 
@@ -638,12 +741,12 @@ protected:
 		 */
 		inline const CContext &curBackend() const
 		{
-			return m_curCtx;
+			return m_outer->threadState().m_curCtx;
 		}
 
 		inline CContext &curBackend()
 		{
-			return m_curCtx;
+			return m_outer->threadState().m_curCtx;
 		}
 
 		/** @brief Sets and activates the new current context.
@@ -661,6 +764,7 @@ protected:
 		 */
 		inline void searchpath(const char *path)
 		{
+			std::lock_guard<std::recursive_mutex> lock(m_mutex);
 			m_rendererLoader.searchpath(path);
 		}
 
@@ -687,6 +791,7 @@ protected:
 			const char *name,
 			TemplPluginFactory<CContextCreator> *f)
 		{
+			std::lock_guard<std::recursive_mutex> lock(m_mutex);
 			return m_rendererLoader.registerFactory(name, f);
 		}
 
@@ -696,6 +801,7 @@ protected:
 		 */
 		inline virtual bool unregisterFactory(const char *name)
 		{
+			std::lock_guard<std::recursive_mutex> lock(m_mutex);
 			return m_rendererLoader.unregisterFactory(name);
 		}
 
@@ -714,6 +820,7 @@ protected:
 		 */
 		inline void standardRendererName(const char *name)
 		{
+			std::lock_guard<std::recursive_mutex> lock(m_mutex);
 			m_rendererLoader.standardRendererName(name);
 		}
 	};
@@ -52,9 +52,14 @@
 #include "ricpp/tools/templatefuncs.h"
 #endif // _RICPP_TOOLS_TEMPLATEFUNCS_H
 
+#ifndef _RICPP_TOOLS_MEMORYBUFFERS_H
+#include "ricpp/tools/memorybuffers.h"
+#endif // _RICPP_TOOLS_MEMORYBUFFERS_H
+
 #include "zlib.h"
 
 #include <fstream>
+#include <vector>
 
 namespace RiCPP {
 	/** @brief Open mode type for streams.
@@ -131,6 +136,44 @@ namespace RiCPP {
 		 *  @return Number of bytes written.
 		 */
 		virtual std::streamsize sputn(const char *b, std::streamsize size) = 0;
+
+		/** @brief Sets the read position.
+		 *
+		 *  Resources that cannot be positioned need not to overwrite this.
+		 *
+		 *  @param pos New position (byte offset from the start of the resource).
+		 *  @return false, the position cannot be set.
+		 */
+		inline virtual bool seek(std::streamoff pos)
+		{
+			return false;
+		}
+
+		/** @brief Tests if the read position can be set by seek().
+		 *
+		 *  @return false, seek() is not supported.
+		 */
+		inline virtual bool seekable() const
+		{
+			return false;
+		}
+		
+		/** @brief Gets the whole content, if it is available in memory.
+		 *
+		 *  Resources that are not held in memory need not to overwrite this.
+		 *  CFrontStreambuf reads unzipped content of such resources without
+		 *  copying it.
+		 *
+		 *  @retval data The content (valid while the resource is open).
+		 *  @retval size Size of the content in bytes.
+		 *  @return false, the content is not available in memory.
+		 */
+		inline virtual bool directData(const char *&data, std::streamsize &size) const
+		{
+			data = 0;
+			size = 0;
+			return false;
+		}
 		
 		/** @brief Gets the URI (read-only) of the associated resource.
 		 *
@@ -217,6 +260,22 @@ namespace RiCPP {
 		 */
 		inline virtual std::streamsize sputn(const char *b,
 											 std::streamsize size);
+
+		/** @brief Sets the read position of the file.
+		 *
+		 *  @param pos New position (byte offset from the start of the file).
+		 *  @return false, the file is not opened for reading or the position cannot be set.
+		 */
+		virtual bool seek(std::streamoff pos);
+
+		/** @brief Tests if the read position can be set by seek().
+		 *
+		 *  @return true, the file is opened for reading.
+		 */
+		inline virtual bool seekable() const
+		{
+			return isOpen() && (mode() & std::ios_base::in) != 0;
+		}
 	}; // CFileBackBuffer
 
 
@@ -480,6 +539,162 @@ namespace RiCPP {
 	}; // CFileBackBufferFactory
 
 
+	/** @brief Back end buffer reading a buffer of CMemoryBuffers.
+	 *
+	 *  Memory back buffers can only be read.
+	 *
+	 *  @see CBackBufferRoot, CMemoryBuffers
+	 */
+	class CMemoryBackBuffer : public CBackBufferRoot {
+		CMemoryBuffers::TypeData m_buffer; ///< Content of the buffer.
+		std::streamoff m_pos; ///< Read position.
+	public:
+		/** @brief Constructor
+		 */
+		inline CMemoryBackBuffer() : m_pos(0) {}
+
+		/** @brief Destructor, releases the content.
+		 */
+		inline virtual ~CMemoryBackBuffer() {}
+
+		/** @brief Releases the content.
+		 */
+		inline virtual void close()
+		{
+			m_buffer.reset();
+			m_pos = 0;
+		}
+
+		/** @brief Opens a memory buffer for reading.
+		 *
+		 *  @param anAbsUri The absolute URI of the buffer, the path is the name
+		 *         of the buffer.
+		 *  @param aMode The mode used to open the resource, only reading is possible.
+		 *  @return false, buffer not registered or opened for writing.
+		 */
+		virtual bool open(
+			const CUri &anAbsUri,
+			TypeOpenMode aMode = std::ios_base::in|std::ios_base::binary);
+
+		/** @brief Query whether the buffer is open.
+		 *
+		 *  @return true, the buffer is open.
+		 */
+		inline virtual bool isOpen() const
+		{
+			return m_buffer.get() != 0;
+		}
+
+		/** @brief Copies bytes from the buffer.
+		 *
+		 *  @param  b Points to the location where the data will be stored.
+		 *  @param  size Maximal number of bytes that can be stored at *b.
+		 *  @return Number of bytes read.
+		 */
+		virtual std::streamsize sgetn(char *b, std::streamsize size);
+
+		/** @brief Memory buffers cannot be written.
+		 *
+		 *  @return 0
+		 */
+		inline virtual std::streamsize sputn(const char *b, std::streamsize size)
+		{
+			return 0;
+		}
+
+		/** @brief Sets the read position.
+		 *
+		 *  @param pos New position (byte offset from the start of the buffer).
+		 *  @return false, the buffer is not open or the position is out of range.
+		 */
+		virtual bool seek(std::streamoff pos);
+
+		/** @brief Tests if the read position can be set by seek().
+		 *
+		 *  @return true, the buffer is open.
+		 */
+		inline virtual bool seekable() const
+		{
+			return isOpen();
+		}
+
+		/** @brief Gets the whole content.
+		 *
+		 *  @retval data The content.
+		 *  @retval size Size of the content in bytes.
+		 *  @return false, the buffer is not open.
+		 */
+		virtual bool directData(const char *&data, std::streamsize &size) const;
+	}; // CMemoryBackBuffer
+
+
+	/** @brief Factory of CMemoryBackBuffer objects (scheme "MEMORY").
+	 *  @see CBackBufferRoot, CMemoryBuffers
+	 */
+	class CMemoryBackBufferFactory : public CBackBufferFactory {
+	public:
+		/** @brief Gets the classes plugin name ("memory_backbuffer").
+		 *
+		 *  @return The the classes plugin name.
+		 */
+		static const char *myName();
+		
+		/** @brief Gets the classes plugin type ("backbufferfactory").
+		 *
+		 *  @return The plugin type.
+		 */
+		static const char *myType();
+
+		/** @brief Major version of the plugin class.
+		 *
+		 *  @return The major version of the plugin class.
+		 */
+		static unsigned long myMajorVersion();
+
+		/** @brief Minor version of the plugin class.
+		 *
+		 *  @return The minor version of the plugin class.
+		 */
+		static unsigned long myMinorVersion();
+
+		/** @brief Revision number of the plugin class.
+		 *
+		 *  @return The revision number version of the plugin class.
+		 */
+		static unsigned long myRevision();
+
+		/** @brief Default constructor
+		 *
+		 *  Supports the "MEMORY" scheme.
+		 */
+		inline CMemoryBackBufferFactory() { addScheme("MEMORY"); }
+
+		/** @brief Destructor, nothing to do
+		 */
+		inline virtual ~CMemoryBackBufferFactory() {}
+
+		inline virtual const char *type() const { return myType(); }
+		inline virtual const char *name() const { return myName(); }
+		inline virtual unsigned long majorVersion() const { return myMajorVersion(); }
+		inline virtual unsigned long minorVersion() const { return myMinorVersion(); }
+		inline virtual unsigned long revision() const { return myRevision(); }
+
+		inline virtual void startup() {}
+		inline virtual void shutdown() {}
+
+		/** @brief Opens a new memory back buffer object.
+		 *
+		 *  @param absUri Absolute URI of the memory buffer to open.
+		 *  @param mode Mode used to open the buffer, only reading is possible.
+		 *  @return A new, opened memory back buffer object.
+		 *  @see CMemoryBackBuffer
+		 */
+		virtual CBackBufferRoot *open(
+			const CUri &absUri,
+			TypeOpenMode mode = std::ios_base::in|std::ios_base::binary);
+	}; // CMemoryBackBufferFactory
+
+
 	/** @brief Registration for back buffer factories.
 	 *
 	 * It's not a singleton, because every RiCPP frontend has its own. Can
@@ -502,7 +717,11 @@ namespace RiCPP {
 		 */
 		TemplPluginFactory<CFileBackBufferFactory> m_fileBuffer;
 		
-		/** @brief Sets a directory, registers the file buffer factory and loads
+		/** @brief Factory for memory buffers is immanent.
+		 */
+		TemplPluginFactory<CMemoryBackBufferFactory> m_memoryBuffer;
+		
+		/** @brief Sets a directory, registers the file and memory buffer factories and loads
 		 *         factories from the directory.
 		 *  @param direct Name of the directory containing the ".buffer" buffer
 		 *                factory files.
@@ -524,7 +743,7 @@ namespace RiCPP {
 
 		/** @brief Gets a buffer factory for a specific protocol scheme.
 		 *
-		 *  At the moment only FILE: is supported.
+		 *  At the moment only FILE: and MEMORY: are supported.
 		 *
 		 *  @param scheme Protocol name
 		 *  @return Buffer factory for the protocol @a scheme
@@ -540,6 +759,90 @@ namespace RiCPP {
 		}
 	}; // CBackBufferProtocolHandlers
 
+	/** @brief Access points for random access into a zipped stream.
+	 *
+	 *  Each access point stores the position of a deflate block boundary in
+	 *  the zipped (in) and the unzipped (out) stream, together with the last
+	 *  32KB of unzipped data needed to resume inflating there (like zran.c
+	 *  of the zlib examples). The access points are recorded by a
+	 *  CFrontStreambuf while reading and used by its seekpos().
+	 */
+	class CInflateIndex {
+	public:
+		/** @brief An access point.
+		 */
+		struct SAccessPoint {
+			std::streamoff m_out; ///< Position in the unzipped stream.
+			std::streamoff m_in;  ///< Position of the first complete byte in the zipped stream.
+			int m_bits;           ///< Number of bits (0-7) of the byte in front of m_in belonging to the next block.
+			std::vector<unsigned char> m_window; ///< Unzipped data in front of m_out (up to WINDOW_SIZE bytes).
+		};
+
+		/** @brief Size of the inflate window (32KB).
+		 */
+		static const unsigned long WINDOW_SIZE;
+
+	private:
+		std::streamoff m_span;              ///< Minimal distance of the access points in the unzipped stream.
+		std::vector<SAccessPoint> m_points; ///< The access points, ordered by m_out.
+
+	public:
+		/** @brief Constructor.
+		 *  @param span Minimal distance of the access points in the unzipped stream.
+		 */
+		inline CInflateIndex(std::streamoff span = 1<<20) : m_span(span > 0 ? span : 1) {}
+
+		/** @brief Gets the minimal distance of the access points.
+		 *  @return The minimal distance of the access points.
+		 */
+		inline std::streamoff span() const { return m_span; }
+
+		/** @brief Removes all access points.
+		 */
+		inline void clear() { m_points.clear(); }
+
+		/** @brief Gets the access points.
+		 *  @return The access points, ordered by their position in the unzipped stream.
+		 */
+		inline const std::vector<SAccessPoint> &points() const { return m_points; }
+
+		/** @brief Tests if an access point at @a out should be recorded.
+		 *  @param out Position in the unzipped stream.
+		 *  @return true, @a out is at least span() behind the last access point.
+		 */
+		inline bool needsPoint(std::streamoff out) const
+		{
+			return out >= (m_points.empty() ? 0 : m_points.back().m_out) + m_span;
+		}
+
+		/** @brief Appends an access point, it must be behind the last one.
+		 *  @param out Position in the unzipped stream.
+		 *  @param in Position of the first complete byte in the zipped stream.
+		 *  @param bits Number of bits of the byte in front of @a in belonging to the next block.
+		 *  @param window Unzipped data in front of @a out.
+		 *  @param windowSize Size of @a window (at most WINDOW_SIZE).
+		 */
+		void addPoint(std::streamoff out, std::streamoff in, int bits, const unsigned char *window, unsigned long windowSize);
+
+		/** @brief Finds the access point to resume inflating for a position.
+		 *  @param out Position in the unzipped stream.
+		 *  @return The last access point in front of or at @a out, 0 if there is none.
+		 */
+		const SAccessPoint *find(std::streamoff out) const;
+
+		/** @brief Writes the access points.
+		 *  @param out Stream to write to (binary).
+		 *  @return false, an error occured.
+		 */
+		bool write(std::ostream &out) const;
+
+		/** @brief Reads access points written by write().
+		 *  @param in Stream to read from (binary).
+		 *  @return false, an error occured, the index is cleared.
+		 */
+		bool read(std::istream &in);
+	}; // CInflateIndex
+
 	/** @brief Type of the stream elements.
 	 */
 	typedef char TypeFrontStreambufElement;
@@ -612,6 +915,14 @@ namespace RiCPP {
 		z_stream m_strmIn;
 		TemplBuffer<TypeFrontStreambufElement> m_transferInBuffer;
 		bool m_inIsEOF;
+		std::streamoff m_inBufferPos;   ///< @brief Position in the unzipped stream of the data read by the last underflow().
+		std::streamoff m_inRawPos;      ///< @brief Position in the zipped stream, where the deflate data (counted by m_strmIn.total_in) starts.
+		std::streamoff m_inHeaderSize;  ///< @brief Number of bytes read by check_header().
+		CInflateIndex *m_inflateIndex;  ///< @brief Access points recorded and used for random access, 0 if not used.
+		std::vector<unsigned char> m_window; ///< @brief Last unzipped bytes (circular) to record access points.
+		unsigned long m_windowPos;      ///< @brief Next write position in m_window.
+		unsigned long m_windowFill;     ///< @brief Number of valid bytes in m_window.
+		bool m_directIn;                ///< @brief The get area is the content of the back buffer (CBackBufferRoot::directData()).
 		long m_in;
 		long m_crcIn;
 		int m_transparentIn; ///< @brief Read input without unpacking zipped content.
@@ -659,11 +970,30 @@ namespace RiCPP {
 			}
 
 			m_strmIn.avail_in--;
+			++m_inHeaderSize;
 			return (int)*(m_strmIn.next_in++);
 		}
 
 		bool check_header();
 		unsigned int fill_in_buffer();
+
+		/** @brief Restarts reading the back buffer at a position of the zipped stream.
+		 *  @param rawPos Position in the zipped stream.
+		 *  @return false, the back buffer cannot be positioned.
+		 */
+		bool restartIn(std::streamoff rawPos);
+
+		/** @brief Appends unzipped data to m_window.
+		 *  @param data The unzipped data.
+		 *  @param size Size of @a data.
+		 */
+		void keepWindow(const unsigned char *data, unsigned long size);
+
+		/** @brief Reads and skips unzipped data.
+		 *  @param n Number of bytes to skip.
+		 *  @return false, end of the stream reached.
+		 */
+		bool skipIn(std::streamoff n);
 		
 		inline CFrontStreambuf(CFrontStreambuf &) {}
 		inline CFrontStreambuf() {}
@@ -675,6 +1005,26 @@ namespace RiCPP {
 		virtual int_type overflow(int_type c);
 		virtual int_type underflow();
 
+		/** @brief Gets or sets the read position (position in the unzipped stream).
+		 *
+		 *  Only std::ios_base::beg and std::ios_base::cur are supported.
+		 *
+		 *  @see seekpos()
+		 */
+		virtual pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which = std::ios_base::in);
+
+		/** @brief Sets the read position (position in the unzipped stream).
+		 *
+		 *  The back buffer has to support seeking. Zipped streams are
+		 *  inflated from the nearest access point of inflateIndex() (or from
+		 *  the start) to the position.
+		 *
+		 *  @param pos The position.
+		 *  @param which Only std::ios_base::in is supported.
+		 *  @return The new position, pos_type(off_type(-1)) if the position cannot be set.
+		 */
+		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in);
+
 		/** @brief Set m_baseUri to the file path current directory
 		 */
 		void setBaseCwd();
@@ -767,6 +1117,40 @@ namespace RiCPP {
 		{
 			return false;
 		}
+
+		/** @brief Sets the access points for random access into zipped streams.
+		 *
+		 *  While reading a zipped stream new access points are added to
+		 *  @a index, seekpos() uses them.
+		 *
+		 *  @param index The access points, 0 to use none. The index is not
+		 *         owned by the stream buffer.
+		 */
+		void inflateIndex(CInflateIndex *index);
+
+		/** @brief Gets the access points for random access into zipped streams.
+		 *  @return The access points, 0 if none are used.
+		 */
+		inline CInflateIndex *inflateIndex() const
+		{
+			return m_inflateIndex;
+		}
+
+		/** @brief Tests if the read position can be set by seekpos().
+		 *  @return true, the back buffer supports seeking.
+		 */
+		inline bool seekable() const
+		{
+			return m_backBuffer != 0 && m_backBuffer->seekable();
+		}
+
+		/** @brief Tests if the stream is read unzipped.
+		 *  @return true, the stream is not zipped.
+		 */
+		inline bool transparentIn() const
+		{
+			return m_transparentIn != 0;
+		}
 	}; // CFrontStreambuf
 
 } // namespace RiCPP
@@ -0,0 +1,119 @@
+#ifndef _RICPP_TOOLS_BYTEORDER_H
+#define _RICPP_TOOLS_BYTEORDER_H
+
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file byteorder.h
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Conversion of float arrays from and to the big endian byte
+ *         order of binary RIB
+ */
+
+#include <cstring>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define _RICPP_TOOLS_BYTEORDER_SSE2
+#endif
+
+namespace RiCPP {
+
+/** @brief Tests the byte order of the machine.
+ *  @return true, the machine is little endian.
+ */
+inline bool littleEndian()
+{
+	const unsigned int one = 1;
+	unsigned char c;
+	memcpy(&c, &one, 1);
+	return c == 1;
+}
+
+/** @brief Swaps the bytes of a 32 bit word.
+ *  @param w The word.
+ *  @return The word with swapped bytes.
+ */
+inline unsigned int swapBytes(unsigned int w)
+{
+	return (w >> 24) | ((w >> 8) & 0xff00U) | ((w << 8) & 0xff0000U) | (w << 24);
+}
+
+/** @brief Swaps the bytes of 32 bit words.
+ *
+ *  Four words are swapped at once using SSE2, if available.
+ *
+ *  @param dst Destination of the words (can be @a src).
+ *  @param src The words (need not to be aligned).
+ *  @param n Number of words.
+ */
+inline void swapBytes(unsigned char *dst, const unsigned char *src, unsigned long n)
+{
+	unsigned long i = 0;
+#if defined _RICPP_TOOLS_BYTEORDER_SSE2
+	for ( ; i + 4 <= n; i += 4 ) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4*i));
+		// Swap the bytes of the 16 bit halves, then the halves
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4*i), v);
+	}
+#endif
+	for ( ; i < n; ++i ) {
+		unsigned int w;
+		memcpy(&w, src + 4*i, 4);
+		w = swapBytes(w);
+		memcpy(dst + 4*i, &w, 4);
+	}
+}
+
+/** @brief Converts floats to big endian IEEE singles (binary RIB).
+ *  @param dst Destination, 4 * @a n bytes.
+ *  @param src The floats.
+ *  @param n Number of floats.
+ */
+inline void floatsToBigEndian(unsigned char *dst, const float *src, unsigned long n)
+{
+	if ( littleEndian() )
+		swapBytes(dst, reinterpret_cast<const unsigned char *>(src), n);
+	else
+		memcpy(dst, src, 4*n);
+}
+
+/** @brief Converts big endian IEEE singles (binary RIB) to floats in place.
+ *  @param data The singles read, the floats afterwards.
+ *  @param n Number of floats.
+ */
+inline void bigEndianToFloats(float *data, unsigned long n)
+{
+	if ( littleEndian() ) {
+		unsigned char *bytes = reinterpret_cast<unsigned char *>(data);
+		swapBytes(bytes, bytes, n);
+	}
+}
+
+} // namespace RiCPP
+
+#endif // _RICPP_TOOLS_BYTEORDER_H
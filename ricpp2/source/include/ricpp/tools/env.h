@@ -96,6 +96,24 @@ namespace RiCPP {
 		 */
 		inline static const char *progDirName() {return "PROGDIR";}
 
+		/** @brief Gets the generation number of the environment.
+		 *
+		 *  The number is incremented by changed(), caches of expanded
+		 *  variables (e.g. in CRenderState) are discarded if it differs.
+		 *
+		 *  @return The current generation number of the environment.
+		 */
+		static unsigned long generation();
+
+		/** @brief Marks the environment as changed.
+		 *
+		 *  Should be called after the process environment has been modified,
+		 *  e.g. by setenv(), to invalidate cached values at once. Without
+		 *  the call, CRenderState notices changed values of the variables
+		 *  it has read at the next frame or world block.
+		 */
+		static void changed();
+
 		/** @brief Gets the value of the special variable TMP (so called in RiCPP).
 		 *
 		 *  A path to a directory, where data can be stored temporarily.
@@ -181,6 +199,21 @@ namespace RiCPP {
 			return get(var, varName, convertPath);
 		}
 
+		/** @brief Creates an empty temporary file with a unique name.
+		 *
+		 *  The file is created in the directory for temporary files of
+		 *  the system (TMPDIR on MacOs and Linux, TMP or TEMP on Windows).
+		 *  Unlike the name returned by getTempFilename() the name cannot be
+		 *  taken by another file before it is used. The file has to be
+		 *  removed by the caller.
+		 *
+		 *  @retval tmpPath Native path of the created file.
+		 *  @param prefix Prefix of the file name, can be 0.
+		 *  @param extension Extension of the file name (e.g. ".rib"), can be 0.
+		 *  @return @a tmpPath as C string, 0 if no file could be created.
+		 */
+		static const char *createTempFile(std::string &tmpPath, const char *prefix, const char *extension);
+
 		static inline const char *getTempFilename(std::string &tmpPath, const char *extension, bool convertPath)
 		{
 			const char *tmpfile = 0;
@@ -0,0 +1,166 @@
+#ifndef _RICPP_TOOLS_MEMORYBUFFERS_H
+#define _RICPP_TOOLS_MEMORYBUFFERS_H
+
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file memorybuffers.h
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Declaration of the registry of named memory buffers
+ *         (read by the "memory" URI scheme)
+ */
+#ifndef _RICPP_TOOLS_INLINETOOLS_H
+#include "ricpp/tools/inlinetools.h"
+#endif // _RICPP_TOOLS_INLINETOOLS_H
+
+#include <ios>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace RiCPP {
+
+/** @brief Process wide registry of named memory buffers.
+ *
+ *  The buffers are read by the "memory" scheme, e.g. a buffer
+ *  registered as "foo" can be read by ReadArchive "memory:foo". The data
+ *  is reference counted, unregistering a buffer while it is read
+ *  is safe. All member functions are thread safe.
+ *
+ *  @see CMemoryBackBuffer, CMemoryBackBufferFactory
+ */
+class CMemoryBuffers {
+public:
+	/** @brief Content of a registered buffer.
+	 */
+	class CData {
+		const char *m_data;         ///< Begin of the content.
+		std::streamsize m_size;     ///< Size of the content in bytes.
+		std::vector<char> m_owned;  ///< Content owned by the buffer, if any.
+	public:
+		/** @brief Refers to data owned by the caller.
+		 *  @param data Begin of the content.
+		 *  @param size Size of the content in bytes.
+		 */
+		inline CData(const char *data, std::streamsize size)
+			: m_data(data), m_size(size)
+		{
+		}
+
+		/** @brief Takes over data, @a data will be empty afterwards.
+		 *  @param data The content.
+		 */
+		inline CData(std::vector<char> &data)
+		{
+			m_owned.swap(data);
+			m_data = m_owned.empty() ? 0 : &m_owned[0];
+			m_size = static_cast<std::streamsize>(m_owned.size());
+		}
+
+		/** @brief Gets the begin of the content.
+		 *  @return The begin of the content.
+		 */
+		inline const char *data() const { return m_data; }
+
+		/** @brief Gets the size of the content.
+		 *  @return The size of the content in bytes.
+		 */
+		inline std::streamsize size() const { return m_size; }
+	}; // CData
+
+	/** @brief Reference counted content of a buffer.
+	 */
+	typedef std::shared_ptr<const CData> TypeData;
+
+private:
+	/** @brief Gets the mutex guarding the registry.
+	 *  @return The mutex.
+	 */
+	static std::mutex &mutex();
+
+	/** @brief Gets the buffers, indexed by their names.
+	 *  @return The buffers.
+	 */
+	static std::map<std::string, TypeData> &buffers();
+
+public:
+	/** @brief Gets the buffer name used by a memory URI or name.
+	 *
+	 *  A leading "memory:" and slashes are removed, "memory:foo",
+	 *  "memory:/foo" and "foo" all name the buffer "foo".
+	 *
+	 *  @param name URI or name of a buffer.
+	 *  @return The name of the buffer.
+	 */
+	static std::string bufferName(const char *name);
+
+	/** @brief Registers a buffer, the data is owned by the caller.
+	 *
+	 *  The data must stay valid until the buffer is unregistered and
+	 *  is not read anymore.
+	 *
+	 *  @param name Name of the buffer (an existing buffer is replaced).
+	 *  @param data Begin of the content.
+	 *  @param size Size of the content in bytes.
+	 *  @return false, invalid name.
+	 */
+	static bool registerBuffer(const char *name, const char *data, std::streamsize size);
+
+	/** @brief Registers a buffer, takes over the data.
+	 *
+	 *  @param name Name of the buffer (an existing buffer is replaced).
+	 *  @param data The content, is empty afterwards.
+	 *  @return false, invalid name.
+	 */
+	static bool registerBuffer(const char *name, std::vector<char> &data);
+
+	/** @brief Unregisters a buffer.
+	 *
+	 *  Open memory back buffers keep reading the content.
+	 *
+	 *  @param name Name of the buffer.
+	 *  @return false, there was no buffer with that name.
+	 */
+	static bool unregisterBuffer(const char *name);
+
+	/** @brief Finds a buffer.
+	 *
+	 *  @param name Name of the buffer.
+	 *  @return The content, empty if there is no buffer with that name.
+	 */
+	static TypeData find(const char *name);
+
+	/** @brief Gets a name, not used by a registered buffer.
+	 *
+	 *  @param prefix Prefix of the name.
+	 *  @return Name "prefix-n" with a number n.
+	 */
+	static std::string uniqueName(const char *prefix);
+}; // CMemoryBuffers
+
+} // namespace RiCPP
+
+#endif // _RICPP_TOOLS_MEMORYBUFFERS_H
@@ -69,7 +69,8 @@ private:
 	 */
 	inline void maskColon(std::string &str)
 	{
-		std::for_each(str.begin(), str.end(), std::ptr_fun(RiCPP::maskColon));
+		for ( std::string::iterator i = str.begin(); i != str.end(); ++i )
+			RiCPP::maskColon(*i);
 	}
 	
 	/** @brief Converts all '|' to ':'
@@ -77,7 +78,8 @@ private:
 	 */
 	inline void unmaskColon(std::string &str)
 	{
-		std::for_each(str.begin(), str.end(), std::ptr_fun(RiCPP::unmaskColon));
+		for ( std::string::iterator i = str.begin(); i != str.end(); ++i )
+			RiCPP::unmaskColon(*i);
 	}
 
 public:
@@ -0,0 +1,229 @@
+#ifndef _RICPP_TOOLS_TRACER_H
+#define _RICPP_TOOLS_TRACER_H
+
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file tracer.h
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Runtime enabled tracing of begin/end events, written as Chrome trace (JSON).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace RiCPP {
+
+/** @brief Records begin and end events of the hot paths (parsing, archives, replay, tessellation, hiding).
+ *
+ *  The tracer is enabled at runtime (Control "trace" "enable" 1). If disabled, the
+ *  trace points only test a flag. Each thread records to its own ring buffer without
+ *  locks, the oldest events are overwritten if the buffer is full. The buffer of
+ *  a thread that exited is retired and reused by the next thread recording its
+ *  first event, so short living threads (e.g. the lexer threads started for each
+ *  archive) do not allocate new buffers. The events of a retired buffer are kept
+ *  until they are written, cleared or overwritten. The
+ *  events are written in the Chrome trace event format (JSON), that can be
+ *  viewed by chrome://tracing or Perfetto.
+ *
+ *  There is one tracer per module (ricppTracer()), the rendering contexts of a
+ *  module share the timeline. write() should be called if the traced threads
+ *  are idle (e.g. at RiEnd), events recorded while writing can be garbled.
+ *
+ *  Event names are not copied, they must be static strings. A detail (e.g.
+ *  the name of an archive) is copied, truncated to TRACE_DETAIL_SIZE-1 characters.
+ */
+class CTracer {
+public:
+	/** @brief Size of the detail of an event (including the terminating 0).
+	 */
+	static const unsigned int TRACE_DETAIL_SIZE = 32;
+
+	/** @brief Default number of events of the ring buffer of a thread.
+	 */
+	static const unsigned long TRACE_DEFAULT_CAPACITY = 1UL << 18;
+
+	/** @brief A recorded event.
+	 */
+	struct STraceEvent {
+		unsigned long long m_time;             ///< Time in nanoseconds (steady clock).
+		const char *m_name;                    ///< Name of the event (static string).
+		char m_phase;                          ///< 'B' begin, 'E' end.
+		char m_detail[TRACE_DETAIL_SIZE];      ///< Optional detail, empty if there is none.
+	};
+
+	/** @brief Ring buffer of the events of a thread.
+	 *
+	 *  Only the owning thread writes to the buffer.
+	 */
+	struct SThreadBuffer {
+		unsigned long m_threadId;                   ///< Number of the buffer (1, 2, ...), shown as thread id.
+		bool m_retired;                             ///< The owning thread exited, the buffer can be reused (guarded by m_mutex).
+		std::vector<STraceEvent> m_events;          ///< The ring of events.
+		std::atomic<unsigned long long> m_count;    ///< Number of events recorded, m_count % size is the next position.
+		unsigned long long m_cleared;               ///< m_count at the last clear(), events before are discarded.
+	};
+
+private:
+	static std::atomic<bool> m_enabled;   ///< Tracing enabled, tested by the trace points.
+
+	std::mutex m_mutex;                   ///< Guards the list of buffers (registration of a thread, writing).
+	std::vector<SThreadBuffer *> m_buffers; ///< The buffers of all threads that recorded events.
+	unsigned long m_capacity;             ///< Capacity of new buffers.
+
+	/** @brief Gets (and registers at the first call) the buffer of the current thread.
+	 *
+	 *  A retired buffer is reused, a new one is only created if there is none.
+	 *
+	 *  @return The buffer of the current thread.
+	 */
+	SThreadBuffer &threadBuffer();
+
+	/** @brief Records an event.
+	 *  @param phase 'B' or 'E'.
+	 *  @param aName Static name of the event.
+	 *  @param aDetail Detail, copied, can be 0.
+	 */
+	void record(char phase, const char *aName, const char *aDetail);
+
+public:
+	/** @brief Constructor, the tracer is disabled.
+	 */
+	CTracer();
+
+	/** @brief Destructor, frees the buffers.
+	 */
+	~CTracer();
+
+	/** @brief Gets the current time.
+	 *  @return Time in nanoseconds.
+	 */
+	inline static unsigned long long now()
+	{
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/** @brief Tracing is enabled.
+	 *  @return true, if the events are recorded.
+	 */
+	inline static bool enabled() { return m_enabled.load(std::memory_order_relaxed); }
+
+	/** @brief Enables or disables the tracing.
+	 *  @param isEnabled true, events are recorded.
+	 */
+	inline static void enabled(bool isEnabled) { m_enabled.store(isEnabled, std::memory_order_relaxed); }
+
+	/** @brief Number of events per thread, applies to threads recording their first event.
+	 *  @return Number of events of the ring buffers.
+	 */
+	inline unsigned long capacity() const { return m_capacity; }
+
+	/** @brief Sets the number of events per thread.
+	 *  @param aCapacity Number of events of the ring buffers (> 0) of the threads recording their first event.
+	 */
+	inline void capacity(unsigned long aCapacity) { if ( aCapacity > 0 ) m_capacity = aCapacity; }
+
+	/** @brief Records the begin of an event.
+	 *  @param aName Static name of the event.
+	 *  @param aDetail Detail (copied), can be 0.
+	 */
+	inline void begin(const char *aName, const char *aDetail = 0) { record('B', aName, aDetail); }
+
+	/** @brief Records the end of an event.
+	 *  @param aName Static name of the event.
+	 */
+	inline void end(const char *aName) { record('E', aName, 0); }
+
+	/** @brief Discards the events recorded so far.
+	 */
+	void clear();
+
+	/** @brief Retires the buffer of a thread, called when the thread exits.
+	 *  @param buf The buffer of the thread.
+	 */
+	void retire(SThreadBuffer &buf);
+
+	/** @brief Writes the events in the Chrome trace event format.
+	 *  @param out Stream to write to.
+	 */
+	void writeChrome(std::ostream &out);
+
+	/** @brief Writes the events to a file in the Chrome trace event format.
+	 *  @param aFilename Name of the file, "-" is the standard error stream.
+	 *  @return false, if the file could not be written.
+	 */
+	bool write(const std::string &aFilename);
+}; // CTracer
+
+
+/** @brief The tracer of the module.
+ *  @return The tracer.
+ */
+extern CTracer &ricppTracer();
+
+
+/** @brief Traces a scope (begin at construction, end at destruction), if tracing is enabled.
+ */
+class CTraceScope {
+	const char *m_name; ///< Name of the event, 0 if tracing was disabled at construction.
+public:
+	/** @brief Records the begin of an event, if tracing is enabled.
+	 *  @param aName Static name of the event.
+	 *  @param aDetail Detail (copied), can be 0.
+	 */
+	inline CTraceScope(const char *aName, const char *aDetail = 0)
+	{
+		m_name = 0;
+		if ( CTracer::enabled() ) {
+			m_name = aName;
+			ricppTracer().begin(aName, aDetail);
+		}
+	}
+
+	/** @brief Records the end of the event, if the begin was recorded.
+	 */
+	inline ~CTraceScope()
+	{
+		end();
+	}
+
+	/** @brief Records the end of the event before the end of the scope.
+	 */
+	inline void end()
+	{
+		if ( m_name ) {
+			ricppTracer().end(m_name);
+			m_name = 0;
+		}
+	}
+}; // CTraceScope
+
+} // namespace RiCPP
+
+#endif // _RICPP_TOOLS_TRACER_H
@@ -62,10 +62,15 @@ void RiCPPRoot(IRi *aRoot) {
 	_riRoot = aRoot;
 }
 	
+std::mutex &RiCPPSlotMutex() {
+	static std::mutex slotMutex;
+	return slotMutex;
+}
 // ----------------------------------------------------------------------------
 RtInt RiCPPGetArgs(va_list marker, RtToken **tokens, RtPointer **params) {
-	static std::vector<RtToken> vec_tokens;   // The tokens of the parameter list of an interface call
-	static std::vector<RtPointer> vec_params; // The values of the parameter list of an interface call
+	// Per thread, the C binding can be called by several threads (each in its own context)
+	static thread_local std::vector<RtToken> vec_tokens;   // The tokens of the parameter list of an interface call
+	static thread_local std::vector<RtPointer> vec_params; // The values of the parameter list of an interface call
 	assert(tokens != 0);
 	assert(params != 0);
 	vec_tokens.clear(); *tokens = 0;
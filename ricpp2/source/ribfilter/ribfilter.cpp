@@ -28,9 +28,16 @@
  */
 
 #include "ricpp/ribfilter/ribfilter.h"
+#include "ricpp/ribfilter/ribfilterlist.h"
 
 using namespace RiCPP;
 
+void CRibFilter::changed()
+{
+	if ( m_list )
+		m_list->updateDispatch();
+}
+
 const char *CRibFilter::myName() { return "ribfilterroot"; }
 const char *CRibFilter::myType() { return "ribfilter"; }
 unsigned long CRibFilter::myMajorVersion() { return 1; }
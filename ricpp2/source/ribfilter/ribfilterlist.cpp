@@ -29,6 +29,8 @@
 
 #include "ricpp/ribfilter/ribfilterlist.h"
 
+#include <vector>
+
 using namespace RiCPP;
 
 bool CRibFilterList::addFront(CRibFilter *aFilter)
@@ -40,7 +42,9 @@ bool CRibFilterList::addFront(CRibFilter *aFilter)
 		return false;
 
 	aFilter->m_next = firstHandler();
+	aFilter->m_list = this;
 	m_filters.push_front(aFilter);
+	updateDispatch();
 	return true;
 }
 
@@ -56,7 +60,9 @@ bool CRibFilterList::removeFront()
 	if ( current != m_filters.end() ) {
 		CRibFilter *filter = (*current);
 		filter->m_next = 0;
+		filter->m_list = 0;
 		m_filters.remove(*current);
+		updateDispatch();
 		deleteFilterPlugin(filter); // deletes only if self loaded
 		return true;
 	}
@@ -65,6 +71,31 @@ bool CRibFilterList::removeFront()
 }
 
 
+void CRibFilterList::updateDispatch()
+{
+	// The filters in calling order, m_ri is the last one and calls the frontend
+	std::vector<CRibFilter *> chain(m_filters.begin(), m_filters.end());
+	if ( m_ri )
+		chain.push_back(m_ri);
+
+	m_dispatch.m_first = firstHandler();
+	for ( int req = 0; req < N_REQUESTS; ++req ) {
+		IRiRoot *handler = m_dispatch.m_first;
+		std::vector<CRibFilter *>::const_iterator i;
+		for ( i = chain.begin(); i != chain.end(); i++ ) {
+			// A filter is only skipped if it would forward the request, a filter
+			// that drops the request (disabled, suspended) is called.
+			if ( !(*i)->forwarding((EnumRequests)req) || !(*i)->canCall((EnumRequests)req) ) {
+				handler = (*i);
+				break;
+			}
+			handler = (*i)->callee();
+		}
+		m_dispatch.m_handler[req] = handler;
+	}
+}
+
+
 CRibFilter *CRibFilterList::newFilterPlugin(const char *name)
 {
 	return m_pluginHandler.newPlugin(name);
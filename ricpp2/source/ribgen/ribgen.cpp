@@ -0,0 +1,509 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file ribgen.cpp
+ *  @author Andreas Pidde (andreas@pidde.de).
+ *  @brief ribgen, generates synthetic RIB scenes of a given size.
+
+Writes parameterized scenes by the RIB writer (ribwriter) to get input
+of a controlled size for benchmarks and stress tests: quadrics, meshes
+(PointsPolygons and SubdivisionMesh with a number of faces each), deep
+attribute nesting, object instancing, delayed read archives and primitives
+with huge parameter arrays. The scenes can be written as ASCII, binary
+or gzip compressed RIB.
+
+The scene depends only on the options, especially the seed, the same options
+produce the same output (the random numbers are generated by an own generator).
+
+The delayed read archives are written as separate files next to the scene
+file, e.g. scene_arch0.rib, scene_arch1.rib, ... for scene.rib, the
+scene references them by their name without the path.
+
+@verbatim
+ribgen [options] filename
+-s seed       Seed of the random numbers (default 4711)
+-F n          Number of frames (default 1)
+-q n          Number of quadrics per frame (default 100)
+-p n          Number of PointsPolygons meshes per frame (default 10)
+-d n          Number of SubdivisionMesh meshes per frame (default 10)
+-f n          Number of faces per mesh (default 100)
+-n n          Depth of the attribute nesting (default 16)
+-O n          Number of objects (ObjectBegin, default 4)
+-I n          Number of object instances per frame (default 100)
+-a n          Number of delayed read archives (default 8)
+-A n          Size of the huge array (number of points of a Points primitive, default 10000)
+-b            Writes binary RIB
+-z            Writes gzip compressed RIB
+-h            Prints the help
+@endverbatim
+
+The renderer module ribwriter must be found, like for ribtool.
+ */
+
+#include "ricpp/ricppbridge/ricppbridge.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace RiCPP;
+
+// ----------------------------------------------------------------------------
+// Settings
+
+static unsigned long seed = 4711;       ///< Seed of the random numbers
+static unsigned long frames = 1;        ///< Number of frames
+static unsigned long quadrics = 100;    ///< Number of quadrics per frame
+static unsigned long polyMeshes = 10;   ///< Number of PointsPolygons per frame
+static unsigned long subdivMeshes = 10; ///< Number of SubdivisionMesh per frame
+static unsigned long faces = 100;       ///< Number of faces per mesh
+static unsigned long nesting = 16;      ///< Depth of the attribute nesting
+static unsigned long objects = 4;       ///< Number of objects
+static unsigned long instances = 100;   ///< Number of instances per frame
+static unsigned long archives = 8;      ///< Number of delayed read archives
+static unsigned long arraySize = 10000; ///< Number of points of the huge array
+static RtInt binary = 0;                ///< Writes binary RIB
+static RtInt compression = 0;           ///< Compression level of the output, 0 no compression
+
+/** @brief Deterministic random numbers (64 bit linear congruential generator).
+ *
+ *  Used instead of rand() to get the same scenes on all platforms.
+ */
+class CGenRandom {
+	unsigned long long m_state;
+public:
+	inline CGenRandom(unsigned long aSeed) : m_state(aSeed) {}
+
+	/** @brief Next random number.
+	 *  @return Number in [0, 1).
+	 */
+	inline RtFloat next()
+	{
+		m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (RtFloat)((m_state >> 40) & 0xffffff) / (RtFloat)0x1000000;
+	}
+
+	/** @brief Next random number in a range.
+	 *  @return Number in [lo, hi).
+	 */
+	inline RtFloat range(RtFloat lo, RtFloat hi) { return lo + (hi-lo)*next(); }
+
+	/** @brief Next random index.
+	 *  @return Number in [0, n).
+	 */
+	inline unsigned long index(unsigned long n) { return n ? tmin((unsigned long)(next()*n), n-1) : 0; }
+};
+
+// ----------------------------------------------------------------------------
+// Scene elements
+
+/** @brief Random position and orientation of a primitive in the scene.
+ */
+static void place(CRiCPPBridge &ri, CGenRandom &rnd, RtFloat size)
+{
+	ri.translate(rnd.range(-size, size), rnd.range(-size, size), rnd.range(-size, size));
+	ri.rotate(rnd.range(0, 360), rnd.range(-1, 1), rnd.range(-1, 1), 1);
+}
+
+/** @brief Random color.
+ */
+static void color(CRiCPPBridge &ri, CGenRandom &rnd)
+{
+	RtFloat c[3] = { rnd.next(), rnd.next(), rnd.next() };
+	ri.color(c);
+}
+
+/** @brief One of the seven quadrics with random parameters.
+ */
+static void quadric(CRiCPPBridge &ri, unsigned long i, CGenRandom &rnd)
+{
+	RtFloat thetamax = rnd.range(180, 360);
+	switch ( i % 7 ) {
+		case 0: {
+			RtFloat r = rnd.range(0.5f, 1.0f);
+			ri.sphereV(r, -r, r, thetamax, 0, 0, 0);
+			break;
+		}
+		case 1:
+			ri.coneV(rnd.range(0.5f, 2.0f), rnd.range(0.2f, 1.0f), thetamax, 0, 0, 0);
+			break;
+		case 2:
+			ri.cylinderV(rnd.range(0.2f, 1.0f), rnd.range(-1.0f, 0.0f), rnd.range(0.1f, 1.0f), thetamax, 0, 0, 0);
+			break;
+		case 3:
+			ri.diskV(rnd.range(-0.5f, 0.5f), rnd.range(0.2f, 1.0f), thetamax, 0, 0, 0);
+			break;
+		case 4: {
+			RtPoint p1 = { rnd.range(0.2f, 1.0f), 0, -1 };
+			RtPoint p2 = { 0, rnd.range(0.2f, 1.0f), 1 };
+			ri.hyperboloidV(p1, p2, thetamax, 0, 0, 0);
+			break;
+		}
+		case 5:
+			ri.paraboloidV(rnd.range(0.2f, 1.0f), 0, rnd.range(0.5f, 2.0f), thetamax, 0, 0, 0);
+			break;
+		default:
+			ri.torusV(1.0f, rnd.range(0.1f, 0.5f), 0, 360, thetamax, 0, 0, 0);
+			break;
+	}
+}
+
+/** @brief Topology of a mesh of quads with exactly @a nfaces faces.
+ *
+ *  The quads are arranged in rows of a grid, the last row can be incomplete.
+ *
+ *  @param nfaces Number of faces.
+ *  @retval nverts Number of vertices per face (always 4).
+ *  @retval verts Vertex indices.
+ *  @retval width Number of vertices of a row of the grid.
+ *  @return Number of vertices used.
+ */
+static RtInt meshTopology(RtInt nfaces, std::vector<RtInt> &nverts, std::vector<RtInt> &verts, RtInt &width)
+{
+	RtInt cols = tmax((RtInt)ceil(sqrt((double)nfaces)), (RtInt)1);
+	width = cols+1;
+	nverts.assign(nfaces, 4);
+	verts.clear();
+	verts.reserve(nfaces*4);
+	RtInt maxIdx = 0;
+	for ( RtInt f = 0; f < nfaces; ++f ) {
+		RtInt v = f / cols, u = f % cols;
+		verts.push_back(v*width+u);
+		verts.push_back(v*width+u+1);
+		verts.push_back((v+1)*width+u+1);
+		verts.push_back((v+1)*width+u);
+		maxIdx = tmax(maxIdx, (v+1)*width+u+1);
+	}
+	return maxIdx+1;
+}
+
+/** @brief Vertices of a mesh (grid in the xy plane with random heights), normalized to [-1, 1].
+ */
+static void meshPoints(RtInt npts, RtInt width, std::vector<RtFloat> &p, CGenRandom &rnd)
+{
+	p.clear();
+	p.reserve(npts*3);
+	RtInt rows = (npts+width-1)/width;
+	RtFloat su = 2.0f/(RtFloat)tmax(width-1, (RtInt)1);
+	RtFloat sv = 2.0f/(RtFloat)tmax(rows-1, (RtInt)1);
+	for ( RtInt i = 0; i < npts; ++i ) {
+		p.push_back(-1.0f + su*(RtFloat)(i % width));
+		p.push_back(-1.0f + sv*(RtFloat)(i / width));
+		p.push_back(rnd.range(-0.1f, 0.1f));
+	}
+}
+
+/** @brief A mesh with the number of faces of the settings.
+ *
+ *  @param subdiv true, SubdivisionMesh (Catmull-Clark), false PointsPolygons.
+ */
+static void mesh(CRiCPPBridge &ri, bool subdiv, CGenRandom &rnd)
+{
+	std::vector<RtInt> nverts, verts;
+	std::vector<RtFloat> p;
+	RtInt width;
+	RtInt npts = meshTopology((RtInt)tmax(faces, 1UL), nverts, verts, width);
+	meshPoints(npts, width, p, rnd);
+
+	RtToken tokens[1] = { RI_P };
+	RtPointer params[1] = { &p[0] };
+	if ( subdiv ) {
+		RtToken tags[1] = { RI_INTERPOLATEBOUNDARY };
+		RtInt nargs[2] = { 0, 0 };
+		ri.subdivisionMeshV(RI_CATMULL_CLARK, (RtInt)nverts.size(), &nverts[0], &verts[0], 1, tags, nargs, 0, 0, 1, tokens, params);
+	} else {
+		ri.pointsPolygonsV((RtInt)nverts.size(), &nverts[0], &verts[0], 1, tokens, params);
+	}
+}
+
+/** @brief Attribute blocks nested to the depth of the settings, a sphere at each level.
+ */
+static void nestedAttributes(CRiCPPBridge &ri, CGenRandom &rnd)
+{
+	for ( unsigned long d = 0; d < nesting; ++d ) {
+		ri.attributeBegin();
+		color(ri, rnd);
+		ri.translate(rnd.range(-0.5f, 0.5f), rnd.range(-0.5f, 0.5f), rnd.range(-0.5f, 0.5f));
+		ri.rotate(rnd.range(0, 45), 0, 0, 1);
+		ri.scale(0.9f, 0.9f, 0.9f);
+		ri.sphereV(0.2f, -0.2f, 0.2f, 360, 0, 0, 0);
+	}
+	for ( unsigned long d = 0; d < nesting; ++d ) {
+		ri.attributeEnd();
+	}
+}
+
+/** @brief Points primitive with huge arrays (position, color and width per point).
+ */
+static void hugeArrays(CRiCPPBridge &ri, CGenRandom &rnd)
+{
+	if ( !arraySize )
+		return;
+
+	std::vector<RtFloat> p, cs, w;
+	p.reserve(arraySize*3);
+	cs.reserve(arraySize*3);
+	w.reserve(arraySize);
+	for ( unsigned long i = 0; i < arraySize; ++i ) {
+		for ( int j = 0; j < 3; ++j ) {
+			p.push_back(rnd.range(-1, 1));
+			cs.push_back(rnd.next());
+		}
+		w.push_back(rnd.range(0.005f, 0.02f));
+	}
+	RtToken tokens[3] = { RI_P, RI_CS, RI_WIDTH };
+	RtPointer params[3] = { &p[0], &cs[0], &w[0] };
+	ri.pointsV((RtInt)arraySize, 3, tokens, params);
+}
+
+/** @brief Name of the i-th delayed read archive of a scene.
+ */
+static std::string archiveName(const std::string &filename, unsigned long i)
+{
+	std::string::size_type pos = filename.find_last_of('.');
+	std::string::size_type sep = filename.find_last_of("/\\");
+	if ( pos == std::string::npos || (sep != std::string::npos && pos < sep) )
+		pos = filename.size();
+	std::ostringstream s;
+	s << filename.substr(0, pos) << "_arch" << i << filename.substr(pos);
+	return s.str();
+}
+
+/** @brief Starts the RIB writer with the output format of the settings.
+ */
+static void beginOutput(CRiCPPBridge &ri, const std::string &filename)
+{
+	const char *name = filename.c_str();
+	ri.begin("ribwriter", RI_FILE, &name, "compress", &compression, RI_NULL);
+	ri.control("ribwriter", "binary-output", &binary, RI_NULL);
+}
+
+/** @brief Writes a delayed read archive, the content lies in [-1, 1]^3.
+ *
+ *  Geometry is not valid at the top level of a file, so the content is
+ *  defined as an inline archive that is read immediately afterwards.
+ */
+static void writeArchive(CRiCPPBridge &ri, const std::string &filename, unsigned long i)
+{
+	CGenRandom rnd(seed + 1 + i);
+	std::ostringstream name;
+	name << "ribgen_arch" << i;
+	beginOutput(ri, filename);
+	ri.archiveBegin(name.str().c_str(), RI_NULL);
+	ri.attributeBegin();
+	color(ri, rnd);
+	ri.scale(0.5f, 0.5f, 0.5f);
+	quadric(ri, i, rnd);
+	mesh(ri, (i % 2) != 0, rnd);
+	ri.attributeEnd();
+	ri.archiveEnd();
+	ri.readArchiveV(name.str().c_str(), 0, 0, 0, 0);
+	ri.end();
+}
+
+/** @brief Writes the scene and its delayed read archives.
+ */
+static void writeScene(CRiCPPBridge &ri, const std::string &filename)
+{
+	std::vector<std::string> archiveRefs;
+	for ( unsigned long i = 0; i < archives; ++i ) {
+		std::string aname = archiveName(filename, i);
+		writeArchive(ri, aname, i);
+		std::string::size_type sep = aname.find_last_of("/\\");
+		archiveRefs.push_back(sep == std::string::npos ? aname : aname.substr(sep+1));
+	}
+
+	CGenRandom rnd(seed);
+	beginOutput(ri, filename);
+
+	RtFloat fov = 45.0f;
+	ri.format(640, 480, 1.0f);
+	ri.projection(RI_PERSPECTIVE, RI_FOV, &fov, RI_NULL);
+
+	std::vector<RtObjectHandle> handles;
+	for ( unsigned long i = 0; i < objects; ++i ) {
+		handles.push_back(ri.objectBegin());
+		quadric(ri, i, rnd);
+		mesh(ri, false, rnd);
+		ri.objectEnd();
+	}
+
+	for ( unsigned long frame = 0; frame < frames; ++frame ) {
+		ri.frameBegin((RtInt)frame+1);
+		ri.translate(0, 0, 30);
+		ri.worldBegin();
+		ri.surface(RI_PLASTIC, RI_NULL);
+
+		for ( unsigned long i = 0; i < quadrics; ++i ) {
+			ri.attributeBegin();
+			color(ri, rnd);
+			place(ri, rnd, 10);
+			quadric(ri, i, rnd);
+			ri.attributeEnd();
+		}
+
+		for ( unsigned long i = 0; i < polyMeshes + subdivMeshes; ++i ) {
+			ri.attributeBegin();
+			color(ri, rnd);
+			place(ri, rnd, 10);
+			mesh(ri, i >= polyMeshes, rnd);
+			ri.attributeEnd();
+		}
+
+		if ( nesting ) {
+			ri.attributeBegin();
+			place(ri, rnd, 5);
+			nestedAttributes(ri, rnd);
+			ri.attributeEnd();
+		}
+
+		for ( unsigned long i = 0; i < instances && !handles.empty(); ++i ) {
+			ri.attributeBegin();
+			color(ri, rnd);
+			place(ri, rnd, 10);
+			ri.objectInstance(handles[rnd.index(handles.size())]);
+			ri.attributeEnd();
+		}
+
+		for ( unsigned long i = 0; i < archiveRefs.size(); ++i ) {
+			ri.attributeBegin();
+			place(ri, rnd, 10);
+			RtString data[1] = { archiveRefs[i].c_str() };
+			RtBound bound = { -1, 1, -1, 1, -1, 1 };
+			ri.procedural((RtPointer)data, bound, ri.procDelayedReadArchive(), 0);
+			ri.attributeEnd();
+		}
+
+		if ( arraySize ) {
+			ri.attributeBegin();
+			ri.scale(10, 10, 10);
+			hugeArrays(ri, rnd);
+			ri.attributeEnd();
+		}
+
+		ri.worldEnd();
+		ri.frameEnd();
+	}
+
+	ri.end();
+}
+
+// ----------------------------------------------------------------------------
+// Main
+
+/** @brief Prints the usage.
+ */
+static void printUsage()
+{
+	std::cout << "Usage: ribgen [options] filename" << std::endl;
+	std::cout << "-s seed  seed of the random numbers (default 4711)" << std::endl;
+	std::cout << "-F n     number of frames (default 1)" << std::endl;
+	std::cout << "-q n     number of quadrics per frame (default 100)" << std::endl;
+	std::cout << "-p n     number of PointsPolygons meshes per frame (default 10)" << std::endl;
+	std::cout << "-d n     number of SubdivisionMesh meshes per frame (default 10)" << std::endl;
+	std::cout << "-f n     number of faces per mesh (default 100)" << std::endl;
+	std::cout << "-n n     depth of the attribute nesting (default 16)" << std::endl;
+	std::cout << "-O n     number of objects (default 4)" << std::endl;
+	std::cout << "-I n     number of object instances per frame (default 100)" << std::endl;
+	std::cout << "-a n     number of delayed read archives (default 8)" << std::endl;
+	std::cout << "-A n     size of the huge array, number of points (default 10000)" << std::endl;
+	std::cout << "-b       writes binary RIB" << std::endl;
+	std::cout << "-z       writes gzip compressed RIB" << std::endl;
+	std::cout << "-h       prints this help" << std::endl;
+}
+
+/** @brief Reads a count of an option.
+ */
+static unsigned long count(const char *arg)
+{
+	long l = atol(arg);
+	return l > 0 ? (unsigned long)l : 0;
+}
+
+/** @brief The main function.
+ *
+ *  @param argc number of arguments @a argv
+ *  @param argv The arguments, see ribgen.cpp
+ *  @return 0, if no error occured, 1, otherwise
+ */
+int main(int argc, char * const argv[])
+{
+	std::string filename;
+
+	for ( int i = 1; i < argc; ++i ) {
+		std::string arg(argv[i]);
+		bool hasValue = i+1 < argc;
+		if ( arg == "-h" ) {
+			printUsage();
+			return 0;
+		} else if ( arg == "-b" ) {
+			binary = 1;
+		} else if ( arg == "-z" ) {
+			compression = 6;
+		} else if ( hasValue && arg == "-s" ) {
+			seed = (unsigned long)strtoul(argv[++i], 0, 10);
+		} else if ( hasValue && arg == "-F" ) {
+			frames = count(argv[++i]);
+		} else if ( hasValue && arg == "-q" ) {
+			quadrics = count(argv[++i]);
+		} else if ( hasValue && arg == "-p" ) {
+			polyMeshes = count(argv[++i]);
+		} else if ( hasValue && arg == "-d" ) {
+			subdivMeshes = count(argv[++i]);
+		} else if ( hasValue && arg == "-f" ) {
+			faces = tmax(count(argv[++i]), 1UL);
+		} else if ( hasValue && arg == "-n" ) {
+			nesting = count(argv[++i]);
+		} else if ( hasValue && arg == "-O" ) {
+			objects = count(argv[++i]);
+		} else if ( hasValue && arg == "-I" ) {
+			instances = count(argv[++i]);
+		} else if ( hasValue && arg == "-a" ) {
+			archives = count(argv[++i]);
+		} else if ( hasValue && arg == "-A" ) {
+			arraySize = count(argv[++i]);
+		} else if ( arg.size() > 1 && arg[0] == '-' ) {
+			std::cerr << "ribgen: unknown option " << arg << std::endl;
+			printUsage();
+			return 1;
+		} else if ( filename.empty() ) {
+			filename = arg;
+		} else {
+			std::cerr << "ribgen: more than one filename " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	if ( filename.empty() ) {
+		std::cerr << "ribgen: missing filename" << std::endl;
+		printUsage();
+		return 1;
+	}
+
+	CRiCPPBridge ri;
+	writeScene(ri, filename);
+	return 0;
+}
@@ -0,0 +1,487 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file ribframeindex.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Implementation of the frame index for random access to the frames of rib streams.
+ */
+
+#include "ricpp/ribparser/ribframeindex.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <set>
+
+using namespace RiCPP;
+
+const unsigned long CRibFrameSelection::MAX_WANTED = 1<<16;
+const std::streamoff CRibFrameIndex::DEFAULT_SPAN = 1<<20;
+
+// ----------------------------------------------------------------------------
+// Reads a frame number of a list, p points to the first digit
+static RtInt readFrameNumber(const char *&p)
+{
+	long n = 0;
+	while ( *p >= '0' && *p <= '9' ) {
+		if ( n < (long)std::numeric_limits<RtInt>::max() )
+			n = n*10 + (*p - '0');
+		++p;
+	}
+	if ( n > (long)std::numeric_limits<RtInt>::max() )
+		n = (long)std::numeric_limits<RtInt>::max();
+	return (RtInt)n;
+}
+
+static inline void skipBlanks(const char *&p)
+{
+	while ( *p == ' ' || *p == '\t' )
+		++p;
+}
+
+bool CRibFrameSelection::parseList(const char *list, std::vector<SRange> &ranges)
+{
+	std::vector<SRange> found;
+	const char *p = list ? list : "";
+	for (;;) {
+		skipBlanks(p);
+		if ( !*p )
+			break;
+		if ( *p == ',' ) {
+			++p;
+			continue;
+		}
+		SRange r;
+		if ( *p == '-' ) {
+			// -n
+			++p;
+			skipBlanks(p);
+			if ( *p < '0' || *p > '9' )
+				return false;
+			r.m_first = 1;
+			r.m_last = readFrameNumber(p);
+		} else if ( *p >= '0' && *p <= '9' ) {
+			// n, n-m, n-
+			r.m_first = readFrameNumber(p);
+			r.m_last = r.m_first;
+			skipBlanks(p);
+			if ( *p == '-' ) {
+				++p;
+				skipBlanks(p);
+				if ( *p >= '0' && *p <= '9' )
+					r.m_last = readFrameNumber(p);
+				else
+					r.m_last = std::numeric_limits<RtInt>::max();
+			}
+		} else {
+			return false;
+		}
+		if ( r.m_first > r.m_last )
+			return false;
+		found.push_back(r);
+		skipBlanks(p);
+		if ( *p && *p != ',' )
+			return false;
+	}
+	ranges.insert(ranges.end(), found.begin(), found.end());
+	return true;
+}
+
+bool CRibFrameSelection::member(const std::vector<SRange> &ranges, RtInt frameNo)
+{
+	std::vector<SRange>::const_iterator i;
+	for ( i = ranges.begin(); i != ranges.end(); ++i ) {
+		if ( frameNo >= (*i).m_first && frameNo <= (*i).m_last )
+			return true;
+	}
+	return false;
+}
+
+void CRibFrameSelection::clear()
+{
+	m_hasFrames = false;
+	m_frames.clear();
+	m_excluded.clear();
+}
+
+bool CRibFrameSelection::frames(const char *list)
+{
+	m_hasFrames = true;
+	return parseList(list, m_frames);
+}
+
+bool CRibFrameSelection::excludeFrames(const char *list)
+{
+	return parseList(list, m_excluded);
+}
+
+bool CRibFrameSelection::selected(RtInt frameNo) const
+{
+	if ( m_hasFrames && !member(m_frames, frameNo) )
+		return false;
+	return !member(m_excluded, frameNo);
+}
+
+unsigned long CRibFrameSelection::wantedFrames() const
+{
+	if ( !m_hasFrames )
+		return 0;
+	
+	unsigned long total = 0;
+	std::vector<SRange>::const_iterator i;
+	for ( i = m_frames.begin(); i != m_frames.end(); ++i ) {
+		if ( (*i).m_last == std::numeric_limits<RtInt>::max() )
+			return 0;
+		total += (unsigned long)((*i).m_last - (*i).m_first) + 1;
+		if ( total > MAX_WANTED )
+			return 0;
+	}
+	
+	std::set<RtInt> wanted;
+	for ( i = m_frames.begin(); i != m_frames.end(); ++i ) {
+		for ( RtInt n = (*i).m_first; n <= (*i).m_last; ++n ) {
+			if ( !member(m_excluded, n) )
+				wanted.insert(n);
+		}
+	}
+	return (unsigned long)wanted.size();
+}
+
+// ----------------------------------------------------------------------------
+CRibRangeStreambuf::CRibRangeStreambuf(std::streambuf &source, std::streamoff size)
+	: m_source(&source), m_remaining(size > 0 ? size : 0), m_buffer(1<<16)
+{
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0]);
+}
+
+CRibRangeStreambuf::int_type CRibRangeStreambuf::underflow()
+{
+	if ( gptr() < egptr() )
+		return traits_type::to_int_type(*gptr());
+	
+	if ( m_remaining <= 0 )
+		return traits_type::eof();
+	
+	std::streamsize n = static_cast<std::streamsize>(m_buffer.size());
+	if ( m_remaining < static_cast<std::streamoff>(n) )
+		n = static_cast<std::streamsize>(m_remaining);
+	n = m_source->sgetn(&m_buffer[0], n);
+	if ( n <= 0 ) {
+		m_remaining = 0;
+		return traits_type::eof();
+	}
+	m_remaining -= n;
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0]+n);
+	return traits_type::to_int_type(*gptr());
+}
+
+// ----------------------------------------------------------------------------
+// Characters ending a token of the frame scanner
+static inline bool isTokenDelimiter(unsigned char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v' ||
+	       c == '[' || c == ']' || c == '"' || c == '#' || c > 0177;
+}
+
+static bool isIntegerToken(const std::string &token)
+{
+	std::string::size_type i = 0;
+	if ( i < token.size() && (token[i] == '-' || token[i] == '+') )
+		++i;
+	if ( i >= token.size() )
+		return false;
+	for ( ; i < token.size(); ++i ) {
+		if ( token[i] < '0' || token[i] > '9' )
+			return false;
+	}
+	return true;
+}
+
+CRibFrameIndex::CRibFrameIndex(std::streamoff span)
+	: m_inflateIndex(span)
+{
+	clear();
+}
+
+void CRibFrameIndex::clear()
+{
+	m_frames.clear();
+	m_prologueEnd = 0;
+	m_length = 0;
+	m_lastLine = 1;
+	m_inflateIndex.clear();
+}
+
+// Handles a token found by the frame scanner
+static void scannedToken(
+	std::vector<CRibFrameIndex::SFrame> &frames,
+	const std::string &token,
+	std::streamoff begin, long beginLine,
+	std::streamoff end, long endLine,
+	int &archiveDepth, bool &inFrame, bool &frameNumber)
+{
+	bool wasFrameNumber = frameNumber;
+	frameNumber = false;
+
+	if ( wasFrameNumber && isIntegerToken(token) ) {
+		frames.back().m_number = (RtInt)atol(token.c_str());
+	} else if ( token == "ArchiveBegin" ) {
+		++archiveDepth;
+	} else if ( token == "ArchiveEnd" ) {
+		if ( archiveDepth > 0 )
+			--archiveDepth;
+	} else if ( archiveDepth == 0 && token == "FrameBegin" ) {
+		if ( inFrame ) {
+			// FrameEnd is missing
+			frames.back().m_end = begin;
+			frames.back().m_endLine = beginLine;
+		}
+		CRibFrameIndex::SFrame frame;
+		frame.m_number = 1;
+		frame.m_begin = begin;
+		frame.m_beginLine = beginLine;
+		frame.m_end = begin;
+		frame.m_endLine = beginLine;
+		frames.push_back(frame);
+		inFrame = true;
+		frameNumber = true;
+	} else if ( archiveDepth == 0 && inFrame && token == "FrameEnd" ) {
+		frames.back().m_end = end;
+		frames.back().m_endLine = endLine;
+		inFrame = false;
+	}
+}
+
+bool CRibFrameIndex::build(std::streambuf &sb)
+{
+	clear();
+
+	enum { SCAN_SPACE, SCAN_TOKEN, SCAN_COMMENT, SCAN_STRING, SCAN_ESCAPE } state = SCAN_SPACE;
+
+	std::vector<char> buffer(1<<16);
+	std::string token;
+	std::streamoff pos = 0, tokenStart = 0;
+	long line = 1, tokenLine = 1;
+	unsigned char last = 0;
+	int archiveDepth = 0;
+	bool inFrame = false;
+	bool frameNumber = false; // The token following FrameBegin is the frame number
+
+	std::streamsize n;
+	while ( (n = sb.sgetn(&buffer[0], static_cast<std::streamsize>(buffer.size()))) > 0 ) {
+		for ( std::streamsize i = 0; i < n; ++i ) {
+			unsigned char c = static_cast<unsigned char>(buffer[i]);
+			
+			if ( state == SCAN_TOKEN && isTokenDelimiter(c) ) {
+				state = SCAN_SPACE;
+				scannedToken(m_frames, token, tokenStart, tokenLine, pos, line, archiveDepth, inFrame, frameNumber);
+			}
+			
+			switch ( state ) {
+				case SCAN_TOKEN:
+					token.push_back(c);
+					break;
+				case SCAN_SPACE:
+					if ( c == '#' ) {
+						state = SCAN_COMMENT;
+					} else if ( c == '"' ) {
+						frameNumber = false;
+						state = SCAN_STRING;
+					} else if ( c > 0177 ) {
+						// Binary encoded rib
+						clear();
+						return false;
+					} else if ( !isTokenDelimiter(c) ) {
+						token.clear();
+						token.push_back(c);
+						tokenStart = pos;
+						tokenLine = line;
+						state = SCAN_TOKEN;
+					} else if ( c == '[' || c == ']' ) {
+						frameNumber = false;
+					}
+					break;
+				case SCAN_COMMENT:
+					if ( c == '\n' || c == '\r' )
+						state = SCAN_SPACE;
+					break;
+				case SCAN_STRING:
+					if ( c == '\\' )
+						state = SCAN_ESCAPE;
+					else if ( c == '"' )
+						state = SCAN_SPACE;
+					break;
+				case SCAN_ESCAPE:
+					state = SCAN_STRING;
+					break;
+			}
+			
+			// Count lines like CRibParser::getchar()
+			if ( c == '\n' ) {
+				if ( last != '\r' )
+					++line;
+			} else if ( c == '\r' ) {
+				if ( last != '\n' )
+					++line;
+			}
+			last = c;
+			++pos;
+		}
+	}
+
+	if ( state == SCAN_TOKEN )
+		scannedToken(m_frames, token, tokenStart, tokenLine, pos, line, archiveDepth, inFrame, frameNumber);
+	if ( inFrame ) {
+		m_frames.back().m_end = pos;
+		m_frames.back().m_endLine = line;
+	}
+	m_length = pos;
+	m_lastLine = line;
+	m_prologueEnd = m_frames.empty() ? m_length : m_frames.front().m_begin;
+	return true;
+}
+
+// Appends a part to parse, merges adjacent parts
+static void addRange(std::vector<CRibFrameIndex::SRange> &ranges, std::streamoff begin, std::streamoff end, long line)
+{
+	if ( begin >= end )
+		return;
+	if ( !ranges.empty() && ranges.back().m_end == begin ) {
+		ranges.back().m_end = end;
+		return;
+	}
+	CRibFrameIndex::SRange r;
+	r.m_begin = begin;
+	r.m_end = end;
+	r.m_line = line;
+	ranges.push_back(r);
+}
+
+void CRibFrameIndex::ranges(const CRibFrameSelection &selection, std::vector<SRange> &ranges) const
+{
+	ranges.clear();
+	
+	unsigned long wanted = selection.wantedFrames();
+	std::set<RtInt> found;
+	std::streamoff pos = 0;
+	long line = 1;
+	
+	std::vector<SFrame>::const_iterator i;
+	for ( i = m_frames.begin(); i != m_frames.end(); ++i ) {
+		addRange(ranges, pos, (*i).m_begin, line);
+		if ( selection.selected((*i).m_number) ) {
+			addRange(ranges, (*i).m_begin, (*i).m_end, (*i).m_beginLine);
+			found.insert((*i).m_number);
+		}
+		pos = (*i).m_end;
+		line = (*i).m_endLine;
+		if ( wanted && found.size() >= wanted ) {
+			// All frames of the list found
+			return;
+		}
+	}
+	addRange(ranges, pos, m_length, line);
+}
+
+bool CRibFrameIndex::fileStat(const std::string &filename, std::streamoff &size, long &mtime)
+{
+	struct stat st;
+	if ( stat(filename.c_str(), &st) != 0 )
+		return false;
+	size = (std::streamoff)st.st_size;
+	mtime = (long)st.st_mtime;
+	return true;
+}
+
+std::string CRibFrameIndex::indexFilename(const std::string &filename)
+{
+	return filename + ".ribidx";
+}
+
+bool CRibFrameIndex::load(const std::string &filename)
+{
+	clear();
+
+	std::streamoff size = 0, storedSize = 0;
+	long mtime = 0, storedMtime = 0;
+	if ( !fileStat(filename, size, mtime) )
+		return false;
+
+	std::ifstream in(indexFilename(filename).c_str(), std::ios_base::in | std::ios_base::binary);
+	if ( !in )
+		return false;
+	
+	std::string tag;
+	int version = 0;
+	unsigned long n = 0;
+	in >> tag >> version >> storedSize >> storedMtime;
+	if ( in.fail() || tag != "ribframeindex" || version != 1 || storedSize != size || storedMtime != mtime )
+		return false;
+	
+	in >> m_length >> m_prologueEnd >> m_lastLine >> n;
+	std::streamoff pos = 0;
+	for ( unsigned long i = 0; !in.fail() && i < n; ++i ) {
+		SFrame frame;
+		in >> frame.m_number >> frame.m_begin >> frame.m_beginLine >> frame.m_end >> frame.m_endLine;
+		if ( frame.m_begin < pos || frame.m_end < frame.m_begin || frame.m_end > m_length ) {
+			clear();
+			return false;
+		}
+		pos = frame.m_end;
+		m_frames.push_back(frame);
+	}
+	
+	if ( in.fail() || !m_inflateIndex.read(in) ) {
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool CRibFrameIndex::save(const std::string &filename) const
+{
+	std::streamoff size = 0;
+	long mtime = 0;
+	if ( !fileStat(filename, size, mtime) )
+		return false;
+
+	std::ofstream out(indexFilename(filename).c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+	if ( !out )
+		return false;
+	
+	out << "ribframeindex 1 " << size << " " << mtime << "\n";
+	out << m_length << " " << m_prologueEnd << " " << m_lastLine << " " << m_frames.size() << "\n";
+	std::vector<SFrame>::const_iterator i;
+	for ( i = m_frames.begin(); i != m_frames.end(); ++i ) {
+		out << (*i).m_number << " " << (*i).m_begin << " " << (*i).m_beginLine << " " << (*i).m_end << " " << (*i).m_endLine << "\n";
+	}
+	if ( !m_inflateIndex.write(out) )
+		return false;
+	out.close();
+	return !out.fail();
+}
@@ -0,0 +1,1054 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file riblexer.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Implementation of the parallel and asynchronous lexers for ASCII rib
+ */
+
+#include "ricpp/ribparser/riblexer.h"
+
+#ifndef _RICPP_TOOLS_TRACER_H
+#include "ricpp/tools/tracer.h"
+#endif // _RICPP_TOOLS_TRACER_H
+
+using namespace RiCPP;
+
+const unsigned long CRibParallelLexer::DEFAULT_CHUNK_SIZE = 1<<18;
+const unsigned long CRibParallelLexer::MIN_PARALLEL_CHUNKS = 4;
+
+// ----------------------------------------------------------------------------
+// Tests, if c can start a request identifier
+static inline bool isIdentifierChar(unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// ----------------------------------------------------------------------------
+CRibChunkLexer::CRibChunkLexer()
+{
+	m_begin = 0;
+	m_pos = 0;
+	m_end = 0;
+	m_isLast = true;
+	m_eof = true;
+	m_valid = false;
+	m_lineNo = 0;
+	m_lastChar = 0;
+	m_hasPutBack = false;
+	m_putBack = 0;
+	m_braketDepth = 0;
+	m_tokenOffset = 0;
+	m_tokens = 0;
+}
+
+// Same line counting as CRibParser::getchar()
+bool CRibChunkLexer::getchar(unsigned char &c)
+{
+	if ( m_hasPutBack ) {
+		c = m_putBack;
+		m_hasPutBack = false;
+		if ( c == '\n' )
+			++m_lineNo;
+		return true;
+	}
+	if ( m_pos >= m_end ) {
+		m_eof = true;
+		return false;
+	}
+
+	unsigned char val = (unsigned char)*m_pos++;
+	unsigned char last = m_lastChar;
+	m_lastChar = val;
+
+	if ( val == '\n' ) {
+		if ( last != '\r' )
+			++m_lineNo;
+	} else if ( val == '\r' ) {
+		if ( last != '\n' )
+			++m_lineNo;
+		val = '\n';
+	}
+
+	c = val;
+	return true;
+}
+
+void CRibChunkLexer::putback(unsigned char c)
+{
+	m_hasPutBack = true;
+	if ( c == '\n' )
+		--m_lineNo;
+	m_putBack = c;
+}
+
+void CRibChunkLexer::message(RtInt code, RtInt severity, const char *text, char c)
+{
+	CRibLexedMessage msg;
+	m_requests.back().m_messages.push_back(msg);
+	CRibLexedMessage &m = m_requests.back().m_messages.back();
+	m.m_code = code;
+	m.m_severity = severity;
+	m.m_lineNo = m_lineNo;
+	m.m_text = text;
+	if ( c ) {
+		// Text contains one '%c'
+		std::string::size_type pos = m.m_text.find("%c");
+		if ( pos != std::string::npos )
+			m.m_text.replace(pos, 2, 1, c);
+	}
+}
+
+void CRibChunkLexer::handleComment(bool isStructured)
+{
+	m_token.push_back((char)0);
+	CRibLexedComment cc;
+	m_requests.back().m_comments.push_back(cc);
+	CRibLexedComment &c = m_requests.back().m_comments.back();
+	c.m_comment = m_token;
+	c.m_isStructured = isStructured;
+	c.m_lineNo = m_lineNo;
+}
+
+void CRibChunkLexer::handleString()
+{
+	m_token.push_back((char)0);
+	std::vector<CRibParameter> &params = m_requests.back().m_parameters;
+	if ( m_braketDepth ) {
+		if ( !params.back().setString(&m_token[0], m_tokens) ) {
+			message(RIE_CONSISTENCY, RIE_ERROR, ", badarray: Mixed types in array");
+		}
+	} else {
+		// RIB string variables are substituted by CRibParser
+		params.resize(params.size()+1);
+		params.back().lineNo(m_lineNo);
+		params.back().setString(&m_token[0], m_tokens);
+	}
+}
+
+void CRibChunkLexer::handleNumber(bool isInteger)
+{
+	m_token.push_back((char)0);
+	std::vector<CRibParameter> &params = m_requests.back().m_parameters;
+	if ( !m_braketDepth ) {
+		// Single value
+		params.resize(params.size()+1);
+		params.back().lineNo(m_lineNo);
+	}
+	bool set;
+	if ( isInteger ) {
+		set = params.back().setInt((RtInt)::atol(&m_token[0]));
+	} else {
+		set = params.back().setFloat((RtFloat)::atof(&m_token[0]));
+	}
+	if ( !set ) {
+		// This happens if an array contains number and string values
+		message(RIE_CONSISTENCY, RIE_ERROR, ", badarray: Mixed types in array");
+	}
+}
+
+void CRibChunkLexer::handleArrayStart()
+{
+	std::vector<CRibParameter> &params = m_requests.back().m_parameters;
+	params.resize(params.size()+1);
+	params.back().lineNo(m_lineNo);
+	params.back().startArray();
+	++m_braketDepth;
+}
+
+void CRibChunkLexer::handleArrayEnd()
+{
+	--m_braketDepth;
+	if ( m_braketDepth < 0 ) {
+		m_braketDepth = 0;
+		message(RIE_CONSISTENCY, RIE_ERROR, ", badarray: Too many closing brakets");
+	}
+}
+
+void CRibChunkLexer::finishRequest()
+{
+	if ( m_requests.size() < 2 ) {
+		// Leading parameters and comments
+		return;
+	}
+
+	m_requests.back().m_lineNo = m_lineNo;
+	if ( m_braketDepth > 0 ) {
+		m_braketDepth = 0;
+		message(RIE_CONSISTENCY, RIE_ERROR, ", badarray: Missing closing brakets");
+	}
+	if ( m_braketDepth < 0 ) {
+		m_braketDepth = 0;
+		message(RIE_CONSISTENCY, RIE_ERROR, ", badarray: Too many closing brakets");
+	}
+}
+
+void CRibChunkLexer::handleRequest()
+{
+	finishRequest();
+	m_braketDepth = 0;
+
+	CRibLexedRequest req;
+	m_requests.push_back(req);
+	m_requests.back().m_request = &m_token[0];
+	m_requests.back().m_offset = m_tokenOffset;
+}
+
+// Mirrors CRibParser::nextToken() without the binary decoder
+bool CRibChunkLexer::nextToken()
+{
+	int state = 0;
+	unsigned char c = 0;
+	bool loop = false;
+	char tmp = 0;
+
+	m_token.clear();
+	loop = !m_eof;
+
+	while ( loop ) {
+		if ( m_eof || !getchar(c) ) {
+			// EOF: finish last request
+			c = '\n';
+			loop = false;
+			if ( !m_isLast && state != 0 ) {
+				// The token continues in the next chunk
+				m_valid = false;
+				return false;
+			}
+		} else if ( c == '\r' ) {
+			continue;
+		}
+
+		if ( c == '#' && state >= 1 && state <= 5 ) {
+			// 'inline' comment
+			std::string tempToken;
+			bool startToken = true;
+			bool isStructured = false;
+			while ( !m_eof ) {
+				if ( getchar(c) ) {
+					if ( startToken ) {
+						isStructured = (c == '#');
+						startToken = false;
+						continue;
+					}
+					if ( c == '\r' )
+						continue;
+					if ( c == '\n' ) {
+						// end of comment
+						tempToken.swap(m_token);
+						handleComment(isStructured);
+						tempToken.swap(m_token);
+						break;
+					}
+					tempToken.push_back(c);
+				}
+			}
+			if ( m_eof ) {
+				if ( !m_isLast ) {
+					m_valid = false;
+					return false;
+				}
+				c = '\n';
+				loop = false;
+			}
+		}
+
+		switch ( state ) {
+		case 0:
+			if ( isspace(c) )
+				continue;
+			if ( c > 127 ) {
+				// Binary encoded rib, cannot be split
+				m_valid = false;
+				m_eof = true;
+				return false;
+			}
+			if ( c == '#' ) {
+				state = 6;
+				continue;
+			}
+			if ( c == '\"' ) {
+				state = 8;
+				continue;
+			}
+			if ( c == '[' ) {
+				handleArrayStart();
+				return true;
+			}
+			if ( c == ']' ) {
+				handleArrayEnd();
+				return true;
+			}
+			if ( c == '-' || c == '+' || (c >= '0' && c <= '9') ) {
+				state = 2;
+				m_token.push_back(c);
+				continue;
+			}
+			if ( c == '.' ) {
+				state = 3;
+				m_token.push_back(c);
+				continue;
+			}
+			if ( isIdentifierChar(c) ) {
+				state = 1;
+				// c is the character read last (also if put back)
+				m_tokenOffset = (unsigned long)(m_pos - m_begin) - 1;
+				m_token.push_back(c);
+				continue;
+			}
+			message(RIE_SYNTAX, RIE_WARNING, ": Invalid character found '%c', treated as whitespace", c);
+			break;
+		case 1: // Identifier
+			if ( isIdentifierChar(c) ) {
+				m_token.push_back(c);
+				continue;
+			}
+			putback(c);
+			m_token.push_back(0);
+			handleRequest();
+			return true;
+		case 2: // Number (left of a decimal point)
+			if ( c >= '0' && c <= '9' ) {
+				m_token.push_back(c);
+				continue;
+			}
+			if ( c == '.' ) {
+				state = 3;
+				m_token.push_back(c);
+				continue;
+			}
+			if ( c == 'E' || c == 'e' ) {
+				state = 4;
+				m_token.push_back(c);
+				continue;
+			}
+			putback(c);
+			handleNumber(true);
+			return true;
+		case 3: // Number (right of a decimal point)
+			if ( c >= '0' && c <= '9' ) {
+				m_token.push_back(c);
+				continue;
+			}
+			if ( c == 'E' || c == 'e' ) {
+				state = 4;
+				m_token.push_back(c);
+				continue;
+			}
+			putback(c);
+			handleNumber(false);
+			return true;
+		case 4: // Number (exponent)
+			if ( c == '+' || c == '-' || (c >= '0' && c <= '9') ) {
+				state = 5;
+				m_token.push_back(c);
+				continue;
+			}
+			putback(c);
+			handleNumber(false);
+			return true;
+		case 5: // Number (exponent)
+			if ( c >= '0' && c <= '9' ) {
+				m_token.push_back(c);
+				continue;
+			}
+			putback(c);
+			handleNumber(false);
+			return true;
+		case 6: // comment after first '#'
+			if ( c == '#' ) {
+				state = 7;
+				continue;
+			}
+			if ( c == '\n' ) {
+				handleComment(false);
+				return true;
+			}
+			m_token.push_back(c);
+			state = 10;
+			break;
+		case 7: // structured comment
+			if ( c == '\n' ) {
+				handleComment(true);
+				return true;
+			}
+			m_token.push_back(c);
+			break;
+		case 8: // string
+			if ( c == '\\' ) {
+				state = 9;
+				continue;
+			}
+			if ( c == '\r' || c == '\n' || c == '"' ) {
+				// End of string (error if \n)
+				handleString();
+				return true;
+			}
+			m_token.push_back(c);
+			break;
+		case 9: // string ( \. )
+			state = 8;
+			switch ( c ) {
+			case '\n':
+				break;
+			case 'n':
+				m_token.push_back('\n');
+				break;
+			case 'r':
+				m_token.push_back('\r');
+				break;
+			case 't':
+				m_token.push_back('\t');
+				break;
+			case 'b':
+				m_token.push_back('\b');
+				break;
+			case 'f':
+				m_token.push_back('\f');
+				break;
+			default:
+				if ( c >= '0' && c <= '7' ) {
+					tmp = c-'0';
+					state = 11;
+				} else {
+					m_token.push_back(c);
+				}
+				break;
+			}
+			break;
+		case 10: // comment
+			if ( c == '\n' ) {
+				handleComment(false);
+				return true;
+			}
+			m_token.push_back(c);
+			break;
+		case 11: // Octal 2 in string
+			if ( c >= '0' && c <= '7' ) {
+				tmp <<= 4;
+				tmp |= c-'0';
+				state = 12;
+				continue;
+			}
+			putback(c);
+			m_token.push_back(tmp);
+			state = 8;
+			break;
+		case 12: // Octal 3 in string
+			if ( c >= '0' && c <= '7' ) {
+				tmp <<= 4;
+				tmp |= c-'0';
+			} else {
+				putback(c);
+			}
+			m_token.push_back(tmp);
+			state = 8;
+			break;
+		default: // This is never reached
+			m_valid = false;
+			m_eof = true;
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool CRibChunkLexer::lex(const char *begin, const char *end, bool isLast, CTokenMap *tokens)
+{
+	CTraceScope trace("lex");
+
+	m_begin = begin;
+	m_pos = begin;
+	m_end = end;
+	m_isLast = isLast;
+	m_eof = false;
+	m_valid = true;
+	m_lineNo = 0;
+	m_lastChar = 0;
+	m_hasPutBack = false;
+	m_putBack = 0;
+	m_braketDepth = 0;
+	m_token.clear();
+	m_tokenOffset = 0;
+	m_tokens = tokens;
+
+	m_requests.clear();
+	m_requests.push_back(CRibLexedRequest());
+
+	while ( nextToken() );
+
+	if ( m_valid )
+		finishRequest();
+	else
+		m_requests.clear();
+
+	return m_valid;
+}
+
+// ----------------------------------------------------------------------------
+CRibLexerThreads::CRibLexerThreads()
+{
+	m_idle = 0;
+	m_stop = false;
+}
+
+CRibLexerThreads::~CRibLexerThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_cond.notify_all();
+	}
+	for ( std::vector<std::thread>::iterator i = m_threads.begin(); i != m_threads.end(); ++i ) {
+		(*i).join();
+	}
+}
+
+CRibLexerThreads &CRibLexerThreads::instance()
+{
+	static CRibLexerThreads threads;
+	return threads;
+}
+
+void CRibLexerThreads::work()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while ( !m_stop ) {
+		if ( m_tasks.empty() ) {
+			++m_idle;
+			m_cond.wait(lock);
+			--m_idle;
+			continue;
+		}
+
+		std::function<void()> task;
+		task.swap(m_tasks.front());
+		m_tasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+bool CRibLexerThreads::run(const std::function<void()> &task)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ( m_idle <= m_tasks.size() ) {
+		// All threads are busy
+		try {
+			m_threads.push_back(std::thread(&CRibLexerThreads::work, this));
+		} catch ( std::exception & ) {
+			if ( m_idle <= m_tasks.size() )
+				return false;
+		}
+	}
+	m_tasks.push_back(task);
+	m_cond.notify_one();
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+CRibParallelLexer::CRibParallelLexer()
+{
+	m_data = 0;
+	m_size = 0;
+	m_nextChunk = 0;
+	m_released = 0;
+	m_window = 0;
+	m_current = 0;
+	m_tokens = 0;
+	m_stop = false;
+	m_workers = 0;
+	m_running = 0;
+}
+
+CRibParallelLexer::~CRibParallelLexer()
+{
+	stop();
+}
+
+void CRibParallelLexer::findChunks(
+	const char *data, unsigned long size,
+	unsigned long minChunkSize,
+	std::vector<unsigned long> &starts)
+{
+	starts.clear();
+	starts.push_back(0);
+
+	if ( minChunkSize < 1 )
+		minChunkSize = 1;
+
+	// Boundaries after minChunkSize bytes, at the start of a line beginning with a letter
+	unsigned long p = minChunkSize;
+	while ( p < size ) {
+		for ( ; p < size; ++p ) {
+			if ( (data[p-1] == '\n' || data[p-1] == '\r') && isIdentifierChar(data[p]) )
+				break;
+		}
+		if ( p >= size )
+			break;
+		starts.push_back(p);
+		p += minChunkSize;
+	}
+}
+
+void CRibParallelLexer::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while ( !m_stop && m_nextChunk < m_starts.size() ) {
+		if ( m_nextChunk >= m_released + m_window ) {
+			// Wait for the parser to catch up
+			m_cond.wait(lock);
+			continue;
+		}
+
+		unsigned long i = m_nextChunk++;
+		bool isLast = i+1 >= m_starts.size();
+		const char *begin = m_data + m_starts[i];
+		const char *end = m_data + (isLast ? m_size : m_starts[i+1]);
+
+		lock.unlock();
+		bool valid = m_chunks[i].lex(begin, end, isLast, m_tokens);
+		lock.lock();
+
+		m_lexed[i] = true;
+		if ( !valid ) {
+			// The following chunks are not needed, the parser continues sequentially
+			m_nextChunk = (unsigned long)m_starts.size();
+		}
+		m_cond.notify_all();
+	}
+
+	// Last access of the lexer, stop() may return and the lexer can be deleted afterwards
+	--m_running;
+	m_cond.notify_all();
+}
+
+void CRibParallelLexer::start(char *data, unsigned long size, unsigned int nThreads, unsigned long minChunkSize, CTokenMap *tokens)
+{
+	stop();
+
+	m_data = data;
+	m_tokens = tokens;
+	m_size = data ? size : 0;
+	if ( nThreads < 1 )
+		nThreads = 1;
+
+	findChunks(m_data, m_size, minChunkSize, m_starts);
+	m_chunks.resize(m_starts.size());
+	m_lexed.assign(m_starts.size(), false);
+	m_nextChunk = 0;
+	m_released = 0;
+	m_window = 2*nThreads;
+	m_current = 0;
+	m_stop = false;
+
+	CRibLexerThreads &threads = CRibLexerThreads::instance();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for ( unsigned int i = 0; i < nThreads && i < m_chunks.size(); ++i ) {
+		if ( !threads.run(std::bind(&CRibParallelLexer::run, this)) ) {
+			// No more threads, lex with the workers already started
+			break;
+		}
+		++m_workers;
+		++m_running;
+	}
+}
+
+void CRibParallelLexer::stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_cond.notify_all();
+		while ( m_running > 0 ) {
+			m_cond.wait(lock);
+		}
+	}
+	m_workers = 0;
+	m_chunks.clear();
+	m_lexed.clear();
+	m_current = 0;
+}
+
+CRibChunkLexer &CRibParallelLexer::chunk(unsigned long idx)
+{
+	assert(idx < m_chunks.size());
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if ( m_workers == 0 && !m_lexed[idx] ) {
+		// No thread could be used, lex in place
+		lock.unlock();
+		bool isLast = idx+1 >= m_starts.size();
+		m_chunks[idx].lex(m_data + m_starts[idx], m_data + (isLast ? m_size : m_starts[idx+1]), isLast, m_tokens);
+		lock.lock();
+		m_lexed[idx] = true;
+	}
+	while ( !m_lexed[idx] ) {
+		m_cond.wait(lock);
+	}
+	return m_chunks[idx];
+}
+
+void CRibParallelLexer::release(unsigned long idx)
+{
+	assert(idx < m_chunks.size());
+
+	std::vector<CRibLexedRequest> empty;
+	m_chunks[idx].requests().swap(empty);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ( idx+1 > m_released )
+		m_released = idx+1;
+	m_cond.notify_all();
+}
+
+CRibChunkLexer *CRibParallelLexer::nextChunk()
+{
+	if ( m_current > 0 && m_current <= m_chunks.size() )
+		release(m_current-1);
+	if ( m_current >= m_chunks.size() )
+		return 0;
+	return &chunk(m_current++);
+}
+
+unsigned long CRibParallelLexer::chunkStart() const
+{
+	if ( m_current > 0 && m_current <= m_starts.size() )
+		return m_starts[m_current-1];
+	return 0;
+}
+
+std::streambuf *CRibParallelLexer::rest()
+{
+	unsigned long offs = m_size;
+	if ( m_current > 0 && m_current <= m_starts.size() )
+		offs = m_starts[m_current-1];
+	m_restBuf.assign(m_data + offs, m_size - offs);
+	return &m_restBuf;
+}
+
+
+// ----------------------------------------------------------------------------
+bool CRibFrameSplitter::split(char *data, unsigned long size, unsigned int nThreads, std::vector<unsigned long> &bounds, std::vector<SSegmentHandles> *handles)
+{
+	bounds.clear();
+	bounds.push_back(0);
+	std::vector<SSegmentHandles> segmentHandles(1);
+
+	CRibParallelLexer lexer;
+	lexer.start(data, size, nThreads);
+
+	bool inFrame = false;
+	bool frameEnded = false;
+	bool globalEnds = false;
+	int archiveDepth = 0;
+
+	CRibChunkLexer *chunk;
+	while ( (chunk = lexer.nextChunk()) != 0 ) {
+		if ( !chunk->valid() ) {
+			lexer.stop();
+			bounds.resize(1);
+			bounds.push_back(size);
+			if ( handles )
+				handles->assign(1, SSegmentHandles());
+			return false;
+		}
+		unsigned long start = lexer.chunkStart();
+		std::vector<CRibLexedRequest>::const_iterator i;
+		for ( i = chunk->requests().begin(); i != chunk->requests().end(); ++i ) {
+			const std::string &req = (*i).m_request;
+			if ( req.empty() )
+				continue;
+			if ( globalEnds ) {
+				// A global request ends in front of the next request
+				segmentHandles.back().m_globals.push_back(start + (*i).m_offset);
+				globalEnds = false;
+			}
+			if ( frameEnded ) {
+				// The segment outside of the frames starts at the request following FrameEnd
+				bounds.push_back(start + (*i).m_offset);
+				segmentHandles.push_back(SSegmentHandles());
+				frameEnded = false;
+			}
+			if ( req == "ArchiveBegin" ) {
+				++archiveDepth;
+			} else if ( req == "ArchiveEnd" ) {
+				if ( archiveDepth > 0 )
+					--archiveDepth;
+			} else if ( archiveDepth == 0 ) {
+				if ( req == "FrameBegin" && !inFrame ) {
+					bounds.push_back(start + (*i).m_offset);
+					segmentHandles.push_back(SSegmentHandles());
+					inFrame = true;
+				} else if ( req == "FrameEnd" && inFrame ) {
+					inFrame = false;
+					frameEnded = true;
+				} else if ( req == "LightSource" || req == "AreaLightSource" ) {
+					++segmentHandles.back().m_lights;
+				} else if ( req == "ObjectBegin" ) {
+					++segmentHandles.back().m_objects;
+				} else if ( req == "ReadArchive" || req == "DelayedReadArchive" || req == "Procedural" || req == "IfBegin" ) {
+					segmentHandles.back().m_exact = false;
+				} else if ( inFrame && req == "Declare" ) {
+					segmentHandles.back().m_globals.push_back(start + (*i).m_offset);
+					globalEnds = true;
+				}
+			}
+		}
+	}
+	lexer.stop();
+
+	if ( globalEnds )
+		segmentHandles.back().m_globals.push_back(size);
+	bounds.push_back(size);
+	if ( (bounds.size() % 2) != 0 ) {
+		// Frame block not closed or FrameEnd at the end, append an empty segment
+		bounds.push_back(size);
+		segmentHandles.push_back(SSegmentHandles());
+	}
+	if ( handles )
+		handles->swap(segmentHandles);
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+CRibPrefixStreambuf::int_type CRibPrefixStreambuf::underflow()
+{
+	if ( gptr() < egptr() )
+		return traits_type::to_int_type(*gptr());
+
+	if ( !m_prefix.empty() ) {
+		std::vector<char> empty;
+		m_prefix.swap(empty);
+	}
+
+	if ( !m_next )
+		return traits_type::eof();
+
+	m_buffer.resize(CRibAsyncLexer::BLOCK_SIZE);
+	std::streamsize n = m_next->sgetn(&m_buffer[0], (std::streamsize)m_buffer.size());
+	if ( n <= 0 ) {
+		setg(0, 0, 0);
+		return traits_type::eof();
+	}
+
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0]+n);
+	return traits_type::to_int_type(*gptr());
+}
+
+void CRibPrefixStreambuf::assign(std::vector<char> &prefix, std::streambuf *next)
+{
+	m_prefix.clear();
+	m_prefix.swap(prefix);
+	m_next = next;
+	if ( m_prefix.empty() )
+		setg(0, 0, 0);
+	else
+		setg(&m_prefix[0], &m_prefix[0], &m_prefix[0]+m_prefix.size());
+}
+
+
+// ----------------------------------------------------------------------------
+const unsigned long CRibAsyncLexer::BLOCK_SIZE = 1<<16;
+const unsigned long CRibAsyncLexer::MAX_CHUNK_SIZE = 1<<20;
+
+CRibAsyncLexer::CRibAsyncLexer()
+{
+	m_in = 0;
+	m_maxQueued = 1;
+	m_current = 0;
+	m_tokens = 0;
+	m_done = true;
+	m_stop = false;
+	m_hasError = false;
+}
+
+CRibAsyncLexer::~CRibAsyncLexer()
+{
+	stop();
+}
+
+void CRibAsyncLexer::run()
+{
+	std::vector<char> buf;
+	bool eof = false;
+
+	try {
+		while ( !eof ) {
+			// Read the next block
+			std::streamsize old = (std::streamsize)buf.size();
+			buf.resize(old + BLOCK_SIZE);
+			std::streamsize n = m_in->sgetn(&buf[old], BLOCK_SIZE);
+			if ( n < 0 )
+				n = 0;
+			buf.resize(old + n);
+			eof = n < (std::streamsize)BLOCK_SIZE;
+
+			// Lex up to the last line starting with a letter, the remainder is lexed with the next block
+			unsigned long split = (unsigned long)buf.size();
+			bool valid = true;
+			if ( !eof ) {
+				for ( --split; split > 0; --split ) {
+					if ( (buf[split-1] == '\n' || buf[split-1] == '\r') && isIdentifierChar(buf[split]) )
+						break;
+				}
+				if ( split == 0 ) {
+					if ( buf.size() < MAX_CHUNK_SIZE )
+						continue;
+					// Probably binary encoded
+					valid = false;
+				}
+			} else if ( split == 0 ) {
+				break;
+			}
+
+			CRibChunkLexer *chunk = new CRibChunkLexer;
+			if ( valid )
+				valid = chunk->lex(&buf[0], &buf[0]+split, eof, m_tokens);
+			else
+				chunk->invalidate();
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while ( !m_stop && m_queue.size() >= m_maxQueued ) {
+				// Wait for the parser to catch up
+				m_cond.wait(lock);
+			}
+			if ( m_stop ) {
+				delete chunk;
+				break;
+			}
+			if ( !valid ) {
+				// The parser continues sequentially, starting at this chunk
+				m_rest.swap(buf);
+				m_queue.push_back(chunk);
+				break;
+			}
+			m_queue.push_back(chunk);
+			m_cond.notify_all();
+			lock.unlock();
+
+			buf.erase(buf.begin(), buf.begin()+split);
+		}
+	} catch ( ExceptRiCPPError &err ) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_error = err;
+		m_hasError = true;
+	} catch ( std::exception &err ) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_error.set(RIE_SYSTEM, RIE_SEVERE, err.what(), __LINE__, __FILE__);
+		m_hasError = true;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_done = true;
+	m_cond.notify_all();
+}
+
+void CRibAsyncLexer::join()
+{
+	if ( m_thread.joinable() )
+		m_thread.join();
+}
+
+void CRibAsyncLexer::start(std::streambuf *in, unsigned long maxQueued, CTokenMap *tokens)
+{
+	stop();
+
+	m_in = in;
+	m_tokens = tokens;
+	m_maxQueued = maxQueued > 0 ? maxQueued : 1;
+	m_rest.clear();
+	m_stop = false;
+	m_hasError = false;
+	m_done = in == 0;
+
+	if ( !in )
+		return;
+
+	try {
+		m_thread = std::thread(&CRibAsyncLexer::run, this);
+	} catch ( std::exception &err ) {
+		m_done = true;
+		m_hasError = true;
+		m_error.set(RIE_SYSTEM, RIE_SEVERE, err.what(), __LINE__, __FILE__);
+	}
+}
+
+CRibChunkLexer *CRibAsyncLexer::nextChunk()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if ( m_current ) {
+		delete m_current;
+		m_current = 0;
+	}
+
+	while ( m_queue.empty() && !m_done ) {
+		m_cond.wait(lock);
+	}
+
+	if ( !m_queue.empty() ) {
+		m_current = m_queue.front();
+		m_queue.pop_front();
+		m_cond.notify_all();
+		return m_current;
+	}
+
+	if ( m_hasError ) {
+		m_hasError = false;
+		throw m_error;
+	}
+
+	return 0;
+}
+
+std::streambuf *CRibAsyncLexer::rest()
+{
+	join();
+	m_restBuf.assign(m_rest, m_in);
+	return &m_restBuf;
+}
+
+void CRibAsyncLexer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_cond.notify_all();
+	}
+	join();
+
+	if ( m_current ) {
+		delete m_current;
+		m_current = 0;
+	}
+	for ( std::deque<CRibChunkLexer *>::iterator i = m_queue.begin(); i != m_queue.end(); ++i ) {
+		delete (*i);
+	}
+	m_queue.clear();
+}
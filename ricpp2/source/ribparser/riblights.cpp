@@ -62,6 +62,9 @@ void CLightSourceRibRequest::operator()(IRibParserState &parser, CRibRequestData
 				request.removePair(2, RI_HANDLEID);
 				request.push_back(tok);
 				request.push_back(val);
+				// The parameters may have been reallocated
+				request[0].getString(name);
+				request[1].getString(lightname);
 			}			
 		} else {
 			lightname = valToStr(lightnamebuf, sizeof(lightnamebuf), number);
@@ -162,6 +165,9 @@ void CAreaLightSourceRibRequest::operator()(IRibParserState &parser, CRibRequest
 				request.removePair(2, RI_HANDLEID);
 				request.push_back(tok);
 				request.push_back(val);
+				// The parameters may have been reallocated
+				request[0].getString(name);
+				request[1].getString(lightname);
 			}			
 		} else {
 			lightname = valToStr(lightnamebuf, sizeof(lightnamebuf), number);
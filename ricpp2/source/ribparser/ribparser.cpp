@@ -50,6 +50,9 @@
 #ifndef _RICPP_RIBPARSER_RIBEXTERNALS_H
 #include "ricpp/ribparser/ribexternals.h"
 #endif // _RICPP_RIBPARSER_RIBEXTERNALS_H
+#ifndef _RICPP_RIBPARSER_RIBLEXER_H
+#include "ricpp/ribparser/riblexer.h"
+#endif // _RICPP_RIBPARSER_RIBLEXER_H
 #ifndef _RICPP_RICPP_PARAMCLASSES_H
 #include "ricpp/ricpp/paramclasses.h"
 #endif // _RICPP_RICPP_PARAMCLASSES_H
@@ -59,6 +62,9 @@
 #ifndef _RICPP_TOOLS_FILEPATH_H
 #include "ricpp/tools/filepath.h"
 #endif // _RICPP_TOOLS_FILEPATH_H
+#ifndef _RICPP_TOOLS_BYTEORDER_H
+#include "ricpp/tools/byteorder.h"
+#endif // _RICPP_TOOLS_BYTEORDER_H
 using namespace RiCPP;
 // -----------------------------------------------------------------------------
 // Various status codes, sequence number is important
@@ -71,36 +77,59 @@ const int CRibParser::RIBPARSER_ARRAY_END = 6;
 const int CRibParser::RIBPARSER_NUMBER = 7;
 const int CRibParser::RIBPARSER_NOT_A_TOKEN = 0;
 const int CRibParser::RIBPARSER_EOF = -1;
-std::map<std::string, CRibRequest *> CRibParser::s_requestMap;
 // ----------------------------------------------------------------------------
+const std::vector<RtFloat> CRibParameter::ms_noFloats;
+const std::vector<RtInt> CRibParameter::ms_noInts;
 CRibParameter::CRibParameter()
 {
 	m_lineNo = 1;
 	m_isArray = false;
 	m_typeID = BASICTYPE_UNKNOWN;
-	m_cstrVector = 0;
 }
 CRibParameter::~CRibParameter()
 {
 	freeValue();
-	if ( m_cstrVector ) {
-		delete m_cstrVector;
-	}
-	m_cstrVector = 0;
 }
 CRibParameter::CRibParameter(const CRibParameter &p)
 {
 	m_lineNo = 1;
-	m_cstrVector = 0;
 	m_isArray = false;
 	m_typeID = BASICTYPE_UNKNOWN;
 	*this = p;
 }
 void CRibParameter::freeValue()
 {
-	m_vInt.clear();
-	m_vFloat.clear();
+	m_vInt.reset();
+	m_vFloat.reset();
 	m_vString.clear();
+	m_ownedStrings.reset();
+}
+RtToken CRibParameter::storeString(const char *v, CTokenMap *tokens)
+{
+	v = noNullStr(v);
+	if ( tokens ) {
+		RtToken token = tokens->findCreate(v);
+		if ( token && strcmp(token, v) == 0 )
+			return token;
+	}
+	if ( !m_ownedStrings ) {
+		m_ownedStrings.reset(new std::deque<std::string>);
+	} else if ( m_ownedStrings.use_count() > 1 ) {
+		// Copy on write, the values of this parameter are moved to the copy
+		std::shared_ptr<std::deque<std::string> > shared(m_ownedStrings);
+		m_ownedStrings.reset(new std::deque<std::string>(*shared));
+		for ( size_t i = 0; i < m_vString.size(); ++i ) {
+			for ( size_t j = 0; j < shared->size(); ++j ) {
+				if ( m_vString[i] == (*shared)[j].c_str() ) {
+					m_vString[i] = (*m_ownedStrings)[j].c_str();
+					break;
+				}
+			}
+		}
+	}
+	// The elements of a deque stay in place while appending
+	m_ownedStrings->push_back(v);
+	return m_ownedStrings->back().c_str();
 }
 CRibParameter &CRibParameter::operator=(const CRibParameter &p)
 {
@@ -108,14 +137,12 @@ CRibParameter &CRibParameter::operator=(const CRibParameter &p)
 		return *this;
 	freeValue();
 	m_lineNo = p.m_lineNo;
-	if ( m_cstrVector )
-		delete m_cstrVector;
-	m_cstrVector = 0;
 	m_typeID = p.m_typeID;
 	m_isArray = p.m_isArray;
 	m_vInt = p.m_vInt;
 	m_vFloat = p.m_vFloat;
 	m_vString = p.m_vString;
+	m_ownedStrings = p.m_ownedStrings;
 	return *this;
 }
 void *CRibParameter::getValue()
@@ -128,26 +155,12 @@ void *CRibParameter::getValue()
 		case BASICTYPE_UNKNOWN:
 			break;
 		case BASICTYPE_INTEGER:
-			return m_vInt.empty() ? 0 : (void *)&m_vInt[0];
+			return ints().empty() ? 0 : (void *)&ints()[0];
 		case BASICTYPE_FLOAT:
-			return m_vFloat.empty() ? 0 : (void *)&m_vFloat[0];
+			return floats().empty() ? 0 : (void *)&floats()[0];
 		case BASICTYPE_STRING:
 			// returns const char **, a pointer to strings
-			// get pointers first
-			if ( !m_cstrVector ) {
-				m_cstrVector = new std::vector<const char *>;
-				if ( !m_cstrVector )
-					return 0;
-			}
-			size_t i;
-			size_t size = m_vString.size();
-			m_cstrVector->clear();
-			m_cstrVector->resize(size);
-			for ( i = 0; i < size; ++i ) {
-				(*m_cstrVector)[i] = m_vString[i].c_str();
-			}
-			// returns char **
-			return m_cstrVector->empty() ? 0 : (void *)&(*m_cstrVector)[0];
+			return m_vString.empty() ? 0 : (void *)&m_vString[0];
 	}
 	return 0;
 }
@@ -159,12 +172,12 @@ void *CRibParameter::getValue(size_t i) const
 		case BASICTYPE_UNKNOWN:
 			break;
 		case BASICTYPE_INTEGER:
-			return (void *)&m_vInt[i];
+			return (void *)&ints()[i];
 		case BASICTYPE_FLOAT:
-			return (void *)&m_vFloat[i];
+			return (void *)&floats()[i];
 		case BASICTYPE_STRING:
 			// ! returns char * not char **
-			return (void *)m_vString[i].c_str();
+			return (void *)m_vString[i];
 	}
 	return 0;
 }
@@ -178,14 +191,21 @@ size_t CRibParameter::getCard() const
 		case BASICTYPE_UNKNOWN:
 			break;
 		case BASICTYPE_INTEGER:
-			return m_vInt.size();
+			return ints().size();
 		case BASICTYPE_FLOAT:
-			return m_vFloat.size();
+			return floats().size();
 		case BASICTYPE_STRING:
 			return m_vString.size();
 	}
 	return 0;
 }
+void CRibParameter::offerValue()
+{
+	if ( m_typeID == BASICTYPE_INTEGER )
+		CParameterValueBlocks::offer(m_vInt);
+	else if ( m_typeID == BASICTYPE_FLOAT )
+		CParameterValueBlocks::offer(m_vFloat);
+}
 bool CRibParameter::convertIntToFloat()
 {
 	if ( m_typeID == BASICTYPE_FLOAT )
@@ -193,12 +213,14 @@ bool CRibParameter::convertIntToFloat()
 	if ( m_typeID != BASICTYPE_INTEGER )
 		return false;
 	size_t i;
-	size_t size = m_vInt.size();
-	m_vFloat.resize(size);
+	const std::vector<RtInt> &intValues = ints();
+	size_t size = intValues.size();
+	std::vector<RtFloat> &floatValues = writeFloats();
+	floatValues.resize(size);
 	for ( i = 0; i < size; ++i ) {
-		m_vFloat[i]=(RtFloat)m_vInt[i];
+		floatValues[i]=(RtFloat)intValues[i];
 	}
-	m_vInt.clear();
+	m_vInt.reset();
 	m_typeID = BASICTYPE_FLOAT;
 	return true;
 }
@@ -208,12 +230,14 @@ bool CRibParameter::convertFloatToInt() {
 	if ( m_typeID != BASICTYPE_FLOAT )
 		return false;
 	size_t i;
-	size_t size = m_vFloat.size();
-	m_vInt.resize(size);
+	const std::vector<RtFloat> &floatValues = floats();
+	size_t size = floatValues.size();
+	std::vector<RtInt> &intValues = writeInts();
+	intValues.resize(size);
 	for ( i = 0; i < size; ++i ) {
-		m_vInt[i]=(RtInt)m_vFloat[i];
+		intValues[i]=(RtInt)floatValues[i];
 	}
-	m_vFloat.clear();
+	m_vFloat.reset();
 	m_typeID = BASICTYPE_INTEGER;
 	return true;
 }
@@ -427,6 +451,7 @@ int CRibRequestData::getTokenList(
 		}
 		if ( useParameter ) {
 			++parameterCount;
+			m_parameters[currParam].offerValue();
 			m_tokenList.push_back(token);
 			m_valueList.push_back(value);
 		}
@@ -498,338 +523,332 @@ unsigned char CRibParser::getchar()
 	
 	return val;
 }
+unsigned char CRibParser::getbyte()
+{
+	if ( m_hasPutBack ) {
+		return getchar();
+	}
+	m_lastChar = 0;
+	return static_cast<unsigned char>(m_istream.get());
+}
+bool CRibParser::getBytes(unsigned char *buf, unsigned long n)
+{
+	if ( !n )
+		return true;
+	if ( m_hasPutBack ) {
+		*buf++ = getbyte();
+		if ( --n == 0 )
+			return true;
+	}
+	m_istream.read(reinterpret_cast<char *>(buf), static_cast<std::streamsize>(n));
+	m_lastChar = 0;
+	return static_cast<unsigned long>(m_istream.gcount()) == n;
+}
+RtToken CRibParser::handleToken(const char *name)
+{
+	// The token map trims the names, these keep no token of their own
+	RtToken token = m_handleNames.findCreate(name);
+	if ( token && strcmp(token, name) != 0 )
+		return RI_NULL;
+	return token;
+}
 bool CRibParser::bindObjectHandle(RtObjectHandle handle, RtInt number)
 {
-	m_mapObjectHandle[number] = handle;
+	m_objectHandles.bind(number, handle);
 	return true;
 }
 bool CRibParser::bindObjectHandle(RtObjectHandle handle, const char *name)
 {
-	m_mapObjectStrHandle[name] = handle;
+	m_objectHandles.bind(handleToken(name), name, handle);
 	return true;
 }
 bool CRibParser::getObjectHandle(RtObjectHandle &handle, RtInt number) const
 {
-	NUM2OBJECT::const_iterator i = m_mapObjectHandle.find(number);
-	if ( i != m_mapObjectHandle.end() ) {
-		handle = (*i).second;
-		return true;
-	}
-	return false;
+	return m_objectHandles.get(handle, number);
 }
 bool CRibParser::getObjectHandle(RtObjectHandle &handle, const char *name) const
 {
-	STR2OBJECT::const_iterator i = m_mapObjectStrHandle.find(name);
-	if ( i != m_mapObjectStrHandle.end() ) {
-		handle = (*i).second;
-		return true;
-	}
-	return false;
+	return m_objectHandles.get(handle, m_handleNames.find(name), name);
 }
 bool CRibParser::bindLightHandle(RtLightHandle handle, RtInt number)
 {
-	m_mapLightHandle[number] = handle;
+	m_lightHandles.bind(number, handle);
 	return true;
 }
 bool CRibParser::bindLightHandle(RtLightHandle handle, const char *handleName)
 {
-	m_mapLightStrHandle[handleName] = handle;
+	m_lightHandles.bind(handleToken(handleName), handleName, handle);
 	return true;
 }
 bool CRibParser::getLightHandle(RtLightHandle &handle, RtInt number) const
 {
-	NUM2LIGHT::const_iterator i = m_mapLightHandle.find(number);
-	if ( i != m_mapLightHandle.end() ) {
-		handle = (*i).second;
-		return true;
-	}
-	return false;
+	return m_lightHandles.get(handle, number);
 }
 bool CRibParser::getLightHandle(RtLightHandle &handle, const char *handleName) const
 {
-	STR2LIGHT::const_iterator i = m_mapLightStrHandle.find(handleName);
-	if ( i != m_mapLightStrHandle.end() ) {
-		handle = (*i).second;
-		return true;
-	}
-	return false;
-}
-/*
-bool CRibParser::bindArchiveHandle(RtArchiveHandle handle, RtInt number)
-{
-	m_mapArchiveHandle[number] = handle;
-	return true;
+	return m_lightHandles.get(handle, m_handleNames.find(handleName), handleName);
 }
-*/
 bool CRibParser::bindArchiveHandle(RtArchiveHandle handle, const char *name)
 {
-	m_mapArchiveStrHandle[name] = handle;
+	m_archiveHandles.bind(handleToken(name), name, handle);
 	return true;
 }
-/*
-bool CRibParser::getArchiveHandle(RtArchiveHandle &handle, RtInt number) const
+bool CRibParser::getArchiveHandle(RtArchiveHandle &handle, const char *name) const
 {
-	NUM2OBJECT::const_iterator i = m_mapArchiveHandle.find(number);
-	if ( i != m_mapArchiveHandle.end() ) {
-		handle = (*i).second;
-		return true;
-	}
-	return false;
+	return m_archiveHandles.get(handle, m_handleNames.find(name), name);
 }
-*/
-bool CRibParser::getArchiveHandle(RtArchiveHandle &handle, const char *name) const
+std::map<std::string, CRibRequest *> &CRibParser::requestMap()
 {
-	STR2OBJECT::const_iterator i = m_mapArchiveStrHandle.find(name);
-	if ( i != m_mapArchiveStrHandle.end() ) {
-		handle = (*i).second;
-		return true;
-	}
-	return false;
+	static std::map<std::string, CRibRequest *> theRequestMap;
+	return theRequestMap;
 }
 void CRibParser::initRequestMap()
 {
-	if ( s_requestMap.empty() ) {
+	// Parsers can be created concurrently by different contexts
+	static std::mutex initMutex;
+	std::lock_guard<std::mutex> lock(initMutex);
+	if ( requestMap().empty() ) {
 		static CErrorHandlerRibRequest errorHandler;
-		s_requestMap.insert(std::make_pair(errorHandler.requestName(), &errorHandler));
+		requestMap().insert(std::make_pair(errorHandler.requestName(), &errorHandler));
 		static CDeclareRibRequest declare;
-		s_requestMap.insert(std::make_pair(declare.requestName(), &declare));
+		requestMap().insert(std::make_pair(declare.requestName(), &declare));
 		static CReadArchiveRibRequest readArchive;
-		s_requestMap.insert(std::make_pair(readArchive.requestName(), &readArchive));
+		requestMap().insert(std::make_pair(readArchive.requestName(), &readArchive));
 		static CVersionRibRequest version;
-		s_requestMap.insert(std::make_pair(version.requestName(), &version));
+		requestMap().insert(std::make_pair(version.requestName(), &version));
 		static CSystemRibRequest systemReq;
-		s_requestMap.insert(std::make_pair(systemReq.requestName(), &systemReq));
+		requestMap().insert(std::make_pair(systemReq.requestName(), &systemReq));
 		static CResourceBeginRibRequest resourceBegin; 
-		s_requestMap.insert(std::make_pair(resourceBegin.requestName(), &resourceBegin));
+		requestMap().insert(std::make_pair(resourceBegin.requestName(), &resourceBegin));
 		static CResourceEndRibRequest resourceEnd; 
-		s_requestMap.insert(std::make_pair(resourceEnd.requestName(), &resourceEnd));
+		requestMap().insert(std::make_pair(resourceEnd.requestName(), &resourceEnd));
 		static CResourceRibRequest resource; 
-		s_requestMap.insert(std::make_pair(resource.requestName(), &resource));
+		requestMap().insert(std::make_pair(resource.requestName(), &resource));
 		static CFrameBeginRibRequest frameBegin; 
-		s_requestMap.insert(std::make_pair(frameBegin.requestName(), &frameBegin));
+		requestMap().insert(std::make_pair(frameBegin.requestName(), &frameBegin));
 		static CFrameEndRibRequest frameEnd; 
-		s_requestMap.insert(std::make_pair(frameEnd.requestName(), &frameEnd));
+		requestMap().insert(std::make_pair(frameEnd.requestName(), &frameEnd));
 		static CWorldBeginRibRequest worldBegin; 
-		s_requestMap.insert(std::make_pair(worldBegin.requestName(), &worldBegin));
+		requestMap().insert(std::make_pair(worldBegin.requestName(), &worldBegin));
 		static CWorldEndRibRequest worldEnd; 
-		s_requestMap.insert(std::make_pair(worldEnd.requestName(), &worldEnd));
+		requestMap().insert(std::make_pair(worldEnd.requestName(), &worldEnd));
 		static CAttributeBeginRibRequest attributeBegin; 
-		s_requestMap.insert(std::make_pair(attributeBegin.requestName(), &attributeBegin));
+		requestMap().insert(std::make_pair(attributeBegin.requestName(), &attributeBegin));
 		static CAttributeEndRibRequest attributeEnd; 
-		s_requestMap.insert(std::make_pair(attributeEnd.requestName(), &attributeEnd));
+		requestMap().insert(std::make_pair(attributeEnd.requestName(), &attributeEnd));
 		static CTransformBeginRibRequest transformBegin; 
-		s_requestMap.insert(std::make_pair(transformBegin.requestName(), &transformBegin));
+		requestMap().insert(std::make_pair(transformBegin.requestName(), &transformBegin));
 		static CTransformEndRibRequest transformEnd; 
-		s_requestMap.insert(std::make_pair(transformEnd.requestName(), &transformEnd));
+		requestMap().insert(std::make_pair(transformEnd.requestName(), &transformEnd));
 		static CSolidBeginRibRequest solidBegin; 
-		s_requestMap.insert(std::make_pair(solidBegin.requestName(), &solidBegin));
+		requestMap().insert(std::make_pair(solidBegin.requestName(), &solidBegin));
 		static CSolidEndRibRequest solidEnd; 
-		s_requestMap.insert(std::make_pair(solidEnd.requestName(), &solidEnd));
+		requestMap().insert(std::make_pair(solidEnd.requestName(), &solidEnd));
 		static CObjectBeginRibRequest objectBegin; 
-		s_requestMap.insert(std::make_pair(objectBegin.requestName(), &objectBegin));
+		requestMap().insert(std::make_pair(objectBegin.requestName(), &objectBegin));
 		static CObjectEndRibRequest objectEnd; 
-		s_requestMap.insert(std::make_pair(objectEnd.requestName(), &objectEnd));
+		requestMap().insert(std::make_pair(objectEnd.requestName(), &objectEnd));
 		static CObjectInstanceRibRequest objectInstance; 
-		s_requestMap.insert(std::make_pair(objectInstance.requestName(), &objectInstance));
+		requestMap().insert(std::make_pair(objectInstance.requestName(), &objectInstance));
 		static CArchiveBeginRibRequest archiveBegin; 
-		s_requestMap.insert(std::make_pair(archiveBegin.requestName(), &archiveBegin));
+		requestMap().insert(std::make_pair(archiveBegin.requestName(), &archiveBegin));
 		static CArchiveEndRibRequest archiveEnd; 
-		s_requestMap.insert(std::make_pair(archiveEnd.requestName(), &archiveEnd));
+		requestMap().insert(std::make_pair(archiveEnd.requestName(), &archiveEnd));
 		static CMotionBeginRibRequest motionBegin; 
-		s_requestMap.insert(std::make_pair(motionBegin.requestName(), &motionBegin));
+		requestMap().insert(std::make_pair(motionBegin.requestName(), &motionBegin));
 		static CMotionEndRibRequest motionEnd; 
-		s_requestMap.insert(std::make_pair(motionEnd.requestName(), &motionEnd));
+		requestMap().insert(std::make_pair(motionEnd.requestName(), &motionEnd));
 		static CIfBeginRibRequest ifBegin; 
-		s_requestMap.insert(std::make_pair(ifBegin.requestName(), &ifBegin));
+		requestMap().insert(std::make_pair(ifBegin.requestName(), &ifBegin));
 		static CElseIfRibRequest elseIf; 
-		s_requestMap.insert(std::make_pair(elseIf.requestName(), &elseIf));
+		requestMap().insert(std::make_pair(elseIf.requestName(), &elseIf));
 		static CElseRibRequest elsePart; 
-		s_requestMap.insert(std::make_pair(elsePart.requestName(), &elsePart));
+		requestMap().insert(std::make_pair(elsePart.requestName(), &elsePart));
 		static CIfEndRibRequest ifEnd; 
-		s_requestMap.insert(std::make_pair(ifEnd.requestName(), &ifEnd));
+		requestMap().insert(std::make_pair(ifEnd.requestName(), &ifEnd));
 		static CFormatRibRequest format;
-		s_requestMap.insert(std::make_pair(format.requestName(), &format));
+		requestMap().insert(std::make_pair(format.requestName(), &format));
 		static CFrameAspectRatioRibRequest frameAspectRatio;
-		s_requestMap.insert(std::make_pair(frameAspectRatio.requestName(), &frameAspectRatio));
+		requestMap().insert(std::make_pair(frameAspectRatio.requestName(), &frameAspectRatio));
 		static CScreenWindowRibRequest screenWindow;
-		s_requestMap.insert(std::make_pair(screenWindow.requestName(), &screenWindow));
+		requestMap().insert(std::make_pair(screenWindow.requestName(), &screenWindow));
 		static CCropWindowRibRequest cropWindow;
-		s_requestMap.insert(std::make_pair(cropWindow.requestName(), &cropWindow));
+		requestMap().insert(std::make_pair(cropWindow.requestName(), &cropWindow));
 		static CProjectionRibRequest projection;
-		s_requestMap.insert(std::make_pair(projection.requestName(), &projection));
+		requestMap().insert(std::make_pair(projection.requestName(), &projection));
 		static CClippingRibRequest clipping;
-		s_requestMap.insert(std::make_pair(clipping.requestName(), &clipping));
+		requestMap().insert(std::make_pair(clipping.requestName(), &clipping));
 		static CClippingPlaneRibRequest clippingPlane;
-		s_requestMap.insert(std::make_pair(clippingPlane.requestName(), &clippingPlane));
+		requestMap().insert(std::make_pair(clippingPlane.requestName(), &clippingPlane));
 		static CDepthOfFieldRibRequest depthOfField;
-		s_requestMap.insert(std::make_pair(depthOfField.requestName(), &depthOfField));
+		requestMap().insert(std::make_pair(depthOfField.requestName(), &depthOfField));
 		static CShutterRibRequest shutter;
-		s_requestMap.insert(std::make_pair(shutter.requestName(), &shutter));
+		requestMap().insert(std::make_pair(shutter.requestName(), &shutter));
 		static CPixelVarianceRibRequest pixelVariance;
-		s_requestMap.insert(std::make_pair(pixelVariance.requestName(), &pixelVariance));
+		requestMap().insert(std::make_pair(pixelVariance.requestName(), &pixelVariance));
 		static CPixelSamplesRibRequest pixelSamples;
-		s_requestMap.insert(std::make_pair(pixelSamples.requestName(), &pixelSamples));
+		requestMap().insert(std::make_pair(pixelSamples.requestName(), &pixelSamples));
 		static CPixelFilterRibRequest pixelFilter;
-		s_requestMap.insert(std::make_pair(pixelFilter.requestName(), &pixelFilter));
+		requestMap().insert(std::make_pair(pixelFilter.requestName(), &pixelFilter));
 		static CExposureRibRequest exposure;
-		s_requestMap.insert(std::make_pair(exposure.requestName(), &exposure));
+		requestMap().insert(std::make_pair(exposure.requestName(), &exposure));
 		static CImagerRibRequest imager;
-		s_requestMap.insert(std::make_pair(imager.requestName(), &imager));
+		requestMap().insert(std::make_pair(imager.requestName(), &imager));
 		static CQuantizeRibRequest quantize;
-		s_requestMap.insert(std::make_pair(quantize.requestName(), &quantize));
+		requestMap().insert(std::make_pair(quantize.requestName(), &quantize));
 		static CDisplayChannelRibRequest displayChannel;
-		s_requestMap.insert(std::make_pair(displayChannel.requestName(), &displayChannel));
+		requestMap().insert(std::make_pair(displayChannel.requestName(), &displayChannel));
 		static CDisplayRibRequest display;
-		s_requestMap.insert(std::make_pair(display.requestName(), &display));
+		requestMap().insert(std::make_pair(display.requestName(), &display));
 		static CHiderRibRequest hider;
-		s_requestMap.insert(std::make_pair(hider.requestName(), &hider));
+		requestMap().insert(std::make_pair(hider.requestName(), &hider));
 		static CColorSamplesRibRequest colorSamples;
-		s_requestMap.insert(std::make_pair(colorSamples.requestName(), &colorSamples));
+		requestMap().insert(std::make_pair(colorSamples.requestName(), &colorSamples));
 		static CRelativeDetailRibRequest relativeDetail;
-		s_requestMap.insert(std::make_pair(relativeDetail.requestName(), &relativeDetail));
+		requestMap().insert(std::make_pair(relativeDetail.requestName(), &relativeDetail));
 		
 		static CCameraRibRequest camera;
-		s_requestMap.insert(std::make_pair(camera.requestName(), &camera));
+		requestMap().insert(std::make_pair(camera.requestName(), &camera));
 		
 		static COptionRibRequest option;
-		s_requestMap.insert(std::make_pair(option.requestName(), &option));
+		requestMap().insert(std::make_pair(option.requestName(), &option));
 		static CAttributeRibRequest attribute; 
-		s_requestMap.insert(std::make_pair(attribute.requestName(), &attribute));
+		requestMap().insert(std::make_pair(attribute.requestName(), &attribute));
 		static CColorRibRequest color; 
-		s_requestMap.insert(std::make_pair(color.requestName(), &color));
+		requestMap().insert(std::make_pair(color.requestName(), &color));
 		static COpacityRibRequest opacity; 
-		s_requestMap.insert(std::make_pair(opacity.requestName(), &opacity));
+		requestMap().insert(std::make_pair(opacity.requestName(), &opacity));
 		static CSurfaceRibRequest surface; 
-		s_requestMap.insert(std::make_pair(surface.requestName(), &surface));
+		requestMap().insert(std::make_pair(surface.requestName(), &surface));
 		static CAtmosphereRibRequest atmosphere; 
-		s_requestMap.insert(std::make_pair(atmosphere.requestName(), &atmosphere));
+		requestMap().insert(std::make_pair(atmosphere.requestName(), &atmosphere));
 		static CInteriorRibRequest interior; 
-		s_requestMap.insert(std::make_pair(interior.requestName(), &interior));
+		requestMap().insert(std::make_pair(interior.requestName(), &interior));
 		static CExteriorRibRequest exterior; 
-		s_requestMap.insert(std::make_pair(exterior.requestName(), &exterior));
+		requestMap().insert(std::make_pair(exterior.requestName(), &exterior));
 		static CDisplacementRibRequest displacement; 
-		s_requestMap.insert(std::make_pair(displacement.requestName(), &displacement));
+		requestMap().insert(std::make_pair(displacement.requestName(), &displacement));
 		static CTextureCoordinatesRibRequest textureCoordinates; 
-		s_requestMap.insert(std::make_pair(textureCoordinates.requestName(), &textureCoordinates));
+		requestMap().insert(std::make_pair(textureCoordinates.requestName(), &textureCoordinates));
 		static CShadingRateRibRequest shadingRate; 
-		s_requestMap.insert(std::make_pair(shadingRate.requestName(), &shadingRate));
+		requestMap().insert(std::make_pair(shadingRate.requestName(), &shadingRate));
 		static CShadingInterpolationRibRequest shadingInterpolation; 
-		s_requestMap.insert(std::make_pair(shadingInterpolation.requestName(), &shadingInterpolation));
+		requestMap().insert(std::make_pair(shadingInterpolation.requestName(), &shadingInterpolation));
 		static CMatteRibRequest matte; 
-		s_requestMap.insert(std::make_pair(matte.requestName(), &matte));
+		requestMap().insert(std::make_pair(matte.requestName(), &matte));
 		static CBoundRibRequest bound; 
-		s_requestMap.insert(std::make_pair(bound.requestName(), &bound));
+		requestMap().insert(std::make_pair(bound.requestName(), &bound));
 		static CDetailRibRequest detail; 
-		s_requestMap.insert(std::make_pair(detail.requestName(), &detail));
+		requestMap().insert(std::make_pair(detail.requestName(), &detail));
 		static CDetailRangeRibRequest detailRange; 
-		s_requestMap.insert(std::make_pair(detailRange.requestName(), &detailRange));
+		requestMap().insert(std::make_pair(detailRange.requestName(), &detailRange));
 		static CGeometricApproximationRibRequest geometricApproximation; 
-		s_requestMap.insert(std::make_pair(geometricApproximation.requestName(), &geometricApproximation));
+		requestMap().insert(std::make_pair(geometricApproximation.requestName(), &geometricApproximation));
 		static CGeometricRepresentationRibRequest geometricRepresentation; 
-		s_requestMap.insert(std::make_pair(geometricRepresentation.requestName(), &geometricRepresentation));
+		requestMap().insert(std::make_pair(geometricRepresentation.requestName(), &geometricRepresentation));
 		static COrientationRibRequest orientation; 
-		s_requestMap.insert(std::make_pair(orientation.requestName(), &orientation));
+		requestMap().insert(std::make_pair(orientation.requestName(), &orientation));
 		static CReverseOrientationRibRequest reverseOrientation; 
-		s_requestMap.insert(std::make_pair(reverseOrientation.requestName(), &reverseOrientation));
+		requestMap().insert(std::make_pair(reverseOrientation.requestName(), &reverseOrientation));
 		static CSidesRibRequest sides; 
-		s_requestMap.insert(std::make_pair(sides.requestName(), &sides));
+		requestMap().insert(std::make_pair(sides.requestName(), &sides));
 		static CBasisRibRequest basis; 
-		s_requestMap.insert(std::make_pair(basis.requestName(), &basis));
+		requestMap().insert(std::make_pair(basis.requestName(), &basis));
 		static CTrimCurveRibRequest trimCurve; 
-		s_requestMap.insert(std::make_pair(trimCurve.requestName(), &trimCurve));
+		requestMap().insert(std::make_pair(trimCurve.requestName(), &trimCurve));
 		static CIdentityRibRequest identity;
-		s_requestMap.insert(std::make_pair(identity.requestName(), &identity));
+		requestMap().insert(std::make_pair(identity.requestName(), &identity));
 		static CTransformRibRequest transform;
-		s_requestMap.insert(std::make_pair(transform.requestName(), &transform));
+		requestMap().insert(std::make_pair(transform.requestName(), &transform));
 		static CConcatTransformRibRequest concatTransform;
-		s_requestMap.insert(std::make_pair(concatTransform.requestName(), &concatTransform));
+		requestMap().insert(std::make_pair(concatTransform.requestName(), &concatTransform));
 		static CPerspectiveRibRequest perspective;
-		s_requestMap.insert(std::make_pair(perspective.requestName(), &perspective));
+		requestMap().insert(std::make_pair(perspective.requestName(), &perspective));
 		static CTranslateRibRequest translate;
-		s_requestMap.insert(std::make_pair(translate.requestName(), &translate));
+		requestMap().insert(std::make_pair(translate.requestName(), &translate));
 		static CRotateRibRequest rotate;
-		s_requestMap.insert(std::make_pair(rotate.requestName(), &rotate));
+		requestMap().insert(std::make_pair(rotate.requestName(), &rotate));
 		static CScaleRibRequest scale;
-		s_requestMap.insert(std::make_pair(scale.requestName(), &scale));
+		requestMap().insert(std::make_pair(scale.requestName(), &scale));
 		static CSkewRibRequest skew;
-		s_requestMap.insert(std::make_pair(skew.requestName(), &skew));
+		requestMap().insert(std::make_pair(skew.requestName(), &skew));
 		static CDeformationRibRequest deformation;
-		s_requestMap.insert(std::make_pair(deformation.requestName(), &deformation));
+		requestMap().insert(std::make_pair(deformation.requestName(), &deformation));
 		static CScopedCoordinateSystemRibRequest scopedCoordinateSystem;
-		s_requestMap.insert(std::make_pair(scopedCoordinateSystem.requestName(), &scopedCoordinateSystem));
+		requestMap().insert(std::make_pair(scopedCoordinateSystem.requestName(), &scopedCoordinateSystem));
 		static CCoordinateSystemRibRequest coordinateSystem;
-		s_requestMap.insert(std::make_pair(coordinateSystem.requestName(), &coordinateSystem));
+		requestMap().insert(std::make_pair(coordinateSystem.requestName(), &coordinateSystem));
 		static CCoordSysTransformRibRequest coordSysTransform;
-		s_requestMap.insert(std::make_pair(coordSysTransform.requestName(), &coordSysTransform));
+		requestMap().insert(std::make_pair(coordSysTransform.requestName(), &coordSysTransform));
 		static CTransformPointsRibRequest transformPoints;
-		s_requestMap.insert(std::make_pair(transformPoints.requestName(), &transformPoints));
+		requestMap().insert(std::make_pair(transformPoints.requestName(), &transformPoints));
 		static CLightSourceRibRequest lightSource;
-		s_requestMap.insert(std::make_pair(lightSource.requestName(), &lightSource));
+		requestMap().insert(std::make_pair(lightSource.requestName(), &lightSource));
 		static CAreaLightSourceRibRequest areaLightSource;
-		s_requestMap.insert(std::make_pair(areaLightSource.requestName(), &areaLightSource));
+		requestMap().insert(std::make_pair(areaLightSource.requestName(), &areaLightSource));
 		static CIlluminateRibRequest illuminate;
-		s_requestMap.insert(std::make_pair(illuminate.requestName(), &illuminate));
+		requestMap().insert(std::make_pair(illuminate.requestName(), &illuminate));
 		static CPolygonRibRequest polygon;
-		s_requestMap.insert(std::make_pair(polygon.requestName(), &polygon));
+		requestMap().insert(std::make_pair(polygon.requestName(), &polygon));
 		static CGeneralPolygonRibRequest generalPolygon;
-		s_requestMap.insert(std::make_pair(generalPolygon.requestName(), &generalPolygon));
+		requestMap().insert(std::make_pair(generalPolygon.requestName(), &generalPolygon));
 		static CPointsPolygonsRibRequest pointsPolygon;
-		s_requestMap.insert(std::make_pair(pointsPolygon.requestName(), &pointsPolygon));
+		requestMap().insert(std::make_pair(pointsPolygon.requestName(), &pointsPolygon));
 		static CPointsGeneralPolygonsRibRequest pointsGeneralPolygon;
-		s_requestMap.insert(std::make_pair(pointsGeneralPolygon.requestName(), &pointsGeneralPolygon));
+		requestMap().insert(std::make_pair(pointsGeneralPolygon.requestName(), &pointsGeneralPolygon));
 		static CPatchRibRequest patch;
-		s_requestMap.insert(std::make_pair(patch.requestName(), &patch));
+		requestMap().insert(std::make_pair(patch.requestName(), &patch));
 		static CPatchMeshRibRequest patchMesh;
-		s_requestMap.insert(std::make_pair(patchMesh.requestName(), &patchMesh));
+		requestMap().insert(std::make_pair(patchMesh.requestName(), &patchMesh));
 		static CNuPatchRibRequest nuPatch;
-		s_requestMap.insert(std::make_pair(nuPatch.requestName(), &nuPatch));
+		requestMap().insert(std::make_pair(nuPatch.requestName(), &nuPatch));
 		static CSubdivisionMeshRibRequest subdivisionMesh;
-		s_requestMap.insert(std::make_pair(subdivisionMesh.requestName(), &subdivisionMesh));
+		requestMap().insert(std::make_pair(subdivisionMesh.requestName(), &subdivisionMesh));
 		static CHierarchicalSubdivisionMeshRibRequest hierarchicalSubdivisionMesh;
-		s_requestMap.insert(std::make_pair(hierarchicalSubdivisionMesh.requestName(), &hierarchicalSubdivisionMesh));
+		requestMap().insert(std::make_pair(hierarchicalSubdivisionMesh.requestName(), &hierarchicalSubdivisionMesh));
 		static CSphereRibRequest sphere; 
-		s_requestMap.insert(std::make_pair(sphere.requestName(), &sphere));
+		requestMap().insert(std::make_pair(sphere.requestName(), &sphere));
 		static CConeRibRequest cone;
-		s_requestMap.insert(std::make_pair(cone.requestName(), &cone));
+		requestMap().insert(std::make_pair(cone.requestName(), &cone));
 		static CCylinderRibRequest cylinder;
-		s_requestMap.insert(std::make_pair(cylinder.requestName(), &cylinder));
+		requestMap().insert(std::make_pair(cylinder.requestName(), &cylinder));
 		static CHyperboloidRibRequest hyperboloid;
-		s_requestMap.insert(std::make_pair(hyperboloid.requestName(), &hyperboloid));
+		requestMap().insert(std::make_pair(hyperboloid.requestName(), &hyperboloid));
 		static CParaboloidRibRequest paraboloid;
-		s_requestMap.insert(std::make_pair(paraboloid.requestName(), &paraboloid));
+		requestMap().insert(std::make_pair(paraboloid.requestName(), &paraboloid));
 		static CDiskRibRequest disk;
-		s_requestMap.insert(std::make_pair(disk.requestName(), &disk));
+		requestMap().insert(std::make_pair(disk.requestName(), &disk));
 		static CTorusRibRequest torus;
-		s_requestMap.insert(std::make_pair(torus.requestName(), &torus));
+		requestMap().insert(std::make_pair(torus.requestName(), &torus));
 		static CPointsRibRequest points;
-		s_requestMap.insert(std::make_pair(points.requestName(), &points));
+		requestMap().insert(std::make_pair(points.requestName(), &points));
 		static CCurvesRibRequest curves;
-		s_requestMap.insert(std::make_pair(curves.requestName(), &curves));
+		requestMap().insert(std::make_pair(curves.requestName(), &curves));
 		static CBlobbyRibRequest blobby;
-		s_requestMap.insert(std::make_pair(blobby.requestName(), &blobby));
+		requestMap().insert(std::make_pair(blobby.requestName(), &blobby));
 		static CProceduralRibRequest procedural;
-		s_requestMap.insert(std::make_pair(procedural.requestName(), &procedural));
+		requestMap().insert(std::make_pair(procedural.requestName(), &procedural));
 		static CGeometryRibRequest geometry;
-		s_requestMap.insert(std::make_pair(geometry.requestName(), &geometry));
+		requestMap().insert(std::make_pair(geometry.requestName(), &geometry));
 		static CMakeTextureRibRequest makeTexture;
-		s_requestMap.insert(std::make_pair(makeTexture.requestName(), &makeTexture));
+		requestMap().insert(std::make_pair(makeTexture.requestName(), &makeTexture));
 		static CMakeBumpRibRequest makeBump;
-		s_requestMap.insert(std::make_pair(makeBump.requestName(), &makeBump));
+		requestMap().insert(std::make_pair(makeBump.requestName(), &makeBump));
 		static CMakeLatLongEnvironmentRibRequest makeLatLongEnvironment;
-		s_requestMap.insert(std::make_pair(makeLatLongEnvironment.requestName(), &makeLatLongEnvironment));
+		requestMap().insert(std::make_pair(makeLatLongEnvironment.requestName(), &makeLatLongEnvironment));
 		static CMakeCubeFaceEnvironmentRibRequest makeCubeFaceEnvironment;
-		s_requestMap.insert(std::make_pair(makeCubeFaceEnvironment.requestName(), &makeCubeFaceEnvironment));
+		requestMap().insert(std::make_pair(makeCubeFaceEnvironment.requestName(), &makeCubeFaceEnvironment));
 		static CMakeShadowRibRequest makeShadow;
-		s_requestMap.insert(std::make_pair(makeShadow.requestName(), &makeShadow));
+		requestMap().insert(std::make_pair(makeShadow.requestName(), &makeShadow));
 		static CMakeBrickMapRibRequest makeBrickMap;
-		s_requestMap.insert(std::make_pair(makeBrickMap.requestName(), &makeBrickMap));
+		requestMap().insert(std::make_pair(makeBrickMap.requestName(), &makeBrickMap));
 	}
 }
 EnumRequests CRibParser::findIdentifier()
 {
 	m_token.push_back(0); // Terminate string
 	std::map<std::string, CRibRequest *>::const_iterator i;
-	if ( (i = s_requestMap.find(&m_token[0])) != s_requestMap.end() ) {
+	if ( (i = requestMap().find(&m_token[0])) != requestMap().end() ) {
 		if ( i->second )
 			return (i->second)->interfaceIdx();
 	}
@@ -837,10 +856,16 @@ EnumRequests CRibParser::findIdentifier()
 }
 bool CRibParser::call(const std::string &request)
 {
+	if ( m_selectFrames && !selectRequest(request) ) {
+		// Request of a frame not selected
+		return true;
+	}
 	std::map<std::string, CRibRequest *>::const_iterator i;
-	if ( (i = s_requestMap.find(request)) != s_requestMap.end() ) {
+	if ( (i = requestMap().find(request)) != requestMap().end() ) {
 		if ( i->second ) {
 			(*(i->second))(*this, m_request);
+			// The render states have shared the values they need
+			CParameterValueBlocks::withdraw();
 			return true;
 		}
 	}
@@ -866,14 +891,14 @@ int CRibParser::handleBinary(unsigned char c) {
 				lineNo(), resourceName(), RI_NULL);
 			// skip values
 			for ( i = 0; i < w; i++ ) {
-				c = getchar();
+				c = getbyte();
 			}
 			return 0;
 		}
 		// Read all bytes to an unsigned long (w has 1..4 bytes)
 		unsigned long tmp = 0;
 		for ( i = 0; i < w; i++ ) {
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {   // EOF is not expected here
 				errHandler().handleError(
 										 RIE_CONSISTENCY, RIE_ERROR,
@@ -884,10 +909,13 @@ int CRibParser::handleBinary(unsigned char c) {
 			tmp = tmp << 8;
 			tmp |= c;
 		}
-		i = w*8;
-		if  ( tmp & ( 1 << (i-1) )) // value is negative
-			tmp |= 0xffffffff << i; // change 0 to 1 in the upper bits
-		RtFloat flt = (RtFloat)((double)tmp / (double)(1 << (d * 8)));
+		// Sign extension of the w*8 bit two's complement value
+		long long value = (long long)tmp;
+		if  ( tmp & ( 1UL << (w*8-1) )) // value is negative
+			value -= (1LL << (w*8));
+		if ( d == 0 )
+			return insertNumber((RtInt)value);
+		RtFloat flt = (RtFloat)((double)value / (double)(1UL << (d * 8)));
 		return insertNumber(flt);
 	} else if ( c < 0240 ) {    // encoded strings of no more than 15 characters
 		// 0220 + w | <ASCII string>, w=[0..15]
@@ -895,7 +923,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		m_token.clear();
 		m_token.reserve(w+1);
 		while ( w-- > 0 ) {
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {   // EOF is not expected here
 				errHandler().handleError(
 										 RIE_CONSISTENCY, RIE_ERROR,
@@ -915,7 +943,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		unsigned long utmp = 0;
 		if ( l != 0 ) {
 			while ( l-- != 0 ) {
-				c = getchar();
+				c = getbyte();
 				if ( !m_istream ) {  // EOF is not expected here
 					errHandler().handleError(
 											 RIE_CONSISTENCY, RIE_ERROR,
@@ -932,7 +960,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		m_token.reserve(utmp+1);
 		if ( utmp != 0 ) {
 			while ( utmp-- != 0 ) {
-				c = getchar();
+				c = getbyte();
 				if ( !m_istream ) {  // EOF is not expected here
 					errHandler().handleError(RIE_CONSISTENCY, RIE_ERROR,
 											 "Line %ld, File \"%s\", protocolbotch: EOF is not expected here [handleBinary() 4]",
@@ -949,7 +977,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		unsigned long tmp = 0;
 		int i;
 		for ( i = 0; i < 4; i++ ) {
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {  // EOF is not expected here
 				errHandler().handleError(RIE_CONSISTENCY, RIE_ERROR,
 										 "Line %ld, File \"%s\", protocolbotch: EOF is not expected here [handleBinary() 5]",
@@ -983,7 +1011,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		for ( i = 0; i < 8; i++ )
 #endif        
 		{
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {  // EOF is not expected here
 				errHandler().handleError(
 										 RIE_CONSISTENCY, RIE_ERROR,
@@ -999,7 +1027,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		return insertNumber((RtFloat)dbl);
 	} else if ( c < 0247 ) {    // encoded RI request
 		// 0246 | <code>
-		c = getchar();
+		c = getbyte();
 		if ( !m_istream ) {  // EOF is not expected here
 			errHandler().handleError(
 									 RIE_CONSISTENCY, RIE_ERROR,
@@ -1027,11 +1055,9 @@ int CRibParser::handleBinary(unsigned char c) {
 		return RIBPARSER_NORMAL_COMMENT;  // Treat as comment
 	} else if ( c < 0314 ) {    // encoded single precision array (length follows)
 		unsigned int l = c - 0310 + 1;
-		int i;
 		unsigned long utmp = 0;
-		unsigned long tmp = 0;
 		while ( l-- != 0 ) {
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {  // EOF is not expected here
 				errHandler().handleError(
 										 RIE_CONSISTENCY, RIE_ERROR,
@@ -1044,43 +1070,32 @@ int CRibParser::handleBinary(unsigned char c) {
 		}
 		handleArrayStart();
 		
-		while ( utmp-- != 0 ) {
-			for ( i = 0; i < 4; i++ ) {
-				c = getchar();
-				if ( !m_istream ) {  // EOF is not expected here
-					errHandler().handleError(RIE_CONSISTENCY, RIE_ERROR,
-											 "Line %ld, File \"%s\", protocolbotch: EOF is not expected here [c==%d, handleBinary() 9]",
-											 lineNo(), resourceName(), static_cast<int>(c), RI_NULL);
-					/*
-					std::cerr << "# ++++**** c = " << static_cast<int>(c) << std::endl;
-					if ( m_istream.fail() ) {
-						std::cerr << "# ++++**** " << "failbit or badbit is set" << std::endl;
-					}
-					if ( m_istream.bad() ) {
-						std::cerr << "# ++++**** " << "badbit is set" << std::endl;
-					}
-					if ( m_istream.eof() ) {
-						std::cerr << "# ++++**** " << "eofbit is set" << std::endl;
-					}
-					if ( m_istream.good() ) {
-						std::cerr << "# ++++**** " << "goodbit is set" << std::endl;
-					}
-					m_istream.clear();
-					*/
-					return 0;
-				}
-				tmp = tmp << 8;
-				tmp |= c;
+		// The payload is read in blocks (the length may be corrupted)
+		// directly into the parameter and converted in place.
+		const unsigned long blockSize = 16384;
+		while ( utmp != 0 ) {
+			unsigned long n = utmp < blockSize ? utmp : blockSize;
+			RtFloat *flts = m_request.back().appendFloats(n);
+			if ( !flts ) {
+				errHandler().handleError(
+					RIE_CONSISTENCY, RIE_ERROR,
+					"Line %ld, File \"%s\", badarray: Mixed types in array",
+					lineNo(), resourceName(), RI_NULL);
+				return handleArrayEnd();
 			}
-			float flt = 0;
-			// flt = *((float *)(void*)&tmp);
-			memcpy(&flt, &tmp, sizeof(float));
-			insertNumber((RtFloat)flt);
+			if ( !getBytes(reinterpret_cast<unsigned char *>(flts), 4*n) ) {  // EOF is not expected here
+				errHandler().handleError(RIE_CONSISTENCY, RIE_ERROR,
+										 "Line %ld, File \"%s\", protocolbotch: EOF is not expected here [handleBinary() 9]",
+										 lineNo(), resourceName(), RI_NULL);
+				return 0;
+			}
+			bigEndianToFloats(flts, n);
+			utmp -= n;
 		}
 		return handleArrayEnd();
 	} else if ( c < 0315 ) {    // define encoded request
 		// 0314 | code | <string>
-		c = getchar();
+		c = getbyte();
 		if ( !m_istream ) {  // EOF is not expected here
 			errHandler().handleError(
 									 RIE_CONSISTENCY, RIE_ERROR,
@@ -1093,7 +1108,7 @@ int CRibParser::handleBinary(unsigned char c) {
 	} else if ( c < 0317 ) {    // define encoded string token
 		// 0315+w | <token> | string
 		int w = c == 0315 ? 1 : 2;
-		c = getchar();
+		c = getbyte();
 		if ( !m_istream ) {  // EOF is not expected here
 			errHandler().handleError(
 									 RIE_CONSISTENCY, RIE_ERROR,
@@ -1103,7 +1118,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		}
 		unsigned long tmp = c;
 		if ( w == 2 ) {
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {  // EOF is not expected here
 				errHandler().handleError(
 										 RIE_CONSISTENCY, RIE_ERROR,
@@ -1119,7 +1134,7 @@ int CRibParser::handleBinary(unsigned char c) {
 	} else if ( c < 0321 ) {    // interpolate defined string
 		// 0317+w | <token> | string
 		int w = c == 0317 ? 1 : 2;
-		c = getchar();
+		c = getbyte();
 		if ( !m_istream ) {  // EOF is not expected here
 			errHandler().handleError(
 									 RIE_CONSISTENCY, RIE_ERROR,
@@ -1129,7 +1144,7 @@ int CRibParser::handleBinary(unsigned char c) {
 		}
 		unsigned long tmp = c;
 		if ( w == 2 ) {
-			c = getchar();
+			c = getbyte();
 			if ( !m_istream ) {  // EOF is not expected here
 				errHandler().handleError(
 										 RIE_CONSISTENCY, RIE_ERROR,
@@ -1141,8 +1156,9 @@ int CRibParser::handleBinary(unsigned char c) {
 			tmp |= c;
 		}
 		NUM2STRING::const_iterator i = m_stringMap.find(tmp);
-		if ( i != m_stringMap.end() ) {
-			m_token.assign((*i).second.c_str(), (*i).second.c_str()+strlen((*i).second.c_str()));
+		const char *str = 0;
+		if ( i != m_stringMap.end() && (*i).second.getString(str) && str ) {
+			m_token.assign(str, str+strlen(str));
 			return handleString();
 		}
 		// Error string not found
@@ -1171,6 +1187,11 @@ int CRibParser::handleComment(TOKENTYPE &token, bool isStructured)
 }
 void CRibParser::handleDeferedComments()
 {
+	if ( m_skipFrame || m_stopParsing ) {
+		// Comments of a frame not selected or following the last frame selected
+		m_deferedCommentList.clear();
+		return;
+	}
 	for ( unsigned int i = 0; i < m_deferedCommentList.size(); ++i ) {
 		CComment &c = m_deferedCommentList[i];
 		if ( c.m_isStructured ) {
@@ -1209,13 +1230,15 @@ int CRibParser::handleString()
 		return RIBPARSER_NORMAL_COMMENT;
 	}
 	if ( m_defineString >= 0 ) {
-		m_stringMap[m_defineString] = &m_token[0];
+		CRibParameter p;
+		p.setString(&m_token[0], stringTokens());
+		m_stringMap[m_defineString] = p;
 		m_defineString = -1;
 		return RIBPARSER_NORMAL_COMMENT;
 	}
 	if ( m_braketDepth ) {
 		CRibParameter &p = m_request.back();
-		if ( !p.setString(&m_token[0]) ) {
+		if ( !p.setString(&m_token[0], stringTokens()) ) {
 			errHandler().handleError(
 				RIE_CONSISTENCY, RIE_ERROR,
 				"Line %ld, File \"%s\", badarray: Mixed types in array",
@@ -1227,7 +1250,7 @@ int CRibParser::handleString()
 		// Handle RIB String Variables, if Option "rib" "string varsubst" ["$"]
 		if ( m_renderState )
 			m_renderState->varSubst(m_token);
-		p.setString(&m_token[0]);
+		p.setString(&m_token[0], stringTokens());
 		m_request.push_back(p);
 	}
 	return RIBPARSER_STRING;
@@ -1604,6 +1627,10 @@ int CRibParser::nextToken()
 }
 int CRibParser::parseNextCall()
 {
+	CRequestStatistics *stats = (m_renderState && m_renderState->statistics().enabled()) ? &m_renderState->statistics() : 0;
+	unsigned long long start = stats ? CRequestStatistics::now() : 0;
+	CTraceScope trace("parse");
+
 	// Find first/next call (lookahead)
 	while ( m_lookahead != RIBPARSER_EOF && !isRequestToken(m_lookahead) ) {
 		m_code = -1;
@@ -1640,6 +1667,9 @@ int CRibParser::parseNextCall()
 				break;
 			}
 		} while ( m_lookahead != RIBPARSER_EOF && !isRequestToken(m_lookahead) ); // while parameters are found
+		trace.end();
+		if ( stats )
+			stats->parsed(CRequestStatistics::now() - start);
 		// m_lookahead is the number of the next request or RIBPARSER_EOF if EOF is found
 	
 		if ( m_braketDepth > 0 ) {
@@ -1668,28 +1698,100 @@ int CRibParser::parseNextCall()
 	}
 	return m_lookahead;
 }
-void CRibParser::parseFile()
+int CRibParser::callNextLexed()
+{
+	CRequestStatistics *stats = (m_renderState && m_renderState->statistics().enabled()) ? &m_renderState->statistics() : 0;
+	unsigned long long start = stats ? CRequestStatistics::now() : 0;
+	CTraceScope trace("parse");
+
+	// Calls the requests lexed by m_lexedSource in sequence
+	while ( !m_lexedChunk || (m_lexedChunk->valid() && m_lexedRequest >= m_lexedChunk->requests().size()) ) {
+		if ( m_lexedChunk )
+			m_lexedLineBase += m_lexedChunk->lines();
+		m_lexedChunk = 0;
+		m_lexedRequest = 0;
+		try {
+			m_lexedChunk = m_lexedSource->nextChunk();
+		} catch ( ExceptRiCPPError &err ) {
+			// The stream could not be read
+			lineNo(m_lexedLineBase);
+			err.line(lineNo());
+			err.file(resourceName());
+			throw err;
+		}
+		if ( !m_lexedChunk )
+			break;
+	}
+	CRibChunkLexer *chunk = m_lexedChunk;
+	// handle any comments left (e.g. after an error)
+	handleDeferedComments();
+	if ( !chunk || !chunk->valid() ) {
+		// End of stream or the chunk has to be parsed sequentially
+		lineNo(m_lexedLineBase);
+		return RIBPARSER_EOF;
+	}
+	CRibLexedRequest &req = chunk->requests()[m_lexedRequest++];
+	std::vector<CRibLexedComment>::const_iterator ci;
+	for ( ci = req.m_comments.begin(); ci != req.m_comments.end(); ++ci ) {
+		CComment cc;
+		m_deferedCommentList.push_back(cc);
+		CComment &c = m_deferedCommentList.back();
+		c.m_comment = (*ci).m_comment;
+		c.m_isStructured = (*ci).m_isStructured;
+		c.m_lineNo = m_lexedLineBase + (*ci).m_lineNo;
+	}
+	// Errors found by the lexer
+	std::vector<CRibLexedMessage>::const_iterator mi;
+	for ( mi = req.m_messages.begin(); mi != req.m_messages.end(); ++mi ) {
+		lineNo(m_lexedLineBase + (*mi).m_lineNo);
+		errHandler().handleError(
+			(*mi).m_code, (*mi).m_severity,
+			"Line %ld, File \"%s\"%s",
+			lineNo(), resourceName(), (*mi).m_text.c_str(), RI_NULL);
+	}
+	if ( !req.m_request.empty() ) {
+		m_request.clear();
+		m_request.curRequest(req.m_request.c_str());
+		std::vector<CRibParameter>::iterator pi;
+		for ( pi = req.m_parameters.begin(); pi != req.m_parameters.end(); ++pi ) {
+			(*pi).lineNo((*pi).lineNo() + m_lexedLineBase);
+			const char *str = 0;
+			if ( m_renderState && !(*pi).isArray() && (*pi).getString(str) && str ) {
+				// Handle RIB String Variables, if Option "rib" "string varsubst" ["$"]
+				TOKENTYPE token(str);
+				token.push_back(0);
+				m_renderState->varSubst(token);
+				if ( strcmp(&token[0], str) != 0 )
+					(*pi).replaceString(&token[0], stringTokens());
+			}
+		}
+		m_request.swapParameters(req.m_parameters);
+		lineNo(m_lexedLineBase + req.m_lineNo);
+		trace.end();
+		if ( stats )
+			stats->parsed(CRequestStatistics::now() - start);
+		// handles the RIB request
+		if ( !call(m_request.curRequest()) ) {
+			// *** Error
+			errHandler().handleError(
+				RIE_BADTOKEN, RIE_ERROR,
+				"Line %ld, File \"%s\", not a valid request: %s",
+				lineNo(), resourceName(), m_request.curRequest().c_str(), RI_NULL);
+		}
+	}
+	handleDeferedComments(); // handles any comments found
+	return RIBPARSER_REQUEST;
+}
+void CRibParser::parseRequests()
 {
-	// Clear data array used by the binary decoder
-	for ( int i = 0; i < 256; ++i )
-		m_ribEncode[i] = REQ_UNKNOWN;
-	// Clear the list of strings (binary decoder)
-	m_stringMap.clear();
-	// Clear handle maps (Handle number -> handle)
-	clearHandleMaps();
-	// Clears any defered comments
-	m_deferedCommentList.clear();
-	m_code = -1;            // No defined token (binary)
-	m_defineString = -1;	// No defind string (binary)
-	m_lookahead = RIBPARSER_NOT_A_TOKEN;  // Initialize, no Token found
-	lineNo(1);
-	m_lastChar = 0;
-	m_hasPutBack = false;
 	bool running = true;
 	do {
 		// Do not stop parsing if an error occurs
 		try {
-			running = parseNextCall() != RIBPARSER_EOF;
+			if ( m_lexedSource )
+				running = callNextLexed() != RIBPARSER_EOF;
+			else
+				running = parseNextCall() != RIBPARSER_EOF;
 		} catch ( ExceptRiCPPError &e1 ) {
 			if ( m_parserCallback ) {
 				m_parserCallback->ricppErrHandler().handleError(e1);
@@ -1717,10 +1819,240 @@ void CRibParser::parseFile()
 				throw;
 			}
 		}
-	} while ( running ); // Parse all requests
+	} while ( running && !m_stopParsing ); // Parse all requests
+}
+void CRibParser::parseLexed(IRibLexedSource &source)
+{
+	m_lexedSource = &source;
+	m_lexedChunk = 0;
+	m_lexedRequest = 0;
+	m_lexedLineBase = 1;
+	try {
+		parseRequests();
+		m_lexedSource = 0;
+		if ( !m_stopParsing && m_lexedChunk && !m_lexedChunk->valid() ) {
+			// Chunk could not be lexed (e.g. binary rib), parse sequentially from its start
+			m_lexedChunk = 0;
+			std::streambuf *oldBuf = m_istream.rdbuf(source.rest());
+			m_lookahead = RIBPARSER_NOT_A_TOKEN;
+			m_lastChar = 0;
+			m_hasPutBack = false;
+			lineNo(m_lexedLineBase);
+			try {
+				parseRequests();
+			} catch ( ... ) {
+				m_istream.rdbuf(oldBuf);
+				throw;
+			}
+			m_istream.rdbuf(oldBuf);
+		}
+	} catch ( ... ) {
+		m_lexedSource = 0;
+		m_lexedChunk = 0;
+		source.stop();
+		throw;
+	}
+	m_lexedChunk = 0;
+	source.stop();
+}
+void CRibParser::parseFile()
+{
+	// Clear data array used by the binary decoder
+	for ( int i = 0; i < 256; ++i )
+		m_ribEncode[i] = REQ_UNKNOWN;
+	// Clear the list of strings (binary decoder)
+	m_stringMap.clear();
+	// Clear handle maps (Handle number -> handle)
+	clearHandleMaps();
+	// Clears any defered comments
+	m_deferedCommentList.clear();
+	m_code = -1;            // No defined token (binary)
+	m_defineString = -1;	// No defind string (binary)
+	m_lookahead = RIBPARSER_NOT_A_TOKEN;  // Initialize, no Token found
+	lineNo(1);
+	m_lastChar = 0;
+	m_hasPutBack = false;
+	m_lexedSource = 0;
+	m_lexedChunk = 0;
+	// Frame selection
+	m_selectFrames = false;
+	m_skipFrame = false;
+	m_inFrame = false;
+	m_frameNo = 0;
+	m_frameArchiveDepth = 0;
+	m_wantedFrames = 0;
+	m_framesFound.clear();
+	m_stopParsing = false;
+	if ( m_frameSelection.active() ) {
+		if ( parseFrameIndex() ) {
+			clearHandleMaps();
+			return;
+		}
+		// No frame index, the requests of the frames not selected are skipped
+		m_selectFrames = true;
+		m_wantedFrames = m_frameSelection.wantedFrames();
+	}
+	if ( m_renderState && m_renderState->parallelLexing() > 1 ) {
+		// Read the whole rib stream and lex it in chunks using threads,
+		// if it has at least CRibParallelLexer::MIN_PARALLEL_CHUNKS chunks
+		std::vector<char> ribData;
+		const std::streamsize blockSize = 1<<16;
+		const size_t minParallelSize = (size_t)m_renderState->parallelLexingChunk() * CRibParallelLexer::MIN_PARALLEL_CHUNKS;
+		bool parallel = false;
+		while ( m_istream ) {
+			size_t oldSize = ribData.size();
+			ribData.resize(oldSize + (size_t)blockSize);
+			m_istream.read(&ribData[oldSize], blockSize);
+			ribData.resize(oldSize + (size_t)m_istream.gcount());
+			if ( ribData.size() >= minParallelSize )
+				parallel = true;
+		}
+		if ( ribData.empty() )
+			ribData.push_back('\n');
+		if ( parallel ) {
+			CRibParallelLexer parallelLexer;
+			parallelLexer.start(
+				&ribData[0], (unsigned long)ribData.size(),
+				(unsigned int)m_renderState->parallelLexing(),
+				(unsigned long)m_renderState->parallelLexingChunk(),
+				stringTokens());
+			parseLexed(parallelLexer);
+		} else {
+			// Small stream, parse it sequentially from memory
+			CRibMemoryStreambuf ribBuf(&ribData[0], (std::streamsize)ribData.size());
+			std::streambuf *oldBuf = m_istream.rdbuf(&ribBuf);
+			try {
+				parseRequests();
+			} catch ( ... ) {
+				m_istream.rdbuf(oldBuf);
+				throw;
+			}
+			m_istream.rdbuf(oldBuf);
+		}
+	} else if ( m_renderState && m_renderState->asyncParsing() > 0 ) {
+		// Read and lex the rib stream in a separate thread
+		CRibAsyncLexer asyncLexer;
+		asyncLexer.start(m_istream.rdbuf(), (unsigned long)m_renderState->asyncParsing(), stringTokens());
+		parseLexed(asyncLexer);
+	} else {
+		parseRequests();
+	}
+	m_selectFrames = false;
+	m_skipFrame = false;
 	// Clear the handle maps
 	clearHandleMaps();
 }
+bool CRibParser::selectRequest(const std::string &request)
+{
+	if ( request == "ArchiveBegin" ) {
+		++m_frameArchiveDepth;
+		return !m_skipFrame;
+	}
+	if ( request == "ArchiveEnd" ) {
+		if ( m_frameArchiveDepth > 0 )
+			--m_frameArchiveDepth;
+		return !m_skipFrame;
+	}
+	if ( m_frameArchiveDepth > 0 ) {
+		return !m_skipFrame;
+	}
+	if ( request == "FrameBegin" ) {
+		// Frame number as in CFrameBeginRibRequest
+		RtInt frameNo = 1;
+		if ( m_request.size() >= 1 && !m_request[0].getInt(frameNo) )
+			frameNo = 1;
+		m_frameNo = frameNo;
+		m_inFrame = true;
+		m_skipFrame = !m_frameSelection.selected(frameNo);
+		return !m_skipFrame;
+	}
+	if ( request == "FrameEnd" && m_inFrame ) {
+		bool skipped = m_skipFrame;
+		m_inFrame = false;
+		m_skipFrame = false;
+		if ( !skipped ) {
+			m_framesFound.insert(m_frameNo);
+			if ( m_wantedFrames && m_framesFound.size() >= m_wantedFrames ) {
+				// All frames of the positive list are found
+				m_stopParsing = true;
+			}
+		}
+		return !skipped;
+	}
+	return !m_skipFrame;
+}
+bool CRibParser::parseFrameIndex()
+{
+	if ( m_istream.rdbuf() != &m_ob || !m_ob.seekable() ) {
+		// e.g. standard input
+		return false;
+	}
+	
+	std::string filename;
+	if ( m_absUri.getScheme() == "file" )
+		filename = m_absUri.decodeFilepath();
+	
+	CRibFrameIndex index;
+	m_ob.inflateIndex(&index.inflateIndex());
+	try {
+		if ( filename.empty() || !index.load(filename) ) {
+			if ( !index.build(m_ob) ) {
+				// Binary encoded rib, parse from the start
+				m_ob.inflateIndex(0);
+				if ( m_ob.pubseekpos(0) == std::streampos(std::streamoff(-1)) ) {
+					errHandler().handleError(
+						RIE_SYSTEM, RIE_ERROR,
+						"Line %ld, File \"%s\", cannot read the rib stream again to select frames",
+						lineNo(), resourceName(), RI_NULL);
+					return true;
+				}
+				return false;
+			}
+			if ( !filename.empty() && m_renderState && m_renderState->storeFrameIndex() ) {
+				// Store the index to be reused, failures are ignored
+				index.save(filename);
+			}
+		}
+		
+		std::vector<CRibFrameIndex::SRange> ranges;
+		index.ranges(m_frameSelection, ranges);
+		std::vector<CRibFrameIndex::SRange>::const_iterator i;
+		for ( i = ranges.begin(); i != ranges.end(); ++i ) {
+			if ( !parseRange(*i) )
+				break;
+		}
+	} catch ( ... ) {
+		m_ob.inflateIndex(0);
+		throw;
+	}
+	m_ob.inflateIndex(0);
+	return true;
+}
+bool CRibParser::parseRange(const CRibFrameIndex::SRange &range)
+{
+	if ( m_ob.pubseekpos(range.m_begin) == std::streampos(std::streamoff(-1)) ) {
+		errHandler().handleError(
+			RIE_SYSTEM, RIE_ERROR,
+			"Line %ld, File \"%s\", cannot position the rib stream to select frames",
+			range.m_line, resourceName(), RI_NULL);
+		return false;
+	}
+	
+	CRibRangeStreambuf rangeBuf(m_ob, range.m_end - range.m_begin);
+	std::streambuf *oldBuf = m_istream.rdbuf(&rangeBuf);
+	m_lookahead = RIBPARSER_NOT_A_TOKEN;
+	m_lastChar = 0;
+	m_hasPutBack = false;
+	lineNo(range.m_line);
+	try {
+		parseRequests();
+	} catch ( ... ) {
+		m_istream.rdbuf(oldBuf);
+		throw;
+	}
+	m_istream.rdbuf(oldBuf);
+	return true;
+}
 bool CRibParser::close()
 {
 	return m_ob.close();
@@ -1732,10 +2064,16 @@ bool CRibParser::canParse(RtString name)
 		return true;
 	}
 	std::string filename = name;
-	CUri refUri;
-	if ( !refUri.encodeFilepath(filename.c_str(), 0) )
+	CUri refUri(filename.c_str());
+	// URIs with a scheme of a buffer factory (e.g. "memory:foo") are used
+	// as they are, single letters are drive letters of file paths.
+	if ( !refUri.isValid() || refUri.getScheme().size() < 2 ||
+		 !m_parserCallback->protocolHandlers().getBufferFactory(refUri.getScheme().c_str()) )
 	{
-		return false;
+		if ( !refUri.encodeFilepath(filename.c_str(), 0) )
+		{
+			return false;
+		}
 	}
 	if ( !CUri::makeAbsolute(m_absUri, m_baseUri, refUri, false) ) {
 		return false;
@@ -1750,5 +2088,33 @@ void CRibParser::parse(
 {
 	m_callback = callback;
 	m_parameterList = params;
+	
+	// Frame selection, the parameters are not propagated to nested archives
+	m_frameSelection.clear();
+	std::vector<CParameter *> selectionParams;
+	CParameterList::iterator i;
+	for ( i = m_parameterList.begin(); i != m_parameterList.end(); ++i ) {
+		if ( !(*i).var() || (*i).type() != TYPE_STRING )
+			continue;
+		bool isFrames = !strcmp((*i).var(), "frames");
+		if ( !isFrames && strcmp((*i).var(), "excludeframes") )
+			continue;
+		selectionParams.push_back(&(*i));
+		std::vector<std::string>::const_iterator s;
+		for ( s = (*i).strings().begin(); s != (*i).strings().end(); ++s ) {
+			bool valid = isFrames ? m_frameSelection.frames((*s).c_str()) : m_frameSelection.excludeFrames((*s).c_str());
+			if ( !valid ) {
+				errHandler().handleError(
+					RIE_RANGE, RIE_ERROR,
+					"File \"%s\", badargument: invalid list of frames \"%s\" for parameter '%s', the list is ignored",
+					resourceName(), (*s).c_str(), (*i).var(), RI_NULL);
+			}
+		}
+	}
+	std::vector<CParameter *>::iterator pi;
+	for ( pi = selectionParams.begin(); pi != selectionParams.end(); ++pi ) {
+		m_parameterList.erase(*pi);
+	}
+	
 	parseFile();
 }
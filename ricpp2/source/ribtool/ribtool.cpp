@@ -254,6 +254,89 @@ Writes either binary (+b) or ASCII (-b) output
 -b ASCII output
 @endverbatim
 
+- The option a (accuracy of binary float arrays), default -a
+
+Writes the float arrays of the parameters P, N and st of binary
+output (+b) as fixed-point numbers, if these meet the error bound
+and are shorter than the IEEE floats. The bound is either absolute
+or, prefixed by r, relative to the largest magnitude of an array.
+
+@verbatim
++a/bound/ Fixed-point numbers within the bound, e.g. +a/0.001/ or +a/r0.0001/
+-a IEEE floats
+@endverbatim
+
+- The option d (deduplicate geometry), default -d
+
+Identical primitives (same request and parameters) repeated within a
+world block are written as object: the third occurrence is written as
+object definition (ObjectBegin/ObjectEnd) and instanced, all following
+occurrences are only instanced by ObjectInstance. Primitives that are
+not larger than the object requests are left as they are, the
+definition would not pay off. The instances are
+written at the places of the primitives, the attributes and
+transformations stay the same. Only primitives of at least the given
+size (in bytes of ASCII RIB) are deduplicated. Primitives within motion
+blocks, conditionals, archive and object definitions are not changed,
+neither are bicubic patches, cubic curves and NURBS, which depend on
+attributes at their definition. The bytes saved are reported at the end.
+
+@verbatim
++d[n] Deduplicates primitives of at least n bytes (no number: 256 bytes)
+-d Writes primitives as they are
+@endverbatim
+
+- The option u (usage statistics of the requests), default -u
+
+Collects statistics per request type: the number of calls, the bytes of
+the parameter values, the time to parse the RIB requests, the times of
+their processing (including the requests of archives they read) and the
+number of tessellated triangles. The statistics are written at the end,
+as CSV if the file name ends with .csv, else as JSON. Without a file
+name they are written (JSON) to the standard error stream. The frame
+jobs (+j) write their statistics to separate files, the job number is
+inserted before the extension (e.g. stats.job1.json).
+
+@verbatim
++u[file] Writes statistics to file (no file: standard error stream)
+-u No statistics
+@endverbatim
+
+- The option w (write a trace of the timeline), default -w
+
+Records the timeline of parsing (lexing), opening archives, inflating
+compressed RIB, replaying macros (objects, archives), processing the
+requests, tessellation and hiding of the surfaces of all threads. The
+trace is written at the end in the Chrome trace event format (JSON),
+that can be viewed by chrome://tracing or Perfetto. Each thread keeps
+its last 262144 events. The frame jobs (+j) are included in the trace.
+
+@verbatim
++w[file] Writes the trace to file (no file: ribtool-trace.json)
+-w No trace
+@endverbatim
+
+- The option s (split attribute blocks into archives), default -s
+
+The top level attribute blocks (AttributeBegin/AttributeEnd in the
+world block) of at least the given size (in bytes of the output) are
+written to separate archive files. The main RIB reads them by
+Procedural "DelayedReadArchive" with the bound of their primitives,
+computed in the object space of the block, so a renderer can skip
+the blocks outside the view without parsing them. The archives are
+named prefix_n.rib (prefix_fm_n.rib within frame m), the default
+prefix is the name of the output file without extension. Blocks
+containing lights, motion blocks, object or archive definitions,
+declarations, conditionals, non affine transformations, displacements
+or primitives without a bound computed from their parameters (bicubic
+patches, cubic curves, blobbies) are not split. The number of archives
+is reported at the end.
+
+@verbatim
++s[n][/prefix/] Splits attribute blocks of at least n bytes (no number: 65536 bytes)
+-s Writes attribute blocks as they are
+@endverbatim
+
 - The option x (Extract frames)
 
 Extracts frames (using positive and negative lists). The
@@ -267,6 +350,14 @@ frames from FrameBegin to FrameEnd, as well as the RIB code
 in front of, between, and possibly after the frames will be
 written.
 
+ASCII RIB files (also gzipped ones) are read using a frame index, the
+frames not extracted are skipped without parsing them. The index is
+built by scanning the file. An index stored beside the RIB file
+(filename.ribidx, see option y) is reused as long as the RIB file is
+not changed. The standard input and binary RIB files are parsed and the
+requests of the frames not extracted are skipped. Frames are not
+processed concurrently (option j) if x is used.
+
 Use no x option to let RIBtool write all frames. -x can
 also be used for extraction.
 
@@ -279,6 +370,17 @@ also be used for extraction.
 		 or missing, all frames will be written
 @endverbatim
 
+- The option y (store the frame index), default -y
+
+The frame index built to extract frames (option x) can be stored beside
+the RIB file (filename.ribidx) to be reused by the next extraction. By
+default, no file is written to the directories of the RIB files.
+
+@verbatim
++y Stores the frame index beside the RIB file
+-y Does not store the frame index
+@endverbatim
+
 - The option v (RIB variable extraction while parsing option used) +v
 
 For compatibility the option "rib" "string varsubst" can
@@ -369,11 +471,81 @@ while parsing. This needs more considerations...
 +e Caches RIB archives.
 -e Doesn't cache RIB archives.
 @endverbatim
+
+- The option t (threads for lexing), default -t
+
+Large ASCII RIB files can be lexed using several threads. The
+file is read into memory, split into chunks at lines starting with
+a request and the chunks are lexed concurrently. The requests are
+processed in sequence afterwards. Binary RIB files, files that
+cannot be split and files smaller than four chunks (1MB) are parsed
+sequentially. The threads are kept and used again for the next file.
+
+@verbatim
++t[0-9] Lexes RIB files using threads (no number: 4 threads)
+-t Parses RIB files sequentially
+@endverbatim
+
+- The option q (queue for asynchronous parsing), default -q
+
+ASCII RIB files can be read and lexed by a separate thread while
+the requests are processed. The thread queues the lexed parts of the
+file and waits if the queue is full. The requests are processed
+by the main thread as before, only reading and lexing run concurrently.
+Binary parts are parsed sequentially. The option t takes precedence.
+
+@verbatim
++q[0-9] Parses RIB files asynchronously (no number: queue of 4 parts)
+-q Parses RIB files sequentially
+@endverbatim
+
+- The option j (frame jobs), default -j
+
+The frame blocks of an ASCII RIB file can be processed concurrently.
+The file is read into memory and split at the frame blocks, each
+frame block and each part of the file between the frame blocks is
+processed by a thread in its own rendering context. The state needed
+by a frame (declarations, options, archives and objects) is set up by
+processing the parts outside of the frame blocks in front of the
+frame without output. Of the frames in front, only the declarations
+are processed, and the light and object handles they
+create are skipped, frames reading archives or containing conditionals
+are processed completely without output. The outputs are written in
+the sequence of the file, as are the error messages of the parts.
+Light and object handles are numbered as in sequential processing.
+Binary RIB files, files without frames, files with parts too large
+to be set up repeatedly, the standard input and binary output are
+processed sequentially. No files are written beside the RIB file,
+the outputs of the frames are buffered in temporary files.
+
+@verbatim
++j[0-9] Processes frames concurrently (no number: 4 threads)
+-j Processes frames sequentially
+@endverbatim
 */
 
 
 #include "ricpp/ricppbridge/ricppbridge.h"
 
+#ifndef _RICPP_RIBPARSER_RIBLEXER_H
+#include "ricpp/ribparser/riblexer.h"
+#endif // _RICPP_RIBPARSER_RIBLEXER_H
+
+#ifndef _RICPP_TOOLS_MEMORYBUFFERS_H
+#include "ricpp/tools/memorybuffers.h"
+#endif // _RICPP_TOOLS_MEMORYBUFFERS_H
+
+#ifndef _RICPP_TOOLS_ENV_H
+#include "ricpp/tools/env.h"
+#endif // _RICPP_TOOLS_ENV_H
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
 using namespace RiCPP;
 
 CRiCPPBridge ri;    ///< The bridge to the rendering context
@@ -382,6 +554,105 @@ RtInt yes = 1;      ///< Used as parmeter for IRi::control() (positive)
 RtInt no = 0;       ///< Used as parmeter for IRi::control() (negative)
 RtInt special = -1; ///< Used as parmeter for IRi::control() (special behaviour)
 
+RtInt frameThreads = 0;     ///< Number of threads to process frames (option j), 0: sequential processing
+bool outputStarted = false; ///< A file was processed before, header and version are written
+std::string outputName;     ///< Name of the output file (option o), empty for stdout
+
+bool extractFrames = false;   ///< A positive list of frames is given (option +x)
+std::string framesList;       ///< Positive list of frames (option +x)
+std::string excludeFramesList; ///< Negative list of frames (option -x)
+
+
+/** @brief A control set by an option, also used for the contexts processing frames (option j).
+ */
+struct SControl {
+	std::string m_name;  ///< Name of the control, e.g. "ribwriter".
+	std::string m_token; ///< Token of the parameter, e.g. "binary-output".
+	RtInt m_value;       ///< Value of the parameter.
+	RtFloat m_floatValue; ///< Value of the parameter, if m_isFloat.
+	bool m_isFloat;      ///< The parameter is a float (m_floatValue).
+	std::string m_stringValue; ///< Value of the parameter, if m_isString.
+	bool m_isString;     ///< The parameter is a string (m_stringValue).
+};
+
+std::vector<SControl> controls; ///< The controls in the sequence they are set.
+
+
+/** @brief Sets a control and remembers it.
+ *  @param name Name of the control.
+ *  @param token Token of the parameter.
+ *  @param value Value of the parameter.
+ */
+void setControl(const char *name, const char *token, RtInt value)
+{
+	SControl c;
+	c.m_name = name;
+	c.m_token = token;
+	c.m_value = value;
+	c.m_floatValue = 0;
+	c.m_isFloat = false;
+	c.m_isString = false;
+	controls.push_back(c);
+	ri.control(name, token, &value, RI_NULL);
+}
+
+
+/** @brief Sets a float control and remembers it.
+ *  @param name Name of the control.
+ *  @param token Token of the parameter.
+ *  @param value Value of the parameter.
+ */
+void setControl(const char *name, const char *token, RtFloat value)
+{
+	SControl c;
+	c.m_name = name;
+	c.m_token = token;
+	c.m_value = 0;
+	c.m_floatValue = value;
+	c.m_isFloat = true;
+	c.m_isString = false;
+	controls.push_back(c);
+	ri.control(name, token, &value, RI_NULL);
+}
+
+
+/** @brief Sets a string control and remembers it.
+ *  @param name Name of the control.
+ *  @param token Token of the parameter.
+ *  @param value Value of the parameter.
+ */
+void setControl(const char *name, const char *token, const std::string &value)
+{
+	SControl c;
+	c.m_name = name;
+	c.m_token = token;
+	c.m_value = 0;
+	c.m_floatValue = 0;
+	c.m_isFloat = false;
+	c.m_stringValue = value;
+	c.m_isString = true;
+	controls.push_back(c);
+	RtString str = c.m_stringValue.c_str();
+	ri.control(name, token, &str, RI_NULL);
+}
+
+
+/** @brief Gets the value of a control last set.
+ *  @param name Name of the control.
+ *  @param token Token of the parameter.
+ *  @param defValue Value if the control was not set.
+ *  @return The value of the control.
+ */
+RtInt controlValue(const char *name, const char *token, RtInt defValue)
+{
+	std::vector<SControl>::reverse_iterator i;
+	for ( i = controls.rbegin(); i != controls.rend(); ++i ) {
+		if ( (*i).m_name == name && (*i).m_token == token && !(*i).m_isFloat && !(*i).m_isString )
+			return (*i).m_value;
+	}
+	return defValue;
+}
+
 
 /** @brief Prints the usage of RIBtool.
  */
@@ -404,8 +675,33 @@ void printUsage()
 	std::cout << "   p Procedurals (experimental)" << std::endl;
 	std::cout << "+b binary output" << std::endl;
 	std::cout << "-b ascii output (default)" << std::endl;
+	std::cout << "+a/bound/ binary output of P, N and st as fixed-point numbers within an" << std::endl;
+	std::cout << "   absolute error bound, e.g. +a/0.001/, or relative to the largest" << std::endl;
+	std::cout << "   magnitude of an array, e.g. +a/r0.0001/" << std::endl;
+	std::cout << "-a IEEE floats in binary output (default)" << std::endl;
 	std::cout << "+i inhibits (supresses) output" << std::endl;
 	std::cout << "-i enables output (default)" << std::endl;
+	std::cout << "+t[0-9] lexes RIB files using threads (default 4)" << std::endl;
+	std::cout << "-t parses RIB files sequentially (default)" << std::endl;
+	std::cout << "+q[0-9] parses RIB files asynchronously (default queue of 4)" << std::endl;
+	std::cout << "-q parses RIB files synchronously (default)" << std::endl;
+	std::cout << "+j[0-9] processes frames concurrently (default 4 threads)" << std::endl;
+	std::cout << "-j processes frames sequentially (default)" << std::endl;
+	std::cout << "+d[n] deduplicates geometry of at least n bytes by ObjectInstance (default 256)" << std::endl;
+	std::cout << "-d writes geometry as it is (default)" << std::endl;
+	std::cout << "+u[file] writes statistics of the requests (calls, parameter bytes, times," << std::endl;
+	std::cout << "   triangles) at the end, file.csv as CSV, else JSON (default: stderr)" << std::endl;
+	std::cout << "-u no statistics (default)" << std::endl;
+	std::cout << "+w[file] writes a trace of the timeline (Chrome trace format) at the end" << std::endl;
+	std::cout << "   (default: ribtool-trace.json)" << std::endl;
+	std::cout << "-w no trace (default)" << std::endl;
+	std::cout << "+s[n][/prefix/] writes attribute blocks of at least n bytes (default 65536)" << std::endl;
+	std::cout << "   to archives prefix_n.rib, read by Procedural \"DelayedReadArchive\"" << std::endl;
+	std::cout << "-s writes attribute blocks as they are (default)" << std::endl;
+	std::cout << "+x/list/ extracts the frames of the list, e.g. +x/-2,7,9-11,15-/" << std::endl;
+	std::cout << "-x/list/ writes all frames except the ones of the list" << std::endl;
+	std::cout << "+y stores the frame index beside the RIB file (filename.ribidx)" << std::endl;
+	std::cout << "-y does not store the frame index (default)" << std::endl;
 }
 
 
@@ -424,8 +720,8 @@ void printError(const char *msg)
 void inhibit(int aSwitch)
 {
 	assert ( aSwitch == '-' || aSwitch == '+' );
-	RtInt *param = (aSwitch == '-') ? &no : &yes; // '-' means no, '+' means yes
-	ri.control("ribwriter", "suppress-output", param, RI_NULL);
+	RtInt param = (aSwitch == '-') ? no : yes; // '-' means no, '+' means yes
+	setControl("ribwriter", "suppress-output", param);
 }
 
 
@@ -435,8 +731,118 @@ void inhibit(int aSwitch)
 void binary(int aSwitch)
 {
 	assert ( aSwitch == '-' || aSwitch == '+' );
-	RtInt *param = (aSwitch == '-') ? &no : &yes; // '-' means no, '+' means yes
-	ri.control("ribwriter", "binary-output", param, RI_NULL);
+	RtInt param = (aSwitch == '-') ? no : yes; // '-' means no, '+' means yes
+	setControl("ribwriter", "binary-output", param);
+}
+
+
+/** @brief Option 'a' error bound (accuracy) of fixed-point float arrays.
+ *  @param aSwitch '+' or '-'
+ *  @param bound The bound, prefixed by 'r' if relative, e.g. "0.001" or "r0.0001".
+ */
+void fixedPoint(int aSwitch, const std::string &bound)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtFloat absBound = 0, relBound = 0;
+	if ( aSwitch == '+' ) {
+		bool relative = !bound.empty() && bound[0] == 'r';
+		RtFloat value = (RtFloat)atof(bound.c_str() + (relative ? 1 : 0));
+		if ( value <= 0 ) {
+			std::string msg = "Sorry, the error bound has to be a positive number ";
+			msg += bound;
+			printError(msg.c_str());
+			return;
+		}
+		(relative ? relBound : absBound) = value;
+	}
+	setControl("ribwriter", "fixedpoint-abs", absBound);
+	setControl("ribwriter", "fixedpoint-rel", relBound);
+}
+
+
+/** @brief Option 'd' deduplicate geometry.
+ *  @param aSwitch '+' or '-'
+ *  @param minSize Minimal size of the primitives in bytes.
+ */
+void dedup(int aSwitch, RtInt minSize)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtInt param = (aSwitch == '-') ? 0 : minSize; // '-' means no deduplication
+	setControl("ribwriter", "dedup", param);
+}
+
+
+/** @brief Option 'u' usage statistics of the requests.
+ *  @param aSwitch '+' or '-'
+ *  @param filename File for the statistics ("-" or empty: standard error stream).
+ */
+void statistics(int aSwitch, const std::string &filename)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtInt param = (aSwitch == '-') ? no : yes; // '-' means no, '+' means yes
+	setControl("statistics", "enable", param);
+	setControl("statistics", "file", std::string(aSwitch == '-' ? "" : (filename.empty() ? "-" : filename.c_str())));
+}
+
+
+/** @brief Option 'w' writes a trace of the timeline.
+ *  @param aSwitch '+' or '-'
+ *  @param filename File for the trace (empty: ribtool-trace.json).
+ */
+void trace(int aSwitch, const std::string &filename)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtInt param = (aSwitch == '-') ? no : yes; // '-' means no, '+' means yes
+	setControl("trace", "enable", param);
+	setControl("trace", "file", std::string(aSwitch == '-' ? "" : (filename.empty() ? "ribtool-trace.json" : filename.c_str())));
+}
+
+
+/** @brief Option 's' split attribute blocks into archives.
+ *  @param aSwitch '+' or '-'
+ *  @param minSize Minimal size of the attribute blocks in bytes.
+ *  @param prefix Prefix of the archive files, empty: derived from the output file.
+ */
+void splitArchives(int aSwitch, RtInt minSize, const std::string &prefix)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtInt param = (aSwitch == '-') ? 0 : minSize; // '-' means no splitting
+	if ( param > 0 ) {
+		// Frame jobs write to temporary files, so the prefix is always set
+		std::string name(prefix);
+		if ( name.empty() ) {
+			name = outputName.empty() ? "ribtool" : outputName;
+			std::string::size_type pos = name.find_last_of("./\\");
+			if ( pos != std::string::npos && name[pos] == '.' )
+				name.erase(pos);
+		}
+		setControl("ribwriter", "split-prefix", name);
+	}
+	setControl("ribwriter", "split-archives", param);
+}
+
+
+/** @brief Option 't' threads for lexing.
+ *  @param aSwitch '+' or '-'
+ *  @param nThreads Number of threads to use.
+ */
+void threads(int aSwitch, RtInt nThreads)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtInt param = (aSwitch == '-') ? 0 : nThreads; // '-' means sequential parsing
+	setControl("rib", "parallel-lexing", param);
+}
+
+
+/** @brief Option 'q' queue for asynchronous parsing.
+ *  @param aSwitch '+' or '-'
+ *  @param nChunks Maximal number of queued chunks.
+ */
+void queue(int aSwitch, RtInt nChunks)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	RtInt param = (aSwitch == '-') ? 0 : nChunks; // '-' means synchronous parsing
+	setControl("rib", "async-parsing", param);
 }
 
 
@@ -448,32 +854,32 @@ void postpone(int aSwitch, int argument)
 {
 	assert ( aSwitch == '-' || aSwitch == '+' );
 
-	RtInt *param = (aSwitch == '-') ? &no : &yes; // '-' means no, '+' means yes
-	RtInt *paramFile = (aSwitch == '-') ? &no : &special; // The file itself should be read
+	RtInt param = (aSwitch == '-') ? no : yes; // '-' means no, '+' means yes
+	RtInt paramFile = (aSwitch == '-') ? no : special; // The file itself should be read
 
 	// Process the argument
 	switch(argument) {
 		case 0: // all
-			ri.control("ribwriter", "postpone-inline-archives", param, RI_NULL);
-			ri.control("ribwriter", "postpone-file-archives", paramFile, RI_NULL);
-			ri.control("ribwriter", "postpone-objects", param, RI_NULL);
-			ri.control("ribwriter", "postpone-procedurals", param, RI_NULL);
+			setControl("ribwriter", "postpone-inline-archives", param);
+			setControl("ribwriter", "postpone-file-archives", paramFile);
+			setControl("ribwriter", "postpone-objects", param);
+			setControl("ribwriter", "postpone-procedurals", param);
 			break;
 
 		case 'a': // Inline archives (ArchiveBegin, ArchiveEnd, ReadArchive)
-			ri.control("ribwriter", "postpone-inline-archives", param, RI_NULL);
+			setControl("ribwriter", "postpone-inline-archives", param);
 			break;
 
 		case 'f': // RIB files (ReadArchive)
-			ri.control("ribwriter", "postpone-file-archives", paramFile, RI_NULL);
+			setControl("ribwriter", "postpone-file-archives", paramFile);
 			break;
 
 		case 'o': // Objects (ObjectBegin, ObjectEnd, ObjectInstance)
-			ri.control("ribwriter", "postpone-objects", param, RI_NULL);
+			setControl("ribwriter", "postpone-objects", param);
 			break;
 
 		case 'p': // Procedurals (delayedReadArchive, RunProgramm, DynamicLoad)
-			ri.control("ribwriter", "postpone-procedurals", param, RI_NULL);
+			setControl("ribwriter", "postpone-procedurals", param);
 			break;
 
 		default: // not recognized
@@ -486,6 +892,467 @@ void postpone(int aSwitch, int argument)
 	}
 }
 
+/** @brief Option 'j' threads for frame jobs.
+ *  @param aSwitch '+' or '-'
+ *  @param nThreads Number of threads to use.
+ */
+void frameJobs(int aSwitch, RtInt nThreads)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	frameThreads = (aSwitch == '-') ? 0 : nThreads; // '-' means sequential processing
+}
+
+
+/** @brief Option 'y' store the frame index.
+ *  @param aSwitch '+' or '-'
+ */
+void frameIndex(int aSwitch)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	setControl("rib", "store-frame-index", (aSwitch == '-') ? no : yes);
+}
+
+
+/** @brief Option 'x' extract frames.
+ *  @param aSwitch '+' (positive list) or '-' (negative list)
+ *  @param list The list of frames, e.g. "-2,7,9-11,15-".
+ */
+void frames(int aSwitch, const std::string &list)
+{
+	assert ( aSwitch == '-' || aSwitch == '+' );
+	std::string &frameList = (aSwitch == '-') ? excludeFramesList : framesList;
+	if ( aSwitch == '+' )
+		extractFrames = true;
+	if ( list.empty() )
+		return;
+	if ( !frameList.empty() )
+		frameList += ",";
+	frameList += list;
+}
+
+
+/** @brief Reads a RIB file or the standard input, selects the frames of option x.
+ *  @param filename Name of the RIB file, RI_NULL for standard input.
+ */
+void readArchive(RtString filename)
+{
+	RtToken tokens[2];
+	RtPointer params[2];
+	RtString lists[2];
+	RtInt n = 0;
+
+	if ( extractFrames ) {
+		lists[n] = framesList.c_str();
+		tokens[n] = "string frames";
+		params[n] = &lists[n];
+		++n;
+	}
+	if ( !excludeFramesList.empty() ) {
+		lists[n] = excludeFramesList.c_str();
+		tokens[n] = "string excludeframes";
+		params[n] = &lists[n];
+		++n;
+	}
+	ri.readArchiveV(filename, 0, n, tokens, params);
+}
+
+
+static const char *FRAME_MARKER = "ribtool-segment"; ///< Comment in front of a segment processed by a frame job.
+static const char *HANDLES_MARKER = "ribtool-handles"; ///< Comment with the numbers of light and object handles created by a skipped frame block.
+
+
+/** @brief A segment of a RIB file, processed in its own context (option j).
+ */
+struct SFrameJob {
+	std::string m_output; ///< Temporary file with the output.
+	std::string m_errors; ///< The error messages.
+	bool m_collect;       ///< Collect the error messages (set at the start of the segment).
+	bool m_done;          ///< The segment is processed.
+
+	inline SFrameJob() : m_collect(false), m_done(false) {}
+};
+
+
+/** @brief The frame jobs of a RIB file (option j).
+ */
+struct SFrameJobs {
+	char *m_data;                        ///< The RIB file.
+	std::string m_directory;             ///< Directory of the RIB file (with separator), relative archive names are resolved there.
+	std::vector<unsigned long> m_bounds; ///< Segments of the RIB file, @see CRibFrameSplitter::split()
+	std::vector<CRibFrameSplitter::SSegmentHandles> m_handles; ///< Numbered handles created by the segments.
+	std::vector<SFrameJob> m_jobs;       ///< The jobs, one for each segment.
+	unsigned long m_next;                ///< Next job to process.
+	unsigned long m_written;             ///< Number of jobs written to the output.
+	unsigned long m_window;              ///< Number of jobs that can be processed in advance.
+	std::mutex m_mutex;                  ///< Guards the jobs.
+	std::condition_variable m_cond;      ///< Signals a processed or a written job.
+};
+
+
+std::mutex contextMutex; ///< Serializes creation and destruction of the frame contexts.
+
+
+/** @brief Error handler of a frame job, collects the messages.
+ */
+class CFrameErrorHandler : public IErrorHandler {
+	SFrameJob *m_job; ///< The job.
+public:
+	inline CFrameErrorHandler(SFrameJob &job) : m_job(&job) {}
+	inline virtual IErrorHandler *duplicate() const { return new CFrameErrorHandler(*this); }
+	inline virtual RtToken name() const { return "ribtoolframeerrors"; }
+	inline virtual const IErrorHandler &singleton() const { return *this; }
+
+	virtual RtVoid operator()(IRi &ri, RtInt code, RtInt severity, RtString message) const
+	{
+		if ( !m_job->m_collect )
+			return;
+		std::ostringstream str;
+		str << "# *** Code " <<
+			"[" << code << "] " << CRiCPPErrMsg::errorMessage(code) <<
+			", severity [" << severity << "] " << CRiCPPErrMsg::errorSeverity(severity) << ", '" <<
+			noNullStr(message) << "'" << std::endl;
+		m_job->m_errors += str.str();
+	}
+};
+
+
+/** @brief Archive callback of a frame job, recognizes the comments inserted by processFrameJob().
+ *
+ *  Skips the handle numbers of the frame blocks not processed by the job, so
+ *  that the handles are numbered like in sequential processing, and
+ *  enables the output at the start of the segment.
+ */
+class CFrameArchiveCallback : public IArchiveCallback {
+	SFrameJob *m_job;         ///< The job.
+	RtInt m_suppressOutput;   ///< Value of the suppress-output control within the segment.
+public:
+	inline CFrameArchiveCallback(SFrameJob &job, RtInt suppressOutput) : m_job(&job), m_suppressOutput(suppressOutput) {}
+	inline virtual IArchiveCallback *duplicate() const { return new CFrameArchiveCallback(*this); }
+	inline virtual RtToken name() const { return "ribtoolframecallback"; }
+	inline virtual const IArchiveCallback &singleton() const { return *this; }
+
+	virtual RtVoid operator()(IRi &ri, RtToken type, RtString line) const
+	{
+		if ( m_job->m_collect || !line )
+			return;
+		size_t len = strlen(HANDLES_MARKER);
+		if ( !strncmp(line, HANDLES_MARKER, len) ) {
+			RtInt lights = 0, objects = 0;
+			std::istringstream str(line+len);
+			str >> lights >> objects;
+			RtToken tokens[2] = {"skip-light-handles", "skip-object-handles"};
+			RtPointer params[2] = {&lights, &objects};
+			ri.controlV("state", 2, tokens, params);
+		} else if ( !strcmp(line, FRAME_MARKER) ) {
+			m_job->m_collect = true;
+			RtToken token = "suppress-output";
+			RtInt value = m_suppressOutput;
+			RtPointer param = &value;
+			ri.controlV("ribwriter", 1, &token, &param);
+		}
+	}
+};
+
+
+/** @brief Counts the line breaks like CRibParser.
+ *  @param begin Start of the text.
+ *  @param end End of the text.
+ *  @return Number of line breaks.
+ */
+long countLines(const char *begin, const char *end)
+{
+	long lines = 0;
+	char last = 0;
+	for ( ; begin != end; ++begin ) {
+		if ( (*begin == '\n' && last != '\r') || (*begin == '\r' && last != '\n') )
+			++lines;
+		last = *begin;
+	}
+	return lines;
+}
+
+
+/** @brief Tests if a segment of a RIB file contains only white spaces.
+ *  @param jobs The frame jobs.
+ *  @param idx Index of the segment.
+ *  @return true, the segment contains only white spaces (no output).
+ */
+bool blankSegment(const SFrameJobs &jobs, unsigned long idx)
+{
+	const char *p = jobs.m_data + jobs.m_bounds[idx];
+	const char *end = jobs.m_data + jobs.m_bounds[idx+1];
+	for ( ; p != end && isspace((unsigned char)*p); ++p );
+	return p == end;
+}
+
+
+/** @brief Processes a segment of a RIB file in its own context.
+ *
+ *  The segments outside the frame blocks in front of the segment are
+ *  processed without output to set up the state. A comment marks the start
+ *  of the segment (see CFrameArchiveCallback), line breaks are inserted
+ *  to preserve the line numbers of the segment.
+ *
+ *  @param jobs The frame jobs.
+ *  @param idx Index of the segment.
+ */
+void processFrameJob(SFrameJobs &jobs, unsigned long idx)
+{
+	SFrameJob &job = jobs.m_jobs[idx];
+	const char *begin = jobs.m_data + jobs.m_bounds[idx];
+	const char *end = jobs.m_data + jobs.m_bounds[idx+1];
+
+	if ( blankSegment(jobs, idx) ) {
+		// Only white spaces, no output
+		job.m_collect = true;
+		return;
+	}
+
+	std::string input;
+	if ( idx > 0 ) {
+		for ( unsigned long i = 0; i < idx; i += 2 ) {
+			input.append(jobs.m_data + jobs.m_bounds[i], jobs.m_data + jobs.m_bounds[i+1]);
+			input += '\n';
+			if ( i+1 >= idx )
+				continue;
+			const CRibFrameSplitter::SSegmentHandles &frame = jobs.m_handles[i+1];
+			if ( !frame.m_exact ) {
+				// The state left by the frame is not known, the frame is processed without output
+				input.append(jobs.m_data + jobs.m_bounds[i+1], jobs.m_data + jobs.m_bounds[i+2]);
+				input += '\n';
+				continue;
+			}
+			for ( std::vector<unsigned long>::size_type g = 0; g+1 < frame.m_globals.size(); g += 2 ) {
+				input.append(jobs.m_data + frame.m_globals[g], jobs.m_data + frame.m_globals[g+1]);
+				input += '\n';
+			}
+			if ( frame.m_lights || frame.m_objects ) {
+				std::ostringstream str;
+				str << "#" << HANDLES_MARKER << " " << frame.m_lights << " " << frame.m_objects << "\n";
+				input += str.str();
+			}
+		}
+		long lines = countLines(input.data(), input.data() + input.size()) + 2;
+		long segmentLine = countLines(jobs.m_data, begin);
+		if ( lines < segmentLine )
+			input.append((size_t)(segmentLine - lines), '\n');
+		input += "\n#";
+		input += FRAME_MARKER;
+		input += "\n";
+	} else {
+		job.m_collect = true;
+	}
+	input.append(begin, end);
+
+	// The input is read from memory, the output is written to a temporary file
+	std::string inputName(CMemoryBuffers::uniqueName("ribtool-frame"));
+	CRiCPPBridge *bridge = 0;
+	CFrameErrorHandler errorHandler(job);
+	CFrameArchiveCallback callback(job, controlValue("ribwriter", "suppress-output", 0));
+
+	if ( !CEnv::createTempFile(job.m_output, "ribtool", ".rib") ) {
+		job.m_collect = true;
+		errorHandler(ri, RIE_SYSTEM, RIE_ERROR, "Cannot create the temporary file of a frame job.");
+		return;
+	}
+	// The buffer refers to the input, that is kept until the buffer is unregistered
+	CMemoryBuffers::registerBuffer(inputName.c_str(), input.data(), (std::streamsize)input.size());
+	inputName.insert(0, "memory:");
+
+	try {
+
+		{
+			std::lock_guard<std::mutex> lock(contextMutex);
+			bridge = new CRiCPPBridge;
+			bridge->errorHandler(errorHandler);
+			const char *outfile = job.m_output.c_str();
+			bridge->begin("ribwriter", RI_FILE, &outfile, RI_NULL);
+		}
+
+		std::vector<SControl>::iterator i;
+		for ( i = controls.begin(); i != controls.end(); ++i ) {
+			if ( (*i).m_name == "trace" ) {
+				// The tracer is shared by the contexts, the trace is written by the main context
+				continue;
+			}
+			if ( (*i).m_isFloat ) {
+				bridge->control((*i).m_name.c_str(), (*i).m_token.c_str(), &(*i).m_floatValue, RI_NULL);
+			} else if ( (*i).m_isString ) {
+				std::string value((*i).m_stringValue);
+				if ( (*i).m_name == "statistics" && (*i).m_token == "file" && value != "-" ) {
+					// Each job writes its own statistics, name.jobN.ext
+					std::ostringstream name;
+					std::string::size_type pos = value.find_last_of("./\\");
+					if ( pos == std::string::npos || value[pos] != '.' )
+						pos = value.size();
+					name << value.substr(0, pos) << ".job" << idx << value.substr(pos);
+					value = name.str();
+				}
+				RtString str = value.c_str();
+				bridge->control((*i).m_name.c_str(), (*i).m_token.c_str(), &str, RI_NULL);
+			} else
+				bridge->control((*i).m_name.c_str(), (*i).m_token.c_str(), &(*i).m_value, RI_NULL);
+		}
+		// The header is written by the first segment with output
+		if ( outputStarted || idx > 1 || (idx == 1 && !blankSegment(jobs, 0)) ) {
+			bridge->control("ribwriter", "skip-headers", &yes, "skip-version", &yes, RI_NULL);
+		}
+		if ( idx > 0 ) {
+			bridge->control("ribwriter", "suppress-output", &yes, RI_NULL);
+		}
+		// Relative archive names are resolved in the directory of the RIB file
+		std::string directory(jobs.m_directory);
+		RtString directoryStr = CFilepathConverter::convertToInternal(directory).c_str();
+		bridge->control("state", "base-directory", &directoryStr, RI_NULL);
+
+		bridge->readArchive(inputName.c_str(), &callback, RI_NULL);
+
+		{
+			std::lock_guard<std::mutex> lock(contextMutex);
+			bridge->end();
+			delete bridge;
+			bridge = 0;
+		}
+	} catch ( ... ) {
+		job.m_collect = true;
+		errorHandler(ri, RIE_SYSTEM, RIE_ERROR, "Unknown error while processing a frame job.");
+		std::lock_guard<std::mutex> lock(contextMutex);
+		if ( bridge )
+			delete bridge;
+	}
+
+	CMemoryBuffers::unregisterBuffer(inputName.c_str());
+}
+
+
+/** @brief Worker thread, processes the frame jobs.
+ *  @param jobs The frame jobs.
+ */
+void frameWorker(SFrameJobs *jobs)
+{
+	std::unique_lock<std::mutex> lock(jobs->m_mutex);
+	while ( jobs->m_next < jobs->m_jobs.size() ) {
+		if ( jobs->m_next >= jobs->m_written + jobs->m_window ) {
+			// Wait for the output
+			jobs->m_cond.wait(lock);
+			continue;
+		}
+		unsigned long idx = jobs->m_next++;
+
+		lock.unlock();
+		processFrameJob(*jobs, idx);
+		lock.lock();
+
+		jobs->m_jobs[idx].m_done = true;
+		jobs->m_cond.notify_all();
+	}
+}
+
+
+/** @brief Reads a RIB file processing the frames concurrently (option j).
+ *  @param filename Name of the RIB file.
+ *  @return false, if the file has to be read sequentially.
+ */
+bool readArchiveFrames(const std::string &filename)
+{
+	if ( frameThreads < 2 || controlValue("ribwriter", "binary-output", 0) != 0 )
+		return false;
+	if ( extractFrames || !excludeFramesList.empty() )
+		return false;
+
+	std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+	if ( !in )
+		return false;
+
+	std::vector<char> data;
+	const std::streamsize blockSize = 1<<16;
+	while ( in ) {
+		size_t oldSize = data.size();
+		data.resize(oldSize + (size_t)blockSize);
+		in.read(&data[oldSize], blockSize);
+		data.resize(oldSize + (size_t)in.gcount());
+	}
+	in.close();
+	if ( data.empty() )
+		return false;
+
+	SFrameJobs jobs;
+	jobs.m_data = &data[0];
+	std::string::size_type pos = filename.find_last_of("/\\");
+	jobs.m_directory = pos == std::string::npos ? std::string("./") : filename.substr(0, pos+1);
+	if ( !CRibFrameSplitter::split(&data[0], (unsigned long)data.size(), (unsigned int)frameThreads, jobs.m_bounds, &jobs.m_handles) || jobs.m_bounds.size() < 4 ) {
+		// Binary or no frames
+		return false;
+	}
+	// Each job replays the segments outside the frames in front of it and
+	// the state left by the frames, the file is processed sequentially if
+	// this costs more than the threads can gain.
+	unsigned long long work = 0, prefix = 0;
+	for ( unsigned long idx = 0; idx+1 < jobs.m_bounds.size(); ++idx ) {
+		unsigned long long segment = jobs.m_bounds[idx+1] - jobs.m_bounds[idx];
+		work += prefix + segment;
+		if ( (idx & 1) == 0 || !jobs.m_handles[idx].m_exact ) {
+			prefix += segment;
+		} else {
+			const std::vector<unsigned long> &globals = jobs.m_handles[idx].m_globals;
+			for ( std::vector<unsigned long>::size_type g = 0; g+1 < globals.size(); g += 2 )
+				prefix += globals[g+1] - globals[g];
+		}
+	}
+	if ( work >= (unsigned long long)data.size() * (unsigned long long)frameThreads )
+		return false;
+
+	jobs.m_jobs.resize(jobs.m_bounds.size()-1);
+	jobs.m_next = 0;
+	jobs.m_written = 0;
+	jobs.m_window = 2*(unsigned long)frameThreads;
+
+	// The header and version are written by the first job
+	ri.control("ribwriter", "skip-headers", &yes, "skip-version", &yes, RI_NULL);
+
+	std::vector<std::thread> threads;
+	for ( RtInt i = 0; i < frameThreads && i < (RtInt)jobs.m_jobs.size(); ++i ) {
+		threads.push_back(std::thread(frameWorker, &jobs));
+	}
+
+	// Write the outputs in sequence
+	for ( unsigned long idx = 0; idx < jobs.m_jobs.size(); ++idx ) {
+		SFrameJob &job = jobs.m_jobs[idx];
+		{
+			std::unique_lock<std::mutex> lock(jobs.m_mutex);
+			while ( !job.m_done )
+				jobs.m_cond.wait(lock);
+		}
+
+		if ( !job.m_output.empty() ) {
+			std::ifstream result(job.m_output.c_str(), std::ios::in | std::ios::binary);
+			std::string text;
+			char buf[1<<16];
+			while ( result ) {
+				result.read(buf, sizeof(buf));
+				text.append(buf, (size_t)result.gcount());
+			}
+			result.close();
+			remove(job.m_output.c_str());
+			if ( !text.empty() )
+				ri.archiveRecordV(RI_VERBATIM, text.c_str());
+		}
+		std::cerr << job.m_errors;
+
+		std::lock_guard<std::mutex> lock(jobs.m_mutex);
+		jobs.m_written = idx+1;
+		std::string().swap(job.m_errors);
+		jobs.m_cond.notify_all();
+	}
+
+	for ( std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i ) {
+		(*i).join();
+	}
+
+	return true;
+}
+
+
 /** @brief Process command.
  *  @retval i Input/Output of current argument index.
  *  @param argc number of arguments @a argv.
@@ -554,6 +1421,132 @@ void command(int &i, int argc, char * const argv[])
 				inhibit(aSwitch);
 			break;
 
+			case 't': // threads for lexing
+			{
+				RtInt nThreads = 4;
+				if ( isdigit(arg[cnt]) ) {
+					nThreads = arg[cnt++]-'0';
+				}
+				threads(aSwitch, nThreads);
+			}
+			break;
+
+			case 'q': // queue for asynchronous parsing
+			{
+				RtInt nChunks = 4;
+				if ( isdigit(arg[cnt]) ) {
+					nChunks = arg[cnt++]-'0';
+				}
+				queue(aSwitch, nChunks);
+			}
+			break;
+
+			case 'j': // frame jobs
+			{
+				RtInt nThreads = 4;
+				if ( isdigit(arg[cnt]) ) {
+					nThreads = arg[cnt++]-'0';
+				}
+				frameJobs(aSwitch, nThreads);
+			}
+			break;
+
+			case 'a': // accuracy, fixed-point error bound
+			{
+				std::string bound;
+				if ( arg[cnt] == '/' ) {
+					const char *end = strchr(&arg[cnt+1], '/');
+					if ( !end ) {
+						std::string msg = "Sorry, missing '/' at the end of the error bound ";
+						msg += arg;
+						printError(msg.c_str());
+						return;
+					}
+					bound.assign(&arg[cnt+1], end);
+					cnt = (int)(end - arg) + 1;
+				}
+				fixedPoint(aSwitch, bound);
+			}
+			break;
+
+			case 'd': // deduplicate geometry
+			{
+				RtInt minSize = 256;
+				if ( isdigit(arg[cnt]) ) {
+					minSize = 0;
+					while ( isdigit(arg[cnt]) ) {
+						minSize = minSize * 10 + (arg[cnt++]-'0');
+					}
+				}
+				dedup(aSwitch, minSize);
+			}
+			break;
+
+			case 'u': // usage statistics of the requests
+			{
+				// Like +o, the rest of the argument is the file name
+				std::string filename(&arg[cnt]);
+				cnt += (int)filename.size();
+				statistics(aSwitch, filename);
+			}
+			break;
+
+			case 'w': // write a trace of the timeline
+			{
+				// Like +o, the rest of the argument is the file name
+				std::string filename(&arg[cnt]);
+				cnt += (int)filename.size();
+				trace(aSwitch, filename);
+			}
+			break;
+
+			case 's': // split attribute blocks into archives
+			{
+				RtInt minSize = 65536;
+				if ( isdigit(arg[cnt]) ) {
+					minSize = 0;
+					while ( isdigit(arg[cnt]) ) {
+						minSize = minSize * 10 + (arg[cnt++]-'0');
+					}
+				}
+				std::string prefix;
+				if ( arg[cnt] == '/' ) {
+					const char *end = strchr(&arg[cnt+1], '/');
+					if ( !end ) {
+						std::string msg = "Sorry, missing '/' at the end of the archive prefix ";
+						msg += arg;
+						printError(msg.c_str());
+						return;
+					}
+					prefix.assign(&arg[cnt+1], end);
+					cnt = (int)(end - arg) + 1;
+				}
+				splitArchives(aSwitch, minSize, prefix);
+			}
+			break;
+
+			case 'x': // extract frames
+			{
+				std::string list;
+				if ( arg[cnt] == '/' ) {
+					const char *end = strchr(&arg[cnt+1], '/');
+					if ( !end ) {
+						std::string msg = "Sorry, missing '/' at the end of the list of frames ";
+						msg += arg;
+						printError(msg.c_str());
+						return;
+					}
+					list.assign(&arg[cnt+1], end);
+					cnt = (int)(end - arg) + 1;
+				}
+				frames(aSwitch, list);
+			}
+			break;
+
+			case 'y': // store the frame index
+				frameIndex(aSwitch);
+			break;
+
 			default: // unknown
 			{
 				std::string msg = "Sorry, unrecogniced command sequence ";
@@ -627,6 +1620,7 @@ int main(int argc, char * const argv[])
 	ri.errorHandler(ri.errorPrint());
 	
 	const char *outfile = outfilename.empty() ? RI_NULL : outfilename.c_str();
+	outputName = outfilename;
 
 	// Start the ribwriter - maybe integrate renderers to the options later
 	ri.begin("ribwriter", RI_FILE, &outfile, "compress", &compression, RI_NULL );
@@ -654,7 +1648,8 @@ int main(int argc, char * const argv[])
 		if ( len == 1 && arg[0]=='-' ) {
 
 			// Reads from standard input
-			ri.readArchive(RI_NULL, 0, RI_NULL);
+			readArchive(RI_NULL);
+			outputStarted = true;
 
 		} else {
 			filename = noNullStr(argv[i]);
@@ -665,14 +1660,16 @@ int main(int argc, char * const argv[])
 			}
 
 			// Reads from the file
-			ri.readArchive(filename.c_str(), 0, RI_NULL);
+			if ( !readArchiveFrames(filename) )
+				readArchive(filename.c_str());
+			outputStarted = true;
 
 		}
 	}
 
 	// If no filename was found, process the standard input
 	if ( !fileWasFound ) {
-		ri.readArchive(RI_NULL, 0, RI_NULL);
+		readArchive(RI_NULL);
 	}
 
 	// Closes the context
@@ -37,6 +37,8 @@
 #include "ricpp/tools/env.h"
 #endif // _RICPP_TOOLS_ENV_H
 
+#include <sstream>
+
 #ifdef _DEBUG
 // #define _TRACE_ARCHIVE
 #define _TRACE
@@ -121,6 +123,15 @@ writePrefix(); \
 obj.writeRIB(*m_writer); \
 }
 
+#define TEST_WRITE_GEOMETRY(CANINSTANCE) { \
+if ( !postTestValid() ) \
+	return; \
+if ( !writeDeduplicated(obj, CANINSTANCE) ) { \
+	writePrefix(); \
+	obj.writeRIB(*m_writer); \
+} \
+}
+
 #define TEST_WRITE_RIB_ARCHIVE_REC(AFLAG) { \
 if ( !postTestValid() ) \
 	return; \
@@ -165,6 +176,12 @@ CRibWriter::CRibWriter()
 	RI_INDENT_STRING = RI_NULL;
 	RI_SUPPRESS_OUTPUT = RI_NULL;
 	RI_BINARY_OUTPUT = RI_NULL;
+	RI_FIXEDPOINT_ABS = RI_NULL;
+	RI_FIXEDPOINT_REL = RI_NULL;
+	RI_FIXEDPOINT_VARS = RI_NULL;
+	RI_DEDUP = RI_NULL;
+	RI_SPLIT_ARCHIVES = RI_NULL;
+	RI_SPLIT_PREFIX = RI_NULL;
 
 	RI_QUAL_POSTPONE_PROCEDURALS = RI_NULL;
 	RI_QUAL_POSTPONE_OBJECTS = RI_NULL;
@@ -176,6 +193,12 @@ CRibWriter::CRibWriter()
 	RI_QUAL_INDENT_STRING = RI_NULL;
 	RI_QUAL_SUPPRESS_OUTPUT = RI_NULL;
 	RI_QUAL_BINARY_OUTPUT = RI_NULL;
+	RI_QUAL_FIXEDPOINT_ABS = RI_NULL;
+	RI_QUAL_FIXEDPOINT_REL = RI_NULL;
+	RI_QUAL_FIXEDPOINT_VARS = RI_NULL;
+	RI_QUAL_DEDUP = RI_NULL;
+	RI_QUAL_SPLIT_ARCHIVES = RI_NULL;
+	RI_QUAL_SPLIT_PREFIX = RI_NULL;
 
 	
 	m_postponeProcedural = 1;
@@ -187,6 +210,23 @@ CRibWriter::CRibWriter()
 	m_indent = true;
 	m_indentString = "    ";
 	m_binary = false;
+	m_fixedPointAbs = 0;
+	m_fixedPointRel = 0;
+	m_fixedPointVars = "P N st";
+
+	m_dedupMinSize = 0;
+	m_dedupObjects = 0;
+	m_dedupInstances = 0;
+	m_dedupSaved = 0;
+
+	m_splitMinSize = 0;
+	m_splitMainWriter = 0;
+	m_splitValid = false;
+	m_splitHasBound = false;
+	memset(m_splitBound, 0, sizeof(RtBound));
+	m_splitNumber = 0;
+	m_splitArchives = 0;
+	m_splitBytes = 0;
 
 	m_controlSuppressOutput = false;
 	m_suppressOutput = false;
@@ -199,6 +239,10 @@ CRibWriter::CRibWriter()
 
 CRibWriter::~CRibWriter()
 {
+	if ( m_splitMainWriter ) {
+		if ( m_writer ) delete m_writer;
+		m_writer = m_splitMainWriter;
+	}
 	if ( m_writer ) delete m_writer;
 	if ( m_buffer ) delete m_buffer;
 }
@@ -244,6 +288,12 @@ void CRibWriter::defaultDeclarations()
 	RI_INDENT_STRING =            renderState()->tokFindCreate("indent-string");
 	RI_SUPPRESS_OUTPUT =          renderState()->tokFindCreate("suppress-output");
 	RI_BINARY_OUTPUT =            renderState()->tokFindCreate("binary-output");
+	RI_FIXEDPOINT_ABS =           renderState()->tokFindCreate("fixedpoint-abs");
+	RI_FIXEDPOINT_REL =           renderState()->tokFindCreate("fixedpoint-rel");
+	RI_FIXEDPOINT_VARS =          renderState()->tokFindCreate("fixedpoint-vars");
+	RI_DEDUP =                    renderState()->tokFindCreate("dedup");
+	RI_SPLIT_ARCHIVES =           renderState()->tokFindCreate("split-archives");
+	RI_SPLIT_PREFIX =             renderState()->tokFindCreate("split-prefix");
 	
 	// Declarations
 	RI_COMPRESS =                 renderState()->declare("compress", "constant integer", true);
@@ -258,8 +308,391 @@ void CRibWriter::defaultDeclarations()
 	RI_QUAL_INDENT_STRING =            renderState()->declare("Control:ribwriter:indent-string",            "constant string",  true);
 	RI_QUAL_SUPPRESS_OUTPUT =          renderState()->declare("Control:ribwriter:suppress-output",          "constant integer", true);
 	RI_QUAL_BINARY_OUTPUT =            renderState()->declare("Control:ribwriter:binary-output",            "constant integer", true);
+	RI_QUAL_FIXEDPOINT_ABS =           renderState()->declare("Control:ribwriter:fixedpoint-abs",           "constant float",   true);
+	RI_QUAL_FIXEDPOINT_REL =           renderState()->declare("Control:ribwriter:fixedpoint-rel",           "constant float",   true);
+	RI_QUAL_FIXEDPOINT_VARS =          renderState()->declare("Control:ribwriter:fixedpoint-vars",          "constant string",  true);
+	RI_QUAL_DEDUP =                    renderState()->declare("Control:ribwriter:dedup",                    "constant integer", true);
+	RI_QUAL_SPLIT_ARCHIVES =           renderState()->declare("Control:ribwriter:split-archives",           "constant integer", true);
+	RI_QUAL_SPLIT_PREFIX =             renderState()->declare("Control:ribwriter:split-prefix",             "constant string",  true);
+}
+
+void CRibWriter::setupWriter()
+{
+	if ( !m_writer )
+		return;
+	m_writer->ascii(!m_binary);
+	m_writer->fixedPoint(m_fixedPointAbs, m_fixedPointRel);
+	m_writer->fixedPointVars(m_fixedPointVars.c_str());
+}
+
+
+bool CRibWriter::writeDeduplicated(const CRManInterfaceCall &obj, bool canInstance)
+{
+	if ( m_dedupMinSize <= 0 || !canInstance || !m_writer )
+		return false;
+
+	// Only primitives of the world block, an object definition within an archive,
+	// object, motion or conditional block would be lost outside. Geometry of
+	// area lights is also left as it is.
+	if ( renderState()->areaLightSourceDepth() > 0 )
+		return false;
+	bool inWorld = false;
+	for ( CModeStack::const_iterator i = renderState()->modesBegin(); i != renderState()->modesEnd(); ++i ) {
+		switch ( *i ) {
+			case MODE_WORLD:
+				inWorld = true;
+				break;
+			case MODE_MOTION:
+			case MODE_ARCHIVE:
+			case MODE_OBJECT:
+			case MODE_IF:
+			case MODE_ELSE_IF:
+			case MODE_ELSE:
+				return false;
+			default:
+				break;
+		}
+	}
+	if ( !inWorld )
+		return false;
+
+	std::stringbuf rib;
+	{
+		CRibElementsWriter ribWriter(&rib, m_noNotification);
+		obj.writeRIB(ribWriter);
+	}
+	const std::string &str = rib.str();
+	if ( str.size() < (std::string::size_type)m_dedupMinSize )
+		return false;
+
+	// FNV-1a and a multiplicative hash (sdbm)
+	TypeDedupKey key(14695981039346656037ULL, (unsigned long long)str.size());
+	for ( std::string::const_iterator i = str.begin(); i != str.end(); ++i ) {
+		unsigned char c = (unsigned char)*i;
+		key.first = (key.first ^ c) * 1099511628211ULL;
+		key.second = c + (key.second << 6) + (key.second << 16) - key.second;
+	}
+
+	SDedupEntry &entry = m_dedupEntries[key];
+	if ( entry.m_count == 0 ) {
+		entry.m_rib = str;
+	} else if ( entry.m_rib != str ) {
+		// Hash collision, different geometry is written as it is
+		return false;
+	}
+	++entry.m_count;
+
+	unsigned long long start = m_writer->bytesWritten();
+	if ( entry.m_handle.empty() ) {
+		std::ostringstream handle;
+		handle << "ribwriter.dedup." << m_dedupObjects+1;
+
+		// The object is defined at the third occurrence, if the next
+		// instance saves more than the ObjectBegin, ObjectEnd and
+		// ObjectInstance requests cost (estimated by their ASCII form)
+		bool define = entry.m_count >= 3;
+		if ( define ) {
+			std::stringbuf overhead;
+			{
+				CRibElementsWriter ribWriter(&overhead, m_noNotification);
+				CRiObjectBegin().writeRIB(ribWriter, handle.str().c_str());
+				CRiObjectEnd().writeRIB(ribWriter);
+				CRiObjectInstance().writeRIB(ribWriter, handle.str().c_str());
+				CRiObjectInstance().writeRIB(ribWriter, handle.str().c_str());
+			}
+			define = str.size() > overhead.str().size();
+		}
+
+		if ( !define ) {
+			writePrefix();
+			obj.writeRIB(*m_writer);
+			if ( entry.m_count == 1 )
+				entry.m_size = m_writer->bytesWritten() - start;
+			return true;
+		}
+
+		++m_dedupObjects;
+		entry.m_handle = handle.str();
+		if ( m_splitMainWriter ) {
+			// The definition is lost if the block is moved to an archive
+			m_splitDedupKeys.push_back(key);
+		}
+
+		writePrefix();
+		CRiObjectBegin().writeRIB(*m_writer, entry.m_handle.c_str());
+		incNestingDepth();
+		writePrefix();
+		obj.writeRIB(*m_writer);
+		decNestingDepth();
+		writePrefix();
+		CRiObjectEnd().writeRIB(*m_writer);
+	}
+
+	writePrefix();
+	CRiObjectInstance().writeRIB(*m_writer, entry.m_handle.c_str());
+	++m_dedupInstances;
+	m_dedupSaved += (long long)entry.m_size - (long long)(m_writer->bytesWritten() - start);
+	return true;
+}
+
+
+void CRibWriter::reportDeduplication()
+{
+	if ( m_dedupInstances == 0 )
+		return;
+	ricppErrHandler().handleError(RIE_NOERROR, RIE_INFO,
+		"Geometry deduplication: %lu objects defined, %lu primitives instanced, %lld bytes saved",
+		m_dedupObjects, m_dedupInstances, m_dedupSaved);
+	m_dedupObjects = 0;
+	m_dedupInstances = 0;
+	m_dedupSaved = 0;
+}
+
+
+void CRibWriter::beginSplit()
+{
+	if ( !m_writer || m_splitMainWriter )
+		return;
+
+	m_splitMainWriter = m_writer;
+	m_writer = new CRibElementsWriter(&m_splitBuffer, *this);
+	m_writer->continueFrom(*m_splitMainWriter);
+
+	// A displacement can move the surface outside the bound of its primitives
+	const CTransformation &t = renderState()->curTransform();
+	m_splitValid = t.isValid() && noNullStr(renderState()->attributes().displacementName())[0] == 0;
+	// The inverse CTM multiplies column vectors, the bound corners are row vectors like for the CTM
+	m_splitInverse = t.getInverseCTM().getMatrix();
+	m_splitInverse.setPreMultiply(true);
+	m_splitHasBound = false;
+	memset(m_splitBound, 0, sizeof(RtBound));
+}
+
+
+void CRibWriter::testSplit(const CRManInterfaceCall &aRequest)
+{
+	if ( !m_splitValid )
+		return;
+
+	switch ( aRequest.interfaceIdx() ) {
+		// Blocks and comments
+		case REQ_ATTRIBUTE_BEGIN:
+		case REQ_ATTRIBUTE_END:
+		case REQ_TRANSFORM_BEGIN:
+		case REQ_TRANSFORM_END:
+		case REQ_SOLID_BEGIN:
+		case REQ_SOLID_END:
+		case REQ_ARCHIVE_RECORD:
+		// Attributes, that are local to the block
+		case REQ_ATTRIBUTE:
+		case REQ_COLOR:
+		case REQ_OPACITY:
+		case REQ_SURFACE:
+		case REQ_ATMOSPHERE:
+		case REQ_INTERIOR:
+		case REQ_EXTERIOR:
+		case REQ_TEXTURE_COORDINATES:
+		case REQ_SHADING_RATE:
+		case REQ_SHADING_INTERPOLATION:
+		case REQ_MATTE:
+		case REQ_BOUND:
+		case REQ_DETAIL:
+		case REQ_DETAIL_RANGE:
+		case REQ_GEOMETRIC_APPROXIMATION:
+		case REQ_GEOMETRIC_REPRESENTATION:
+		case REQ_ORIENTATION:
+		case REQ_REVERSE_ORIENTATION:
+		case REQ_SIDES:
+		case REQ_BASIS:
+		case REQ_TRIM_CURVE:
+		// Affine transformations
+		case REQ_IDENTITY:
+		case REQ_TRANSFORM:
+		case REQ_CONCAT_TRANSFORM:
+		case REQ_TRANSLATE:
+		case REQ_ROTATE:
+		case REQ_SCALE:
+		case REQ_SKEW:
+		case REQ_COORD_SYS_TRANSFORM:
+			return;
+		default:
+			break;
+	}
+
+	if ( !aRequest.boundable() || !renderState()->curTransform().isValid() ) {
+		// E.g. lights, declarations, motion and object blocks, unbounded primitives
+		m_splitValid = false;
+		return;
+	}
+
+	RtBound bound;
+	aRequest.getBounds(bound);
+
+	// Transforms the corners of the bound to the object space of the block
+	const CMatrix3D &ctm = renderState()->curTransform().getCTM();
+	for ( int i = 0; i < 8; ++i ) {
+		RtFloat p[3] = { bound[i&1], bound[2+((i>>1)&1)], bound[4+((i>>2)&1)] };
+		ctm.transformPoint(p[0], p[1], p[2]);
+		m_splitInverse.transformPoint(p[0], p[1], p[2]);
+		for ( int j = 0; j < 3; ++j ) {
+			if ( !m_splitHasBound || p[j] < m_splitBound[2*j] )
+				m_splitBound[2*j] = p[j];
+			if ( !m_splitHasBound || p[j] > m_splitBound[2*j+1] )
+				m_splitBound[2*j+1] = p[j];
+		}
+		m_splitHasBound = true;
+	}
 }
 
+
+void CRibWriter::endSplit(bool toArchive)
+{
+	if ( !m_splitMainWriter )
+		return;
+
+	delete m_writer; // Flushes to m_splitBuffer
+	m_writer = m_splitMainWriter;
+	m_splitMainWriter = 0;
+
+	const std::string &rib = m_splitBuffer.str();
+	std::string filename;
+	if ( toArchive && m_splitValid && m_splitHasBound &&
+	     rib.size() >= (std::string::size_type)m_splitMinSize &&
+	     writeSplitArchive(rib, filename) )
+	{
+		// Objects defined in the archive are not known in the main RIB
+		for ( std::vector<TypeDedupKey>::const_iterator i = m_splitDedupKeys.begin(); i != m_splitDedupKeys.end(); ++i ) {
+			m_dedupEntries[*i].m_handle.clear();
+		}
+
+		RtString args[1] = { filename.c_str() };
+		writePrefix();
+		m_writer->putRequest(REQ_PROCEDURAL);
+		m_writer->putBlank();
+		m_writer->putStringToken(RI_DELAYED_READ_ARCHIVE);
+		m_writer->putBlank();
+		m_writer->putArray(1, args);
+		m_writer->putBlank();
+		m_writer->putArray(m_splitBound);
+		m_writer->putNewLine();
+	} else {
+		m_writer->putRaw(rib.data(), (unsigned long)rib.size());
+	}
+
+	m_splitBuffer.str(std::string());
+	m_splitDedupKeys.clear();
+}
+
+
+bool CRibWriter::writeSplitArchive(const std::string &rib, std::string &filename)
+{
+	if ( !parserCallback() )
+		return false;
+
+	std::string prefix(m_splitPrefix);
+	if ( prefix.empty() ) {
+		if ( m_outputName.empty() ) {
+			prefix = "ribwriter";
+		} else {
+			prefix = m_outputName;
+			std::string::size_type pos = prefix.find_last_of("./\\");
+			if ( pos != std::string::npos && prefix[pos] == '.' )
+				prefix.erase(pos);
+		}
+	}
+
+	// Frame jobs write the frames in different contexts, so the frame number is part of the name
+	std::ostringstream name;
+	name << prefix;
+	for ( CModeStack::const_iterator i = renderState()->modesBegin(); i != renderState()->modesEnd(); ++i ) {
+		if ( *i == MODE_FRAME ) {
+			name << "_f" << renderState()->frameNumber();
+			break;
+		}
+	}
+	name << "_" << ++m_splitNumber << ".rib";
+	filename = name.str();
+
+	CFrontStreambuf buffer(parserCallback()->protocolHandlers());
+	CUri fileuri;
+	fileuri.encodeFilepath(filename.c_str(), "file");
+	if ( !buffer.open(fileuri, std::ios_base::out|std::ios_base::binary, 0) ) {
+		ricppErrHandler().handleError(RIE_NOFILE, RIE_ERROR, "Could not open archive '%s' for the attribute block", filename.c_str());
+		return false;
+	}
+	buffer.sputn(rib.data(), (std::streamsize)rib.size());
+	buffer.close();
+
+	// DelayedReadArchive resolves relative names beside the main RIB
+	std::string::size_type dirEnd = m_outputName.find_last_of("/\\");
+	if ( dirEnd != std::string::npos ) {
+		std::string dir(m_outputName, 0, dirEnd+1);
+		if ( filename.compare(0, dir.size(), dir) == 0 ) {
+			filename.erase(0, dir.size());
+		} else {
+			CFilepath path(filename.c_str());
+			if ( path.isRelative() )
+				filename = path.fullpath();
+		}
+	}
+
+	++m_splitArchives;
+	m_splitBytes += rib.size();
+	return true;
+}
+
+
+void CRibWriter::reportSplitArchives()
+{
+	if ( m_splitArchives == 0 )
+		return;
+	ricppErrHandler().handleError(RIE_NOERROR, RIE_INFO,
+		"Archive splitting: %lu attribute blocks written to archives (%llu bytes)",
+		m_splitArchives, m_splitBytes);
+	m_splitArchives = 0;
+	m_splitBytes = 0;
+}
+
+
+void CRibWriter::processRequest(CRManInterfaceCall *aRequest, bool immediately)
+{
+	if ( !aRequest || (m_splitMinSize <= 0 && !m_splitMainWriter) ) {
+		TypeParent::processRequest(aRequest, immediately);
+		return;
+	}
+
+	// aRequest can be deleted by TypeParent::processRequest()
+	EnumRequests req = aRequest->interfaceIdx();
+
+	if ( req == REQ_FRAME_BEGIN ) {
+		m_splitNumber = 0;
+	}
+
+	if ( m_splitMainWriter ) {
+		if ( req == REQ_BEGIN || req == REQ_END || req == REQ_FRAME_END || req == REQ_WORLD_END ) {
+			// Missing AttributeEnd
+			endSplit(false);
+		} else {
+			testSplit(*aRequest);
+		}
+	} else if ( req == REQ_ATTRIBUTE_BEGIN && !immediately &&
+	            renderState()->curMode() == MODE_WORLD &&
+	            renderState()->areaLightSourceDepth() == 0 &&
+	            !renderState()->recordMode() && renderState()->executeConditionial() &&
+	            postTestValid() )
+	{
+		beginSplit();
+	}
+
+	TypeParent::processRequest(aRequest, immediately);
+
+	if ( m_splitMainWriter && renderState()->curMode() == MODE_WORLD ) {
+		// End of the block or AttributeBegin failed
+		endSplit(req == REQ_ATTRIBUTE_END);
+	}
+}
+
+
 void CRibWriter::writePrefix(bool isArchiveRecord)
 {
 	/** @todo move formatting to CRibElementsWriter */
@@ -312,7 +745,30 @@ RtVoid CRibWriter::doProcess(CRiControl &obj)
 				RtInt intval;
 				if ( (*i).get(0, intval) ) {
 					m_binary = intval != 0;
-					m_writer->ascii(!m_binary);
+					setupWriter();
+				}
+			} else if ( (*i).matches(QUALIFIER_CONTROL, RI_RIBWRITER, RI_FIXEDPOINT_ABS) ) {
+				if ( (*i).get(0, m_fixedPointAbs) ) {
+					setupWriter();
+				}
+			} else if ( (*i).matches(QUALIFIER_CONTROL, RI_RIBWRITER, RI_FIXEDPOINT_REL) ) {
+				if ( (*i).get(0, m_fixedPointRel) ) {
+					setupWriter();
+				}
+			} else if ( (*i).matches(QUALIFIER_CONTROL, RI_RIBWRITER, RI_FIXEDPOINT_VARS) ) {
+				RtString strval = 0;
+				if ( (*i).get(0, strval) ) {
+					m_fixedPointVars = noNullStr(strval);
+					setupWriter();
+				}
+			} else if ( (*i).matches(QUALIFIER_CONTROL, RI_RIBWRITER, RI_DEDUP) ) {
+				(*i).get(0, m_dedupMinSize);
+			} else if ( (*i).matches(QUALIFIER_CONTROL, RI_RIBWRITER, RI_SPLIT_ARCHIVES) ) {
+				(*i).get(0, m_splitMinSize);
+			} else if ( (*i).matches(QUALIFIER_CONTROL, RI_RIBWRITER, RI_SPLIT_PREFIX) ) {
+				RtString strval = 0;
+				if ( (*i).get(0, strval) ) {
+					m_splitPrefix = noNullStr(strval);
 				}
 			}
 		}
@@ -345,15 +801,17 @@ RtVoid CRibWriter::version()
 
 RtVoid CRibWriter::postProcess(CRiBegin &obj)
 {
-	if ( m_buffer ) delete m_buffer;
-	m_buffer = 0;
+	// The writer writes its buffered output to m_buffer
 	if ( m_writer ) delete m_writer;
 	m_writer = 0;
+	if ( m_buffer ) delete m_buffer;
+	m_buffer = 0;
 	
 	nestingDepth(0);
 
 	m_cmd = "";
 	m_nativepath = "";
+	m_outputName = "";
 
 	RtInt compress = 0;
 	std::string filename;
@@ -403,6 +861,7 @@ RtVoid CRibWriter::postProcess(CRiBegin &obj)
 		}
 
 		if ( filename.size() > 0 ) {
+			m_outputName = filename;
 			m_buffer = new CFrontStreambuf(parserCallback()->protocolHandlers());
 			if ( !m_buffer ) {
 				return;
@@ -417,7 +876,7 @@ RtVoid CRibWriter::postProcess(CRiBegin &obj)
 				// Error
 				return;
 			}
-			m_writer->ascii(!m_binary);
+			setupWriter();
 		}
 	}
 	
@@ -429,13 +888,17 @@ RtVoid CRibWriter::postProcess(CRiBegin &obj)
 			// Error
 			return;
 		}
-		m_writer->ascii(!m_binary);
+		setupWriter();
 	}
 
 }
 
 RtVoid CRibWriter::postProcess(CRiEnd &obj)
 {
+	reportDeduplication();
+	m_dedupEntries.clear();
+	reportSplitArchives();
+
 	if ( m_writer ) delete m_writer;
 	m_writer = 0;
 	if ( m_buffer ) {
@@ -502,6 +965,9 @@ RtVoid CRibWriter::postProcess(CRiWorldBegin &obj)
 
 RtVoid CRibWriter::postProcess(CRiWorldEnd &obj)
 {
+	// Objects defined within the world block are gone
+	m_dedupEntries.clear();
+
 	if ( !postTestValid() )
 		return;
 
@@ -1061,83 +1527,83 @@ TEST_WRITE_RIB
 
 
 RtVoid CRibWriter::postProcess(CRiPolygon &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiGeneralPolygon &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiPointsPolygons &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiPointsGeneralPolygons &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiPatch &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(obj.type() != RI_BICUBIC)
 
 
 RtVoid CRibWriter::postProcess(CRiPatchMesh &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(obj.type() != RI_BICUBIC)
 
 
 RtVoid CRibWriter::postProcess(CRiNuPatch &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(false)
 
 
 RtVoid CRibWriter::postProcess(CRiSubdivisionMesh &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiHierarchicalSubdivisionMesh &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiSphere &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiCone &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiCylinder &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiHyperboloid &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiParaboloid &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiDisk &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiTorus &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiPoints &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiCurves &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(obj.type() != RI_CUBIC)
 
 
 RtVoid CRibWriter::postProcess(CRiBlobby &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::postProcess(CRiGeometry &obj)
-TEST_WRITE_RIB
+TEST_WRITE_GEOMETRY(true)
 
 
 RtVoid CRibWriter::doProcess(CRiProcedural &obj)
@@ -46,6 +46,57 @@ using namespace RiCPP;
 
 // -----------------------------------------------------------------------------
 
+/** @brief Integer blocks offered to CParameter::set() by the current thread.
+ */
+static thread_local std::vector<IntBlock_type> offeredInts;
+
+/** @brief Float blocks offered to CParameter::set() by the current thread.
+ */
+static thread_local std::vector<FloatBlock_type> offeredFloats;
+
+void CParameterValueBlocks::offer(const IntBlock_type &block)
+{
+	if ( block && !block->empty() )
+		offeredInts.push_back(block);
+}
+
+void CParameterValueBlocks::offer(const FloatBlock_type &block)
+{
+	if ( block && !block->empty() )
+		offeredFloats.push_back(block);
+}
+
+void CParameterValueBlocks::withdraw()
+{
+	offeredInts.clear();
+	offeredFloats.clear();
+}
+
+IntBlock_type CParameterValueBlocks::findInts(RtPointer data, unsigned long n)
+{
+	std::vector<IntBlock_type>::const_iterator i;
+	for ( i = offeredInts.begin(); i != offeredInts.end(); ++i ) {
+		if ( (*i)->size() == n && static_cast<const void *>(&(**i)[0]) == data )
+			return *i;
+	}
+	return IntBlock_type();
+}
+
+FloatBlock_type CParameterValueBlocks::findFloats(RtPointer data, unsigned long n)
+{
+	std::vector<FloatBlock_type>::const_iterator i;
+	for ( i = offeredFloats.begin(); i != offeredFloats.end(); ++i ) {
+		if ( (*i)->size() == n && static_cast<const void *>(&(**i)[0]) == data )
+			return *i;
+	}
+	return FloatBlock_type();
+}
+
+// -----------------------------------------------------------------------------
+
+const std::vector<RtInt> CParameter::ms_noInts;
+const std::vector<RtFloat> CParameter::ms_noFloats;
+
 void CParameter::copyStringPtr()
 {
 	m_stringPtrs.reserve(m_strings.size());
@@ -66,8 +117,8 @@ void CParameter::clear()
 	m_declaration = 0;
 	m_position = 0;
 
-	m_ints.clear();
-	m_floats.clear();
+	m_ints.reset();
+	m_floats.reset();
 	m_stringPtrs.clear();
 	m_strings.clear();
 	
@@ -113,6 +164,37 @@ CParameter &CParameter::operator=(const CParameter &p)
 }
 
 
+void CParameter::take(CParameter &p) noexcept
+{
+	if ( m_declaration && m_declaration->isInline() )
+		delete m_declaration;
+
+	// The inline declaration is owned by this parameter now
+	m_declaration = p.m_declaration;
+	p.m_declaration = 0;
+
+	m_position = p.m_position;
+	m_parameterName.swap(p.m_parameterName);
+
+	m_ints.swap(p.m_ints);
+	m_floats.swap(p.m_floats);
+
+	// The string buffers are taken over, so the pointers stay valid
+	m_strings.swap(p.m_strings);
+	m_stringPtrs.swap(p.m_stringPtrs);
+
+	p.clear();
+}
+
+
+CParameter &CParameter::operator=(CParameter &&p) noexcept
+{
+	if ( this != &p )
+		take(p);
+	return *this;
+}
+
+
 CParameter &CParameter::assignRemap(const CParameter &param, CDeclarationDictionary &newDict)
 {
 	if ( this == &param )
@@ -220,17 +302,16 @@ void CParameter::set(
 	if ( theData ) {
 		switch ( m_declaration->basicType() ) {
 			case BASICTYPE_INTEGER:
-				m_ints.clear();
-				m_ints.reserve(elems);
-				for (unsigned long cnt = 0; cnt < elems; ++cnt ) {
-					m_ints.push_back(((RtInt *)theData)[cnt]);
+				// Share the values, if the caller offered them as block
+				m_ints = CParameterValueBlocks::findInts(theData, elems);
+				if ( !m_ints ) {
+					m_ints.reset(new std::vector<RtInt>((RtInt *)theData, (RtInt *)theData + elems));
 				}
 				break;
 			case BASICTYPE_FLOAT:
-				m_floats.clear();
-				m_floats.reserve(elems);
-				for (unsigned long cnt = 0; cnt < elems; ++cnt ) {
-					m_floats.push_back(((RtFloat *)theData)[cnt]);
+				m_floats = CParameterValueBlocks::findFloats(theData, elems);
+				if ( !m_floats ) {
+					m_floats.reset(new std::vector<RtFloat>((RtFloat *)theData, (RtFloat *)theData + elems));
 				}
 				break;
 			case BASICTYPE_STRING:
@@ -268,13 +349,13 @@ RtPointer CParameter::valPtr()
 {
 	switch ( basicType() ) {
 		case BASICTYPE_INTEGER:
-			if ( m_ints.empty() )
+			if ( ints().empty() )
 				return 0;
-			return static_cast<RtPointer>(&m_ints[0]);
+			return static_cast<RtPointer>(const_cast<RtInt *>(&ints()[0]));
 		case BASICTYPE_FLOAT:
-			if ( m_floats.empty() )
+			if ( floats().empty() )
 				return 0;
-			return static_cast<RtPointer>(&m_floats[0]);
+			return static_cast<RtPointer>(const_cast<RtFloat *>(&floats()[0]));
 		case BASICTYPE_STRING:
 			if ( m_stringPtrs.empty() )
 				return 0;
@@ -288,9 +369,9 @@ IndexType CParameter::vectorSize() const
 {
 	switch ( basicType() ) {
 		case BASICTYPE_INTEGER:
-			return static_cast<unsigned long >(m_ints.size());
+			return static_cast<unsigned long >(ints().size());
 		case BASICTYPE_FLOAT:
-			return static_cast<unsigned long >(m_floats.size());
+			return static_cast<unsigned long >(floats().size());
 		case BASICTYPE_STRING:
 			return static_cast<unsigned long >(m_stringPtrs.size());
 		default:
@@ -302,18 +383,18 @@ bool CParameter::get(unsigned long pos, CValue &result) const
 {
 	switch ( basicType() ) {
 		case BASICTYPE_INTEGER:
-			if ( pos >= m_ints.size() ) {
+			if ( pos >= ints().size() ) {
 				result.clear();
 				return false;
 			}
-			result.set(m_ints[pos]);
+			result.set(ints()[pos]);
 			break;
 		case BASICTYPE_FLOAT:
-			if ( pos >= m_floats.size() ) {
+			if ( pos >= floats().size() ) {
 				result.clear();
 				return false;
 			}
-			result.set(m_floats[pos]);
+			result.set(floats()[pos]);
 			break;
 		case BASICTYPE_STRING:
 			if ( pos >= m_stringPtrs.size() ) {
@@ -331,17 +412,17 @@ bool CParameter::get(unsigned long pos, CValue &result) const
 
 bool CParameter::get(unsigned long pos, RtInt &result) const
 {
-	if ( basicType() != BASICTYPE_INTEGER || pos >= m_ints.size() )
+	if ( basicType() != BASICTYPE_INTEGER || pos >= ints().size() )
 		return false;
-	result = m_ints[pos];
+	result = ints()[pos];
 	return true;
 }
 
 bool CParameter::get(unsigned long pos, RtFloat &result) const
 {
-	if ( basicType() != BASICTYPE_FLOAT || pos >= m_floats.size() )
+	if ( basicType() != BASICTYPE_FLOAT || pos >= floats().size() )
 		return false;
-	result = m_floats[pos];
+	result = floats()[pos];
 	return true;
 }
 
@@ -367,7 +448,7 @@ void CParameter::extract(IndexType pos, std::vector<RtInt>::iterator &result) co
 	pos = es * pos;
 	unsigned long endPos  = pos+es;
 	for ( ;  pos < endPos; ++pos ) {
-		*result = m_ints[pos];
+		*result = ints()[pos];
 		result++;
 	}
 }
@@ -395,7 +476,7 @@ void CParameter::extract(IndexType pos, std::vector<RtFloat>::iterator &result)
 #ifdef _TRACE_EXTRACT
 		std::cout << "-- extract pos = " << pos << std::endl;
 #endif // _TRACE_EXTRACT
-		*result = m_floats[pos];
+		*result = floats()[pos];
 		result++;
 	}
 
@@ -584,7 +665,7 @@ void CParameterList::rebuild()
 	m_paramPtr.resize(0);
 
 	for (
-		std::list<CParameter>::iterator i = m_params.begin();
+		std::vector<CParameter>::iterator i = m_params.begin();
 		i != m_params.end();
 		++i )
 	{
@@ -605,8 +686,7 @@ void CParameterList::rebuild()
 void CParameterList::reset(const IParameterClasses &counts)
 {
 	m_valueCounts = counts;
-	m_params.resize(0);
-	m_paramMap.clear();
+	m_params.clear();
 	m_tokenPtr.resize(0);
 	m_paramPtr.resize(0);
 }
@@ -628,6 +708,31 @@ CParameterList &CParameterList::operator=(const CParameterList &params)
 }
 
 
+void CParameterList::take(CParameterList &params)
+{
+	if ( this == &params )
+		return;
+
+	m_valueCounts = params.m_valueCounts;
+
+	// The parameters keep their addresses, so the pointer vectors stay valid
+	m_params.swap(params.m_params);
+	m_tokenPtr.swap(params.m_tokenPtr);
+	m_paramPtr.swap(params.m_paramPtr);
+
+	params.m_params.clear();
+	params.m_tokenPtr.clear();
+	params.m_paramPtr.clear();
+}
+
+
+CParameterList &CParameterList::operator=(CParameterList &&params)
+{
+	take(params);
+	return *this;
+}
+
+
 void CParameterList::set(
 	const char *aQualifier, const char *aTable, 
 	const CParameterClasses &counts,
@@ -646,20 +751,17 @@ void CParameterList::add(
 	const CColorDescr &curColorDescr,
 	RtInt n, RtToken tokens[], RtPointer params[])
 {
+	if ( n > 0 )
+		m_params.reserve(m_params.size() + n);
+
 	for ( RtInt i = 0; i < n; ++i ) {
 		CParameter *param = get(tokens[i]);
 		if ( param ) {
 			erase(param);
 		}
 		try {
-			m_params.push_back(CParameter(aQualifier, aTable, tokens[i], params[i], i, m_valueCounts, dict, curColorDescr));
-			RtToken var = m_params.back().var(); // The unqualified variable name as key
-			assert(var);
-			if ( var )
-				m_paramMap[var] = &m_params.back();
-			RtToken token = m_params.back().token(); // The qualified variable name as key
-			if ( token != var )
-				m_paramMap[token] = &m_params.back();
+			m_params.emplace_back(aQualifier, aTable, tokens[i], params[i], i, m_valueCounts, dict, curColorDescr);
+			assert(m_params.back().var());
 		} catch(ExceptRiCPPError &) {
 			/// @todo Better throw, redesign the handling of parameters without types (previously defined parameters) to work without an exception.
 			// Consume Error, ignore illegal parameters
@@ -677,20 +779,17 @@ void CParameterList::add(const CParameterList &params)
 	
 	assert(m_valueCounts == params.m_valueCounts);
 
+	m_params.reserve(m_params.size() + params.size());
+
 	for (
 		const_iterator i = params.begin();
 		i != params.end();
 		++i )
 	{
 		if ( i->token() != RI_NULL ) {
+			// Values are shared, not copied
 			m_params.push_back(*i);
-			RtToken var = m_params.back().var(); // The unqualified variable name as key
-			assert(var);
-			if ( var )
-				m_paramMap[var] = &m_params.back();
-			RtToken token = m_params.back().token(); // The qualified variable name as key
-			if ( token != var )
-				m_paramMap[token] = &m_params.back();
+			assert(m_params.back().var());
 		}
 	}
 
@@ -700,9 +799,12 @@ void CParameterList::add(const CParameterList &params)
 
 CParameter *CParameterList::get(RtToken var)
 {
-	Map_type::iterator i = m_paramMap.find(var);
-	if ( i != m_paramMap.end() ) {
-		return i->second;
+	// Searched backwards, the last parameter with the name is found
+	for ( size_type i = m_params.size(); i > 0; --i ) {
+		CParameter &p = m_params[i-1];
+		if ( p.var() == var || p.token() == var ) {
+			return &p;
+		}
 	}
 	return 0;
 }
@@ -710,9 +812,11 @@ CParameter *CParameterList::get(RtToken var)
 
 const CParameter *CParameterList::get(RtToken var) const
 {
-	Map_type::const_iterator i = m_paramMap.find(var);
-	if ( i != m_paramMap.end() ) {
-		return i->second;
+	for ( size_type i = m_params.size(); i > 0; --i ) {
+		const CParameter &p = m_params[i-1];
+		if ( p.var() == var || p.token() == var ) {
+			return &p;
+		}
 	}
 	return 0;
 }
@@ -720,46 +824,27 @@ const CParameter *CParameterList::get(RtToken var) const
 
 bool CParameterList::erase(RtToken var)
 {
-	const CParameter *param = get(var);
-	if ( !param )
-		return false;
-
-	std::list<CParameter>::iterator i;
-	for ( i = m_params.begin(); i != m_params.end(); ++i ) {
-		if ( param == &(*i) ) {
-			m_paramMap.erase(param->token());
-			m_params.erase(i);
-			rebuild();
-			return true;
-		}
-	}
-
-	return false;
+	return erase(get(var));
 }
 
 
 bool CParameterList::erase(CParameter *param)
 {
-	if (!param )
+	if ( !param || m_params.empty() )
 		return false;
 
-	std::list<CParameter>::iterator i;
-	for ( i = m_params.begin(); i != m_params.end(); ++i ) {
-		if ( param == &(*i) ) {
-			m_paramMap.erase(param->token());
-			m_params.erase(i);
-			rebuild();
-			return true;
-		}
-	}
+	if ( param < &m_params.front() || param > &m_params.back() )
+		return false;
 
-	return false;
+	m_params.erase(m_params.begin() + (param - &m_params.front()));
+	rebuild();
+	return true;
 }
 
 
 bool CParameterList::hasColor() const
 {
-	std::list<CParameter>::const_iterator i;
+	std::vector<CParameter>::const_iterator i;
 	for ( i = m_params.begin(); i != m_params.end(); ++i ) {
 		if ( (*i).type() == TYPE_COLOR ) {
 			return true;
@@ -774,6 +859,7 @@ CParameterList &CParameterList::assignRemap(const CParameterList &params, CDecla
 		return *this;
 	
 	reset(params.parameterClasses());
+	m_params.reserve(params.size());
 	
 	for (
 		 const_iterator i = params.begin();
@@ -781,14 +867,8 @@ CParameterList &CParameterList::assignRemap(const CParameterList &params, CDecla
 		 ++i )
 	{
 		if ( i->token() != RI_NULL ) {
-			m_params.push_back(CParameter(*i, newDict));
-			RtToken var = m_params.back().var(); // The unqualified variable name as key
-			assert(var);
-			if ( var )
-				m_paramMap[var] = &m_params.back();
-			RtToken token = m_params.back().token(); // The qualified variable name as key
-			if ( token != var )
-				m_paramMap[token] = &m_params.back();
+			m_params.emplace_back(*i, newDict);
+			assert(m_params.back().var());
 		}
 	}
 	
@@ -796,10 +876,6 @@ CParameterList &CParameterList::assignRemap(const CParameterList &params, CDecla
 	
 	return *this;	
 }
-
-
-
-
 // ----------------------------------------------------------------------------
 
 
@@ -37,9 +37,17 @@
 #include "ricpp/ribparser/ribparser.h"
 #endif // _RICPP_RIBPARSER_RIBPARSER_H
 
+#ifndef _RICPP_TOOLS_ENV_H
+#include "ricpp/tools/env.h"
+#endif // _RICPP_TOOLS_ENV_H
+
 using namespace RiCPP;
 
 static const bool _DEF_CACHE_FILE_ARCHIVES=true;
+static const RtInt _DEF_PARALLEL_LEXING=0;
+static const RtInt _DEF_PARALLEL_LEXING_CHUNK=1<<18;
+static const RtInt _DEF_ASYNC_PARSING=0;
+static const bool _DEF_STORE_FRAME_INDEX=false;
 
 #ifdef _DEBUG
 // #define _TRACE
@@ -379,7 +387,8 @@ bool CRenderState::CIfExprParser::quotestring(
 bool CRenderState::CIfExprParser::calcvar(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	const unsigned char *sav = *str;
 	std::string retval;
@@ -393,18 +402,14 @@ bool CRenderState::CIfExprParser::calcvar(
 	
 	if ( case1 || case2 ) {
 		wss(str, retval);
-		if ( expr(str, retval, val) ) {
+		size_t nameNode;
+		if ( expr(str, retval, prog, nameNode) ) {
 			wss(str, retval);
 			if ( case1 ? match("}", str, retval) : match(")", str, retval) ) {
-				std::string strname;
-				val.get(strname);
-				if ( m_outer->getValue(val, strname.c_str()) ) {
-					result += retval;
-					return true;
-				}
-				// error: value strname not found
-				*str = sav;
-				return false;
+				aNode = prog.newNode(CIfExpr::OP_CALCVAR);
+				prog.node(aNode).m_args.push_back(nameNode);
+				result += retval;
+				return true;
 			}
 		}
 	} else 
@@ -416,9 +421,10 @@ bool CRenderState::CIfExprParser::calcvar(
 bool CRenderState::CIfExprParser::var(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
-	if ( calcvar(str, result, val) ) {
+	if ( calcvar(str, result, prog, aNode) ) {
 		return true;
 	}
 
@@ -428,37 +434,13 @@ bool CRenderState::CIfExprParser::var(
 	if ( match("$", str, strname) ) {
 		strname = "";
 		if ( name(str, strname) ) {
-			if ( m_outer->getValue(val, strname.c_str()) ) {
-				result += "$";
-				result += strname;
-				return true;
-			}
-			// error: value strname not found
-			*str = sav;
-			return false;
-		}
-	} /* else if ( match("${", str, strname) ) {
-	    // nonrecursive
-		strname = "";
-		unsigned char c;
-		while ( (c = la(str)) != '}' ) {
-			if ( !c ) {
-				// error variable name not closed
-				*str = sav;
-				return false;
-			}
-			advance(str, strname, 1);
-		}
-		if ( m_outer->getValue(val, strname.c_str()) ) {
-			result += "${";
+			aNode = prog.newNode(CIfExpr::OP_VAR);
+			prog.node(aNode).m_name = strname;
+			result += "$";
 			result += strname;
-			advance(str, result, 1); // '}'
 			return true;
 		}
-		// error: value strname not found
-		*str = sav;
-		return false;
-	} */
+	}
 
 	*str = sav;
 	return false;
@@ -468,15 +450,17 @@ bool CRenderState::CIfExprParser::var(
 bool CRenderState::CIfExprParser::varstr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
-	if ( var(str, result, val) ) {
+	if ( var(str, result, prog, aNode) ) {
 		return true;
 	}
 
 	std::string strval;
 	if ( quotestring(str, result, strval) ) {
-		val.set(strval.c_str());
+		aNode = prog.newNode(CIfExpr::OP_CONST);
+		prog.node(aNode).m_value.set(strval.c_str());
 		return true;
 	}
 
@@ -486,25 +470,27 @@ bool CRenderState::CIfExprParser::varstr(
 bool CRenderState::CIfExprParser::varstrlist(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
-	if ( !varstr(str, result, val) ) {
+	size_t node1;
+	if ( !varstr(str, result, prog, node1) ) {
 		return false;
 	}
 
-	int count = 1;
-	CValue val2;
+	wss(str, result);
+	size_t node2;
+	if ( !varstr(str, result, prog, node2) ) {
+		aNode = node1;
+		return true;
+	}
 
+	aNode = prog.newNode(CIfExpr::OP_STRLIST);
+	prog.node(aNode).m_args.push_back(node1);
 	do {
+		prog.node(aNode).m_args.push_back(node2);
 		wss(str, result);
-		if ( count > 1 ) {
-			// append string to val
-			std::string str;
-			val2.get(str);
-			val.append(str);
-		}
-		++count;
-	} while ( varstr(str, result, val2) );
+	} while ( varstr(str, result, prog, node2) );
 
 	return true;
 }
@@ -512,28 +498,34 @@ bool CRenderState::CIfExprParser::varstrlist(
 bool CRenderState::CIfExprParser::litvar(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
+	CValue val;
 	if ( number(str, result, val) ) {
+		aNode = prog.newNode(CIfExpr::OP_CONST);
+		prog.node(aNode).m_value = val;
 		wss(str, result);
 		return true;
 	}
 
 	if ( match_word("true", str, result) ) {
-		val.set(1);
+		aNode = prog.newNode(CIfExpr::OP_CONST);
+		prog.node(aNode).m_value.set(1);
 		wss(str, result);
 		return true;
 	}
 
 	if ( match_word("false", str, result) ) {
-		val.set(0);
+		aNode = prog.newNode(CIfExpr::OP_CONST);
+		prog.node(aNode).m_value.set(0);
 		wss(str, result);
 		return true;
 	}
 
-	if ( varstrlist(str, result, val) ) {
+	if ( varstrlist(str, result, prog, aNode) ) {
 		return true;
 	}
 
@@ -544,33 +536,36 @@ bool CRenderState::CIfExprParser::litvar(
 bool CRenderState::CIfExprParser::expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
-	return log_or_expr(str, result, val);
+	return log_or_expr(str, result, prog, aNode);
 }
 
 
 bool CRenderState::CIfExprParser::log_or_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 	
-	if ( log_and_expr(str, res, val) ) {
+	if ( log_and_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		while ( match("||", str, res) ) {
 			wss(str, res);
-			if ( !log_and_expr(str, res, val2) ) {
+			if ( !log_and_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			val = val || val2;
+			prog.appendOperand(chain, aNode, CIfExpr::OP_LOG_OR, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -585,23 +580,25 @@ bool CRenderState::CIfExprParser::log_or_expr(
 bool CRenderState::CIfExprParser::log_and_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( incl_or_expr(str, res, val) ) {
+	if ( incl_or_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		while ( match("&&", str, res) ) {
 			wss(str, res);
-			if ( !incl_or_expr(str, res, val2) ) {
+			if ( !incl_or_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			val = val && val2;
+			prog.appendOperand(chain, aNode, CIfExpr::OP_LOG_AND, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -615,23 +612,25 @@ bool CRenderState::CIfExprParser::log_and_expr(
 bool CRenderState::CIfExprParser::incl_or_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( excl_or_expr(str, res, val) ) {
+	if ( excl_or_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		while ( match_op("|", str, res) ) {
 			wss(str, res);
-			if ( !excl_or_expr(str, res, val2) ) {
+			if ( !excl_or_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			val |= val2;
+			prog.appendOperand(chain, aNode, CIfExpr::OP_OR, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -646,23 +645,25 @@ bool CRenderState::CIfExprParser::incl_or_expr(
 bool CRenderState::CIfExprParser::excl_or_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( and_expr(str, res, val) ) {
+	if ( and_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		while ( match("^", str, res) ) {
 			wss(str, res);
-			if ( !and_expr(str, res, val2) ) {
+			if ( !and_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			val ^= val2;
+			prog.appendOperand(chain, aNode, CIfExpr::OP_XOR, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -677,23 +678,25 @@ bool CRenderState::CIfExprParser::excl_or_expr(
 bool CRenderState::CIfExprParser::and_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( eq_expr(str, res, val) ) {
+	if ( eq_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		while ( match_op("&", str, res) ) {
 			wss(str, res);
-			if ( !eq_expr(str, res, val2) ) {
+			if ( !eq_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			val &= val2;
+			prog.appendOperand(chain, aNode, CIfExpr::OP_AND, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -708,29 +711,27 @@ bool CRenderState::CIfExprParser::and_expr(
 bool CRenderState::CIfExprParser::eq_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 	
-	if ( rel_expr(str, res, val) ) {
+	if ( rel_expr(str, res, prog, aNode) ) {
 		bool eq = false;
 		bool neq = false;
 		wss(str, res);
 		while ( (eq = match("==", str, res)) || (neq = match("!=", str, res)) ) {
 			wss(str, res);
-			if ( !rel_expr(str, res, val2) ) {
+			if ( !rel_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			if ( eq ) {
-				val = val == val2;
-			} else {
-				val = val != val2;
-			}
+			prog.appendOperand(chain, aNode, eq ? CIfExpr::OP_EQ : CIfExpr::OP_NEQ, node2);
 			wss(str, res);
 			eq = false;
 			neq = false;
@@ -747,15 +748,17 @@ bool CRenderState::CIfExprParser::eq_expr(
 bool CRenderState::CIfExprParser::rel_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( match_expr(str, res, val) ) {
+	if ( match_expr(str, res, prog, aNode) ) {
 		bool gt = false;
 		bool ge = false;
 		bool lt = false;
@@ -763,20 +766,20 @@ bool CRenderState::CIfExprParser::rel_expr(
 		wss(str, res);
 		while ( (ge = match(">=", str, res)) || (le = match("<=", str, res)) || (gt = match(">", str, res)) || (lt = match("<", str, res)) ) {
 			wss(str, res);
-			if ( !match_expr(str, res, val2) ) {
+			if ( !match_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
 			wss(str, res);
 			if ( gt ) {
-				val = val > val2;
+				prog.appendOperand(chain, aNode, CIfExpr::OP_GT, node2);
 			} else if ( ge ) {
-				val = val >= val2;
+				prog.appendOperand(chain, aNode, CIfExpr::OP_GE, node2);
 			} else if ( lt ) {
-				val = val < val2;
+				prog.appendOperand(chain, aNode, CIfExpr::OP_LT, node2);
 			} else {
 				// le
-				val = val <= val2;
+				prog.appendOperand(chain, aNode, CIfExpr::OP_LE, node2);
 			}
 			gt = false;
 			ge = false;
@@ -795,26 +798,25 @@ bool CRenderState::CIfExprParser::rel_expr(
 bool CRenderState::CIfExprParser::match_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( add_expr(str, res, val) ) {
+	if ( add_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		if ( match("=~", str, res) ) {
 			wss(str, res);
-			if ( !add_expr(str, res, val2) ) {
+			if ( !add_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			std::string s;
-			val2.get(s);
-			if ( val.matchedBy(s.c_str()) )
-				val.set(1);
+			prog.appendOperand(chain, aNode, CIfExpr::OP_MATCH, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -829,28 +831,27 @@ bool CRenderState::CIfExprParser::match_expr(
 bool CRenderState::CIfExprParser::add_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( mul_expr(str, res, val) ) {
+	if ( mul_expr(str, res, prog, aNode) ) {
 		bool add = false;
 		bool sub = false;
 		wss(str, res);
 		while ( (add = match("+", str, res)) || (sub = match("-", str, res)) ) {
 			wss(str, res);
-			if ( !mul_expr(str, res, val2) ) {
+			if ( !mul_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			if ( add )
-				val += val2;
-			else
-				val -= val2;
+			prog.appendOperand(chain, aNode, add ? CIfExpr::OP_ADD : CIfExpr::OP_SUB, node2);
 			wss(str, res);
 			add = false;
 			sub = false;
@@ -867,28 +868,27 @@ bool CRenderState::CIfExprParser::add_expr(
 bool CRenderState::CIfExprParser::mul_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( pow_expr(str, res, val) ) {
+	if ( pow_expr(str, res, prog, aNode) ) {
 		bool mul = false;
 		bool div = false;
 		wss(str, res);
 		while ( (mul = match_op("*", str, res)) || (div = match_op("/", str, res)) ) {
 			wss(str, res);
-			if ( !pow_expr(str, res, val2) ) {
+			if ( !pow_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			if ( mul )
-				val *= val2;
-			else
-				val /= val2;
+			prog.appendOperand(chain, aNode, mul ? CIfExpr::OP_MUL : CIfExpr::OP_DIV, node2);
 			wss(str, res);
 			mul = false;
 			div = false;
@@ -905,23 +905,25 @@ bool CRenderState::CIfExprParser::mul_expr(
 bool CRenderState::CIfExprParser::pow_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
-	CValue val2;
+	size_t chain = CIfExpr::npos;
+	size_t node2;
 
-	if ( unary_expr(str, res, val) ) {
+	if ( unary_expr(str, res, prog, aNode) ) {
 		wss(str, res);
 		while ( match("**", str, res) ) {
 			wss(str, res);
-			if ( !unary_expr(str, res, val2) ) {
+			if ( !unary_expr(str, res, prog, node2) ) {
 				*str = sav;
 				return false;
 			}
-			val.powBy(val2);
+			prog.appendOperand(chain, aNode, CIfExpr::OP_POW, node2);
 			wss(str, res);
 		}
 		result += res;
@@ -936,27 +938,31 @@ bool CRenderState::CIfExprParser::pow_expr(
 bool CRenderState::CIfExprParser::unary_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 
 	const unsigned char *sav = *str;
 	std::string res;
 	
-	unsigned char c = 0;
+	bool c = false;
 	
+	// '!' negates the value like '-'
 	c = match("!", str, res);
 	c = c || match("-", str, res);
 	match("+", str, res);
 	
 	wss(str, res);
-	if ( primary_expr(str, res, val) ) {
+	size_t node1;
+	if ( primary_expr(str, res, prog, node1) ) {
 		wss(str, res);
 		result += res;
-		if ( c == '!' ) {
-			val = !val;
-		} else if ( c ) {
-			val.setNegative();
+		if ( c ) {
+			aNode = prog.newNode(CIfExpr::OP_NEGATE);
+			prog.node(aNode).m_args.push_back(node1);
+		} else {
+			aNode = node1;
 		}
 		return true;
 	}
@@ -969,11 +975,12 @@ bool CRenderState::CIfExprParser::unary_expr(
 bool CRenderState::CIfExprParser::primary_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	wss(str, result);
 	
-	if ( litvar(str, result, val) ) {
+	if ( litvar(str, result, prog, aNode) ) {
 		return true;
 	}
 	
@@ -984,19 +991,20 @@ bool CRenderState::CIfExprParser::primary_expr(
 		wss(str, res);
 		if ( match("(", str, res) ) {
 			wss(str, res);
-			if ( expr(str, res, val) ) {
+			size_t node1;
+			if ( expr(str, res, prog, node1) ) {
 				wss(str, res);
 				if ( match(",", str, res) ) {
 					wss(str, res);
-					CValue val2;
-					if ( expr(str, res, val2) ) {
+					size_t node2;
+					if ( expr(str, res, prog, node2) ) {
 							wss(str, res);
 							if ( match(")", str, res) ) {
 								wss(str, res);
 								result += res;
-								std::string s2;
-								val2.get(s2);
-								val.append(s2);
+								aNode = prog.newNode(CIfExpr::OP_CONCAT);
+								prog.node(aNode).m_args.push_back(node1);
+								prog.node(aNode).m_args.push_back(node2);
 								return true;
 							}
 					}
@@ -1012,16 +1020,17 @@ bool CRenderState::CIfExprParser::primary_expr(
 				res += strname;
 				wss(str, res);
 				if ( match(")", str, res) ) {
-					CValue val;
 					wss(str, res);
 					result += res;
-					return m_outer->getValue(val, strname.c_str());
+					aNode = prog.newNode(CIfExpr::OP_DEFINED);
+					prog.node(aNode).m_name = strname;
+					return true;
 				}
 			}
 		}
 	} else if ( match("(", str, res) ) {
 		wss(str, res);
-		if ( expr(str, res, val) ) {
+		if ( expr(str, res, prog, aNode) ) {
 			wss(str, res);
 			if ( match(")", str, res) ) {
 				wss(str, res);
@@ -1039,7 +1048,8 @@ bool CRenderState::CIfExprParser::primary_expr(
 bool CRenderState::CIfExprParser::if_expr(
 	const unsigned char **str,
 	std::string &result,
-	CValue &val) const
+	CIfExpr &prog,
+	size_t &aNode) const
 {
 	if ( !str || !*str )
 		return true;
@@ -1049,7 +1059,7 @@ bool CRenderState::CIfExprParser::if_expr(
 	if ( (*str)[0] == 0 )
 		return true;
 
-	if ( !expr(str, result, val) ) {
+	if ( !expr(str, result, prog, aNode) ) {
 		*str = sav;
 		return false;
 	}
@@ -1062,41 +1072,136 @@ bool CRenderState::CIfExprParser::if_expr(
 	return false;
 }
 
-bool CRenderState::CIfExprParser::parse(RtString expr) const
+void CRenderState::CIfExprParser::compile(RtString expr, CIfExpr &prog) const
 {
-	if ( !expr )
-		return true;
-
-	const unsigned char **str = (const unsigned char **)(&expr);
+	const unsigned char *str = reinterpret_cast<const unsigned char *>(noNullStr(expr));
 	std::string result;
-	CValue val;
+	size_t aNode = CIfExpr::npos;
 
-	try {
-		if ( if_expr(str, result, val) ) {
-			RtFloat fval = 0;
-			val.get(fval);
-			return fval != 0;
-		} else {
-			return false;
+	bool valid = if_expr(&str, result, prog, aNode);
+	prog.root(valid ? aNode : CIfExpr::npos, valid);
+}
+
+
+// ----------------------------------------------------------------------------
+bool CRenderState::CIfExpr::evalNode(const CRenderState &state, size_t aNode, CValue &val) const
+{
+	const SNode &n = m_nodes[aNode];
+
+	switch ( n.m_opcode ) {
+		case OP_CONST:
+			val = n.m_value;
+			return true;
+
+		case OP_VAR:
+			return state.getValue(val, n.m_name.c_str());
+
+		case OP_CALCVAR: {
+			if ( !evalNode(state, n.m_args[0], val) )
+				return false;
+			std::string strname;
+			val.get(strname);
+			return state.getValue(val, strname.c_str());
 		}
-	} catch ( ExceptRiCPPError &e2 ) {
-		throw e2;
-	} catch ( std::exception &e1 ) {
-		throw ExceptRiCPPError(
-			RIE_MATH, RIE_SEVERE,
-			m_outer->printLineNo(__LINE__),
-			m_outer->printName(__FILE__),
-			"Error %s in expression.", e1.what());
-	} catch( ... ) {
-		throw ExceptRiCPPError(
-			RIE_MATH, RIE_SEVERE,
-			m_outer->printLineNo(__LINE__),
-			m_outer->printName(__FILE__),
-			"Unknown error in expression.");
+
+		case OP_DEFINED: {
+			// val is not touched
+			CValue val2;
+			return state.getValue(val2, n.m_name.c_str());
+		}
+
+		case OP_STRLIST: {
+			if ( !evalNode(state, n.m_args[0], val) )
+				return false;
+			CValue val2;
+			std::string str;
+			for ( size_t i = 1; i < n.m_args.size(); ++i ) {
+				if ( !evalNode(state, n.m_args[i], val2) )
+					return false;
+				val2.get(str);
+				val.append(str);
+			}
+			return true;
+		}
+
+		case OP_CONCAT: {
+			CValue val2;
+			if ( !evalNode(state, n.m_args[0], val) || !evalNode(state, n.m_args[1], val2) )
+				return false;
+			std::string s2;
+			val2.get(s2);
+			val.append(s2);
+			return true;
+		}
+
+		case OP_NEGATE:
+			if ( !evalNode(state, n.m_args[0], val) )
+				return false;
+			val.setNegative();
+			return true;
+
+		case OP_CHAIN: {
+			if ( !evalNode(state, n.m_args[0], val) )
+				return false;
+			// The right operands share one value, as in the levels of the parser
+			CValue val2;
+			for ( size_t i = 1; i < n.m_args.size(); ++i ) {
+				if ( !evalNode(state, n.m_args[i], val2) )
+					return false;
+				switch ( n.m_ops[i] ) {
+					case OP_LOG_OR:  val = val || val2; break;
+					case OP_LOG_AND: val = val && val2; break;
+					case OP_OR:      val |= val2; break;
+					case OP_XOR:     val ^= val2; break;
+					case OP_AND:     val &= val2; break;
+					case OP_EQ:      val = val == val2; break;
+					case OP_NEQ:     val = val != val2; break;
+					case OP_GT:      val = val > val2; break;
+					case OP_GE:      val = val >= val2; break;
+					case OP_LT:      val = val < val2; break;
+					case OP_LE:      val = val <= val2; break;
+					case OP_MATCH: {
+						std::string s;
+						val2.get(s);
+						if ( val.matchedBy(s.c_str()) )
+							val.set(1);
+						break;
+					}
+					case OP_ADD:     val += val2; break;
+					case OP_SUB:     val -= val2; break;
+					case OP_MUL:     val *= val2; break;
+					case OP_DIV:     val /= val2; break;
+					case OP_POW:     val.powBy(val2); break;
+					default:
+						assert(false);
+						break;
+				}
+			}
+			return true;
+		}
+
+		default:
+			assert(false);
+			break;
 	}
+
 	return false;
 }
 
+bool CRenderState::CIfExpr::eval(const CRenderState &state) const
+{
+	if ( !m_valid )
+		return false;
+
+	CValue val;
+	if ( m_root != npos && !evalNode(state, m_root, val) )
+		return false;
+
+	RtFloat fval = 0;
+	val.get(fval);
+	return fval != 0;
+}
+
 
 /* ************************************************************************** */
 
@@ -1122,18 +1227,57 @@ CRenderState::CRenderState(
 	m_transformationFactory = &transformationFactory;
 	m_filterFuncFactory = &filterFuncFactory;
 	m_macroFactory = &macroFactory;
+
+	m_searchPathGeneration = 0;
+	m_varSubstSearchPathGeneration = 0;
+	m_valueGeneration = 0;
+	m_varSubstValueGeneration = 0;
+	m_varSubstEnvGeneration = CEnv::generation();
 	m_frameNumber = 0;
 	m_lineNo = -1;
 
 	RI_RIB = RI_NULL;
 	RI_CACHE_FILE_ARCHIVES = RI_NULL;
+	RI_PARALLEL_LEXING = RI_NULL;
+	RI_PARALLEL_LEXING_CHUNK = RI_NULL;
+	RI_ASYNC_PARSING = RI_NULL;
+	RI_STORE_FRAME_INDEX = RI_NULL;
 	RI_VARSUBST = RI_NULL;
+	RI_SEARCHPATH = RI_NULL;
 	RI_QUAL_CACHE_FILE_ARCHIVES = RI_NULL;
+	RI_QUAL_PARALLEL_LEXING = RI_NULL;
+	RI_QUAL_PARALLEL_LEXING_CHUNK = RI_NULL;
+	RI_QUAL_ASYNC_PARSING = RI_NULL;
+	RI_QUAL_STORE_FRAME_INDEX = RI_NULL;
 	RI_QUAL_VARSUBST = RI_NULL;
+	RI_STATISTICS = RI_NULL;
+	RI_STATISTICS_ENABLE = RI_NULL;
+	RI_STATISTICS_RESET = RI_NULL;
+	RI_STATISTICS_FILE = RI_NULL;
+	RI_STATISTICS_DUMP = RI_NULL;
+	RI_QUAL_STATISTICS_ENABLE = RI_NULL;
+	RI_QUAL_STATISTICS_RESET = RI_NULL;
+	RI_QUAL_STATISTICS_FILE = RI_NULL;
+	RI_QUAL_STATISTICS_DUMP = RI_NULL;
+	RI_TRACE = RI_NULL;
+	RI_TRACE_ENABLE = RI_NULL;
+	RI_TRACE_CLEAR = RI_NULL;
+	RI_TRACE_SIZE = RI_NULL;
+	RI_TRACE_FILE = RI_NULL;
+	RI_TRACE_DUMP = RI_NULL;
+	RI_QUAL_TRACE_ENABLE = RI_NULL;
+	RI_QUAL_TRACE_CLEAR = RI_NULL;
+	RI_QUAL_TRACE_SIZE = RI_NULL;
+	RI_QUAL_TRACE_FILE = RI_NULL;
+	RI_QUAL_TRACE_DUMP = RI_NULL;
 
 	m_curMacro = 0;
 	m_curReplay = 0;
 	m_cacheFileArchives = _DEF_CACHE_FILE_ARCHIVES;
+	m_parallelLexing = _DEF_PARALLEL_LEXING;
+	m_parallelLexingChunk = _DEF_PARALLEL_LEXING_CHUNK;
+	m_asyncParsing = _DEF_ASYNC_PARSING;
+	m_storeFrameIndex = _DEF_STORE_FRAME_INDEX;
 
 	m_reject = false;
 	m_recordMode = false;
@@ -1213,6 +1357,9 @@ void CRenderState::freeAll()
 	m_worldToCamera = 0;
 	m_transformationFactory->deleteTransformation(m_idTransform);
 	m_idTransform = 0;
+
+	clearIfExprCache();
+	clearVarSubstCache();
 }
 
 CRenderState::~CRenderState()
@@ -1713,6 +1860,8 @@ void CRenderState::frameBegin(RtInt number)
 
 	m_modeStack->frameBegin();
 	frameNumber(number);
+
+	checkEnvValueCache();
 }
 
 void CRenderState::frameEnd()
@@ -1740,6 +1889,8 @@ void CRenderState::frameEnd()
 
 void CRenderState::worldBegin()
 {
+	checkEnvValueCache();
+
 	// Sets the viewing transformations
 	setCameraToScreen();
 
@@ -2214,36 +2365,58 @@ bool CRenderState::devideName(RtString identifier, RtToken *aQualifier, RtToken
 	if ( emptyStr(identifier) )
 		return false;
 
-	CStringList sl(':', identifier, false);
-	std::string result;
+	// Separate the components at ':' in place, like CStringList does
+	// (a trailing empty component is dropped), but without allocating
+	// for the usual short names.
+	char buf[256];
+	std::string longName;
+	char *parts = buf;
+	size_t len = strlen(identifier);
+	if ( len < sizeof(buf) ) {
+		memcpy(buf, identifier, len+1);
+	} else {
+		longName = identifier;
+		parts = &longName[0];
+	}
+
+	const char *comp[3];
+	size_t n = 0;
+	char *start = parts;
+	for ( char *cp = parts; *cp; ++cp ) {
+		if ( *cp == ':' ) {
+			*cp = 0;
+			if ( n < 3 )
+				comp[n] = start;
+			++n;
+			start = cp+1;
+		}
+	}
+	if ( *start ) {
+		if ( n < 3 )
+			comp[n] = start;
+		++n;
+	}
 
-	if ( sl.empty() )
+	if ( n == 0 )
 		return false;
 
-	if ( sl.size() > 3 ) {
+	if ( n > 3 ) {
 		*varname = tokFind(identifier);
 		return *varname != RI_NULL;
 	}
 
-	*varname = sl.back().c_str();
-	*varname = tokFind(*varname);
+	*varname = tokFind(comp[n-1]);
 	if ( *varname == RI_NULL ) {
 		*varname = tokFind(identifier);
 		return *varname != RI_NULL;
 	}
 
-	sl.pop_back();
-
-	if ( !sl.empty() ) {
-		*tablename = sl.back().c_str();
-		*tablename = tokFind(*tablename);
-		sl.pop_back();
+	if ( n > 1 ) {
+		*tablename = tokFind(comp[n-2]);
 	}
 
-	if ( !sl.empty() ) {
-		*aQualifier = sl.back().c_str();
-		*aQualifier = tokFind(*aQualifier);
-		sl.pop_back();
+	if ( n > 2 ) {
+		*aQualifier = tokFind(comp[n-3]);
 	}
 
 	return true;
@@ -2306,9 +2479,101 @@ bool CRenderState::getValue(CValue &p, RtString identifier) const
 	return false;
 }
 
+bool CRenderState::getEnvValue(CValue &p, RtString identifier) const
+{
+	if ( emptyStr(identifier) )
+		return false;
+
+	validateVarSubstCache();
+
+	TypeEnvValueCache::const_iterator iter = m_envValueCache.find(identifier);
+	if ( iter == m_envValueCache.end() ) {
+		if ( m_envValueCache.size() >= MAX_VARSUBST_CACHE )
+			m_envValueCache.clear();
+		std::string var;
+		CEnv::find(var, identifier, false);
+		iter = m_envValueCache.insert(TypeEnvValueCache::value_type(identifier, std::make_pair(!var.empty(), var))).first;
+	}
+
+	if ( !(*iter).second.first )
+		return false;
+
+	p.set((*iter).second.second.c_str());
+	return true;
+}
+
+void CRenderState::clearVarSubstCache() const
+{
+	m_varSubstCache.clear();
+	m_envValueCache.clear();
+}
+
+bool CRenderState::addsValue(const COptionsBase &values, RtToken name, const CParameterList &params) const
+{
+	for ( CParameterList::const_iterator i = params.begin(); i != params.end(); ++i ) {
+		if ( !values.get(name, (*i).var()) )
+			return true;
+	}
+	return false;
+}
+
+void CRenderState::validateVarSubstCache() const
+{
+	if ( m_varSubstSearchPathGeneration != m_searchPathGeneration || m_varSubstEnvGeneration != CEnv::generation() ) {
+		clearVarSubstCache();
+		m_varSubstSearchPathGeneration = m_searchPathGeneration;
+		m_varSubstEnvGeneration = CEnv::generation();
+	}
+	// Expansions with variables not found in the state are memoized
+	if ( m_varSubstValueGeneration != m_valueGeneration ) {
+		m_varSubstCache.clear();
+		m_varSubstValueGeneration = m_valueGeneration;
+	}
+}
+
+void CRenderState::checkEnvValueCache() const
+{
+	std::string var;
+	for ( TypeEnvValueCache::const_iterator i = m_envValueCache.begin(); i != m_envValueCache.end(); ++i ) {
+		CEnv::find(var, (*i).first.c_str(), false);
+		if ( (*i).second.first != !var.empty() || (*i).second.second != var ) {
+			clearVarSubstCache();
+			return;
+		}
+	}
+}
+
 std::string &CRenderState::varSubst(std::string &aStr, char varId, RtString stdPath, RtString curPath) const
 {
-	return RiCPP::varSubst(aStr, varId, this, stdPath, curPath);
+	if ( !hasVarSubst(aStr, varId, stdPath, curPath) )
+		return aStr;
+
+	validateVarSubstCache();
+
+	// The key distinguishes between a missing and an empty path
+	std::string key(1, varId);
+	key += stdPath ? '@' : '-';
+	key += noNullStr(stdPath);
+	key += '\0';
+	key += curPath ? '&' : '-';
+	key += noNullStr(curPath);
+	key += '\0';
+	key += aStr;
+
+	TypeVarSubstCache::const_iterator iter = m_varSubstCache.find(key);
+	if ( iter != m_varSubstCache.end() ) {
+		aStr = (*iter).second;
+		return aStr;
+	}
+
+	CVarSubstQuery query(*this);
+	RiCPP::varSubst(aStr, varId, &query, stdPath, curPath);
+	if ( !query.m_usedState ) {
+		if ( m_varSubstCache.size() >= MAX_VARSUBST_CACHE )
+			m_varSubstCache.clear();
+		m_varSubstCache[key] = aStr;
+	}
+	return aStr;
 }
 
 std::string &CRenderState::varSubst(std::string &aStr, RtString stdPath, RtString curPath) const
@@ -2324,10 +2589,52 @@ std::string &CRenderState::varSubst(std::string &aStr, RtString stdPath, RtStrin
 	return varSubst(aStr, 0, stdPath, curPath); // maybe stdPath, curPath have to be inserted (not done via parsing)
 }
 
+void CRenderState::clearIfExprCache() const
+{
+	for ( TypeIfExprCache::iterator iter = m_ifExprCache.begin(); iter != m_ifExprCache.end(); ++iter ) {
+		delete (*iter).second;
+	}
+	m_ifExprCache.clear();
+}
+
 bool CRenderState::eval(RtString expr) const
 {
-	CIfExprParser parser(*this);
-	return parser.parse(expr);
+	if ( !expr )
+		return true;
+
+	// Each distinct expression string is compiled only once
+	const CIfExpr *prog = 0;
+	TypeIfExprCache::const_iterator iter = m_ifExprCache.find(expr);
+	if ( iter != m_ifExprCache.end() ) {
+		prog = (*iter).second;
+	} else {
+		if ( m_ifExprCache.size() >= MAX_IFEXPR_CACHE )
+			clearIfExprCache();
+		CIfExpr *newProg = new CIfExpr(expr);
+		CIfExprParser parser;
+		parser.compile(expr, *newProg);
+		m_ifExprCache[newProg->source()] = newProg;
+		prog = newProg;
+	}
+
+	try {
+		return prog->eval(*this);
+	} catch ( ExceptRiCPPError &e2 ) {
+		throw e2;
+	} catch ( std::exception &e1 ) {
+		throw ExceptRiCPPError(
+			RIE_MATH, RIE_SEVERE,
+			printLineNo(__LINE__),
+			printName(__FILE__),
+			"Error %s in expression.", e1.what());
+	} catch( ... ) {
+		throw ExceptRiCPPError(
+			RIE_MATH, RIE_SEVERE,
+			printLineNo(__LINE__),
+			printName(__FILE__),
+			"Unknown error in expression.");
+	}
+	return false;
 }
 
 
@@ -3010,9 +3317,42 @@ void CRenderState::defaultDeclarations()
 	RI_RIB = tokFindCreate("rib");
 	RI_CACHE_FILE_ARCHIVES = tokFindCreate("cache-file-archives");
 	RI_QUAL_CACHE_FILE_ARCHIVES = declare("Control:rib:cache-file-archives", "constant integer", true);
+	RI_PARALLEL_LEXING = tokFindCreate("parallel-lexing");
+	RI_QUAL_PARALLEL_LEXING = declare("Control:rib:parallel-lexing", "constant integer", true);
+	RI_PARALLEL_LEXING_CHUNK = tokFindCreate("parallel-lexing-chunk");
+	RI_QUAL_PARALLEL_LEXING_CHUNK = declare("Control:rib:parallel-lexing-chunk", "constant integer", true);
+	RI_ASYNC_PARSING = tokFindCreate("async-parsing");
+	RI_QUAL_ASYNC_PARSING = declare("Control:rib:async-parsing", "constant integer", true);
+	RI_STORE_FRAME_INDEX = tokFindCreate("store-frame-index");
+	RI_QUAL_STORE_FRAME_INDEX = declare("Control:rib:store-frame-index", "constant integer", true);
 	RI_VARSUBST = tokFindCreate("varsubst");
+	RI_SEARCHPATH = tokFindCreate("searchpath");
 	RI_QUAL_VARSUBST = declare("Option:rib:varsubst", "string", true);
 
+	// statistics control
+	RI_STATISTICS = tokFindCreate("statistics");
+	RI_STATISTICS_ENABLE = tokFindCreate("enable");
+	RI_QUAL_STATISTICS_ENABLE = declare("Control:statistics:enable", "constant integer", true);
+	RI_STATISTICS_RESET = tokFindCreate("reset");
+	RI_QUAL_STATISTICS_RESET = declare("Control:statistics:reset", "constant integer", true);
+	RI_STATISTICS_FILE = tokFindCreate("file");
+	RI_QUAL_STATISTICS_FILE = declare("Control:statistics:file", "constant string", true);
+	RI_STATISTICS_DUMP = tokFindCreate("dump");
+	RI_QUAL_STATISTICS_DUMP = declare("Control:statistics:dump", "constant string", true);
+
+	// trace control
+	RI_TRACE = tokFindCreate("trace");
+	RI_TRACE_ENABLE = tokFindCreate("enable");
+	RI_QUAL_TRACE_ENABLE = declare("Control:trace:enable", "constant integer", true);
+	RI_TRACE_CLEAR = tokFindCreate("clear");
+	RI_QUAL_TRACE_CLEAR = declare("Control:trace:clear", "constant integer", true);
+	RI_TRACE_SIZE = tokFindCreate("size");
+	RI_QUAL_TRACE_SIZE = declare("Control:trace:size", "constant integer", true);
+	RI_TRACE_FILE = tokFindCreate("file");
+	RI_QUAL_TRACE_FILE = declare("Control:trace:file", "constant string", true);
+	RI_TRACE_DUMP = tokFindCreate("dump");
+	RI_QUAL_TRACE_DUMP = declare("Control:trace:dump", "constant string", true);
+
 	// state control
 	RI_STATE = tokFindCreate("state");
 	RI_STORE_TRANSFORM = tokFindCreate("store-transform");
@@ -3020,6 +3360,12 @@ void CRenderState::defaultDeclarations()
 	RI_LOAD_TRANSFORM = tokFindCreate("load-transform");
 	RI_QUAL_LOAD_TRANSFORM = declare("Control:state:load-transform", "constant string", true);
 	RI_PRE_CAMERA = tokFindCreate("pre-camera");
+	RI_SKIP_LIGHT_HANDLES = tokFindCreate("skip-light-handles");
+	RI_QUAL_SKIP_LIGHT_HANDLES = declare("Control:state:skip-light-handles", "constant integer", true);
+	RI_SKIP_OBJECT_HANDLES = tokFindCreate("skip-object-handles");
+	RI_QUAL_SKIP_OBJECT_HANDLES = declare("Control:state:skip-object-handles", "constant integer", true);
+	RI_BASE_DIRECTORY = tokFindCreate("base-directory");
+	RI_QUAL_BASE_DIRECTORY = declare("Control:state:base-directory", "constant string", true);
 }
 
 RtToken CRenderState::declare(RtToken name, RtString declaration, bool isDefault)
@@ -3038,6 +3384,27 @@ RtVoid CRenderState::control(RtToken name, const CParameterList &params)
 				(*i).get(0, intVal);
 				m_cacheFileArchives = intVal != 0;
 			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_RIB, RI_PARALLEL_LEXING) ) {
+				RtInt intVal;
+				(*i).get(0, intVal);
+				m_parallelLexing = intVal;
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_RIB, RI_PARALLEL_LEXING_CHUNK) ) {
+				RtInt intVal;
+				(*i).get(0, intVal);
+				if ( intVal > 0 )
+					m_parallelLexingChunk = intVal;
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_RIB, RI_ASYNC_PARSING) ) {
+				RtInt intVal;
+				(*i).get(0, intVal);
+				m_asyncParsing = intVal;
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_RIB, RI_STORE_FRAME_INDEX) ) {
+				RtInt intVal;
+				(*i).get(0, intVal);
+				m_storeFrameIndex = intVal != 0;
+			}
 		}
 	} else if ( name == RI_STATE ) {
 		CParameterList::const_iterator i;
@@ -3054,6 +3421,93 @@ RtVoid CRenderState::control(RtToken name, const CParameterList &params)
 				if ( strVal == std::string(RI_PRE_CAMERA) )
 					curTransform().concatTransform(m_preCamera);
 			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATE, RI_SKIP_LIGHT_HANDLES) ) {
+				RtInt intVal;
+				(*i).get(0, intVal);
+				if ( intVal > 0 )
+					m_lightSourceHandles.skipHandles((unsigned long)intVal);
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATE, RI_SKIP_OBJECT_HANDLES) ) {
+				RtInt intVal;
+				(*i).get(0, intVal);
+				if ( intVal > 0 )
+					m_objectMacros.skipHandles((unsigned long)intVal);
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATE, RI_BASE_DIRECTORY) ) {
+				// Relative archive names are resolved there, like the ones of an archive read from that directory
+				std::string strVal;
+				(*i).get(0, strVal);
+				if ( !strVal.empty() && strVal[strVal.size()-1] != CFilepathConverter::internalPathSeparator() )
+					strVal += CFilepathConverter::internalPathSeparator();
+				CUri refUri, absUri;
+				if ( refUri.encodeFilepath(strVal.c_str(), 0) && CUri::makeAbsolute(absUri, m_baseUri, refUri, false) )
+					m_baseUri = absUri;
+			}
+		}
+	} else if ( name == RI_STATISTICS ) {
+		CParameterList::const_iterator i;
+		for ( i = params.begin(); i != params.end(); i++ ) {
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATISTICS, RI_STATISTICS_ENABLE) ) {
+				RtInt intVal;
+				if ( (*i).get(0, intVal) )
+					m_statistics.enabled(intVal != 0);
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATISTICS, RI_STATISTICS_RESET) ) {
+				RtInt intVal;
+				if ( (*i).get(0, intVal) && intVal != 0 )
+					m_statistics.reset();
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATISTICS, RI_STATISTICS_FILE) ) {
+				std::string strVal;
+				if ( (*i).get(0, strVal) )
+					m_statistics.filename(strVal);
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_STATISTICS, RI_STATISTICS_DUMP) ) {
+				std::string strVal;
+				if ( (*i).get(0, strVal) && !m_statistics.write(strVal) ) {
+					throw ExceptRiCPPError(
+						RIE_NOFILE, RIE_ERROR,
+						printLineNo(__LINE__),
+						printName(__FILE__),
+						"Could not write the statistics to '%s'",
+						strVal.c_str());
+				}
+			}
+		}
+	} else if ( name == RI_TRACE ) {
+		CParameterList::const_iterator i;
+		for ( i = params.begin(); i != params.end(); i++ ) {
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_TRACE, RI_TRACE_SIZE) ) {
+				RtInt intVal;
+				if ( (*i).get(0, intVal) && intVal > 0 )
+					ricppTracer().capacity((unsigned long)intVal);
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_TRACE, RI_TRACE_ENABLE) ) {
+				RtInt intVal;
+				if ( (*i).get(0, intVal) )
+					CTracer::enabled(intVal != 0);
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_TRACE, RI_TRACE_CLEAR) ) {
+				RtInt intVal;
+				if ( (*i).get(0, intVal) && intVal != 0 )
+					ricppTracer().clear();
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_TRACE, RI_TRACE_FILE) ) {
+				std::string strVal;
+				if ( (*i).get(0, strVal) )
+					m_traceFilename = strVal;
+			}
+			if ( (*i).matches(QUALIFIER_CONTROL, RI_TRACE, RI_TRACE_DUMP) ) {
+				std::string strVal;
+				if ( (*i).get(0, strVal) && !ricppTracer().write(strVal) ) {
+					throw ExceptRiCPPError(
+						RIE_NOFILE, RIE_ERROR,
+						printLineNo(__LINE__),
+						printName(__FILE__),
+						"Could not write the trace to '%s'",
+						strVal.c_str());
+				}
+			}
 		}
 	}
 }
@@ -3061,11 +3515,17 @@ RtVoid CRenderState::control(RtToken name, const CParameterList &params)
 
 RtVoid CRenderState::option(RtToken name, const CParameterList &params)
 {
+	if ( addsValue(options(), name, params) )
+		++m_valueGeneration;
 	options().set(name, params);
+	if ( name == RI_SEARCHPATH )
+		++m_searchPathGeneration;
 }
 
 
 RtVoid CRenderState::attribute(RtToken name, const CParameterList &params)
 {
+	if ( addsValue(attributes(), name, params) )
+		++m_valueGeneration;
 	attributes().set(name, params);
 }
@@ -0,0 +1,135 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file requeststats.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Implementation of the per request statistics (calls, parameters, times, triangles)
+ */
+
+#include "ricpp/ricontext/requeststats.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace RiCPP;
+
+CRequestStatistics::CRequestStatistics()
+{
+	m_enabled = false;
+	reset();
+}
+
+
+void CRequestStatistics::reset()
+{
+	memset(m_stats, 0, sizeof(m_stats));
+	m_current = REQ_UNKNOWN;
+	m_pendingParseTime = 0;
+}
+
+
+/** @brief Converts nanoseconds to seconds for output.
+ */
+static inline double seconds(unsigned long long t)
+{
+	return (double)t / 1.0e9;
+}
+
+
+void CRequestStatistics::writeJSON(std::ostream &out) const
+{
+	SRequestStats total;
+	memset(&total, 0, sizeof(total));
+
+	out << "{\n  \"requests\": [";
+	bool first = true;
+	for ( int i = 0; i < N_REQUESTS; ++i ) {
+		const SRequestStats &s = m_stats[i];
+		if ( !s.m_calls && !s.m_parseTime )
+			continue;
+		out << (first ? "\n" : ",\n");
+		first = false;
+		out << "    { \"request\": \"" << CRequestInfo::requestName((EnumRequests)i) << "\""
+		    << ", \"calls\": " << s.m_calls
+		    << ", \"parameterBytes\": " << s.m_paramBytes
+		    << ", \"triangles\": " << s.m_triangles
+		    << ", \"parseTime\": " << seconds(s.m_parseTime)
+		    << ", \"preProcessTime\": " << seconds(s.m_preTime)
+		    << ", \"doProcessTime\": " << seconds(s.m_doTime)
+		    << ", \"postProcessTime\": " << seconds(s.m_postTime)
+		    << " }";
+		total.m_calls += s.m_calls;
+		total.m_paramBytes += s.m_paramBytes;
+		total.m_triangles += s.m_triangles;
+		total.m_parseTime += s.m_parseTime;
+	}
+	out << "\n  ],\n  \"total\": { \"calls\": " << total.m_calls
+	    << ", \"parameterBytes\": " << total.m_paramBytes
+	    << ", \"triangles\": " << total.m_triangles
+	    << ", \"parseTime\": " << seconds(total.m_parseTime)
+	    << " }\n}\n";
+}
+
+
+void CRequestStatistics::writeCSV(std::ostream &out) const
+{
+	out << "request,calls,parameter_bytes,triangles,parse_time,preprocess_time,doprocess_time,postprocess_time\n";
+	for ( int i = 0; i < N_REQUESTS; ++i ) {
+		const SRequestStats &s = m_stats[i];
+		if ( !s.m_calls && !s.m_parseTime )
+			continue;
+		out << CRequestInfo::requestName((EnumRequests)i)
+		    << "," << s.m_calls
+		    << "," << s.m_paramBytes
+		    << "," << s.m_triangles
+		    << "," << seconds(s.m_parseTime)
+		    << "," << seconds(s.m_preTime)
+		    << "," << seconds(s.m_doTime)
+		    << "," << seconds(s.m_postTime)
+		    << "\n";
+	}
+}
+
+
+bool CRequestStatistics::write(const std::string &aFilename) const
+{
+	std::string::size_type pos = aFilename.find_last_of('.');
+	bool csv = pos != std::string::npos && aFilename.compare(pos, std::string::npos, ".csv") == 0;
+
+	if ( aFilename == "-" ) {
+		writeJSON(std::cerr);
+		std::cerr.flush();
+		return true;
+	}
+
+	std::ofstream out(aFilename.c_str(), std::ios_base::out|std::ios_base::trunc);
+	if ( !out )
+		return false;
+	if ( csv )
+		writeCSV(out);
+	else
+		writeJSON(out);
+	return out.good();
+}
@@ -36,16 +36,19 @@
 using namespace RiCPP;
 
 
-RtToken CAttributesResource::s_operation = RI_NULL;
-RtToken CAttributesResource::s_save = RI_NULL;
-RtToken CAttributesResource::s_restore = RI_NULL;
-RtToken CAttributesResource::s_concat = RI_NULL;
-RtToken CAttributesResource::s_subset = RI_NULL;
-RtToken CAttributesResource::s_shading = RI_NULL;
-RtToken CAttributesResource::s_transform = RI_NULL;
-RtToken CAttributesResource::s_all = RI_NULL;
-RtToken CAttributesResource::s_geometrymodification = RI_NULL;
-RtToken CAttributesResource::s_geometrydefinition = RI_NULL;
+// The names are not taken from the token map of a context, the tokens
+// of a context (e.g. the variables of a parameter list) are compared by string,
+// because several contexts (with own token maps) can exist at the same time.
+RtToken CAttributesResource::s_operation = "operation";
+RtToken CAttributesResource::s_save = "save";
+RtToken CAttributesResource::s_restore = "restore";
+RtToken CAttributesResource::s_concat = "concat";
+RtToken CAttributesResource::s_subset = "subset";
+RtToken CAttributesResource::s_shading = "shading";
+RtToken CAttributesResource::s_transform = "transform";
+RtToken CAttributesResource::s_all = "all";
+RtToken CAttributesResource::s_geometrymodification = "geometrymodification";
+RtToken CAttributesResource::s_geometrydefinition = "geometrydefinition";
 
 RtToken CAttributesResource::myType()
 {
@@ -54,19 +57,29 @@ RtToken CAttributesResource::myType()
 
 void CAttributesResource::registerOperations(CTokenMap &m)
 {
-	s_operation = m.findCreate("operation");
+	m.findCreate(s_operation);
 
-	s_save = m.findCreate("save");
-	s_restore = m.findCreate("restore");
-	s_concat = m.findCreate("concat");
+	m.findCreate(s_save);
+	m.findCreate(s_restore);
+	m.findCreate(s_concat);
 	
-	s_subset = m.findCreate("subset");
+	m.findCreate(s_subset);
 
-	s_shading = m.findCreate("shading");
-	s_transform = m.findCreate("transform");
-	s_all = m.findCreate("all");
-	s_geometrymodification = m.findCreate("geometrymodification");
-	s_geometrydefinition = m.findCreate("geometrydefinition");
+	m.findCreate(s_shading);
+	m.findCreate(s_transform);
+	m.findCreate(s_all);
+	m.findCreate(s_geometrymodification);
+	m.findCreate(s_geometrydefinition);
+}
+
+const CParameter *CAttributesResource::getParameter(const CParameterList &parameters, RtString aName)
+{
+	CParameterList::const_iterator i;
+	for ( i = parameters.begin(); i != parameters.end(); ++i ) {
+		if ( (*i).var() && !strcmp((*i).var(), aName) )
+			return &(*i);
+	}
+	return 0;
 }
 
 CAttributesResource::CAttributesResource(RtToken anId, unsigned long aHandleNo, bool isFromHandleId)
@@ -170,7 +183,7 @@ void CAttributesResource::operate(IRiContext &ri, RtToken operation, RtToken sub
 
 void CAttributesResource::operate(IRiContext &ri, const CParameterList &parameters)
 {
-	const CParameter *operp = parameters.get(s_operation);
+	const CParameter *operp = getParameter(parameters, s_operation);
 	if ( !operp )
 		return;
 
@@ -178,7 +191,7 @@ void CAttributesResource::operate(IRiContext &ri, const CParameterList &paramete
 		RtToken operation = getOperation(operp->strings()[0]);
 
 		RtToken subset = s_all;
-		const CParameter *subp = parameters.get(s_subset);
+		const CParameter *subp = getParameter(parameters, s_subset);
 		if ( subp && subp->type() == TYPE_STRING && !subp->strings().empty() ) {
 			subset = getSubset(subp->strings()[0]);
 		}
@@ -194,7 +207,7 @@ RtToken CAttributesResource::type() const
 
 bool CAttributesResource::overwrites(const CParameterList &parameters)
 {
-	const CParameter *p = parameters.get(s_operation);
+	const CParameter *p = getParameter(parameters, s_operation);
 	if ( !p )
 		return false;
 
@@ -33,30 +33,183 @@
 #include "ricpp/ribase/ricpptokens.h"
 #endif // _RICPP_RIBASE_RICPPTOKENS_H
 
+#ifndef _RICPP_TOOLS_BYTEORDER_H
+#include "ricpp/tools/byteorder.h"
+#endif // _RICPP_TOOLS_BYTEORDER_H
+
+#include <algorithm>
 #include <cassert>
-#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#if defined __has_include
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
 
 using namespace RiCPP;
 
+// ----------------------------------------------------------------------------
+
+/** @brief Formats an integer.
+ *  @param buf Buffer for the digits, at least 21 characters.
+ *  @param value Absolute value of the integer.
+ *  @param negative Put a minus sign in front.
+ *  @return Number of characters written to @a buf.
+ */
+static unsigned long formatInteger(char *buf, unsigned long long value, bool negative)
+{
+	char digits[24];
+	char *p = digits + sizeof(digits);
+	do {
+		*--p = (char)('0' + (value % 10));
+		value /= 10;
+	} while ( value );
+
+	unsigned long n = 0;
+	if ( negative )
+		buf[n++] = '-';
+	unsigned long len = (unsigned long)(digits + sizeof(digits) - p);
+	memcpy(buf+n, p, len);
+	return n + len;
+}
+
+/** @brief Reads back a formatted number, used to find the shortest representation.
+ */
+static inline float readBack(const char *buf, float) { return strtof(buf, 0); }
+
+/** @brief Reads back a formatted number, used to find the shortest representation.
+ */
+static inline double readBack(const char *buf, double) { return strtod(buf, 0); }
+
+/** @brief Formats a floating point number with the shortest representation
+ *         that reads back to the same value.
+ *
+ *  Integral values, that are frequent in RIB, are formatted as integers.
+ *
+ *  @param buf Buffer for the characters, at least 32 characters.
+ *  @param value The number.
+ *  @return Number of characters written to @a buf.
+ */
+template<typename TypeFloat>
+static unsigned long formatShortest(char *buf, TypeFloat value)
+{
+	// Integral values are exact in float up to 2^24
+	if ( value > (TypeFloat)-16777216 && value < (TypeFloat)16777216 ) {
+		long l = (long)value;
+		if ( (TypeFloat)l == value ) {
+			return formatInteger(buf,
+				(unsigned long long)(l < 0 ? -l : l),
+				l < 0 || (l == 0 && std::signbit(value)));
+		}
+	}
+
+#if defined __cpp_lib_to_chars
+	// The shortest scientific representation gives the number of digits,
+	// written like printf("%g") with that precision ("0.0008", not "8e-04")
+	char sci[32];
+	std::to_chars_result res = std::to_chars(sci, sci+sizeof(sci), value, std::chars_format::scientific);
+	int prec = 0;
+	for ( const char *p = sci; p < res.ptr && *p != 'e'; ++p ) {
+		if ( *p >= '0' && *p <= '9' )
+			++prec;
+	}
+	res = std::to_chars(buf, buf+32, value, std::chars_format::general, prec);
+	return (unsigned long)(res.ptr - buf);
+#else
+	// Tries the precisions from the decimal digits that always can be
+	// represented up to the digits that always read back to the same value
+	int prec = std::numeric_limits<TypeFloat>::digits10;
+	int maxPrec = std::numeric_limits<TypeFloat>::digits10 + 3;
+	int n = 0;
+	for ( ; prec <= maxPrec; ++prec ) {
+		n = snprintf(buf, 32, "%.*g", prec, (double)value);
+		if ( value != value || readBack(buf, value) == value )
+			break;
+	}
+	return n < 0 ? 0 : (unsigned long)n;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
 CRibElementsWriter::CRibElementsWriter(std::basic_streambuf<char, std::char_traits<char> > *ribout, IRequestNotification &notify)
-: m_ostream(ribout), m_ascii(true), m_countStrings(0), m_firstRequestWritten(false), m_notify(notify), m_linecnt(1)
+: m_ribout(ribout), m_bytesFlushed(0), m_ascii(true), m_countStrings(0), m_firstRequestWritten(false), m_notify(notify), m_linecnt(1),
+  m_fixedAbs(0), m_fixedRel(0)
 {
 	memset(m_reqEncoding, 0, sizeof(m_reqEncoding)*sizeof(unsigned char));	
+	fixedPointVars("P N st");
+	m_outBuffer.resize(OUT_BUFFER_SIZE);
+	m_outPos = &m_outBuffer[0];
+	m_outEnd = m_outPos + m_outBuffer.size();
 }
 
 /*
 CRibElementsWriter::CRibElementsWriter(TemplFrontStreambuf<char> *ribout, IRequestNotification &notify)
-: m_ostream(ribout), m_ascii(true), m_countStrings(0), m_firstRequestWritten(false), m_notify(notify), m_linecnt(1)
+: m_ribout(ribout), m_ascii(true), m_countStrings(0), m_firstRequestWritten(false), m_notify(notify), m_linecnt(1)
 {
 	memset(m_reqEncoding, 0, sizeof(m_reqEncoding)*sizeof(unsigned char));
 }
 */
 
 
+void CRibElementsWriter::flush()
+{
+	char *start = &m_outBuffer[0];
+	if ( m_outPos != start && m_ribout ) {
+		m_ribout->sputn(start, (std::streamsize)(m_outPos - start));
+	}
+	m_bytesFlushed += (unsigned long long)(m_outPos - start);
+	m_outPos = start;
+}
+
+
+void CRibElementsWriter::put(const char *cs, unsigned long n)
+{
+	if ( n > (unsigned long)(m_outEnd - m_outPos) ) {
+		flush();
+		if ( n > (unsigned long)(m_outEnd - m_outPos) ) {
+			// Larger than the buffer
+			if ( m_ribout )
+				m_ribout->sputn(cs, (std::streamsize)n);
+			m_bytesFlushed += n;
+			return;
+		}
+	}
+	memcpy(m_outPos, cs, n);
+	m_outPos += n;
+}
+
+
+void CRibElementsWriter::continueFrom(const CRibElementsWriter &writer)
+{
+	m_ascii = writer.m_ascii;
+	m_fixedAbs = writer.m_fixedAbs;
+	m_fixedRel = writer.m_fixedRel;
+	m_fixedVars = writer.m_fixedVars;
+	m_countStrings = writer.m_countStrings;
+	m_firstRequestWritten = true;
+}
+
+
+void CRibElementsWriter::putRaw(const char *cs, unsigned long n)
+{
+	if ( !cs || !n )
+		return;
+	if ( m_ascii )
+		m_linecnt += (unsigned long)std::count(cs, cs+n, '\n');
+	put(cs, n);
+}
+
+
 void CRibElementsWriter::putNewLine()
 {
 	if ( m_ascii ) {
-		m_ostream << std::endl;
+		put('\n');
 		++m_linecnt;
 	}
 }
@@ -65,7 +218,7 @@ void CRibElementsWriter::putNewLine()
 void CRibElementsWriter::putBlank()
 {
 	if ( m_ascii ) {
-		m_ostream << ' ';
+		put(' ');
 	}
 }
 
@@ -74,29 +227,29 @@ void CRibElementsWriter::putEncodedChar(char ce)
 {
 	switch ( ce ) {
 		case '\n' :
-			m_ostream << "\\n";
+			put("\\n", 2);
 			break;
 		case '\r' :
-			m_ostream << "\\r";
+			put("\\r", 2);
 			break;
 		case '\t' :
-			m_ostream << "\\t";
+			put("\\t", 2);
 			break;
 		case '\b' :
-			m_ostream << "\\b";
+			put("\\b", 2);
 			break;
 		case '\f' :
-			m_ostream << "\\f";
+			put("\\f", 2);
 			break;
 		case '\\' :
-			m_ostream << "\\\\";
+			put("\\\\", 2);
 			break;
 		case '"' :
-			m_ostream << "\\\"";
+			put("\\\"", 2);
 			break;
 		default:
 			if ( ce >= ' ' && ce <= '~' ) {
-				m_ostream << ce;
+				put(ce);
 			} else {
 				unsigned char c = (unsigned char)ce;
 				int d3 = c / 64;
@@ -104,10 +257,10 @@ void CRibElementsWriter::putEncodedChar(char ce)
 				int d2 = c / 8;
 				c %= 8;
 				int d1 = c;
-				m_ostream << '\\';
-				m_ostream << (char)('0'+d3);
-				m_ostream << (char)('0'+d2);
-				m_ostream << (char)('0'+d1);
+				put('\\');
+				put((char)('0'+d3));
+				put((char)('0'+d2));
+				put((char)('0'+d1));
 			}
 			break;
 	}
@@ -119,7 +272,7 @@ void CRibElementsWriter::putChar(char c)
 	// 	putEncodedChar(c);
 	// 	return;
 	// }
-	m_ostream << c;
+	put(c);
 	if ( c == '\n' )
 		++m_linecnt;
 }
@@ -130,8 +283,12 @@ void CRibElementsWriter::putChars(const char *cs)
 	if ( !cs )
 		return;
 	
-	for ( ; *cs; ++cs )
-		putChar(*cs);
+	const char *start = cs;
+	for ( ; *cs; ++cs ) {
+		if ( *cs == '\n' )
+			++m_linecnt;
+	}
+	put(start, (unsigned long)(cs - start));
 }
 
 
@@ -154,7 +311,8 @@ void CRibElementsWriter::putComment(RtToken type, const char *cs)
 
 	putChars(cs);
 	
-	if ( type != RI_VERBATIM || !cs || !*cs || cs[strlen(cs)-1] == '\n' ) {
+	// Verbatim text is written as it is
+	if ( type != RI_VERBATIM ) {
 		putNewLine();
 	}
 
@@ -166,22 +324,131 @@ void CRibElementsWriter::putComment(RtToken type, const char *cs)
 
 void CRibElementsWriter::putBinValue(float aFloat)
 {
-	unsigned char code;
-	unsigned long tmp = 0;
-//	tmp = *((unsigned long *)(void *)&aFloat);
-	memcpy(&tmp, &aFloat, sizeof(unsigned long));
+	unsigned char bytes[4];
+	floatsToBigEndian(bytes, &aFloat, 1);
+	put(reinterpret_cast<const char *>(bytes), 4);
+}
+
+
+void CRibElementsWriter::putBinValues(unsigned long length, const float *floats)
+{
+	while ( length > 0 ) {
+		unsigned long n = (unsigned long)(m_outEnd - m_outPos) / 4;
+		if ( n == 0 ) {
+			flush();
+			continue;
+		}
+		if ( n > length )
+			n = length;
+		floatsToBigEndian(reinterpret_cast<unsigned char *>(m_outPos), floats, n);
+		m_outPos += 4*n;
+		floats += n;
+		length -= n;
+	}
+}
+
+
+void CRibElementsWriter::putFixedValue(long aValue, unsigned char d)
+{
+	assert(d <= 3);
+	assert(aValue >= -2147483647L-1 && aValue <= 2147483647L);
+
+	// Smallest signed width holding the value, at least d bytes
+	unsigned char w = 1;
+	while ( w < 4 && (aValue < -(1L << (8*w-1)) || aValue >= (1L << (8*w-1))) )
+		++w;
+	if ( w < d )
+		w = d;
+
+	put((char)(0200 + 4*d + (w-1)));
+	unsigned long bits = (unsigned long)aValue;
+	for ( int i = w-1; i >= 0; --i ) {
+		put((char)((bits >> (8*i)) & 0xffUL));
+	}
+}
+
+
+bool CRibElementsWriter::putFixedArray(unsigned long length, const float *floats)
+{
+	if ( length == 0 || (m_fixedAbs <= 0 && m_fixedRel <= 0) )
+		return false;
+
+	float maxAbs = 0;
+	for ( unsigned long i = 0; i < length; ++i ) {
+		float a = std::fabs(floats[i]);
+		if ( !(a <= std::numeric_limits<float>::max()) )
+			return false; // NaN or infinite
+		if ( a > maxAbs )
+			maxAbs = a;
+	}
+
+	double bound = std::numeric_limits<double>::max();
+	if ( m_fixedAbs > 0 )
+		bound = m_fixedAbs;
+	if ( m_fixedRel > 0 && m_fixedRel * (double)maxAbs < bound )
+		bound = m_fixedRel * (double)maxAbs;
+
+	// Rounding to a multiple of 1/256^d errs by at most 0.5/256^d
+	unsigned char d = 0;
+	double scale = 1.0;
+	if ( maxAbs > 0 ) {
+		while ( 0.5/scale > bound ) {
+			if ( d == 3 )
+				return false;
+			++d;
+			scale *= 256.0;
+		}
+	}
+	if ( (double)maxAbs * scale + 0.5 > 2147483647.0 )
+		return false;
 
-	code = (unsigned char)((tmp >> 24) & 0xffUL);
-	m_ostream << code;			
+	// Size of the fixed-point values including '[' and ']' compared to a float array
+	unsigned long fixedSize = 2;
+	for ( unsigned long i = 0; i < length; ++i ) {
+		double q = std::fabs(std::floor(floats[i] * scale + 0.5));
+		unsigned char w = q < 128.0 ? 1 : (q < 32768.0 ? 2 : (q < 8388608.0 ? 3 : 4));
+		fixedSize += 1 + (w < d ? d : w);
+	}
+	unsigned long floatSize = 4*length + 2 + (length > 0xffUL) + (length > 0xffffUL) + (length > 0xffffffUL);
+	if ( fixedSize >= floatSize )
+		return false;
 
-	code = (unsigned char)((tmp >> 16) & 0xffUL);
-	m_ostream << code;			
+	put('[');
+	for ( unsigned long i = 0; i < length; ++i ) {
+		putFixedValue((long)std::floor(floats[i] * scale + 0.5), d);
+	}
+	put(']');
+	return true;
+}
+
+
+void CRibElementsWriter::fixedPointVars(const char *vars)
+{
+	m_fixedVars.clear();
+	if ( !vars )
+		return;
+	const char *cp = vars;
+	while ( *cp ) {
+		while ( *cp == ' ' || *cp == '\t' || *cp == ',' )
+			++cp;
+		const char *start = cp;
+		while ( *cp && *cp != ' ' && *cp != '\t' && *cp != ',' )
+			++cp;
+		if ( cp != start )
+			m_fixedVars.push_back(std::string(start, cp));
+	}
+}
 
-	code = (unsigned char)((tmp >> 8) & 0xffUL);
-	m_ostream << code;			
 
-	code = (unsigned char)(tmp & 0xffUL);
-	m_ostream << code;			
+bool CRibElementsWriter::fixedPointVar(const char *var) const
+{
+	if ( m_ascii || !var || (m_fixedAbs <= 0 && m_fixedRel <= 0) )
+		return false;
+	for ( std::vector<std::string>::const_iterator i = m_fixedVars.begin(); i != m_fixedVars.end(); ++i ) {
+		if ( *i == var )
+			return true;
+	}
+	return false;
 }
 
 
@@ -199,7 +466,7 @@ void CRibElementsWriter::putBinValue(double aFloat)
 		for ( i = 0; i < 8; i++ )
 #endif        
 		{
-			m_ostream << v[i];
+			put((char)v[i]);
 		}
 }
 
@@ -213,12 +480,14 @@ void CRibElementsWriter::putRequest(EnumRequests aRequest)
 		if ( !m_reqEncoding[aRequest] ) {
 			unsigned char code = 0314;
 			m_reqEncoding[aRequest] =  (unsigned char)aRequest;
-			m_ostream << code << m_reqEncoding[aRequest];
+			put((char)code);
+			put((char)m_reqEncoding[aRequest]);
 			putString(CRequestInfo::requestName(aRequest));
 			// Also write the request hereafter
 		}
 		unsigned char code = 0246;
-		m_ostream << code << m_reqEncoding[aRequest];
+		put((char)code);
+		put((char)m_reqEncoding[aRequest]);
 	}
 	m_notify.requestWritten(aRequest);
 }
@@ -234,28 +503,28 @@ void CRibElementsWriter::putLength(unsigned char code, unsigned long length)
 	if ( length > 0xffffffUL )
 		bytes = 3;
 	code += bytes;
-	m_ostream << code;
+	put((char)code);
 
 	if ( bytes == 3 ) {
 		code = (unsigned char)((length >> 24) & 0xffUL);
-		m_ostream << code;			
+		put((char)code);			
 	}
 	if ( bytes >= 2 ) {
 		code = (unsigned char)((length >> 16) & 0xffUL);
-		m_ostream << code;			
+		put((char)code);			
 	}
 	if ( bytes >= 1 ) {
 		code = (unsigned char)((length >> 8) & 0xffUL);
-		m_ostream << code;			
+		put((char)code);			
 	}
 	code = (unsigned char)(length & 0xffUL);
-	m_ostream << code;			
+	put((char)code);			
 }
 
 
 void CRibElementsWriter::putArray()
 {
-	m_ostream << "[ ]";
+	put("[ ]", 3);
 }
 
 void CRibElementsWriter::putArray(const RtMatrix m)
@@ -286,21 +555,29 @@ void CRibElementsWriter::putArray(unsigned long length, const float *floats)
 {
 	assert ((length > 0) ? floats != 0 : true); 
 	if ( m_ascii ) {
-		m_ostream << "[";
+		put('[');
+		char buf[32];
 		for ( unsigned long i = 0; i< length; ++i ) {
-			m_ostream << " " << floats[i];
+			buf[0] = ' ';
+			put(buf, 1 + formatShortest(buf+1, floats[i]));
 		}
-		m_ostream << " ]";
+		put(" ]", 2);
 	} else {
 		unsigned char code = 0310;
 		putLength(code, length);
-		for ( unsigned long i = 0; i< length; ++i ) {
-			putBinValue(floats[i]);
-		}
+		putBinValues(length, floats);
 	}
 }
 
 
+void CRibElementsWriter::putParameterArray(const char *var, const std::vector<float> &floats)
+{
+	if ( !floats.empty() && fixedPointVar(var) && putFixedArray((unsigned long)floats.size(), &floats[0]) )
+		return;
+	putArray(floats);
+}
+
+
 void CRibElementsWriter::putArray(const std::vector<double> &floats)
 {
 	putArray((unsigned long)floats.size(), floats.size() ? &floats[0] : 0);
@@ -310,12 +587,12 @@ void CRibElementsWriter::putArray(const std::vector<double> &floats)
 void CRibElementsWriter::putArray(unsigned long length, const double *floats)
 {
 	assert ((length > 0) ? floats != 0 : true); 
-	m_ostream << "[";
+	put('[');
 	for ( unsigned long i = 0; i < length; ++i ) {
-		m_ostream << " ";
+		put(' ');
 		putValue(floats[i]);
 	}
-	m_ostream << " ]";
+	put(" ]", 2);
 }
 
 
@@ -328,12 +605,12 @@ void CRibElementsWriter::putArray(const std::vector<RtInt> &integers)
 void CRibElementsWriter::putArray(unsigned long length, const RtInt *integers)
 {
 	assert ((length > 0) ? integers != 0 : true); 
-	m_ostream << "[";
+	put('[');
 	for ( size_t i = 0; i< length; ++i ) {
-		m_ostream << " ";
+		put(' ');
 		putValue(integers[i]);
 	}
-	m_ostream << " ]";
+	put(" ]", 2);
 }
 
 
@@ -346,12 +623,12 @@ void CRibElementsWriter::putArray(const std::vector<RtString> &strings)
 void CRibElementsWriter::putArray(unsigned long length, const RtString *strings)
 {
 	assert ((length > 0) ? strings != 0 : true); 
-	m_ostream << "[";
+	put('[');
 	for ( size_t i = 0; i< length; ++i ) {
-		m_ostream << " ";
+		put(' ');
 		putString(strings[i]);
 	}
-	m_ostream << " ]";
+	put(" ]", 2);
 }
 
 
@@ -378,22 +655,23 @@ void CRibElementsWriter::putTokenArray(const std::vector<RtString> &strings)
 void CRibElementsWriter::putTokenArray(unsigned long length, const RtString *strings)
 {
 	assert ((length > 0) ? strings != 0 : true); 
-	m_ostream << "[";
+	put('[');
 	for ( size_t i = 0; i< length; ++i ) {
-		m_ostream << " ";
+		put(' ');
 		putStringToken(strings[i]);
 	}
-	m_ostream << " ]";
+	put(" ]", 2);
 }
 
 
 void CRibElementsWriter::putValue(float aFloat)
 {
 	if ( m_ascii ) {
-		m_ostream << aFloat;
+		char buf[32];
+		put(buf, formatShortest(buf, aFloat));
 	} else {
 		unsigned char code = 0244;
-		m_ostream << code;
+		put((char)code);
 		putBinValue(aFloat);
 	}
 }
@@ -402,10 +680,11 @@ void CRibElementsWriter::putValue(float aFloat)
 void CRibElementsWriter::putValue(double aFloat)
 {
 	if ( m_ascii ) {
-		m_ostream << aFloat;
+		char buf[32];
+		put(buf, formatShortest(buf, aFloat));
 	} else {
 		unsigned char code = 0245;
-		m_ostream << code;
+		put((char)code);
 		putBinValue(aFloat);
 	}
 }
@@ -414,10 +693,12 @@ void CRibElementsWriter::putValue(double aFloat)
 void CRibElementsWriter::putValue(int anInteger)
 {
 	if ( m_ascii ) {
-		m_ostream << anInteger;
+		char buf[24];
+		put(buf, formatInteger(buf,
+			anInteger < 0 ? 0ULL - (unsigned long long)anInteger : (unsigned long long)anInteger,
+			anInteger < 0));
 	} else {
-		unsigned char code = 0200;
-		putLength(code, (unsigned long)anInteger);
+		putFixedValue((long)anInteger, 0);
 	}
 }
 
@@ -425,10 +706,12 @@ void CRibElementsWriter::putValue(int anInteger)
 void CRibElementsWriter::putValue(unsigned long anInteger)
 {
 	if ( m_ascii ) {
-		m_ostream << anInteger;
+		char buf[24];
+		put(buf, formatInteger(buf, anInteger, false));
+	} else if ( anInteger <= 0x7fffffffUL ) {
+		putFixedValue((long)anInteger, 0);
 	} else {
-		unsigned char code = 0200;
-		putLength(code, (unsigned long)anInteger);
+		putValue((double)anInteger);
 	}
 }
 
@@ -440,11 +723,11 @@ void CRibElementsWriter::putString(RtString aString)
 
 	if ( m_ascii ) {
 	
-		m_ostream << "\"";
+		put('"');
 		for ( ; *aString; ++aString ) {
 			putEncodedChar( *aString );
 		}
-		m_ostream << "\"";
+		put('"');
 		
 	} else {
 	
@@ -452,7 +735,7 @@ void CRibElementsWriter::putString(RtString aString)
 
 		if ( len < 16 ) {
 			unsigned char code = 0220+(unsigned char)len;
-			m_ostream << code;
+			put((char)code);
 			putChars(aString);
 			return;
 		}
@@ -470,14 +753,14 @@ void CRibElementsWriter::putStringTokenNum(unsigned char code, unsigned long tok
 	if ( tok > 0xffUL )
 		bytes = 1;
 	code += bytes;
-	m_ostream << code;			
+	put((char)code);			
 
 	if ( bytes >= 1 ) {
 		code = (unsigned char)((tok >> 8) & 0xffUL);
-		m_ostream << code;			
+		put((char)code);			
 	}
 	code = (unsigned char)(tok & 0xffUL);
-	m_ostream << code;
+	put((char)code);
 }
 
 
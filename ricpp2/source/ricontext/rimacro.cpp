@@ -33,6 +33,10 @@
 #include "ricpp/ricontext/triangulation.h"
 #endif // _RICPP_RICONTEXT_TRIANGULATION_H
 
+#ifndef _RICPP_TOOLS_TRACER_H
+#include "ricpp/tools/tracer.h"
+#endif // _RICPP_TOOLS_TRACER_H
+
 using namespace RiCPP;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -117,6 +121,8 @@ void CRiMacro::replay(IDoRender &ri, const IArchiveCallback *callback)
 	if ( !state )
 		return;
 
+	CTraceScope trace("replay", handle());
+
 	RtToken archiveNameStored = state->archiveName();
 	long linNoStored = state->lineNo();
 	
@@ -193,7 +199,7 @@ void CVarParamRManInterfaceCall::writeRIB(CRibElementsWriter &ribWriter, RtInt n
 				ribWriter.putArray(p.ints());
 				break;
 			case BASICTYPE_FLOAT:
-				ribWriter.putArray(p.floats());
+				ribWriter.putParameterArray(p.var(), p.floats());
 				break;
 			case BASICTYPE_STRING:
 				ribWriter.putArray(p.stringPtrs());
@@ -214,12 +220,88 @@ void CVarParamRManInterfaceCall::writeRIB(CRibElementsWriter &ribWriter, RtInt n
 	TypeParent::writeRIB(ribWriter, n, ignoreTokens);
 }
 
-/*
+bool CVarParamRManInterfaceCall::boundableByVertices() const
+{
+	const CParameter *p = parameters().get(RI_P);
+	if ( p ) {
+		return p->floats().size() >= 3;
+	}
+
+	p = parameters().get(RI_PW);
+	if ( !p || p->floats().size() < 4 )
+		return false;
+
+	const std::vector<RtFloat> &pw = p->floats();
+	for ( std::vector<RtFloat>::size_type i = 3; i < pw.size(); i += 4 ) {
+		if ( !(pw[i] > 0) )
+			return false;
+	}
+	return true;
+}
+
 void CVarParamRManInterfaceCall::getBounds(RtBound bounds) const
 {
-	// @todo Bounds, first consider RI_P then (if not found) RI_PW
+	// First consider RI_P then (if not found) RI_PW
+	std::vector<RtFloat>::size_type stride = 3;
+	const CParameter *p = parameters().get(RI_P);
+	if ( !p ) {
+		p = parameters().get(RI_PW);
+		stride = 4;
+	}
+
+	bounds[0] = bounds[1] = bounds[2] = bounds[3] = bounds[4] = bounds[5] = 0;
+	if ( !p || p->floats().size() < stride )
+		return;
+
+	const std::vector<RtFloat> &v = p->floats();
+	for ( std::vector<RtFloat>::size_type i = 0; i+stride <= v.size(); i += stride ) {
+		RtFloat w = stride == 4 ? v[i+3] : 1;
+		for ( int j = 0; j < 3; ++j ) {
+			RtFloat c = v[i+j] / w;
+			if ( i == 0 || c < bounds[2*j] )
+				bounds[2*j] = c;
+			if ( i == 0 || c > bounds[2*j+1] )
+				bounds[2*j+1] = c;
+		}
+	}
 }
+
+unsigned long long CVarParamRManInterfaceCall::parameterBytes() const
+{
+	unsigned long long bytes = 0;
+	CParameterList::const_iterator i;
+	for ( i = parameters().begin(); i != parameters().end(); ++i ) {
+		bytes += (*i).floats().size() * sizeof(RtFloat);
+		bytes += (*i).ints().size() * sizeof(RtInt);
+		std::vector<std::string>::const_iterator s;
+		for ( s = (*i).strings().begin(); s != (*i).strings().end(); ++s )
+			bytes += (*s).size();
+	}
+	return bytes;
+}
+
+/** @brief Widens @a bounds by half of the largest width of points or curves.
+ *  @param params Parameters of the primitive (RI_WIDTH, RI_CONSTANTWIDTH).
+ *  @retval bounds Bounds of the vertices, widened on return.
  */
+static void widenBounds(const CParameterList &params, RtBound bounds)
+{
+	RtFloat width = 1; // Default width
+	const CParameter *p = params.get(RI_WIDTH);
+	if ( p && !p->floats().empty() ) {
+		width = tmax(p->floats().size(), &(p->floats()[0]));
+	} else {
+		p = params.get(RI_CONSTANTWIDTH);
+		if ( p && !p->floats().empty() )
+			width = p->floats()[0];
+	}
+
+	width = (RtFloat)fabs(width) / 2;
+	for ( int j = 0; j < 3; ++j ) {
+		bounds[2*j] -= width;
+		bounds[2*j+1] += width;
+	}
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 void CRiGeneralPolygon::enterValues(RtInt theNLoops, const RtInt theNVerts[])
@@ -748,6 +830,19 @@ void CRiCurves::get(
 	aNVerts = m_nverts;
 }
 
+void CRiCurves::getBounds(RtBound bounds) const
+{
+	TypeParent::getBounds(bounds);
+	widenBounds(parameters(), bounds);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void CRiPoints::getBounds(RtBound bounds) const
+{
+	TypeParent::getBounds(bounds);
+	widenBounds(parameters(), bounds);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 CRiBlobby::CRiBlobby(
 	long aLineNo, CDeclarationDictionary &decl, const CColorDescr &curColorDescr,
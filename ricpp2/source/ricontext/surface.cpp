@@ -37,6 +37,8 @@
 
 using namespace RiCPP;
 
+std::atomic<unsigned long> CFace::ms_nextSerial(1);
+
 void CFace::insertConst(const CParameter &p)
 {
 	const CDeclaration *decl = p.declarationPtr();
@@ -509,6 +509,131 @@ void CTransformation::CMovedSkew::sampleReset(CMatrix3D &ctm, CMatrix3D &inverse
 	}
 }
 // -----------------------------------------------------------------------------
+CTransformation::EnumMatrixClass CTransformation::classify(const RtMatrix m)
+{
+	if ( m[0][3] != 0 || m[1][3] != 0 || m[2][3] != 0 || m[3][3] != 1 )
+		return MATRIX_PROJECTIVE;
+	bool translated = m[3][0] != 0 || m[3][1] != 0 || m[3][2] != 0;
+	if ( m[0][1] == 0 && m[0][2] == 0 &&
+	     m[1][0] == 0 && m[1][2] == 0 &&
+	     m[2][0] == 0 && m[2][1] == 0 )
+	{
+		if ( m[0][0] == 1 && m[1][1] == 1 && m[2][2] == 1 )
+			return translated ? MATRIX_TRANSLATE : MATRIX_IDENTITY;
+		return MATRIX_SCALE;
+	}
+	// Orthonormal rows, rotation (or reflection)
+	const RtFloat eps = static_cast<RtFloat>(1e-6);
+	for ( int i = 0; i < 3; ++i ) {
+		for ( int j = i; j < 3; ++j ) {
+			RtFloat d = m[i][0]*m[j][0] + m[i][1]*m[j][1] + m[i][2]*m[j][2];
+			if ( i == j )
+				d -= 1;
+			if ( d > eps || d < -eps )
+				return MATRIX_AFFINE;
+		}
+	}
+	return MATRIX_RIGID;
+}
+CTransformation::EnumMatrixClass CTransformation::combine(EnumMatrixClass c1, EnumMatrixClass c2)
+{
+	if ( c1 == MATRIX_IDENTITY )
+		return c2;
+	if ( c2 == MATRIX_IDENTITY || c1 == c2 )
+		return c1;
+	if ( c1 == MATRIX_PROJECTIVE || c2 == MATRIX_PROJECTIVE )
+		return MATRIX_PROJECTIVE;
+	if ( c1 == MATRIX_TRANSLATE && (c2 == MATRIX_SCALE || c2 == MATRIX_RIGID) )
+		return c2;
+	if ( c2 == MATRIX_TRANSLATE && (c1 == MATRIX_SCALE || c1 == MATRIX_RIGID) )
+		return c1;
+	return MATRIX_AFFINE;
+}
+bool CTransformation::invert(const RtMatrix m, EnumMatrixClass c, RtMatrix inv)
+{
+	// Inverse of [A 0, t 1] is [A' 0, -tA' 1], A' is the inverse of the 3x3 matrix A
+	switch ( c ) {
+		case MATRIX_IDENTITY:
+			memcpy(inv, RiIdentityMatrix, sizeof(RtMatrix));
+			return true;
+		case MATRIX_TRANSLATE:
+			memcpy(inv, RiIdentityMatrix, sizeof(RtMatrix));
+			inv[3][0] = -m[3][0];
+			inv[3][1] = -m[3][1];
+			inv[3][2] = -m[3][2];
+			return true;
+		case MATRIX_SCALE:
+			if ( m[0][0] == 0 || m[1][1] == 0 || m[2][2] == 0 )
+				return false;
+			memcpy(inv, RiIdentityMatrix, sizeof(RtMatrix));
+			inv[0][0] = static_cast<RtFloat>(1.0/m[0][0]);
+			inv[1][1] = static_cast<RtFloat>(1.0/m[1][1]);
+			inv[2][2] = static_cast<RtFloat>(1.0/m[2][2]);
+			inv[3][0] = -m[3][0]*inv[0][0];
+			inv[3][1] = -m[3][1]*inv[1][1];
+			inv[3][2] = -m[3][2]*inv[2][2];
+			return true;
+		case MATRIX_RIGID:
+		case MATRIX_AFFINE: {
+			if ( c == MATRIX_RIGID ) {
+				for ( int i = 0; i < 3; ++i )
+					for ( int j = 0; j < 3; ++j )
+						inv[i][j] = m[j][i];
+			} else {
+				RtFloat c00 = m[1][1]*m[2][2] - m[1][2]*m[2][1];
+				RtFloat c01 = m[1][2]*m[2][0] - m[1][0]*m[2][2];
+				RtFloat c02 = m[1][0]*m[2][1] - m[1][1]*m[2][0];
+				RtFloat det = m[0][0]*c00 + m[0][1]*c01 + m[0][2]*c02;
+				if ( det == 0 )
+					return false;
+				RtFloat d = static_cast<RtFloat>(1.0/det);
+				inv[0][0] = c00*d;
+				inv[1][0] = c01*d;
+				inv[2][0] = c02*d;
+				inv[0][1] = (m[0][2]*m[2][1] - m[0][1]*m[2][2])*d;
+				inv[1][1] = (m[0][0]*m[2][2] - m[0][2]*m[2][0])*d;
+				inv[2][1] = (m[0][1]*m[2][0] - m[0][0]*m[2][1])*d;
+				inv[0][2] = (m[0][1]*m[1][2] - m[0][2]*m[1][1])*d;
+				inv[1][2] = (m[0][2]*m[1][0] - m[0][0]*m[1][2])*d;
+				inv[2][2] = (m[0][0]*m[1][1] - m[0][1]*m[1][0])*d;
+			}
+			for ( int j = 0; j < 3; ++j ) {
+				inv[3][j] = -(m[3][0]*inv[0][j] + m[3][1]*inv[1][j] + m[3][2]*inv[2][j]);
+			}
+			inv[0][3] = inv[1][3] = inv[2][3] = 0;
+			inv[3][3] = 1;
+			return true;
+		}
+		default: {
+			CMatrix3D mat(m);
+			RtMatrix res;
+			if ( !mat.getInverse(res) )
+				return false;
+			memcpy(inv, res, sizeof(RtMatrix));
+			return true;
+		}
+	}
+}
+RtFloat CTransformation::determinant(const RtMatrix m, EnumMatrixClass c)
+{
+	switch ( c ) {
+		case MATRIX_IDENTITY:
+		case MATRIX_TRANSLATE:
+			return 1;
+		case MATRIX_SCALE:
+			return m[0][0]*m[1][1]*m[2][2];
+		case MATRIX_RIGID:
+		case MATRIX_AFFINE:
+			return m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) +
+			       m[0][1]*(m[1][2]*m[2][0] - m[1][0]*m[2][2]) +
+			       m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+		default: {
+			CMatrix3D mat(m);
+			return mat.determinant();
+		}
+	}
+}
+// -----------------------------------------------------------------------------
 CTransformation::CTransformation()
 {
 	m_dirty = false;
@@ -522,6 +647,8 @@ CTransformation::CTransformation()
 	m_CTM.setPreMultiply(true);
 	m_inverseCTM.identity();
 	m_inverseCTM.setPreMultiply(false);
+	m_inverseStale = false;
+	m_ctmClass = MATRIX_IDENTITY;
 	// The ...onMotionStart variables are initialized at motionBegin
 	// m_CTM_onMotionStart = m_CTM;
 	// m_inverseCTM_onMotionStart = m_inverseCTM;
@@ -539,6 +666,18 @@ void CTransformation::clear()
 	m_deferedTrans.clear();
 	dirty(true);
 }
+void CTransformation::validateInverse() const
+{
+	if ( !m_inverseStale )
+		return;
+	m_inverseStale = false;
+	RtMatrix inv;
+	if ( invert(m_CTM.getMatrix(), m_ctmClass, inv) ) {
+		m_inverseCTM.set(inv);
+	} else {
+		m_inverseCTM.identity();
+	}
+}
 CTransformation *CTransformation::duplicate() const
 { 
 	if ( m_factory )
@@ -555,6 +694,8 @@ CTransformation &CTransformation::operator=(const CTransformation &o)
 	
 	m_CTM = o.m_CTM;
 	m_inverseCTM = o.m_inverseCTM;
+	m_inverseStale = o.m_inverseStale;
+	m_ctmClass = o.m_ctmClass;
 	m_isValid_onMotionStart = o.m_isValid_onMotionStart;
 	m_CTM_onMotionStart = o.m_CTM_onMotionStart;
 	m_inverseCTM_onMotionStart = o.m_inverseCTM_onMotionStart;
@@ -581,6 +722,8 @@ void CTransformation::reset()
 	m_isValid = true;
 	m_CTM.identity();
 	m_inverseCTM.identity();
+	m_inverseStale = false;
+	m_ctmClass = MATRIX_IDENTITY;
 	clear();
 }
 void CTransformation::identity()
@@ -589,6 +732,8 @@ void CTransformation::identity()
 	if ( !m_motionState ) {
 		m_CTM.identity();
 		m_inverseCTM.identity();
+		m_inverseStale = false;
+		m_ctmClass = MATRIX_IDENTITY;
 		m_isValid = true;
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
@@ -596,10 +741,12 @@ void CTransformation::identity()
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM ) {
+			validateInverse();
 			dynamic_cast<CMovedMatrix *>(m_deferedTrans.back())->set(
 				RiIdentityMatrix, false,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -610,14 +757,26 @@ void CTransformation::transform(const RtMatrix aTransform)
 	dirty(true);
 	if ( !m_motionState ) {
 		m_CTM.transform(aTransform);
-		CMatrix3D mat(aTransform);
+		m_ctmClass = classify(aTransform);
 		RtMatrix inv;
-		if ( !mat.getInverse(inv) ) {
-			m_isValid = false;
-			m_inverseCTM.identity();
-			throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::transform()");
+		if ( m_ctmClass == MATRIX_PROJECTIVE ) {
+			if ( !invert(aTransform, m_ctmClass, inv) ) {
+				m_isValid = false;
+				m_inverseCTM.identity();
+				m_inverseStale = false;
+				throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::transform()");
+			}
+			m_inverseCTM.transform(inv);
+			m_inverseStale = false;
+		} else {
+			if ( determinant(aTransform, m_ctmClass) == 0 ) {
+				m_isValid = false;
+				m_inverseCTM.identity();
+				m_inverseStale = false;
+				throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::transform()");
+			}
+			m_inverseStale = true;
 		}
-		m_inverseCTM.transform(inv);
 		m_isValid = true;
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
@@ -625,10 +784,12 @@ void CTransformation::transform(const RtMatrix aTransform)
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM ) {
+			validateInverse();
 			dynamic_cast<CMovedMatrix *>(m_deferedTrans.back())->set(
 				aTransform, false,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -640,6 +801,8 @@ void CTransformation::transform(const RtMatrix aTransform, const RtMatrix anInve
 	if ( !m_motionState ) {
 		m_CTM.transform(aTransform);
 		m_inverseCTM.transform(anInverseTransform);
+		m_inverseStale = false;
+		m_ctmClass = classify(aTransform);
 		m_isValid = true;
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
@@ -647,10 +810,12 @@ void CTransformation::transform(const RtMatrix aTransform, const RtMatrix anInve
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM ) {
+			validateInverse();
 			dynamic_cast<CMovedMatrix *>(m_deferedTrans.back())->set(
 				aTransform, anInverseTransform, false,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -660,24 +825,47 @@ void CTransformation::concatTransform(const RtMatrix aTransform)
 {
 	dirty(true);
 	if ( !m_motionState ) {
-		m_CTM.concatTransform(aTransform);
-		CMatrix3D mat(aTransform);
-		RtMatrix inv;
-		if ( !mat.getInverse(inv) ) {
-			m_isValid = false;
-			throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::concatTransform()");
+		EnumMatrixClass c = classify(aTransform);
+		EnumMatrixClass newClass = combine(m_ctmClass, c);
+		bool singular = c != MATRIX_PROJECTIVE && determinant(aTransform, c) == 0;
+		if ( singular || !lazyInverse() || newClass == MATRIX_PROJECTIVE ) {
+			// Concatenate the inverse at once
+			validateInverse();
+			RtMatrix inv;
+			singular = singular || !invert(aTransform, c, inv);
+			m_CTM.concatTransform(aTransform);
+			m_ctmClass = newClass;
+			if ( singular ) {
+				m_isValid = false;
+				throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::concatTransform()");
+			}
+			m_inverseCTM.concatTransform(inv);
+		} else {
+			switch ( c ) {
+				case MATRIX_IDENTITY:
+					break;
+				case MATRIX_TRANSLATE:
+					m_CTM.translate(aTransform[3][0], aTransform[3][1], aTransform[3][2]);
+					break;
+				default:
+					m_CTM.concatTransform(aTransform);
+					break;
+			}
+			m_ctmClass = newClass;
+			m_inverseStale = true;
 		}
-		m_inverseCTM.concatTransform(inv);
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
 			m_deferedTrans.push_back(new CMovedMatrix);
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM ) {
+			validateInverse();
 			dynamic_cast<CMovedMatrix *>(m_deferedTrans.back())->set(
 				aTransform, true,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -687,18 +875,26 @@ void CTransformation::concatTransform(const RtMatrix aTransform, const RtMatrix
 {
 	dirty(true);
 	if ( !m_motionState ) {
+		EnumMatrixClass newClass = combine(m_ctmClass, classify(aTransform));
+		if ( newClass == MATRIX_PROJECTIVE )
+			validateInverse();
 		m_CTM.concatTransform(aTransform);
-		m_inverseCTM.concatTransform(anInverseTransform);
+		m_ctmClass = newClass;
+		// The given inverse is only used, if the inverse is not calculated lazily anyway
+		if ( !m_inverseStale )
+			m_inverseCTM.concatTransform(anInverseTransform);
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
 			m_deferedTrans.push_back(new CMovedMatrix);
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSFORM ) {
+			validateInverse();
 			dynamic_cast<CMovedMatrix *>(m_deferedTrans.back())->set(
 				aTransform, anInverseTransform, true,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -711,18 +907,22 @@ void CTransformation::perspective(RtFloat fov)
 		if ( fov >= (RtFloat)180.0 || fov <= -(RtFloat)180.0 ) {
 			throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "CTransformation::perspective(%f), fov out of range", fov);
 		}
+		validateInverse();
 		m_CTM.perspective(fov);
 		m_inverseCTM.inversePerspective(fov);
+		m_ctmClass = MATRIX_PROJECTIVE;
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
 			m_deferedTrans.push_back(new CMovedPerspective);
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSLATE );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSLATE ) {
+			validateInverse();
 			dynamic_cast<CMovedPerspective *>(m_deferedTrans.back())->set(
 				fov,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -733,17 +933,24 @@ void CTransformation::translate(RtFloat dx, RtFloat dy, RtFloat dz)
 	dirty(true);
 	if ( !m_motionState ) {
 		m_CTM.translate(dx, dy, dz);
-		m_inverseCTM.translate(-dx, -dy, -dz);
+		if ( lazyInverse() ) {
+			m_inverseStale = true;
+		} else {
+			m_inverseCTM.translate(-dx, -dy, -dz);
+		}
+		m_ctmClass = combine(m_ctmClass, MATRIX_TRANSLATE);
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
 			m_deferedTrans.push_back(new CMovedTranslate);
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSLATE );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_TRANSLATE ) {
+			validateInverse();
 			dynamic_cast<CMovedTranslate *>(m_deferedTrans.back())->set(
 				dx, dy, dz,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -754,17 +961,24 @@ void CTransformation::rotate(RtFloat angle, RtFloat dx, RtFloat dy, RtFloat dz)
 	dirty(true);
 	if ( !m_motionState ) {
 		m_CTM.rotate(angle, dx, dy, dz);
-		m_inverseCTM.rotate(-angle, dx, dy, dz);
+		if ( lazyInverse() ) {
+			m_inverseStale = true;
+		} else {
+			m_inverseCTM.rotate(-angle, dx, dy, dz);
+		}
+		m_ctmClass = combine(m_ctmClass, MATRIX_RIGID);
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
 			m_deferedTrans.push_back(new CMovedRotate);
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_ROTATE );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_ROTATE ) {
+			validateInverse();
 			dynamic_cast<CMovedRotate *>(m_deferedTrans.back())->set(
 				angle, dx, dy, dz,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -774,27 +988,32 @@ void CTransformation::scale(RtFloat dx, RtFloat dy, RtFloat dz)
 {
 	dirty(true);
 	if ( !m_motionState ) {
-		m_CTM.scale(dx, dy, dz);
-		
-		bool throwErr = false;
-		if ( dx == 0 ) {
-			dx = static_cast<RtFloat>(1.0);
-			throwErr = true;
-		}
-		if ( dy == 0 ) {
-			dy = static_cast<RtFloat>(1.0);
-			throwErr = true;
-		}
-		if ( dz == 0 ) {
-			dz = static_cast<RtFloat>(1.0);
-			throwErr = true;
-		}
-		
-		m_inverseCTM.scale(static_cast<RtFloat>(1.0/dx), static_cast<RtFloat>(1.0/dy), static_cast<RtFloat>(1.0/dz));
-		
-		if ( throwErr ) {
-			m_isValid = false;
-			throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::scale()");
+		bool throwErr = dx == 0 || dy == 0 || dz == 0;
+		if ( throwErr || !lazyInverse() ) {
+			validateInverse();
+			m_CTM.scale(dx, dy, dz);
+			m_ctmClass = combine(m_ctmClass, MATRIX_SCALE);
+			
+			if ( dx == 0 ) {
+				dx = static_cast<RtFloat>(1.0);
+			}
+			if ( dy == 0 ) {
+				dy = static_cast<RtFloat>(1.0);
+			}
+			if ( dz == 0 ) {
+				dz = static_cast<RtFloat>(1.0);
+			}
+			
+			m_inverseCTM.scale(static_cast<RtFloat>(1.0/dx), static_cast<RtFloat>(1.0/dy), static_cast<RtFloat>(1.0/dz));
+			
+			if ( throwErr ) {
+				m_isValid = false;
+				throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "Could not calculate inverse matrix in %s", "CTransformation::scale()");
+			}
+		} else {
+			m_CTM.scale(dx, dy, dz);
+			m_ctmClass = combine(m_ctmClass, MATRIX_SCALE);
+			m_inverseStale = true;
 		}
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
@@ -802,10 +1021,12 @@ void CTransformation::scale(RtFloat dx, RtFloat dy, RtFloat dz)
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_SCALE );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_SCALE ) {
+			validateInverse();
 			dynamic_cast<CMovedScale *>(m_deferedTrans.back())->set(
 				dx, dy, dz,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -819,17 +1040,24 @@ void CTransformation::skew(RtFloat angle, RtFloat dx1, RtFloat dy1, RtFloat dz1,
 			throw ExceptRiCPPError(RIE_MATH, RIE_ERROR, __LINE__, __FILE__, "CTransformation::skew(%f), skew out of range", angle);
 		}
 		m_CTM.skew(angle, dx1, dy1, dz1, dx2, dy2, dz2);
-		m_inverseCTM.skew(-angle, dx1, dy1, dz1, dx2, dy2, dz2);
+		if ( lazyInverse() ) {
+			m_inverseStale = true;
+		} else {
+			m_inverseCTM.skew(-angle, dx1, dy1, dz1, dx2, dy2, dz2);
+		}
+		m_ctmClass = combine(m_ctmClass, MATRIX_AFFINE);
 	} else {
 		if ( m_motionState->curSampleIdx() == 0 ) {
 			m_deferedTrans.push_back(new CMovedSkew);
 		}
 		assert( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_SKEW );
 		if ( !m_deferedTrans.empty() && m_deferedTrans.back() != 0 && m_deferedTrans.back()->reqType() == REQ_SKEW ) {
+			validateInverse();
 			dynamic_cast<CMovedSkew *>(m_deferedTrans.back())->set(
 				angle, dx1, dy1, dz1, dx2, dy2, dz2,
 				m_motionState->curSampleIdx(), m_motionState->firstSampleIdx(), m_motionState->lastSampleIdx(),
 				m_CTM, m_inverseCTM);
+			m_ctmClass = classify(m_CTM.getMatrix());
 		} else {
 			// ERROR
 		}
@@ -840,6 +1068,7 @@ void CTransformation::motionBegin(const CMotionState &state)
 	assert(m_motionState==0);
 	m_motionState = &state;
 	if ( m_deferedTrans.empty() ) {
+		validateInverse();
 		m_isValid_onMotionStart = m_isValid;
 		m_CTM_onMotionStart = m_CTM;
 		m_inverseCTM_onMotionStart = m_inverseCTM;
@@ -861,10 +1090,13 @@ void CTransformation::motionSuspend()
 }
 void CTransformation::sample(RtFloat shutterTime, const TypeMotionTimes &times)
 {
+	validateInverse();
 	std::vector<IMovedTransform *>::iterator i = m_deferedTrans.begin();
 	for ( ; i != m_deferedTrans.end(); ++i ) {
 		(*i)->sample(shutterTime, times, m_CTM, m_inverseCTM);
 	}
+	if ( !m_deferedTrans.empty() )
+		m_ctmClass = classify(m_CTM.getMatrix());
 }
 void CTransformation::sampleReset()
 {
@@ -872,10 +1104,12 @@ void CTransformation::sampleReset()
 		m_isValid = m_isValid_onMotionStart;
 		m_CTM = m_CTM_onMotionStart;
 		m_inverseCTM = m_inverseCTM_onMotionStart;
+		m_inverseStale = false;
 		std::vector<IMovedTransform *>::iterator i = m_deferedTrans.begin();
 		for ( ; i != m_deferedTrans.end(); ++i ) {
 			(*i)->sampleReset(m_CTM, m_inverseCTM);
 		}
+		m_ctmClass = classify(m_CTM.getMatrix());
 	}
 }
 RtToken CTransformation::coordSysOrientation() const
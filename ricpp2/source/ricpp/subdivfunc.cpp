@@ -38,9 +38,16 @@
 #include "ricpp/tools/filepath.h"
 #endif // _RICPP_TOOLS_FILEPATH_H
 
-#ifndef _RICPP_TOOLS_ENV_H
-#include "ricpp/tools/env.h"
-#endif // _RICPP_TOOLS_ENV_H
+#ifndef _RICPP_TOOLS_MEMORYBUFFERS_H
+#include "ricpp/tools/memorybuffers.h"
+#endif // _RICPP_TOOLS_MEMORYBUFFERS_H
+
+#include <cstdio>
+
+#if defined _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
 
 using namespace RiCPP;
 
@@ -74,11 +81,6 @@ RtVoid CProcRunProgram::operator()(IRi &ri, RtPointer data, RtFloat detail) cons
 	if ( !cmd || !cmd[0] )
 		return;
 
-	std::string tmpPath;
-	if ( !CEnv::getTempFilename(tmpPath, ".rib", false) ) {
-		return;
-	}
-
 	std::string cmdline;
 	if ( genRequestData && genRequestData[0] ) {
 		cmdline += "echo ";
@@ -86,15 +88,33 @@ RtVoid CProcRunProgram::operator()(IRi &ri, RtPointer data, RtFloat detail) cons
 		cmdline += " | ";
 	}
 	cmdline += cmd;
-	cmdline += " >";
-	cmdline += tmpPath;
 
+	// The output of the program is read into a memory buffer, no temporary file is used
+	FILE *pipe = popen(cmdline.c_str(), "r"); // Insecure !!!
+	if ( !pipe )
+		return;
 
-	system(cmdline.c_str()); // Insecure !!!
+	std::vector<char> output;
+	char chunk[8192];
+	size_t n;
+	while ( (n = fread(chunk, 1, sizeof(chunk), pipe)) > 0 ) {
+		output.insert(output.end(), chunk, chunk+n);
+	}
+	pclose(pipe);
 
-	ri.readArchive(tmpPath.c_str(), 0, RI_NULL);
-	
-	/// @todo delete tmpfile or better use CreateProcess() in win32 and similar on other OS.
+	std::string name(CMemoryBuffers::uniqueName("runprogram"));
+	if ( !CMemoryBuffers::registerBuffer(name.c_str(), output) )
+		return;
+
+	std::string uri("memory:");
+	uri += name;
+	try {
+		ri.readArchive(uri.c_str(), 0, RI_NULL);
+	} catch ( ... ) {
+		CMemoryBuffers::unregisterBuffer(name.c_str());
+		throw;
+	}
+	CMemoryBuffers::unregisterBuffer(name.c_str());
 }
 
 CProcRunProgram CProcRunProgram::func;
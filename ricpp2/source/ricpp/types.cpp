@@ -1080,29 +1080,46 @@ void CMatrix3D::concatTransform(CMatrix3D mat)
 }
 
 
+// Translation and scaling only touch some of the components,
+// no need for a full matrix multiplication.
+
 void CMatrix3D::translate(RtFloat dx, RtFloat dy, RtFloat dz)
 {
-        RtMatrix mat;
-
-        mat[0][0] = 1.0; mat[0][1] = 0.0; mat[0][2] = 0.0; mat[0][3] = 0.0;
-        mat[1][0] = 0.0; mat[1][1] = 1.0; mat[1][2] = 0.0; mat[1][3] = 0.0;
-        mat[2][0] = 0.0; mat[2][1] = 0.0; mat[2][2] = 1.0; mat[2][3] = 0.0;
-        mat[3][0] = dx;  mat[3][1] = dy;  mat[3][2] = dz;  mat[3][3] = 1.0;
-
-        concatTransform(mat);
+	int j;
+	if ( m_preMultiply ) {
+		// M' = T x M, only the last row changes
+		for ( j=0; j<4; ++j )
+			m_Matrix[3][j] += dx * m_Matrix[0][j] + dy * m_Matrix[1][j] + dz * m_Matrix[2][j];
+	} else {
+		// M' = M x T, the last column is added to the first three
+		for ( j=0; j<4; ++j ) {
+			RtFloat w = m_Matrix[j][3];
+			m_Matrix[j][0] += w * dx;
+			m_Matrix[j][1] += w * dy;
+			m_Matrix[j][2] += w * dz;
+		}
+	}
 }
 
 
 void CMatrix3D::scale(RtFloat sx, RtFloat sy, RtFloat sz)
 {
-        RtMatrix mat;
-
-        mat[0][0] = sx;  mat[0][1] = 0.0; mat[0][2] = 0.0; mat[0][3] = 0.0;
-        mat[1][0] = 0.0; mat[1][1] = sy;  mat[1][2] = 0.0; mat[1][3] = 0.0;
-        mat[2][0] = 0.0; mat[2][1] = 0.0; mat[2][2] = sz;  mat[2][3] = 0.0;
-        mat[3][0] = 0.0; mat[3][1] = 0.0; mat[3][2] = 0.0; mat[3][3] = 1.0;
-
-        concatTransform(mat);
+	int j;
+	if ( m_preMultiply ) {
+		// M' = S x M, scales the first three rows
+		for ( j=0; j<4; ++j ) {
+			m_Matrix[0][j] *= sx;
+			m_Matrix[1][j] *= sy;
+			m_Matrix[2][j] *= sz;
+		}
+	} else {
+		// M' = M x S, scales the first three columns
+		for ( j=0; j<4; ++j ) {
+			m_Matrix[j][0] *= sx;
+			m_Matrix[j][1] *= sy;
+			m_Matrix[j][2] *= sz;
+		}
+	}
 }
 
 
@@ -1153,7 +1170,15 @@ void CMatrix3D::transformPoints(RtInt n, RtPoint p[]) const
 	printMatrix(m_Matrix);
 #endif // _TRACE
 
-	if ( m_preMultiply ) {
+	if ( m_preMultiply && m_Matrix[0][3] == 0 && m_Matrix[1][3] == 0 && m_Matrix[2][3] == 0 && m_Matrix[3][3] == 1 ) {
+		// Affine, w stays 1
+		for ( j = 0; j < n; j+=3 ) {
+			RtFloat x = s[j], y = s[j+1], z = s[j+2];
+			s[j]   = x * m_Matrix[0][0] + y * m_Matrix[1][0] + z * m_Matrix[2][0] + m_Matrix[3][0];
+			s[j+1] = x * m_Matrix[0][1] + y * m_Matrix[1][1] + z * m_Matrix[2][1] + m_Matrix[3][1];
+			s[j+2] = x * m_Matrix[0][2] + y * m_Matrix[1][2] + z * m_Matrix[2][2] + m_Matrix[3][2];
+		}
+	} else if ( m_preMultiply ) {
 		for ( j = 0; j < n; j+=3 ) {
 			RtFloat t[4] = {s[j], s[j+1], s[j+2], 1.0};
 			RtFloat d[4] = {0.0, 0.0, 0.0, 0.0};
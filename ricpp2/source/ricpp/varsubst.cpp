@@ -22,6 +22,20 @@ namespace RiCPP {
 		return false;
 	}
 
+	// Test if aStr contains anything varSubst() would have to look at
+	bool hasVarSubst(const std::string &aStr, char varId, const char *stdPath, const char *curPath)
+	{
+		char specials[4] = { 0, 0, 0, 0 };
+		int nSpecials = 0;
+		if ( varId )
+			specials[nSpecials++] = varId;
+		if ( stdPath )
+			specials[nSpecials++] = '@';
+		if ( curPath )
+			specials[nSpecials++] = '&';
+		return nSpecials > 0 && aStr.find_first_of(specials) != std::string::npos;
+	}
+
 	std::string &varSubst(std::string &aStr, char varId, const IVarSubstCallback *cb, const char *stdPath, const char *curPath)
 	{
 		/**
@@ -40,7 +54,8 @@ namespace RiCPP {
 		 */
 		 
 		// No substitution?
-		if ( !varId && !stdPath && !curPath )
+		// Nothing to substitute, leave the string as it is without rebuilding it
+		if ( !hasVarSubst(aStr, varId, stdPath, curPath) )
 			return aStr;
 
 		bool found = false;
@@ -82,7 +97,7 @@ namespace RiCPP {
 						if ( i != aStr.end() )
 							++i;
 						varSubst(varname, varId, cb, stdPath, curPath); // recursive e.g. ${$var1$var2};
-						if ( (cb && cb->getValue(p, varname.c_str())) || getEnvValue(p, varname.c_str()) ) {
+						if ( cb ? (cb->getValue(p, varname.c_str()) || cb->getEnvValue(p, varname.c_str())) : getEnvValue(p, varname.c_str()) ) {
 							found = true;
 							p.get(resval);
 							result += resval;
@@ -105,7 +120,7 @@ namespace RiCPP {
 							varname += c;
 						}
 						// No i++
-						if ( (cb && cb->getValue(p, varname.c_str())) || getEnvValue(p, varname.c_str()) ) {
+						if ( cb ? (cb->getValue(p, varname.c_str()) || cb->getEnvValue(p, varname.c_str())) : getEnvValue(p, varname.c_str()) ) {
 							found = true;
 							p.get(resval);
 							result += resval;
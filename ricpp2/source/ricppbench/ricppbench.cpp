@@ -0,0 +1,954 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file ricppbench.cpp
+ *  @author Andreas Pidde (andreas@pidde.de).
+ *  @brief ricppbench, benchmarks of the RiCPP framework.
+
+Runs reproducible micro benchmarks (matrix transforms, the tesselators at
+several tessellation rates, the ear clipper and Catmull-Clark subdivision
+of depth 1 to 4) and macro benchmarks (writing and parsing of synthetic RIB
+scenes, ASCII, binary and gzip). The scenes are generated from a fixed seed
+at the start, all benchmarks use the same input in each run.
+
+Each benchmark is calibrated to run for at least the minimal time per
+sample, the median of the samples is reported as time per operation.
+
+The results are written as JSON. The compare mode reads a stored baseline
+(written by an earlier run) and flags the benchmarks that became slower
+than the threshold, the program returns 1 in this case.
+
+@verbatim
+ricppbench [options]
+-o file       Writes the results as JSON to file (default: standard output)
+-f pattern    Runs only the benchmarks matching the glob pattern, e.g. "tessellate/*"
+-k kind       Runs only the "micro" or "macro" benchmarks
+-r n          Number of samples per benchmark (default 5)
+-m ms         Minimal time of a sample in milliseconds (default 50)
+-s n          Size of the synthetic scenes (number of primitives, default 2000)
+-c baseline   Compares the results with a baseline (JSON written by -o)
+-t percent    Threshold of a regression in percent (default 10)
+-i results    Compares the results of an earlier run (-c) instead of running the benchmarks
+-l            Lists the benchmarks
+@endverbatim
+
+The renderer module ribwriter must be found, like for ribtool.
+ */
+
+#include "ricpp/ricppbridge/ricppbridge.h"
+
+#ifndef _RICPP_RICONTEXT_TRIANGULATION_H
+#include "ricpp/ricontext/triangulation.h"
+#endif // _RICPP_RICONTEXT_TRIANGULATION_H
+
+#ifndef _RICPP_RICONTEXT_POLYGON_H
+#include "ricpp/ricontext/polygon.h"
+#endif // _RICPP_RICONTEXT_POLYGON_H
+
+#ifndef _RICPP_RICONTEXT_SUBDIVISION_H
+#include "ricpp/ricontext/subdivision.h"
+#endif // _RICPP_RICONTEXT_SUBDIVISION_H
+
+#ifndef _RICPP_TOOLS_ENV_H
+#include "ricpp/tools/env.h"
+#endif // _RICPP_TOOLS_ENV_H
+
+#ifndef _RICPP_TOOLS_STRINGPATTERN_H
+#include "ricpp/tools/stringpattern.h"
+#endif // _RICPP_TOOLS_STRINGPATTERN_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace RiCPP;
+
+// ----------------------------------------------------------------------------
+// Settings
+
+static int repetitions = 5;           ///< Number of samples per benchmark
+static double minSampleTime = 0.05;   ///< Minimal time of a sample in seconds
+static unsigned long sceneSize = 2000; ///< Number of primitives of the synthetic scenes
+static const unsigned long SEED = 4711; ///< Seed of the synthetic data
+
+/** @brief Gets the current time.
+ *  @return Time in nanoseconds.
+ */
+static inline unsigned long long now()
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** @brief Deterministic random numbers (64 bit linear congruential generator).
+ *
+ *  Used instead of rand() to get the same data on all platforms.
+ */
+class CBenchRandom {
+	unsigned long long m_state;
+public:
+	inline CBenchRandom(unsigned long seed) : m_state(seed) {}
+
+	/** @brief Next random number.
+	 *  @return Number in [0, 1).
+	 */
+	inline RtFloat next()
+	{
+		m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (RtFloat)((m_state >> 40) & 0xffffff) / (RtFloat)0x1000000;
+	}
+
+	/** @brief Next random number in a range.
+	 *  @return Number in [lo, hi).
+	 */
+	inline RtFloat range(RtFloat lo, RtFloat hi) { return lo + (hi-lo)*next(); }
+};
+
+// ----------------------------------------------------------------------------
+// Benchmarks
+
+/** @brief Base class of a benchmark.
+ *
+ *  setup() prepares the data (not measured), run() is one measured operation.
+ */
+class CBenchmark {
+	std::string m_name;
+	bool m_isMacro;
+protected:
+	unsigned long long m_bytes; ///< Bytes processed by one operation (0 if not meaningful)
+	unsigned long long m_items; ///< Items (e.g. points) processed by one operation (0 if not meaningful)
+public:
+	inline CBenchmark(const std::string &aName, bool isMacro = false)
+	: m_name(aName), m_isMacro(isMacro), m_bytes(0), m_items(0) {}
+	virtual ~CBenchmark() {}
+
+	inline const std::string &name() const { return m_name; }
+	inline bool isMacro() const { return m_isMacro; }
+	inline unsigned long long bytes() const { return m_bytes; }
+	inline unsigned long long items() const { return m_items; }
+
+	virtual void setup() {}
+	virtual void run() = 0;
+	virtual void teardown() {}
+};
+
+/** @brief Result of a benchmark.
+ */
+struct SBenchResult {
+	std::string m_name;
+	std::string m_kind;
+	unsigned long long m_ops;    ///< Operations per sample
+	double m_ns;                 ///< Median time per operation (ns)
+	double m_minNs;              ///< Minimal time per operation (ns)
+	double m_maxNs;              ///< Maximal time per operation (ns)
+	double m_bytesPerSec;        ///< Throughput, 0 if not meaningful
+	double m_itemsPerSec;        ///< Throughput, 0 if not meaningful
+};
+
+/** @brief Declarations and strategies used by the primitives and tesselators.
+ */
+class CPrimEnv {
+public:
+	CDeclarationDictionary m_decl;
+	CColorDescr m_color;
+	const CDeclaration *m_posDecl;
+	const CDeclaration *m_normDecl;
+	CEarClipper m_earClipper;
+	CSubdivisionStrategies m_strategies;
+
+	CPrimEnv()
+	{
+		m_decl.declare(RI_P, "vertex point", true, m_color);
+		m_decl.declare(RI_N, "varying point", true, m_color);
+		m_decl.declare(RI_PW, "vertex hpoint", true, m_color);
+		m_posDecl = m_decl.find(RI_P);
+		m_normDecl = m_decl.find(RI_N);
+		m_strategies.registerObj(RI_CATMULL_CLARK, new CCatmullClarkSubdivision);
+		m_strategies.registerObj(RI_NULL, new CNoneSubdivision);
+	}
+};
+
+static CPrimEnv *primEnv = 0;
+
+/** @brief Tessellates a primitive, a new tesselator for each operation (the surfaces are cached by the tesselators).
+ */
+template <class Prim, class Tess> class TemplBaseTessBench : public CBenchmark {
+	Prim *m_prim;
+	IndexType m_tess;
+public:
+	inline TemplBaseTessBench(const std::string &aName, Prim *aPrim, IndexType aTess)
+	: CBenchmark(aName), m_prim(aPrim), m_tess(aTess) {}
+	virtual ~TemplBaseTessBench() { delete m_prim; }
+
+	virtual Tess *create() = 0;
+
+	virtual void run()
+	{
+		Tess *t = create();
+		t->tesselation(m_tess, m_tess);
+		CSurface *surf = t->tesselate(*primEnv->m_posDecl, *primEnv->m_normDecl);
+		// Items are the triangles
+		m_items = 0;
+		if ( surf ) {
+			for ( CSurface::const_iterator i = surf->begin(); i != surf->end(); ++i ) {
+				const std::vector<IndexType> &sizes = (*i).sizes();
+				for ( std::vector<IndexType>::const_iterator s = sizes.begin(); s != sizes.end(); ++s ) {
+					if ( (*i).faceType() == FACETYPE_TRIANGLES )
+						m_items += (*s) / 3;
+					else if ( (*i).faceType() == FACETYPE_TRIANGLESTRIPS && (*s) > 2 )
+						m_items += (*s) - 2;
+				}
+			}
+		}
+		delete t;
+	}
+
+protected:
+	inline Prim &prim() { return *m_prim; }
+};
+
+/** @brief Tessellates a primitive (quadrics, polygons, nupatch).
+ */
+template <class Prim, class Tess> class TemplTessBench : public TemplBaseTessBench<Prim, Tess> {
+public:
+	inline TemplTessBench(const std::string &aName, Prim *aPrim, IndexType aTess)
+	: TemplBaseTessBench<Prim, Tess>(aName, aPrim, aTess) {}
+	virtual Tess *create() { return new Tess(this->prim()); }
+};
+
+/** @brief Tessellates with a triangulation strategy (general polygons).
+ */
+template <class Prim, class Tess> class TemplStrategyTessBench : public TemplBaseTessBench<Prim, Tess> {
+public:
+	inline TemplStrategyTessBench(const std::string &aName, Prim *aPrim, IndexType aTess)
+	: TemplBaseTessBench<Prim, Tess>(aName, aPrim, aTess) {}
+	virtual Tess *create() { return new Tess(this->prim(), primEnv->m_earClipper); }
+};
+
+/** @brief Tessellates with a basis (patches).
+ */
+template <class Prim, class Tess> class TemplBasisTessBench : public TemplBaseTessBench<Prim, Tess> {
+	CRiBasis m_basis;
+public:
+	inline TemplBasisTessBench(const std::string &aName, Prim *aPrim, IndexType aTess)
+	: TemplBaseTessBench<Prim, Tess>(aName, aPrim, aTess) {}
+	virtual Tess *create() { return new Tess(this->prim(), m_basis); }
+};
+
+/** @brief Subdivision meshes, uses the subdivision strategies.
+ */
+class CSubdivBench : public TemplBaseTessBench<CRiSubdivisionMesh, CSubdivisionHierarchyTesselator> {
+public:
+	inline CSubdivBench(const std::string &aName, CRiSubdivisionMesh *aPrim, IndexType aTess)
+	: TemplBaseTessBench<CRiSubdivisionMesh, CSubdivisionHierarchyTesselator>(aName, aPrim, aTess) {}
+	virtual CSubdivisionHierarchyTesselator *create() { return new CSubdivisionHierarchyTesselator(prim(), primEnv->m_strategies); }
+};
+
+/** @brief Builds a grid (nu x nv vertices) in the xy plane with random heights.
+ */
+static void gridPoints(RtInt nu, RtInt nv, std::vector<RtFloat> &p, CBenchRandom &rnd)
+{
+	p.clear();
+	for ( RtInt v = 0; v < nv; ++v ) {
+		for ( RtInt u = 0; u < nu; ++u ) {
+			p.push_back((RtFloat)u/(RtFloat)(nu-1));
+			p.push_back((RtFloat)v/(RtFloat)(nv-1));
+			p.push_back(rnd.range(-0.1f, 0.1f));
+		}
+	}
+}
+
+/** @brief Builds a polygon outline with n vertices, every second vertex is moved inwards (not convex).
+ */
+static void starPoints(RtInt n, RtFloat r, RtFloat z, std::vector<RtFloat> &p, bool reverse = false)
+{
+	for ( RtInt i = 0; i < n; ++i ) {
+		RtInt k = reverse ? n-1-i : i;
+		RtFloat a = (RtFloat)(2.0*M_PI*k/n);
+		RtFloat rad = (k % 2) ? r*0.8f : r;
+		p.push_back(rad*(RtFloat)cos(a));
+		p.push_back(rad*(RtFloat)sin(a));
+		p.push_back(z);
+	}
+}
+
+/** @brief Builds a closed quad mesh on a torus (n x n faces), all vertices have valence 4.
+ */
+static void torusMesh(RtInt n, std::vector<RtInt> &nverts, std::vector<RtInt> &verts, std::vector<RtFloat> &p)
+{
+	for ( RtInt i = 0; i < n; ++i ) {
+		RtFloat u = (RtFloat)(2.0*M_PI*i/n);
+		for ( RtInt j = 0; j < n; ++j ) {
+			RtFloat v = (RtFloat)(2.0*M_PI*j/n);
+			p.push_back((RtFloat)((1.0+0.4*cos(v))*cos(u)));
+			p.push_back((RtFloat)((1.0+0.4*cos(v))*sin(u)));
+			p.push_back((RtFloat)(0.4*sin(v)));
+			nverts.push_back(4);
+			verts.push_back(i*n+j);
+			verts.push_back(((i+1)%n)*n+j);
+			verts.push_back(((i+1)%n)*n+(j+1)%n);
+			verts.push_back(i*n+(j+1)%n);
+		}
+	}
+}
+
+/** @brief Ear clipping of a star shaped polygon with a hole.
+ */
+class CEarClipperBench : public CBenchmark {
+	RtInt m_n;
+	std::vector<RtFloat> m_p;
+	RtInt m_loops[2];
+public:
+	inline CEarClipperBench(const std::string &aName, RtInt n) : CBenchmark(aName), m_n(n)
+	{
+		starPoints(n, 1.0f, 0.0f, m_p);
+		starPoints(n/2, 0.3f, 0.0f, m_p, true);
+		m_loops[0] = n;
+		m_loops[1] = n/2;
+		m_items = n + n/2;
+	}
+	virtual void run()
+	{
+		CTriangulatedPolygon tp;
+		tp.triangulate(primEnv->m_earClipper, 2, m_loops, &m_p[0], true);
+	}
+};
+
+/** @brief Concatenation of transformations.
+ */
+class CMatrixConcatBench : public CBenchmark {
+	std::vector<CMatrix3D> m_mats;
+public:
+	inline CMatrixConcatBench() : CBenchmark("matrix/concat")
+	{
+		CBenchRandom rnd(SEED);
+		m_mats.resize(1024);
+		for ( size_t i = 0; i < m_mats.size(); ++i ) {
+			m_mats[i].identity();
+			m_mats[i].translate(rnd.range(-1, 1), rnd.range(-1, 1), rnd.range(-1, 1));
+			m_mats[i].rotate(rnd.range(0, 360), rnd.range(-1, 1), rnd.range(-1, 1), 1.0f);
+			m_mats[i].scale(rnd.range(0.9f, 1.1f), rnd.range(0.9f, 1.1f), rnd.range(0.9f, 1.1f));
+		}
+		m_items = m_mats.size();
+	}
+	virtual void run()
+	{
+		CMatrix3D m;
+		m.identity();
+		for ( size_t i = 0; i < m_mats.size(); ++i ) {
+			m.concatTransform(m_mats[i]);
+		}
+	}
+};
+
+/** @brief Transformation of points and normals.
+ */
+class CMatrixPointsBench : public CBenchmark {
+	CMatrix3D m_mat;
+	std::vector<RtFloat> m_p, m_work;
+	bool m_normals;
+public:
+	inline CMatrixPointsBench(const std::string &aName, bool normals) : CBenchmark(aName), m_normals(normals)
+	{
+		CBenchRandom rnd(SEED);
+		m_mat.identity();
+		m_mat.rotate(30, 1, 1, 0);
+		m_mat.translate(1, 2, 3);
+		m_mat.scale(1, 2, 1);
+		m_p.resize(3*4096);
+		for ( size_t i = 0; i < m_p.size(); ++i )
+			m_p[i] = rnd.range(-1, 1);
+		m_items = m_p.size()/3;
+	}
+	virtual void run()
+	{
+		m_work = m_p;
+		if ( m_normals )
+			m_mat.transformNormals((RtInt)(m_work.size()/3), (RtPoint *)&m_work[0]);
+		else
+			m_mat.transformPoints((RtInt)(m_work.size()/3), (RtPoint *)&m_work[0]);
+	}
+};
+
+/** @brief Inversion of a matrix.
+ */
+class CMatrixInverseBench : public CBenchmark {
+	CMatrix3D m_mat;
+public:
+	inline CMatrixInverseBench() : CBenchmark("matrix/inverse")
+	{
+		m_mat.identity();
+		m_mat.rotate(30, 1, 1, 0);
+		m_mat.translate(1, 2, 3);
+		m_mat.scale(1, 2, 1);
+		m_items = 1;
+	}
+	virtual void run()
+	{
+		RtMatrix inv;
+		m_mat.getInverse(inv);
+	}
+};
+
+// ----------------------------------------------------------------------------
+// Synthetic scenes
+
+/** @brief Writes a synthetic scene (deterministic from the seed).
+ *
+ *  Attribute blocks with quadrics, polygon meshes, subdivision meshes and
+ *  instances of objects.
+ */
+static void writeScene(CRiCPPBridge &ri, unsigned long nPrims, unsigned long seed)
+{
+	CBenchRandom rnd(seed);
+
+	RtToken tokens[2];
+	RtPointer params[2];
+
+	ri.format(640, 480, 1.0f);
+	ri.projection(RI_PERSPECTIVE, RI_NULL);
+	ri.frameBegin(1);
+	ri.worldBegin();
+
+	// Object with a mesh
+	std::vector<RtFloat> gp;
+	gridPoints(9, 9, gp, rnd);
+	std::vector<RtInt> gnverts, gverts;
+	for ( RtInt v = 0; v < 8; ++v ) {
+		for ( RtInt u = 0; u < 8; ++u ) {
+			gnverts.push_back(4);
+			gverts.push_back(v*9+u);
+			gverts.push_back(v*9+u+1);
+			gverts.push_back((v+1)*9+u+1);
+			gverts.push_back((v+1)*9+u);
+		}
+	}
+	tokens[0] = RI_P;
+	params[0] = &gp[0];
+	RtObjectHandle obj = ri.objectBegin();
+	ri.pointsPolygonsV((RtInt)gnverts.size(), &gnverts[0], &gverts[0], 1, tokens, params);
+	ri.objectEnd();
+
+	std::vector<RtInt> snverts, sverts;
+	std::vector<RtFloat> sp;
+	torusMesh(4, snverts, sverts, sp);
+
+	for ( unsigned long i = 0; i < nPrims; ++i ) {
+		ri.attributeBegin();
+		RtFloat c[3] = { rnd.next(), rnd.next(), rnd.next() };
+		ri.color(c);
+		ri.translate(rnd.range(-10, 10), rnd.range(-10, 10), rnd.range(5, 30));
+		ri.rotate(rnd.range(0, 360), 0, 1, 0);
+		switch ( i % 5 ) {
+			case 0:
+				ri.sphereV(rnd.range(0.5f, 2.0f), -1, 1, 360, 0, 0, 0);
+				break;
+			case 1:
+				ri.torusV(1.0f, rnd.range(0.1f, 0.5f), 0, 360, 360, 0, 0, 0);
+				break;
+			case 2: {
+				std::vector<RtFloat> p;
+				gridPoints(9, 9, p, rnd);
+				tokens[0] = RI_P;
+				params[0] = &p[0];
+				ri.pointsPolygonsV((RtInt)gnverts.size(), &gnverts[0], &gverts[0], 1, tokens, params);
+				break;
+			}
+			case 3:
+				tokens[0] = RI_P;
+				params[0] = &sp[0];
+				ri.subdivisionMeshV(RI_CATMULL_CLARK, (RtInt)snverts.size(), &snverts[0], &sverts[0], 0, 0, 0, 0, 0, 1, tokens, params);
+				break;
+			default:
+				ri.objectInstance(obj);
+				break;
+		}
+		ri.attributeEnd();
+	}
+
+	ri.worldEnd();
+	ri.frameEnd();
+}
+
+/** @brief Size of a file.
+ */
+static unsigned long long fileSize(const std::string &filename)
+{
+	std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	return in ? (unsigned long long)in.tellg() : 0;
+}
+
+/** @brief Writes the synthetic scene by the RIB writer (ASCII, binary or compressed).
+ */
+class CWriteBench : public CBenchmark {
+	std::string m_filename;
+	RtInt m_binary;
+	RtInt m_compress;
+public:
+	inline CWriteBench(const std::string &aName, const std::string &aFilename, bool binary, bool compress)
+	: CBenchmark(aName, true), m_filename(aFilename), m_binary(binary ? 1 : 0), m_compress(compress ? 6 : 0)
+	{
+		m_items = sceneSize;
+	}
+	virtual void run()
+	{
+		CRiCPPBridge ri;
+		const char *name = m_filename.c_str();
+		ri.begin("ribwriter", RI_FILE, &name, "compress", &m_compress, RI_NULL);
+		ri.control("ribwriter", "binary-output", &m_binary, RI_NULL);
+		writeScene(ri, sceneSize, SEED);
+		ri.end();
+	}
+	virtual void teardown()
+	{
+		m_bytes = fileSize(m_filename);
+	}
+};
+
+/** @brief Parses a synthetic scene, the output of the RIB writer is suppressed.
+ */
+class CParseBench : public CBenchmark {
+	std::string m_filename;
+	std::string m_output;
+public:
+	inline CParseBench(const std::string &aName, const std::string &aFilename, const std::string &anOutput)
+	: CBenchmark(aName, true), m_filename(aFilename), m_output(anOutput)
+	{
+		m_items = sceneSize;
+	}
+	virtual void setup()
+	{
+		m_bytes = fileSize(m_filename);
+	}
+	virtual void run()
+	{
+		CRiCPPBridge ri;
+		const char *name = m_output.c_str();
+		RtInt yes = 1;
+		ri.begin("ribwriter", RI_FILE, &name, RI_NULL);
+		ri.control("ribwriter", "suppress-output", &yes, RI_NULL);
+		ri.readArchiveV(m_filename.c_str(), 0, 0, 0, 0);
+		ri.end();
+	}
+};
+
+// ----------------------------------------------------------------------------
+// Registry
+
+static std::vector<CBenchmark *> benchmarks;
+static std::vector<std::string> tempFiles;
+
+/** @brief Creates a temporary file, it is removed at exit.
+ */
+static std::string tempFile(const char *ext)
+{
+	std::string name;
+	if ( CEnv::createTempFile(name, "ricppbench", ext) )
+		tempFiles.push_back(name);
+	return name;
+}
+
+/** @brief Registers the micro benchmarks.
+ */
+static void microBenchmarks()
+{
+	benchmarks.push_back(new CMatrixConcatBench);
+	benchmarks.push_back(new CMatrixPointsBench("matrix/points", false));
+	benchmarks.push_back(new CMatrixPointsBench("matrix/normals", true));
+	benchmarks.push_back(new CMatrixInverseBench);
+
+	CDeclarationDictionary &decl = primEnv->m_decl;
+	const CColorDescr &col = primEnv->m_color;
+	static const IndexType rates[] = { 4, 16, 64 };
+	RtToken tokens[1] = { RI_P };
+	RtPointer params[1];
+	CBenchRandom rnd(SEED);
+
+	for ( size_t r = 0; r < sizeof(rates)/sizeof(rates[0]); ++r ) {
+		IndexType t = rates[r];
+		std::ostringstream s;
+		s << "/" << t;
+		std::string rate = s.str();
+
+		RtPoint p1 = { 0.5f, 0, -1 }, p2 = { 1, 0.5f, 1 };
+		benchmarks.push_back(new TemplTessBench<CRiSphere, CSphereTesselator>("tessellate/sphere"+rate, new CRiSphere(-1, decl, col, 1, -1, 1, 360, 0, 0, 0), t));
+		benchmarks.push_back(new TemplTessBench<CRiCone, CConeTesselator>("tessellate/cone"+rate, new CRiCone(-1, decl, col, 2, 1, 360, 0, 0, 0), t));
+		benchmarks.push_back(new TemplTessBench<CRiCylinder, CCylinderTesselator>("tessellate/cylinder"+rate, new CRiCylinder(-1, decl, col, 1, -1, 1, 360, 0, 0, 0), t));
+		benchmarks.push_back(new TemplTessBench<CRiDisk, CDiskTesselator>("tessellate/disk"+rate, new CRiDisk(-1, decl, col, 0, 1, 360, 0, 0, 0), t));
+		benchmarks.push_back(new TemplTessBench<CRiHyperboloid, CHyperboloidTesselator>("tessellate/hyperboloid"+rate, new CRiHyperboloid(-1, decl, col, p1, p2, 360, 0, 0, 0), t));
+		benchmarks.push_back(new TemplTessBench<CRiParaboloid, CParaboloidTesselator>("tessellate/paraboloid"+rate, new CRiParaboloid(-1, decl, col, 1, 0, 2, 360, 0, 0, 0), t));
+		benchmarks.push_back(new TemplTessBench<CRiTorus, CTorusTesselator>("tessellate/torus"+rate, new CRiTorus(-1, decl, col, 1, 0.3f, 0, 360, 360, 0, 0, 0), t));
+
+		std::vector<RtFloat> p;
+		gridPoints(2, 2, p, rnd);
+		params[0] = &p[0];
+		benchmarks.push_back(new TemplBasisTessBench<CRiPatch, CPatchTesselator>("tessellate/patch-bilinear"+rate, new CRiPatch(-1, decl, col, RI_BILINEAR, 1, tokens, params), t));
+		gridPoints(4, 4, p, rnd);
+		params[0] = &p[0];
+		benchmarks.push_back(new TemplBasisTessBench<CRiPatch, CPatchTesselator>("tessellate/patch-bicubic"+rate, new CRiPatch(-1, decl, col, RI_BICUBIC, 1, tokens, params), t));
+		gridPoints(7, 7, p, rnd);
+		params[0] = &p[0];
+		benchmarks.push_back(new TemplBasisTessBench<CRiPatchMesh, CPatchMeshTesselator>("tessellate/patchmesh-bicubic"+rate, new CRiPatchMesh(-1, decl, col, 3, 3, RI_BICUBIC, 7, RI_NONPERIODIC, 7, RI_NONPERIODIC, 1, tokens, params), t));
+
+		static const RtFloat knots[] = { 0, 0, 0, 0, 1, 2, 2, 2, 2 };
+		gridPoints(5, 5, p, rnd);
+		params[0] = &p[0];
+		benchmarks.push_back(new TemplTessBench<CRiNuPatch, CNuPatchTesselator>("tessellate/nupatch"+rate, new CRiNuPatch(-1, decl, col, 5, 4, knots, 0, 2, 5, 4, knots, 0, 2, 1, tokens, params), t));
+	}
+
+	// Polygons (the tessellation rate is not used)
+	{
+		std::vector<RtFloat> p;
+		starPoints(64, 1, 0, p);
+		RtToken polyTokens[1] = { RI_P };
+		RtPointer polyParams[1] = { &p[0] };
+		benchmarks.push_back(new TemplTessBench<CRiPolygon, CPolygonTesselator>("tessellate/polygon/64", new CRiPolygon(-1, decl, col, 64, 1, polyTokens, polyParams), 1));
+
+		std::vector<RtFloat> gp;
+		starPoints(64, 1, 0, gp);
+		starPoints(32, 0.3f, 0, gp, true);
+		RtInt loops[2] = { 64, 32 };
+		polyParams[0] = &gp[0];
+		benchmarks.push_back(new TemplStrategyTessBench<CRiGeneralPolygon, CGeneralPolygonTesselator>("tessellate/generalpolygon/96", new CRiGeneralPolygon(-1, decl, col, 2, loops, 1, polyTokens, polyParams), 1));
+
+		std::vector<RtFloat> mp;
+		gridPoints(33, 33, mp, rnd);
+		std::vector<RtInt> nverts, verts, nloops;
+		for ( RtInt v = 0; v < 32; ++v ) {
+			for ( RtInt u = 0; u < 32; ++u ) {
+				nloops.push_back(1);
+				nverts.push_back(4);
+				verts.push_back(v*33+u);
+				verts.push_back(v*33+u+1);
+				verts.push_back((v+1)*33+u+1);
+				verts.push_back((v+1)*33+u);
+			}
+		}
+		polyParams[0] = &mp[0];
+		benchmarks.push_back(new TemplTessBench<CRiPointsPolygons, CPointsPolygonsTesselator>("tessellate/pointspolygons/1024", new CRiPointsPolygons(-1, decl, col, 1024, &nverts[0], &verts[0], 1, polyTokens, polyParams), 1));
+		benchmarks.push_back(new TemplStrategyTessBench<CRiPointsGeneralPolygons, CPointsGeneralPolygonsTesselator>("tessellate/pointsgeneralpolygons/1024", new CRiPointsGeneralPolygons(-1, decl, col, 1024, &nloops[0], &nverts[0], &verts[0], 1, polyTokens, polyParams), 1));
+	}
+
+	// Ear clipper
+	benchmarks.push_back(new CEarClipperBench("earclipper/24", 16));
+	benchmarks.push_back(new CEarClipperBench("earclipper/384", 256));
+	benchmarks.push_back(new CEarClipperBench("earclipper/1536", 1024));
+
+	// Catmull-Clark, depth 1 to 4 (tessellation 2^depth)
+	{
+		std::vector<RtInt> nverts, verts;
+		std::vector<RtFloat> p;
+		torusMesh(8, nverts, verts, p);
+		RtToken subdTokens[1] = { RI_P };
+		RtPointer subdParams[1] = { &p[0] };
+		for ( IndexType depth = 1; depth <= 4; ++depth ) {
+			std::ostringstream s;
+			s << "subdivision/catmull-clark/" << depth;
+			benchmarks.push_back(new CSubdivBench(s.str(), new CRiSubdivisionMesh(-1, decl, col, RI_CATMULL_CLARK, (RtInt)nverts.size(), &nverts[0], &verts[0], 0, 0, 0, 0, 0, 1, subdTokens, subdParams), (IndexType)1 << depth));
+		}
+	}
+}
+
+/** @brief Registers the macro benchmarks.
+ */
+static void macroBenchmarks()
+{
+	std::string ascii = tempFile(".rib");
+	std::string binary = tempFile(".rib");
+	std::string gzip = tempFile(".rib.gz");
+	std::string output = tempFile(".rib");
+
+	benchmarks.push_back(new CWriteBench("write/ascii", ascii, false, false));
+	benchmarks.push_back(new CWriteBench("write/binary", binary, true, false));
+	benchmarks.push_back(new CWriteBench("write/gzip", gzip, false, true));
+	benchmarks.push_back(new CParseBench("parse/ascii", ascii, output));
+	benchmarks.push_back(new CParseBench("parse/binary", binary, output));
+	benchmarks.push_back(new CParseBench("parse/gzip", gzip, output));
+}
+
+// ----------------------------------------------------------------------------
+// Running
+
+/** @brief Runs a benchmark.
+ *
+ *  A first operation warms up (caches, lazy initialization), a second one
+ *  calibrates the number of operations per sample, the median of the
+ *  samples is the result.
+ */
+static SBenchResult runBenchmark(CBenchmark &b)
+{
+	b.setup();
+
+	b.run();
+	unsigned long long t0 = now();
+	b.run();
+	unsigned long long first = tmax(now() - t0, 1ULL);
+
+	unsigned long long ops = (unsigned long long)(minSampleTime * 1e9 / (double)first) + 1;
+
+	std::vector<double> samples;
+	for ( int r = 0; r < repetitions; ++r ) {
+		t0 = now();
+		for ( unsigned long long i = 0; i < ops; ++i )
+			b.run();
+		samples.push_back((double)(now() - t0) / (double)ops);
+	}
+	b.teardown();
+
+	std::sort(samples.begin(), samples.end());
+
+	SBenchResult res;
+	res.m_name = b.name();
+	res.m_kind = b.isMacro() ? "macro" : "micro";
+	res.m_ops = ops;
+	res.m_ns = samples[samples.size()/2];
+	res.m_minNs = samples.front();
+	res.m_maxNs = samples.back();
+	res.m_bytesPerSec = b.bytes() ? (double)b.bytes() * 1e9 / res.m_ns : 0;
+	res.m_itemsPerSec = b.items() ? (double)b.items() * 1e9 / res.m_ns : 0;
+	return res;
+}
+
+/** @brief Writes the results as JSON, one benchmark per line.
+ */
+static void writeJSON(std::ostream &out, const std::vector<SBenchResult> &results)
+{
+	out << "{\n  \"ricppbench\": 1,\n  \"repetitions\": " << repetitions
+	    << ",\n  \"sceneSize\": " << sceneSize
+	    << ",\n  \"benchmarks\": [";
+	for ( size_t i = 0; i < results.size(); ++i ) {
+		const SBenchResult &r = results[i];
+		out << (i ? ",\n" : "\n")
+		    << "    { \"name\": \"" << r.m_name << "\""
+		    << ", \"kind\": \"" << r.m_kind << "\""
+		    << ", \"ops\": " << r.m_ops
+		    << ", \"ns\": " << r.m_ns
+		    << ", \"minNs\": " << r.m_minNs
+		    << ", \"maxNs\": " << r.m_maxNs
+		    << ", \"bytesPerSec\": " << r.m_bytesPerSec
+		    << ", \"itemsPerSec\": " << r.m_itemsPerSec
+		    << " }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+/** @brief Reads the results (name and median time) written by writeJSON().
+ */
+static bool readJSON(const std::string &filename, std::map<std::string, double> &results)
+{
+	std::ifstream in(filename.c_str());
+	if ( !in )
+		return false;
+	std::string line;
+	while ( std::getline(in, line) ) {
+		std::string::size_type pos = line.find("\"name\": \"");
+		std::string::size_type nsPos = line.find("\"ns\": ");
+		if ( pos == std::string::npos || nsPos == std::string::npos )
+			continue;
+		pos += 9;
+		std::string::size_type end = line.find('"', pos);
+		if ( end == std::string::npos )
+			continue;
+		results[line.substr(pos, end-pos)] = atof(line.c_str() + nsPos + 6);
+	}
+	return true;
+}
+
+/** @brief Compares results with a baseline.
+ *  @return Number of regressions.
+ */
+static int compare(const std::map<std::string, double> &baseline, const std::vector<SBenchResult> &results, double threshold)
+{
+	int regressions = 0;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%-44s %14s %14s %9s", "benchmark", "baseline ns", "current ns", "change");
+	std::cout << buf << std::endl;
+	for ( size_t i = 0; i < results.size(); ++i ) {
+		std::map<std::string, double>::const_iterator b = baseline.find(results[i].m_name);
+		if ( b == baseline.end() || (*b).second <= 0 ) {
+			snprintf(buf, sizeof(buf), "%-44s %14s %14.0f  (new)", results[i].m_name.c_str(), "-", results[i].m_ns);
+			std::cout << buf << std::endl;
+			continue;
+		}
+		double change = (results[i].m_ns - (*b).second) * 100.0 / (*b).second;
+		const char *flag = "";
+		if ( change > threshold ) {
+			flag = "  REGRESSION";
+			++regressions;
+		} else if ( change < -threshold ) {
+			flag = "  improved";
+		}
+		snprintf(buf, sizeof(buf), "%-44s %14.0f %14.0f %+8.1f%%%s", results[i].m_name.c_str(), (*b).second, results[i].m_ns, change, flag);
+		std::cout << buf << std::endl;
+	}
+	return regressions;
+}
+
+/** @brief Prints the usage.
+ */
+static void printUsage()
+{
+	std::cout << "ricppbench [options], benchmarks of RiCPP" << std::endl;
+	std::cout << "-o file      writes the results as JSON to file (default: standard output)" << std::endl;
+	std::cout << "-f pattern   runs only the benchmarks matching the pattern, e.g. \"tessellate/*\"" << std::endl;
+	std::cout << "-k kind      runs only the \"micro\" or \"macro\" benchmarks" << std::endl;
+	std::cout << "-r n         number of samples per benchmark (default 5)" << std::endl;
+	std::cout << "-m ms        minimal time of a sample in milliseconds (default 50)" << std::endl;
+	std::cout << "-s n         number of primitives of the synthetic scenes (default 2000)" << std::endl;
+	std::cout << "-c baseline  compares the results with a baseline (JSON written by -o)," << std::endl;
+	std::cout << "             returns 1 if there are regressions" << std::endl;
+	std::cout << "-t percent   threshold of a regression (default 10)" << std::endl;
+	std::cout << "-i results   compares these results (-c) instead of running the benchmarks" << std::endl;
+	std::cout << "-l           lists the benchmarks" << std::endl;
+	std::cout << "-h           prints this help" << std::endl;
+}
+
+/** @brief The main function.
+ *
+ *  @param argc number of arguments @a argv
+ *  @param argv The arguments, see ricppbench.cpp
+ *  @return 0, if no error occured and no regression was found, 1, otherwise
+ */
+int main(int argc, char * const argv[])
+{
+	std::string outputName, filter, kind, baselineName, inputName;
+	double threshold = 10.0;
+	bool list = false;
+
+	for ( int i = 1; i < argc; ++i ) {
+		std::string arg(argv[i]);
+		bool hasValue = i+1 < argc;
+		if ( arg == "-l" ) {
+			list = true;
+		} else if ( arg == "-h" ) {
+			printUsage();
+			return 0;
+		} else if ( hasValue && arg == "-o" ) {
+			outputName = argv[++i];
+		} else if ( hasValue && arg == "-f" ) {
+			filter = argv[++i];
+		} else if ( hasValue && arg == "-k" ) {
+			kind = argv[++i];
+		} else if ( hasValue && arg == "-r" ) {
+			repetitions = tmax(atoi(argv[++i]), 1);
+		} else if ( hasValue && arg == "-m" ) {
+			minSampleTime = tmax(atof(argv[++i]), 0.0) / 1000.0;
+		} else if ( hasValue && arg == "-s" ) {
+			sceneSize = (unsigned long)tmax(atol(argv[++i]), 1L);
+		} else if ( hasValue && arg == "-c" ) {
+			baselineName = argv[++i];
+		} else if ( hasValue && arg == "-t" ) {
+			threshold = atof(argv[++i]);
+		} else if ( hasValue && arg == "-i" ) {
+			inputName = argv[++i];
+		} else {
+			std::cerr << "ricppbench: unknown option " << arg << std::endl;
+			printUsage();
+			return 1;
+		}
+	}
+
+	std::map<std::string, double> baseline;
+	if ( !baselineName.empty() && !readJSON(baselineName, baseline) ) {
+		std::cerr << "ricppbench: cannot read the baseline " << baselineName << std::endl;
+		return 1;
+	}
+
+	std::vector<SBenchResult> results;
+
+	if ( !inputName.empty() ) {
+		// Compares stored results
+		std::map<std::string, double> input;
+		if ( !readJSON(inputName, input) ) {
+			std::cerr << "ricppbench: cannot read the results " << inputName << std::endl;
+			return 1;
+		}
+		for ( std::map<std::string, double>::const_iterator i = input.begin(); i != input.end(); ++i ) {
+			SBenchResult r;
+			r.m_name = (*i).first;
+			r.m_ns = (*i).second;
+			results.push_back(r);
+		}
+	} else {
+		primEnv = new CPrimEnv;
+		if ( kind.empty() || kind == "micro" )
+			microBenchmarks();
+		if ( kind.empty() || kind == "macro" )
+			macroBenchmarks();
+
+		CStringPattern pattern(filter.empty() ? "*" : filter.c_str());
+		for ( std::vector<CBenchmark *>::iterator i = benchmarks.begin(); i != benchmarks.end(); ++i ) {
+			if ( !pattern.matches((*i)->name().c_str()) )
+				continue;
+			if ( list ) {
+				std::cout << (*i)->name() << std::endl;
+				continue;
+			}
+			std::cerr << (*i)->name() << std::endl;
+			results.push_back(runBenchmark(**i));
+		}
+
+		for ( std::vector<CBenchmark *>::iterator i = benchmarks.begin(); i != benchmarks.end(); ++i ) {
+			delete (*i);
+		}
+		benchmarks.clear();
+		for ( std::vector<std::string>::iterator i = tempFiles.begin(); i != tempFiles.end(); ++i ) {
+			remove((*i).c_str());
+		}
+		delete primEnv;
+		primEnv = 0;
+
+		if ( list )
+			return 0;
+
+		if ( outputName.empty() ) {
+			if ( baselineName.empty() )
+				writeJSON(std::cout, results);
+		} else {
+			std::ofstream out(outputName.c_str(), std::ios_base::out|std::ios_base::trunc);
+			writeJSON(out, results);
+			if ( !out ) {
+				std::cerr << "ricppbench: cannot write the results to " << outputName << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	if ( !baselineName.empty() ) {
+		int regressions = compare(baseline, results, threshold);
+		if ( regressions ) {
+			std::cout << regressions << " regression(s), threshold " << threshold << "%" << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
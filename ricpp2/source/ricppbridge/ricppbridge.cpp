@@ -26,6 +26,8 @@
  *  @brief Bridges the interface functions to a current renderer
  */
 #include "ricpp/ricppbridge/ricppbridge.h"
+
+#include <algorithm>
 // #ifndef _RICPP_RIBWRITER_RIBWRITER_H
 // #include "ricpp/ribwriter/ribwriter.h"
 // #endif // _RICPP_RIBWRITER_RIBWRITER_H
@@ -35,9 +37,8 @@ CRiCPPBridge::CContextManagement::CContextManagement()
 {
 	m_nextCtxHandle = 1;
 	// illContextHandle is always the first context (outside begin-end)
-	// m_curCtx initially has nor context creator or rendering context.
-	m_ctxHandle = illContextHandle;
-	m_ctxMap[m_ctxHandle] = m_curCtx;
+	// it has no context creator or rendering context.
+	m_ctxMap[illContextHandle] = CContext();
 	m_outer = 0;
 }
 CRiCPPBridge::CContextManagement::~CContextManagement() {
@@ -47,10 +48,10 @@ RtContextHandle CRiCPPBridge::CContextManagement::addContext(const CContext &ctx
 	m_ctxMap[m_nextCtxHandle] = ctx;
 	return m_nextCtxHandle++;
 }
-void CRiCPPBridge::CContextManagement::removeContext(RtContextHandle handle)
+void CRiCPPBridge::CContextManagement::removeContext(RtContextHandle handle, SThreadState &ts)
 {
 	// illContextHandle illContextHandle is not removed
-	if ( m_ctxHandle == illContextHandle )
+	if ( handle == illContextHandle )
 		return;
 	// Remove if the handle is an element of the map
 	assert(isContext(handle));
@@ -58,37 +59,49 @@ void CRiCPPBridge::CContextManagement::removeContext(RtContextHandle handle)
 		// m_ctxMap[handle].renderingContext() is not 0 but already destroyed
 		m_ctxMap.erase(handle);
 	}
-	if ( handle == m_ctxHandle ) {
+	if ( handle == ts.m_ctxHandle ) {
 		// Was the current context handle - no active context any more
-		m_ctxHandle = illContextHandle;
-		m_curCtx = m_ctxMap[m_ctxHandle];
+		ts.m_ctxHandle = illContextHandle;
+		ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 	}
 }
 bool CRiCPPBridge::CContextManagement::context(RtContextHandle handle)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	SThreadState &ts = m_outer->threadState();
 	if ( isContext(handle) ) {
-		m_curCtx.deactivate();
-		m_ctxHandle = handle;
-		m_curCtx = m_ctxMap[m_ctxHandle];
-		m_curCtx.activate();
+		ts.m_curCtx.deactivate();
+		ts.m_ctxHandle = handle;
+		ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
+		ts.m_curCtx.activate();
 		return true;
 	}
-	m_ctxHandle = illContextHandle;
-	m_curCtx = m_ctxMap[m_ctxHandle];
+	ts.m_ctxHandle = illContextHandle;
+	ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 	return false;
 }
+void CRiCPPBridge::CContextManagement::abort()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	SThreadState &ts = m_outer->threadState();
+	// The creator aborts its current context, that can be the one of another thread
+	ts.m_curCtx.activate();
+	ts.m_curCtx.abort();
+}
 RtContextHandle CRiCPPBridge::CContextManagement::beginV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 	// throws ExceptRiCPPError
 {
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	SThreadState &ts = m_outer->threadState();
 	try {
-		m_curCtx.deactivate();
+		ts.m_curCtx.deactivate();
 	} catch (ExceptRiCPPError &e) {
-		m_ctxHandle = illContextHandle;
-		m_curCtx = m_ctxMap[m_ctxHandle];
+		ts.m_ctxHandle = illContextHandle;
+		ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 		throw e;
 	}
-	m_ctxHandle = illContextHandle; // No context!
-	m_curCtx = m_ctxMap[m_ctxHandle];
+	ts.m_ctxHandle = illContextHandle; // No context!
+	ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 	// Try to create a new context creator
 	CContextCreator *contextCreator = 0;
 	try {
@@ -110,8 +123,8 @@ RtContextHandle CRiCPPBridge::CContextManagement::beginV(RtString name, RtInt n,
 		// Context may be invalid, nevertheless it is stored, so interface
 		// requests can be called until end()
 		CContext ctx(contextCreator, contextCreator->getContext());
-		m_ctxHandle = addContext(ctx);
-		m_curCtx = m_ctxMap[m_ctxHandle];
+		ts.m_ctxHandle = addContext(ctx);
+		ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 		throw e;
 	}
 	// A backend exists
@@ -120,20 +133,24 @@ RtContextHandle CRiCPPBridge::CContextManagement::beginV(RtString name, RtInt n,
 	if ( backendContext != 0 ) {
 		assert(m_outer != 0);
 		CContext ctx(contextCreator, backendContext);
-		m_ctxHandle = addContext(ctx);
-		m_curCtx = m_ctxMap[m_ctxHandle];
+		ts.m_ctxHandle = addContext(ctx);
+		ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 	}
-	return m_ctxHandle;
+	return ts.m_ctxHandle;
 }
 void CRiCPPBridge::CContextManagement::end()
 	// throws ExceptRiCPPError
 {
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	SThreadState &ts = m_outer->threadState();
 	ExceptRiCPPError e;
-	if ( m_ctxHandle != illContextHandle ) {
-		// CContextCreator *cc = m_curCtx.contextCreator();
+	if ( ts.m_ctxHandle != illContextHandle ) {
+		// CContextCreator *cc = ts.m_curCtx.contextCreator();
 		try {
-			// Also destroys the rendering context (done by the CContextCreator)
-			m_curCtx.end();
+			// Also destroys the rendering context (done by the CContextCreator),
+			// the creator ends its current context, that can be the one of another thread
+			ts.m_curCtx.activate();
+			ts.m_curCtx.end();
 		} catch (ExceptRiCPPError &e2) {
 			e = e2;
 		}
@@ -141,23 +158,54 @@ void CRiCPPBridge::CContextManagement::end()
 		// m_rendererLoader.removeContextCreator(cc);
 		
 		// Just remove the CContext pair
-		removeContext(m_ctxHandle);
+		removeContext(ts.m_ctxHandle, ts);
 		
 		// Done by removeContext()
-		// m_ctxHandle = illContextHandle;
-		// m_curCtx = m_ctxMap[m_ctxHandle];
+		// ts.m_ctxHandle = illContextHandle;
+		// ts.m_curCtx = m_ctxMap[ts.m_ctxHandle];
 	}
 	if ( e.isError() )
 		throw e;
 }
 // ----------------------------------------------------------------------------
+std::atomic<unsigned long> CRiCPPBridge::ms_nextId(1);
+thread_local unsigned long CRiCPPBridge::ms_cachedId = 0;
+thread_local CRiCPPBridge::SThreadState *CRiCPPBridge::ms_cachedState = 0;
+thread_local CRiCPPBridge::SThreadBridges CRiCPPBridge::ms_threadBridges;
+thread_local bool CRiCPPBridge::ms_threadExiting = false;
+CRiCPPBridge::SThreadBridges::~SThreadBridges()
+{
+	ms_threadExiting = true;
+	std::lock_guard<std::mutex> lock(bridgesMutex());
+	for ( std::vector<unsigned long>::iterator i = m_ids.begin(); i != m_ids.end(); ++i ) {
+		std::map<unsigned long, CRiCPPBridge *>::iterator b = bridges().find(*i);
+		if ( b != bridges().end() )
+			(*b).second->removeThreadState();
+	}
+	m_ids.clear();
+}
+std::mutex &CRiCPPBridge::bridgesMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+std::map<unsigned long, CRiCPPBridge *> &CRiCPPBridge::bridges()
+{
+	static std::map<unsigned long, CRiCPPBridge *> existing;
+	return existing;
+}
 CRiCPPBridge::CRiCPPBridge() :
-	m_lastError(RIE_NOERROR),
+	m_id(ms_nextId++),
 	m_ribFilterList(&m_ribFilter)
 {
+	{
+		std::lock_guard<std::mutex> lock(bridgesMutex());
+		bridges()[m_id] = this;
+	}
 	m_ricppErrorHandler.setOuter(const_cast<CRiCPPBridge &>(*this));
 	m_ctxMgmt.setOuter(*this);
 	m_ribFilter.m_next = this;
+	m_ribFilterList.updateDispatch();
 	m_curErrorHandler = &CPrintErrorHandler::func();
 	for ( int reqNum = 0; reqNum < N_REQUESTS; ++reqNum )
 		m_disabledCommand[reqNum] = false;
@@ -193,6 +241,50 @@ CRiCPPBridge::~CRiCPPBridge()
 	if ( f )
 		delete f;
 	*/
+	{
+		// Exiting threads do not access the bridge anymore
+		std::lock_guard<std::mutex> lock(bridgesMutex());
+		bridges().erase(m_id);
+	}
+	if ( !ms_threadExiting ) {
+		std::vector<unsigned long> &ids = ms_threadBridges.m_ids;
+		ids.erase(std::remove(ids.begin(), ids.end(), m_id), ids.end());
+	}
+	std::lock_guard<std::mutex> lock(m_threadMutex);
+	for ( std::map<std::thread::id, SThreadState *>::iterator i = m_threadStates.begin(); i != m_threadStates.end(); ++i ) {
+		delete (*i).second;
+	}
+	m_threadStates.clear();
+	if ( ms_cachedId == m_id ) {
+		ms_cachedId = 0;
+		ms_cachedState = 0;
+	}
+}
+CRiCPPBridge::SThreadState &CRiCPPBridge::findThreadState()
+{
+	std::lock_guard<std::mutex> lock(m_threadMutex);
+	SThreadState *&state = m_threadStates[std::this_thread::get_id()];
+	if ( !state ) {
+		state = new SThreadState;
+		if ( !ms_threadExiting )
+			ms_threadBridges.m_ids.push_back(m_id);
+	}
+	ms_cachedId = m_id;
+	ms_cachedState = state;
+	return *state;
+}
+void CRiCPPBridge::removeThreadState()
+{
+	std::lock_guard<std::mutex> lock(m_threadMutex);
+	std::map<std::thread::id, SThreadState *>::iterator i = m_threadStates.find(std::this_thread::get_id());
+	if ( i != m_threadStates.end() ) {
+		delete (*i).second;
+		m_threadStates.erase(i);
+	}
+	if ( ms_cachedId == m_id ) {
+		ms_cachedId = 0;
+		ms_cachedState = 0;
+	}
 }
 void CRiCPPBridge::defaultDeclarations()
 {
@@ -261,22 +353,23 @@ RtInt CRiCPPBridge::getTokens(RtToken token, va_list marker)
 {
 	RtInt n;
 	RtPointer param;
+	SThreadState &ts = threadState();
 	
-	m_tokens.clear();
-	m_params.clear();
+	ts.m_tokens.clear();
+	ts.m_params.clear();
 	
 	for ( n = 0; token != RI_NULL; ++n, token = va_arg(marker, RtToken) ) {
 		param = va_arg(marker, RtPointer);
-		m_tokens.push_back(token);
-		m_params.push_back(param);
+		ts.m_tokens.push_back(token);
+		ts.m_params.push_back(param);
 	}
 	va_end(marker);
 	
 	if ( n == 0 ) {
-		m_tokens.resize(1);
-		m_params.resize(1);
-		m_tokens[0] = 0;
-		m_params[0] = 0;
+		ts.m_tokens.resize(1);
+		ts.m_params.resize(1);
+		ts.m_tokens[0] = 0;
+		ts.m_params[0] = 0;
 	}
 	
 	return n;
@@ -364,7 +457,7 @@ IFreeFunc   &CRiCPPBridge::procFree() const { return CProcFree::func; }
 const IErrorHandler &CRiCPPBridge::errorAbort() const { return CAbortErrorHandler::func(); }
 const IErrorHandler &CRiCPPBridge::errorIgnore() const { return CIgnoreErrorHandler::func(); }
 const IErrorHandler &CRiCPPBridge::errorPrint() const { return CPrintErrorHandler::func(); };
-RtInt CRiCPPBridge::lastError() { return m_lastError; }
+RtInt CRiCPPBridge::lastError() { return threadState().m_lastError; }
 RtVoid CRiCPPBridge::errorHandler(const IErrorHandler &handler)
 {
 	if ( m_ctxMgmt.curBackend().valid() ) {
@@ -381,7 +474,7 @@ RtVoid CRiCPPBridge::errorHandler(const IErrorHandler &handler)
 RtVoid CRiCPPBridge::CRiCPPBridgeErrorHandler::handleErrorV(RtInt code, RtInt severity, int line, const char *file, RtString message, va_list argList)
 {
 	assert(m_outer != 0);
-	m_outer->m_lastError = code;
+	m_outer->threadState().m_lastError = code;
 	// Do no more error handling if the context is already aborted
 	if ( m_outer->m_ctxMgmt.curBackend().aborted() )
 		return;
@@ -451,6 +544,7 @@ void CRiCPPBridge::disableCommands(const std::vector<RtString> &theCommands)
 }
 RtToken CRiCPPBridge::doDeclare(RtToken name, RtString declaration, bool isDefault)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_ctxMgmt.mutex());
 	return m_declDict.declare(name, declaration, isDefault, m_options.colorDescr());
 }
 RtToken CRiCPPBridge::declare(RtToken name, RtString declaration)
@@ -480,7 +574,7 @@ RtContextHandle CRiCPPBridge::begin(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return beginV(name, n, &m_tokens[0], &m_params[0]);
+	return beginV(name, n, varTokens(), varParams());
 }
 RtContextHandle CRiCPPBridge::beginV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -488,18 +582,19 @@ RtContextHandle CRiCPPBridge::beginV(RtString name, RtInt n, RtToken tokens[], R
 	// Start the new context
 	if ( n==0 && (name && *name) ) {
 		// Test name for rib filename or pipe - if found call ribwriter
+		SThreadState &ts = threadState();
 		std::string filename = name;
 		RiCPP::varSubst(filename);
 		const char *ptr = filename.c_str();
 		if ( ptr && ptr[0] == '|' ) {
 			// name was the name of a piped ribfile
 			// remove the 0 entries
-			m_tokens.clear();
-			m_params.clear();
-			m_tokens.push_back(RI_FILE);
-			m_params.push_back((RtPointer)(&name)); // Pipe is identified because of leading '|'
-			tokens = &m_tokens[0];
-			params = &m_params[0];
+			ts.m_tokens.clear();
+			ts.m_params.clear();
+			ts.m_tokens.push_back(RI_FILE);
+			ts.m_params.push_back((RtPointer)(&name)); // Pipe is identified because of leading '|'
+			tokens = &ts.m_tokens[0];
+			params = &ts.m_params[0];
 			n = 1;
 			// new name == 0 to load the rib writer
 			myName = 0;
@@ -508,12 +603,12 @@ RtContextHandle CRiCPPBridge::beginV(RtString name, RtInt n, RtToken tokens[], R
 			if ( ptr && !(strcasecmp(ptr, ".rib") && strcasecmp(ptr, ".ribz") && strcasecmp(ptr, ".z") && strcasecmp(ptr, ".gz")) ) {
 				// name was the name of a rib file
 				// remove the 0 entries
-				m_tokens.clear();
-				m_params.clear();
-				m_tokens.push_back(RI_FILE);
-				m_params.push_back((RtPointer)(&name));
-				tokens = &m_tokens[0];
-				params = &m_params[0];
+				ts.m_tokens.clear();
+				ts.m_params.clear();
+				ts.m_tokens.push_back(RI_FILE);
+				ts.m_params.push_back((RtPointer)(&name));
+				tokens = &ts.m_tokens[0];
+				params = &ts.m_params[0];
 				n = 1;
 				// new name == 0 to load the rib writer
 				myName = 0;
@@ -880,7 +975,7 @@ RtArchiveHandle CRiCPPBridge::archiveBegin(RtToken name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return archiveBeginV(name, n, &m_tokens[0], &m_params[0]);
+	return archiveBeginV(name, n, varTokens(), varParams());
 }
 RtArchiveHandle CRiCPPBridge::archiveBeginV(RtToken name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -956,7 +1051,7 @@ RtVoid CRiCPPBridge::resource(RtToken handle, RtString type, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	resourceV(handle, type, n, &m_tokens[0], &m_params[0]);
+	resourceV(handle, type, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::resourceV(RtToken handle, RtString type, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1040,7 +1135,7 @@ RtVoid CRiCPPBridge::projection(RtToken name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	projectionV(name, n, &m_tokens[0], &m_params[0]);
+	projectionV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::projectionV(RtToken name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1182,7 +1277,7 @@ RtVoid CRiCPPBridge::imager(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	imagerV(name, n, &m_tokens[0], &m_params[0]);
+	imagerV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::imagerV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1219,7 +1314,7 @@ RtVoid CRiCPPBridge::displayChannel(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	displayChannelV(name, n, &m_tokens[0], &m_params[0]);
+	displayChannelV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::displayChannelV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1241,7 +1336,7 @@ RtVoid CRiCPPBridge::display(RtString name, RtToken type, RtString mode, RtToken
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	displayV(name, type, mode, n, &m_tokens[0], &m_params[0]);
+	displayV(name, type, mode, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::displayV(RtString name, RtToken type, RtString mode, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1263,7 +1358,7 @@ RtVoid CRiCPPBridge::hider(RtToken type, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	imagerV(type, n, &m_tokens[0], &m_params[0]);
+	imagerV(type, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::hiderV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1316,7 +1411,7 @@ RtVoid CRiCPPBridge::camera(RtToken type, RtToken token, ...)
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
 	
-	cameraV(type, n, &m_tokens[0], &m_params[0]);
+	cameraV(type, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::cameraV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1342,6 +1437,8 @@ RtVoid CRiCPPBridge::doControl(RtToken name, const CParameterList &params)
 	
 	// std::cout << "> " << params.size() << std::endl;
 	if ( name == RI_SEARCHPATH ) {
+		// Libraries may be found at other places now
+		CDynLib::clearLookupCache();
 		for ( CParameterList::const_iterator i = params.begin();
 		      i != params.end();
 			  i++ )
@@ -1391,17 +1488,20 @@ RtVoid CRiCPPBridge::control(RtToken name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	controlV(name, n, &m_tokens[0], &m_params[0]);
+	controlV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::controlV(RtToken name, RtInt n, RtToken tokens[], RtPointer params[])
 {
 	// Controls for the Renderer creator and its children.
 	try {
 		// First try own Control, this cannot be disabled
-		name = m_declDict.tokenMap().findCreate(name);
-		CParameterList p;
-		p.set(RI_CONTROL, name, CParameterClasses(), m_declDict, m_options.colorDescr(), n, tokens, params);
-		doControl(name, p);
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_ctxMgmt.mutex());
+			name = m_declDict.tokenMap().findCreate(name);
+			CParameterList p;
+			p.set(RI_CONTROL, name, CParameterClasses(), m_declDict, m_options.colorDescr(), n, tokens, params);
+			doControl(name, p);
+		}
 		// Then try Backend Control
 		if ( m_ctxMgmt.curBackend().valid() ) {
 			try {
@@ -1443,7 +1543,7 @@ RtVoid CRiCPPBridge::option(RtToken name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	optionV(name, n, &m_tokens[0], &m_params[0]);
+	optionV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::optionV(RtToken name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1458,6 +1558,7 @@ RtVoid CRiCPPBridge::optionV(RtToken name, RtInt n, RtToken tokens[], RtPointer
 	} else {
 		// Default options for the Renderer creator and its children.
 		try {
+			std::lock_guard<std::recursive_mutex> lock(m_ctxMgmt.mutex());
 			name = m_declDict.tokenMap().findCreate(name);
 			CParameterList p;
 			p.set(RI_OPTION, name, CParameterClasses(), m_declDict, m_options.colorDescr(), n, tokens, params);
@@ -1472,7 +1573,7 @@ RtLightHandle CRiCPPBridge::lightSource(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return lightSourceV(name, n, &m_tokens[0], &m_params[0]);
+	return lightSourceV(name, n, varTokens(), varParams());
 }
 RtLightHandle CRiCPPBridge::lightSourceV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1495,7 +1596,7 @@ RtLightHandle CRiCPPBridge::areaLightSource(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return areaLightSourceV(name, n, &m_tokens[0], &m_params[0]);
+	return areaLightSourceV(name, n, varTokens(), varParams());
 }
 RtLightHandle CRiCPPBridge::areaLightSourceV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1518,7 +1619,7 @@ RtVoid CRiCPPBridge::attribute(RtToken name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return attributeV(name, n, &m_tokens[0], &m_params[0]);
+	return attributeV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::attributeV(RtToken name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1570,7 +1671,7 @@ RtVoid CRiCPPBridge::surface(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return surfaceV(name, n, &m_tokens[0], &m_params[0]);
+	return surfaceV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::surfaceV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1592,7 +1693,7 @@ RtVoid CRiCPPBridge::atmosphere(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return atmosphereV(name, n, &m_tokens[0], &m_params[0]);
+	return atmosphereV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::atmosphereV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1614,7 +1715,7 @@ RtVoid CRiCPPBridge::interior(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return interiorV(name, n, &m_tokens[0], &m_params[0]);
+	return interiorV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::interiorV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1636,7 +1737,7 @@ RtVoid CRiCPPBridge::exterior(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return exteriorV(name, n, &m_tokens[0], &m_params[0]);
+	return exteriorV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::exteriorV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -1673,7 +1774,7 @@ RtVoid CRiCPPBridge::displacement(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return displacementV(name, n, &m_tokens[0], &m_params[0]);
+	return displacementV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::displacementV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2025,7 +2126,7 @@ RtVoid CRiCPPBridge::deformation(RtString name, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return deformationV(name, n, &m_tokens[0], &m_params[0]);
+	return deformationV(name, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::deformationV(RtString name, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2109,7 +2210,7 @@ RtVoid CRiCPPBridge::polygon(RtInt nvertices, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return polygonV(nvertices, n, &m_tokens[0], &m_params[0]);
+	return polygonV(nvertices, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::polygonV(RtInt nvertices, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2131,7 +2232,7 @@ RtVoid CRiCPPBridge::generalPolygon(RtInt nloops, RtInt nverts[], RtToken token,
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return generalPolygonV(nloops, nverts, n, &m_tokens[0], &m_params[0]);
+	return generalPolygonV(nloops, nverts, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::generalPolygonV(RtInt nloops, RtInt nverts[], RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2153,7 +2254,7 @@ RtVoid CRiCPPBridge::pointsPolygons(RtInt npolys, RtInt nverts[], RtInt verts[],
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return pointsPolygonsV(npolys, nverts, verts, n, &m_tokens[0], &m_params[0]);
+	return pointsPolygonsV(npolys, nverts, verts, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::pointsPolygonsV(RtInt npolys, RtInt nverts[], RtInt verts[], RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2175,7 +2276,7 @@ RtVoid CRiCPPBridge::pointsGeneralPolygons(RtInt npolys, RtInt nloops[], RtInt n
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return pointsGeneralPolygonsV(npolys, nloops, nverts, verts, n, &m_tokens[0], &m_params[0]);
+	return pointsGeneralPolygonsV(npolys, nloops, nverts, verts, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::pointsGeneralPolygonsV(RtInt npolys, RtInt nloops[], RtInt nverts[], RtInt verts[], RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2197,7 +2298,7 @@ RtVoid CRiCPPBridge::patch(RtToken type, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return patchV(type, n, &m_tokens[0], &m_params[0]);
+	return patchV(type, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::patchV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2219,7 +2320,7 @@ RtVoid CRiCPPBridge::patchMesh(RtToken type, RtInt nu, RtToken uwrap, RtInt nv,
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return patchMeshV(type, nu, uwrap, nv, vwrap, n, &m_tokens[0], &m_params[0]);
+	return patchMeshV(type, nu, uwrap, nv, vwrap, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::patchMeshV(RtToken type, RtInt nu, RtToken uwrap, RtInt nv, RtToken vwrap, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2241,7 +2342,7 @@ RtVoid CRiCPPBridge::nuPatch(RtInt nu, RtInt uorder, RtFloat uknot[], RtFloat um
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return nuPatchV(nu, uorder, uknot, umin, umax, nv, vorder, vknot, vmin, vmax, n, &m_tokens[0], &m_params[0]);
+	return nuPatchV(nu, uorder, uknot, umin, umax, nv, vorder, vknot, vmin, vmax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::nuPatchV(RtInt nu, RtInt uorder, RtFloat uknot[], RtFloat umin, RtFloat umax, RtInt nv, RtInt vorder, RtFloat vknot[], RtFloat vmin, RtFloat vmax,  RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2263,7 +2364,7 @@ RtVoid CRiCPPBridge::subdivisionMesh(RtToken scheme, RtInt nfaces, RtInt nvertic
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return subdivisionMeshV(scheme, nfaces, nvertices, vertices, ntags, tags, nargs, intargs, floatargs, n, &m_tokens[0], &m_params[0]);
+	return subdivisionMeshV(scheme, nfaces, nvertices, vertices, ntags, tags, nargs, intargs, floatargs, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::subdivisionMeshV(RtToken scheme, RtInt nfaces, RtInt nvertices[], RtInt vertices[], RtInt ntags, RtToken tags[], RtInt nargs[], RtInt intargs[], RtFloat floatargs[],  RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2285,7 +2386,7 @@ RtVoid CRiCPPBridge::hierarchicalSubdivisionMesh(RtToken scheme, RtInt nfaces, R
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return hierarchicalSubdivisionMeshV(scheme, nfaces, nvertices, vertices, ntags, tags, nargs, intargs, floatargs, stringargs, n, &m_tokens[0], &m_params[0]);
+	return hierarchicalSubdivisionMeshV(scheme, nfaces, nvertices, vertices, ntags, tags, nargs, intargs, floatargs, stringargs, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::hierarchicalSubdivisionMeshV(RtToken scheme, RtInt nfaces, RtInt nvertices[], RtInt vertices[], RtInt ntags, RtToken tags[], RtInt nargs[], RtInt intargs[], RtFloat floatargs[],  RtToken stringargs[],  RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2307,7 +2408,7 @@ RtVoid CRiCPPBridge::sphere(RtFloat radius, RtFloat zmin, RtFloat zmax, RtFloat
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return sphereV(radius, zmin, zmax, thetamax, n, &m_tokens[0], &m_params[0]);
+	return sphereV(radius, zmin, zmax, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::sphereV(RtFloat radius, RtFloat zmin, RtFloat zmax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2329,7 +2430,7 @@ RtVoid CRiCPPBridge::cone(RtFloat height, RtFloat radius, RtFloat thetamax, RtTo
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return coneV(height, radius, thetamax, n, &m_tokens[0], &m_params[0]);
+	return coneV(height, radius, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::coneV(RtFloat height, RtFloat radius, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2351,7 +2452,7 @@ RtVoid CRiCPPBridge::cylinder(RtFloat radius, RtFloat zmin, RtFloat zmax, RtFloa
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return cylinderV(radius, zmin, zmax, thetamax, n, &m_tokens[0], &m_params[0]);
+	return cylinderV(radius, zmin, zmax, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::cylinderV(RtFloat radius, RtFloat zmin, RtFloat zmax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2373,7 +2474,7 @@ RtVoid CRiCPPBridge::hyperboloid(RtPoint point1, RtPoint point2, RtFloat thetama
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return hyperboloidV(point1, point2, thetamax, n, &m_tokens[0], &m_params[0]);
+	return hyperboloidV(point1, point2, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::hyperboloidV(RtPoint point1, RtPoint point2, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2395,7 +2496,7 @@ RtVoid CRiCPPBridge::paraboloid (RtFloat rmax, RtFloat zmin, RtFloat zmax, RtFlo
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return paraboloidV(rmax, zmin, zmax, thetamax, n, &m_tokens[0], &m_params[0]);
+	return paraboloidV(rmax, zmin, zmax, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::paraboloidV(RtFloat rmax, RtFloat zmin, RtFloat zmax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2417,7 +2518,7 @@ RtVoid CRiCPPBridge::disk(RtFloat height, RtFloat radius, RtFloat thetamax, RtTo
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return diskV(height, radius, thetamax, n, &m_tokens[0], &m_params[0]);
+	return diskV(height, radius, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::diskV(RtFloat height, RtFloat radius, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2439,7 +2540,7 @@ RtVoid CRiCPPBridge::torus(RtFloat majorrad, RtFloat minorrad, RtFloat phimin, R
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return torusV(majorrad, minorrad, phimin, phimax, thetamax, n, &m_tokens[0], &m_params[0]);
+	return torusV(majorrad, minorrad, phimin, phimax, thetamax, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::torusV(RtFloat majorrad, RtFloat minorrad, RtFloat phimin, RtFloat phimax, RtFloat thetamax, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2461,7 +2562,7 @@ RtVoid CRiCPPBridge::points(RtInt npts, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return pointsV(npts, n, &m_tokens[0], &m_params[0]);
+	return pointsV(npts, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::pointsV(RtInt npts, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2483,7 +2584,7 @@ RtVoid CRiCPPBridge::curves(RtToken type, RtInt ncurves, RtInt nverts[], RtToken
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return curvesV(type, ncurves, nverts, wrap, n, &m_tokens[0], &m_params[0]);
+	return curvesV(type, ncurves, nverts, wrap, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::curvesV(RtToken type, RtInt ncurves, RtInt nverts[], RtToken wrap, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2505,7 +2606,7 @@ RtVoid CRiCPPBridge::blobby(RtInt nleaf, RtInt ncode, RtInt code[], RtInt nflt,
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return blobbyV(nleaf, ncode, code, nflt, flt, nstr, str, n, &m_tokens[0], &m_params[0]);
+	return blobbyV(nleaf, ncode, code, nflt, flt, nstr, str, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::blobbyV(RtInt nleaf, RtInt ncode, RtInt code[], RtInt nflt, RtFloat flt[], RtInt nstr, RtString str[], RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2548,7 +2649,7 @@ RtVoid CRiCPPBridge::geometry(RtToken type, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return geometryV(type, n, &m_tokens[0], &m_params[0]);
+	return geometryV(type, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::geometryV(RtToken type, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2571,7 +2672,7 @@ RtVoid CRiCPPBridge::makeTexture(RtString pic, RtString tex, RtToken swrap, RtTo
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return makeTextureV(pic, tex, swrap, twrap, filterfunc, swidth, twidth, n, &m_tokens[0], &m_params[0]);
+	return makeTextureV(pic, tex, swrap, twrap, filterfunc, swidth, twidth, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::makeTextureV(RtString pic, RtString tex, RtToken swrap, RtToken twrap, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2593,7 +2694,7 @@ RtVoid CRiCPPBridge::makeBump(RtString pic, RtString tex, RtToken swrap, RtToken
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return makeBumpV(pic, tex, swrap, twrap, filterfunc, swidth, twidth, n, &m_tokens[0], &m_params[0]);
+	return makeBumpV(pic, tex, swrap, twrap, filterfunc, swidth, twidth, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::makeBumpV(RtString pic, RtString tex, RtToken swrap, RtToken twrap, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2615,7 +2716,7 @@ RtVoid CRiCPPBridge::makeLatLongEnvironment(RtString pic, RtString tex, const IF
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return makeLatLongEnvironmentV(pic, tex, filterfunc, swidth, twidth, n, &m_tokens[0], &m_params[0]);
+	return makeLatLongEnvironmentV(pic, tex, filterfunc, swidth, twidth, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::makeLatLongEnvironmentV(RtString pic, RtString tex, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2637,7 +2738,7 @@ RtVoid CRiCPPBridge::makeCubeFaceEnvironment(RtString px, RtString nx, RtString
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return makeCubeFaceEnvironmentV(px, nx, py, ny, pz, nz, tex, fov, filterfunc, swidth, twidth, n, &m_tokens[0], &m_params[0]);
+	return makeCubeFaceEnvironmentV(px, nx, py, ny, pz, nz, tex, fov, filterfunc, swidth, twidth, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::makeCubeFaceEnvironmentV(RtString px, RtString nx, RtString py, RtString ny, RtString pz, RtString nz, RtString tex, RtFloat fov, const IFilterFunc &filterfunc, RtFloat swidth, RtFloat twidth, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2659,7 +2760,7 @@ RtVoid CRiCPPBridge::makeShadow(RtString pic, RtString tex, RtToken token, ...)
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return makeShadowV(pic, tex, n, &m_tokens[0], &m_params[0]);
+	return makeShadowV(pic, tex, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::makeShadowV(RtString pic, RtString tex, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2681,7 +2782,7 @@ RtVoid CRiCPPBridge::makeBrickMap(RtInt nNames, RtString ptcnames[], RtString bk
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return makeBrickMapV(nNames, ptcnames, bkmname, n, &m_tokens[0], &m_params[0]);
+	return makeBrickMapV(nNames, ptcnames, bkmname, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::makeBrickMapV(RtInt nNames, RtString ptcnames[], RtString bkmname, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -2735,7 +2836,7 @@ RtVoid CRiCPPBridge::readArchive(RtString name, const IArchiveCallback *callback
 	va_list marker;
 	va_start(marker, token);
 	RtInt n = getTokens(token, marker);
-	return readArchiveV(name, callback, n, &m_tokens[0], &m_params[0]);
+	return readArchiveV(name, callback, n, varTokens(), varParams());
 }
 RtVoid CRiCPPBridge::readArchiveV(RtString name, const IArchiveCallback *callback, RtInt n, RtToken tokens[], RtPointer params[])
 {
@@ -29,7 +29,13 @@
  */
 
 #include "ricpp/streams/backbuffer.h"
+
+#ifndef _RICPP_TOOLS_TRACER_H
+#include "ricpp/tools/tracer.h"
+#endif // _RICPP_TOOLS_TRACER_H
+
 #include <cassert>
+#include <algorithm>
 
 using namespace RiCPP;
 
@@ -81,6 +87,14 @@ std::streamsize CFileBackBuffer::sputn(const char *b, std::streamsize size)
 	return m_filebuf.sputn(b, size);
 }
 
+bool CFileBackBuffer::seek(std::streamoff pos)
+{
+	if ( !isOpen() || !(mode() & std::ios_base::in) ) {
+		return false;
+	}
+	return m_filebuf.pubseekpos(pos, std::ios_base::in) != std::streampos(std::streamoff(-1));
+}
+
 // ----------------------------------------------------------------------------
 
 const char *CBackBufferFactory::myType() { return "backbufferfactory"; }
@@ -155,6 +169,92 @@ CFileBackBufferFactory::open(const CUri &absUri, TypeOpenMode mode)
 
 // ----------------------------------------------------------------------------
 
+bool CMemoryBackBuffer::open(const CUri &anAbsUri, TypeOpenMode aMode)
+{
+	close();
+	
+	CBackBufferRoot::open(anAbsUri, aMode);
+	
+	if ( (mode() & std::ios_base::out) != 0 ) {
+		// Memory buffers are read only
+		return false;
+	}
+	
+	m_buffer = CMemoryBuffers::find(lastFileName().getPath().c_str());
+	return isOpen();
+}
+
+std::streamsize CMemoryBackBuffer::sgetn(char *b, std::streamsize size)
+{
+	if ( !isOpen() || !b || size <= 0 ) {
+		return 0;
+	}
+	
+	std::streamoff avail = m_buffer->size() - m_pos;
+	if ( avail <= 0 )
+		return 0;
+	if ( static_cast<std::streamoff>(size) > avail )
+		size = static_cast<std::streamsize>(avail);
+	memcpy(b, m_buffer->data() + m_pos, static_cast<size_t>(size));
+	m_pos += size;
+	return size;
+}
+
+bool CMemoryBackBuffer::seek(std::streamoff pos)
+{
+	if ( !isOpen() || pos < 0 || pos > m_buffer->size() ) {
+		return false;
+	}
+	m_pos = pos;
+	return true;
+}
+
+bool CMemoryBackBuffer::directData(const char *&data, std::streamsize &size) const
+{
+	if ( !isOpen() ) {
+		return CBackBufferRoot::directData(data, size);
+	}
+	data = m_buffer->data();
+	size = m_buffer->size();
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+const char *CMemoryBackBufferFactory::myType()
+{
+	return CBackBufferFactory::myType();
+}
+
+const char *CMemoryBackBufferFactory::myName()
+{
+	return "memory_backbuffer";
+}
+
+unsigned long CMemoryBackBufferFactory::myMajorVersion()
+{
+	return CBackBufferFactory::myMajorVersion();
+}
+
+unsigned long CMemoryBackBufferFactory::myMinorVersion() { return 1; }
+unsigned long CMemoryBackBufferFactory::myRevision() { return 1; }
+
+CBackBufferRoot *
+CMemoryBackBufferFactory::open(const CUri &absUri, TypeOpenMode mode)
+{
+	CMemoryBackBuffer *buf = new CMemoryBackBuffer;
+	if ( buf ) {
+		if ( !buf->open(absUri, mode) ) {
+			delete buf;
+			return 0;
+		}
+	}
+	registerObj(buf);
+	return buf;
+}
+
+// ----------------------------------------------------------------------------
+
 void CBackBufferProtocolHandlers::init(const char *direct)
 {
 	m_direct = direct ? direct : "";
@@ -169,6 +269,14 @@ void CBackBufferProtocolHandlers::init(const char *direct)
 												  >
 												  (&m_fileBuffer));
 		
+		// The MEMORY handler as well
+		m_backBufferPluginHandler.registerFactory("memory.buffer",
+												  reinterpret_cast<
+												  TemplPluginFactory
+												  <CBackBufferFactory> *
+												  >
+												  (&m_memoryBuffer));
+		
 		// Load more handlers (there are none at the moment)
 		m_backBufferPluginHandler.registerFromDirectory(direct, ".buffer");
 	}
@@ -191,6 +299,89 @@ CBackBufferProtocolHandlers::getBufferFactory(const char *scheme)
 
 // ----------------------------------------------------------------------------
 
+const unsigned long CInflateIndex::WINDOW_SIZE = 32768;
+
+void CInflateIndex::addPoint(std::streamoff out, std::streamoff in, int bits, const unsigned char *window, unsigned long windowSize)
+{
+	if ( !m_points.empty() && m_points.back().m_out >= out )
+		return;
+	
+	if ( windowSize > WINDOW_SIZE ) {
+		window += windowSize - WINDOW_SIZE;
+		windowSize = WINDOW_SIZE;
+	}
+
+	m_points.push_back(SAccessPoint());
+	SAccessPoint &point = m_points.back();
+	point.m_out = out;
+	point.m_in = in;
+	point.m_bits = bits;
+	if ( window && windowSize )
+		point.m_window.assign(window, window+windowSize);
+}
+
+const CInflateIndex::SAccessPoint *CInflateIndex::find(std::streamoff out) const
+{
+	// Binary search for the last point in front of or at out
+	std::vector<SAccessPoint>::size_type lo = 0, hi = m_points.size();
+	while ( lo < hi ) {
+		std::vector<SAccessPoint>::size_type mid = lo + (hi-lo)/2;
+		if ( m_points[mid].m_out <= out )
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	return lo > 0 ? &m_points[lo-1] : 0;
+}
+
+bool CInflateIndex::write(std::ostream &out) const
+{
+	out << "inflateindex 1 " << m_span << " " << m_points.size() << "\n";
+	for ( std::vector<SAccessPoint>::const_iterator i = m_points.begin(); i != m_points.end(); ++i ) {
+		out << (*i).m_out << " " << (*i).m_in << " " << (*i).m_bits << " " << (*i).m_window.size() << "\n";
+		if ( !(*i).m_window.empty() )
+			out.write(reinterpret_cast<const char *>(&(*i).m_window[0]), static_cast<std::streamsize>((*i).m_window.size()));
+		out << "\n";
+	}
+	return !out.fail();
+}
+
+bool CInflateIndex::read(std::istream &in)
+{
+	clear();
+
+	std::string tag;
+	int version = 0;
+	std::streamoff span = 0;
+	unsigned long n = 0;
+	
+	in >> tag >> version >> span >> n;
+	if ( in.fail() || tag != "inflateindex" || version != 1 || span <= 0 || in.get() != '\n' )
+		return false;
+	
+	m_span = span;
+	for ( unsigned long i = 0; i < n; ++i ) {
+		SAccessPoint point;
+		unsigned long size = 0;
+		in >> point.m_out >> point.m_in >> point.m_bits >> size;
+		if ( in.fail() || size > WINDOW_SIZE || point.m_bits < 0 || point.m_bits > 7 || in.get() != '\n' ) {
+			clear();
+			return false;
+		}
+		point.m_window.resize(size);
+		if ( size )
+			in.read(reinterpret_cast<char *>(&point.m_window[0]), static_cast<std::streamsize>(size));
+		if ( in.fail() || in.get() != '\n' || (!m_points.empty() && m_points.back().m_out >= point.m_out) ) {
+			clear();
+			return false;
+		}
+		m_points.push_back(point);
+	}
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
 void  CFrontStreambuf::init()
 {
 	m_backBuffer = 0;
@@ -208,6 +399,14 @@ void  CFrontStreambuf::init()
 	m_frontInBuffer.resize(m_buffersize);
 	m_in = 0;
 	m_crcIn = 0;
+	m_inIsEOF = false;
+	m_inBufferPos = 0;
+	m_inRawPos = 0;
+	m_inHeaderSize = 0;
+	m_inflateIndex = 0;
+	m_windowPos = 0;
+	m_windowFill = 0;
+	m_directIn = false;
 	m_transparentIn = true;
 	m_strategyIn = Z_DEFAULT_STRATEGY;
 	m_methodIn = Z_DEFLATED;
@@ -257,6 +456,8 @@ bool CFrontStreambuf::check_header()
 	uInt len;
 	char c;
 	
+	m_inHeaderSize = 0;
+
 	// Stream buffer is greater than 2 - maybe zipped
 	// if it is less than 2, the file is smaller as 2 Bytes, not zipped
 	if ( m_strmIn.avail_in < 2 ) {
@@ -576,6 +777,9 @@ CFrontStreambuf::int_type CFrontStreambuf::underflow()
 			   numPutback);
 	}
 	
+	// Position of the characters to read
+	m_inBufferPos += static_cast<std::streamoff>(TypeParent::egptr() - (m_frontInBuffer.begin()+m_putbackSize));
+
 	// Read new Characters
 	std::streamsize num = 0;
 	
@@ -587,7 +791,42 @@ CFrontStreambuf::int_type CFrontStreambuf::underflow()
 		fill_in_buffer();
 		if ( m_strmIn.avail_in != 0 ) {
 			if ( !m_transparentIn ) {
-				inflate(&m_strmIn, Z_NO_FLUSH);
+				// Z_BLOCK stops at the deflate block boundaries to record access points
+				Bytef *out = m_strmIn.next_out;
+				int ret;
+				{
+					CTraceScope trace("inflate");
+					ret = inflate(&m_strmIn, m_inflateIndex ? Z_BLOCK : Z_NO_FLUSH);
+				}
+				keepWindow(out, static_cast<unsigned long>(m_strmIn.next_out - out));
+				if ( m_inflateIndex &&
+					 (m_strmIn.data_type & 128) != 0 && (m_strmIn.data_type & 64) == 0 )
+				{
+					std::streamoff outPos = m_inBufferPos +
+						static_cast<std::streamoff>(m_strmIn.next_out - reinterpret_cast<Bytef *>(m_frontInBuffer.begin()+m_putbackSize));
+					if ( m_inflateIndex->needsPoint(outPos) ) {
+						// Linearize the window
+						std::vector<unsigned char> window(m_windowFill);
+						if ( m_windowFill ) {
+							unsigned long start = (m_windowPos + m_window.size() - m_windowFill) % m_window.size();
+							unsigned long first = tmin(m_windowFill, static_cast<unsigned long>(m_window.size()) - start);
+							memcpy(&window[0], &m_window[start], first);
+							if ( first < m_windowFill )
+								memcpy(&window[first], &m_window[0], m_windowFill - first);
+						}
+						m_inflateIndex->addPoint(outPos,
+							m_inRawPos + static_cast<std::streamoff>(m_strmIn.total_in),
+							m_strmIn.data_type & 7,
+							window.empty() ? 0 : &window[0],
+							m_windowFill);
+					}
+				}
+				if ( ret != Z_OK ) {
+					// End of the deflate data (or an error), the remaining
+					// input is the gzip footer.
+					m_inIsEOF = true;
+					break;
+				}
 			} else {
 				uInt avail = tmin(m_strmIn.avail_in, m_strmIn.avail_out);
 				memcpy(m_strmIn.next_out, m_strmIn.next_in, avail);
@@ -616,6 +855,182 @@ CFrontStreambuf::int_type CFrontStreambuf::underflow()
 	return * reinterpret_cast<unsigned char *>(TypeParent::gptr());
 }
 
+bool CFrontStreambuf::restartIn(std::streamoff rawPos)
+{
+	if ( !m_backBuffer || !m_backBuffer->seek(rawPos) ) {
+		return false;
+	}
+	
+	// The next fill_in_buffer() starts reading like at the start of the stream
+	m_transferInBuffer.resize(0);
+	m_strmIn.avail_in = 0;
+	m_inIsEOF = false;
+	setg(m_frontInBuffer.begin()+m_putbackSize,
+		 m_frontInBuffer.begin()+m_putbackSize,
+		 m_frontInBuffer.begin()+m_putbackSize);
+	return true;
+}
+
+void CFrontStreambuf::keepWindow(const unsigned char *data, unsigned long size)
+{
+	if ( !size )
+		return;
+	
+	if ( m_window.size() != CInflateIndex::WINDOW_SIZE ) {
+		m_window.resize(CInflateIndex::WINDOW_SIZE);
+		m_windowPos = 0;
+		m_windowFill = 0;
+	}
+	
+	if ( size >= CInflateIndex::WINDOW_SIZE ) {
+		memcpy(&m_window[0], data + (size - CInflateIndex::WINDOW_SIZE), CInflateIndex::WINDOW_SIZE);
+		m_windowPos = 0;
+		m_windowFill = CInflateIndex::WINDOW_SIZE;
+		return;
+	}
+	
+	unsigned long first = tmin(size, CInflateIndex::WINDOW_SIZE - m_windowPos);
+	memcpy(&m_window[m_windowPos], data, first);
+	if ( first < size )
+		memcpy(&m_window[0], data + first, size - first);
+	m_windowPos = (m_windowPos + size) % CInflateIndex::WINDOW_SIZE;
+	m_windowFill = tmin(m_windowFill + size, CInflateIndex::WINDOW_SIZE);
+}
+
+bool CFrontStreambuf::skipIn(std::streamoff n)
+{
+	while ( n > 0 ) {
+		if ( TypeParent::gptr() == TypeParent::egptr() &&
+			 underflow() == std::char_traits<TypeFrontStreambufElement>::eof() )
+		{
+			return false;
+		}
+		std::streamoff avail = static_cast<std::streamoff>(TypeParent::egptr() - TypeParent::gptr());
+		if ( avail > n )
+			avail = n;
+		TypeParent::gbump(static_cast<int>(avail));
+		n -= avail;
+	}
+	return true;
+}
+
+CFrontStreambuf::pos_type CFrontStreambuf::seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
+{
+	if ( (which & std::ios_base::in) == 0 || (m_mode & std::ios_base::in) == 0 ) {
+		return pos_type(off_type(-1));
+	}
+
+	std::streamoff cur = m_directIn ?
+		static_cast<std::streamoff>(TypeParent::gptr() - TypeParent::eback()) :
+		m_inBufferPos +
+		static_cast<std::streamoff>(TypeParent::gptr() - (m_frontInBuffer.begin()+m_putbackSize));
+	
+	if ( way == std::ios_base::cur ) {
+		if ( off == 0 )
+			return pos_type(cur);
+		return seekpos(pos_type(cur + off), which);
+	}
+	if ( way == std::ios_base::beg ) {
+		return seekpos(pos_type(off), which);
+	}
+	return pos_type(off_type(-1));
+}
+
+CFrontStreambuf::pos_type CFrontStreambuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	const pos_type failed = pos_type(off_type(-1));
+	
+	if ( (which & std::ios_base::in) == 0 || (m_mode & std::ios_base::in) == 0 ) {
+		return failed;
+	}
+	
+	std::streamoff target = static_cast<std::streamoff>(pos);
+	if ( target < 0 ) {
+		return failed;
+	}
+	
+	if ( m_directIn ) {
+		// The get area is the whole content
+		if ( target > static_cast<std::streamoff>(TypeParent::egptr() - TypeParent::eback()) ) {
+			return failed;
+		}
+		setg(TypeParent::eback(), TypeParent::eback() + target, TypeParent::egptr());
+		return pos;
+	}
+	
+	TypeFrontStreambufElement *start = m_frontInBuffer.begin()+m_putbackSize;
+	
+	// Position inside the current get area (including put back characters)
+	if ( target >= m_inBufferPos - static_cast<std::streamoff>(start - TypeParent::eback()) &&
+		 target <= m_inBufferPos + static_cast<std::streamoff>(TypeParent::egptr() - start) )
+	{
+		setg(TypeParent::eback(), start + (target - m_inBufferPos), TypeParent::egptr());
+		return pos;
+	}
+	
+	if ( !m_backBuffer ) {
+		// Coupled buffers cannot be positioned
+		return failed;
+	}
+	
+	if ( m_transparentIn ) {
+		if ( !restartIn(target) ) {
+			return failed;
+		}
+		m_inBufferPos = target;
+		return pos;
+	}
+	
+	std::streamoff cur = m_inBufferPos + static_cast<std::streamoff>(TypeParent::gptr() - start);
+	const CInflateIndex::SAccessPoint *point = m_inflateIndex ? m_inflateIndex->find(target) : 0;
+	
+	if ( target < cur || (point && point->m_out > cur) ) {
+		// Resume inflating at the access point or at the start
+		if ( point ) {
+			if ( !restartIn(point->m_in - (point->m_bits ? 1 : 0)) ) {
+				return failed;
+			}
+			inflateReset(&m_strmIn);
+			if ( point->m_bits ) {
+				int c = get_byte();
+				if ( c == EOF ) {
+					return failed;
+				}
+				inflatePrime(&m_strmIn, point->m_bits, c >> (8 - point->m_bits));
+			}
+			if ( !point->m_window.empty() ) {
+				inflateSetDictionary(&m_strmIn, &point->m_window[0], static_cast<uInt>(point->m_window.size()));
+			}
+			m_inRawPos = point->m_in;
+			m_inBufferPos = point->m_out;
+			m_windowPos = 0;
+			m_windowFill = 0;
+			if ( !point->m_window.empty() ) {
+				keepWindow(&point->m_window[0], static_cast<unsigned long>(point->m_window.size()));
+			}
+		} else {
+			if ( !restartIn(0) || !check_header() || m_transparentIn ) {
+				return failed;
+			}
+			inflateReset(&m_strmIn);
+			m_inRawPos = m_inHeaderSize;
+			m_inBufferPos = 0;
+			m_windowPos = 0;
+			m_windowFill = 0;
+		}
+	}
+	
+	if ( !skipIn(target - (m_inBufferPos + static_cast<std::streamoff>(TypeParent::gptr() - start))) ) {
+		return failed;
+	}
+	return pos;
+}
+
+void CFrontStreambuf::inflateIndex(CInflateIndex *index)
+{
+	m_inflateIndex = index;
+}
+
 bool CFrontStreambuf::postOpen(TypeOpenMode mode,
 							   int compressLevel)
 {			
@@ -664,13 +1079,39 @@ bool CFrontStreambuf::postOpen(TypeOpenMode mode,
 		m_in = 0;
 		m_inIsEOF = false;
 		m_crcIn = crc32(0L, Z_NULL, 0);
+		m_transferInBuffer.resize(0);
+		m_inBufferPos = 0;
+		m_inRawPos = 0;
+		m_inHeaderSize = 0;
+		m_windowPos = 0;
+		m_windowFill = 0;
+		m_directIn = false;
 		setg(m_frontInBuffer.begin()+m_putbackSize,
 			 m_frontInBuffer.begin()+m_putbackSize,
 			 m_frontInBuffer.begin()+m_putbackSize);
 		
+		const char *data = 0;
+		std::streamsize size = 0;
+		if ( m_backBuffer && m_backBuffer->directData(data, size) &&
+			 (m_transparentIn || size < 2 ||
+			  static_cast<unsigned char>(data[0]) != gz_magic_0 ||
+			  static_cast<unsigned char>(data[1]) != gz_magic_1) )
+		{
+			// Unzipped content in memory is read without copying it
+			m_transparentIn = true;
+			m_directIn = true;
+			m_inIsEOF = true;
+			char *begin = const_cast<char *>(data);
+			setg(begin, begin, begin+size);
+			return true;
+		}
+		
 		if ( !m_transparentIn && !check_header() )
 			return false;
 		
+		if ( !m_transparentIn )
+			m_inRawPos = m_inHeaderSize;
+		
 		if ( !m_transparentIn ) {
 			int ret = inflateInit2(&m_strmIn, -MAX_WBITS);
 			if ( ret != Z_OK ) {
@@ -757,6 +1198,13 @@ bool CFrontStreambuf::close()
 	if ( m_factory && m_backBuffer )
 		result = m_factory->close(m_backBuffer) || result;
 	
+	if ( m_directIn ) {
+		m_directIn = false;
+		setg(m_frontInBuffer.begin()+m_putbackSize,
+			 m_frontInBuffer.begin()+m_putbackSize,
+			 m_frontInBuffer.begin()+m_putbackSize);
+	}
+	
 	m_coupledBuffer = 0;
 	m_backBuffer = 0;
 	m_factory = 0;
@@ -0,0 +1,158 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file testglretained.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Tests the retained faces of the glrenderer.
+ *
+ *  An archive is replayed some times by the glrenderer into an offscreen
+ *  OSMesa context, with Control "glrenderer" "retained" "off" (immediate),
+ *  "auto" (vertex buffer objects) and "displaylists". The faces are
+ *  retained at the second replay and drawn from the GL objects afterwards,
+ *  the pixels of all modes have to be the same.
+ *
+ *  Usage: testglretained [renderer searchpath]
+ */
+
+#include "ricpp/ricppbridge/ricppbridge.h"
+
+#include <GL/osmesa.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace RiCPP;
+
+static const int WIDTH = 128;  ///< Width of the image.
+static const int HEIGHT = 128; ///< Height of the image.
+static const int REPLAYS = 3;  ///< Number of times the archive is drawn.
+
+static int failures = 0; ///< Number of failed checks.
+static std::vector<unsigned char> colorBuffer(WIDTH*HEIGHT*4); ///< RGBA buffer the OSMesa context renders to.
+
+/** @brief Counts and prints a failed check.
+ *  @param ok Result of the check.
+ *  @param what Description of the check.
+ */
+static void check(bool ok, const char *what)
+{
+	if ( ok )
+		return;
+	++failures;
+	std::cerr << "testglretained: failed: " << what << std::endl;
+}
+
+/** @brief Replays an archive with the glrenderer.
+ *  @param ri The bridge.
+ *  @param mode Mode of Control "glrenderer" "retained".
+ *  @retval image Gets the RGBA pixels after the last replay (the glrenderer
+ *          finishes the screen at the end of the world block).
+ */
+static void render(CRiCPPBridge &ri, RtString mode, std::vector<unsigned char> &image)
+{
+	ri.begin("glrenderer", RI_NULL);
+	ri.control("glrenderer", "retained", &mode, RI_NULL);
+
+	ri.archiveBegin("scene", RI_NULL);
+		ri.worldBegin();
+		ri.lightSource("distantlight", RI_NULL);
+		RtFloat orange[3] = {1, 0.5f, 0.2f};
+		ri.color(orange);
+		ri.sphere(1, -1, 1, 360, RI_NULL);
+		ri.translate(1.2f, 0.5f, 0);
+		ri.torus(0.6f, 0.2f, 0, 360, 360, RI_NULL);
+		// Colors per vertex are not put into display lists
+		RtFloat p[12] = {-2, -2, 1,  2, -2, 1,  2, 2, 1,  -2, 2, 1};
+		RtFloat cs[12] = {1, 0, 0,  0, 1, 0,  0, 0, 1,  1, 1, 1};
+		ri.polygon(4, RI_P, p, RI_CS, cs, RI_NULL);
+		ri.worldEnd();
+	ri.archiveEnd();
+
+	RtInt width = WIDTH, height = HEIGHT;
+	for ( int i = 0; i < REPLAYS; ++i ) {
+		ri.identity();
+		ri.option("glrenderer", RI_DISPXRES, &width, RI_DISPYRES, &height, RI_NULL);
+		ri.format(WIDTH, HEIGHT, 1);
+		ri.projection(RI_ORTHOGRAPHIC, RI_NULL);
+		ri.screenWindow(-3, 3, -3, 3);
+		ri.clipping(0.1f, 50.0f);
+		ri.translate(0, 0, 5);
+		ri.readArchive("scene", 0, RI_NULL);
+	}
+
+	image = colorBuffer;
+
+	check(ri.lastError() == RIE_NOERROR, "no error");
+	ri.end();
+}
+
+/** @brief Test program of the retained modes
+ */
+int main(int argc, char * const argv[])
+{
+	OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, 0);
+	if ( !ctx ) {
+		std::cerr << "testglretained: could not create an OSMesa context" << std::endl;
+		return 1;
+	}
+	if ( !OSMesaMakeCurrent(ctx, &colorBuffer[0], GL_UNSIGNED_BYTE, WIDTH, HEIGHT) ) {
+		std::cerr << "testglretained: could not use the OSMesa context" << std::endl;
+		OSMesaDestroyContext(ctx);
+		return 1;
+	}
+
+	{
+		CRiCPPBridge ri;
+		ri.errorHandler(ri.errorPrint());
+		if ( argc > 1 ) {
+			RtString path = argv[1];
+			ri.control("searchpath", "renderer", &path, RI_NULL);
+		}
+
+		std::vector<unsigned char> immediate, vbo, displayLists;
+		render(ri, "off", immediate);
+		render(ri, "auto", vbo);
+		render(ri, "displaylists", displayLists);
+
+		bool drawn = false;
+		for ( std::vector<unsigned char>::size_type i = 0; i < immediate.size(); i += 4 ) {
+			if ( immediate[i] != immediate[0] || immediate[i+1] != immediate[1] || immediate[i+2] != immediate[2] ) {
+				drawn = true;
+				break;
+			}
+		}
+		check(drawn, "scene is drawn");
+		check(vbo == immediate, "vertex buffer objects draw the same pixels as immediate mode");
+		check(displayLists == immediate, "display lists draw the same pixels as immediate mode");
+	}
+
+	OSMesaDestroyContext(ctx);
+
+	if ( failures ) {
+		std::cerr << "testglretained: " << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "testglretained: ok" << std::endl;
+	return 0;
+}
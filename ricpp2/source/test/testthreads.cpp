@@ -0,0 +1,178 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file testthreads.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Tests rendering contexts of one bridge used by several threads.
+ *
+ *  Two threads at a time begin and end ribwriter contexts at the same
+ *  CRiCPPBridge. Each thread has to see its own context and error state.
+ *  A thread that exits without ending its context must not pass the
+ *  context to a later thread getting the same thread id.
+ *
+ *  Usage: testthreads [renderer searchpath]
+ */
+
+#include "ricpp/ricppbridge/ricppbridge.h"
+#include "ricpp/tools/env.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace RiCPP;
+
+static std::atomic<int> failures(0); ///< Number of failed checks.
+static std::mutex tempFilesMutex;    ///< Guards tempFiles.
+static std::vector<std::string> tempFiles; ///< Files to remove at the end.
+
+/** @brief Counts and prints a failed check.
+ *  @param ok Result of the check.
+ *  @param what Description of the check.
+ */
+static void check(bool ok, const char *what)
+{
+	if ( ok )
+		return;
+	++failures;
+	std::cerr << "testthreads: failed: " << what << std::endl;
+}
+
+/** @brief Creates a temporary output file.
+ *  @return Path of the file, empty if it could not be created.
+ */
+static std::string tempFile()
+{
+	std::string path;
+	check(CEnv::createTempFile(path, "testthreads", ".rib") != 0, "creating a temporary file");
+	std::lock_guard<std::mutex> lock(tempFilesMutex);
+	tempFiles.push_back(path);
+	return path;
+}
+
+/** @brief Begins a ribwriter context writing to a new temporary file.
+ *  @param ri The bridge.
+ *  @param path Gets the path of the file.
+ *  @return The context handle.
+ */
+static RtContextHandle beginContext(CRiCPPBridge &ri, std::string &path)
+{
+	path = tempFile();
+	RtString outfile = path.c_str();
+	ri.begin("ribwriter", RI_FILE, &outfile, RI_NULL);
+	return ri.getContext();
+}
+
+/** @brief Renders some frames in own contexts.
+ *  @param ri The bridge.
+ *  @param thread Number of the thread, used as sphere radius.
+ *  @param contexts Number of contexts to begin and end.
+ */
+static void render(CRiCPPBridge &ri, int thread, int contexts)
+{
+	for ( int i = 0; i < contexts; ++i ) {
+		check(ri.getContext() == illContextHandle, "no context before begin");
+
+		std::string path;
+		RtContextHandle ctx = beginContext(ri, path);
+		check(ctx != illContextHandle, "context after begin");
+
+		for ( int frame = 1; frame <= 3; ++frame ) {
+			ri.frameBegin(frame);
+			ri.worldBegin();
+			ri.sphere((RtFloat)thread, -1, 1, 360, RI_NULL);
+			ri.worldEnd();
+			ri.frameEnd();
+			check(ri.getContext() == ctx, "own context while rendering");
+		}
+
+		ri.end();
+		check(ri.getContext() == illContextHandle, "no context after end");
+		check(ri.lastError() == RIE_NOERROR, "no error");
+
+		std::ifstream in(path.c_str());
+		std::string rib((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		char sphere[32];
+		sprintf(sphere, "Sphere %d -1 1 360", thread);
+		check(rib.find(sphere) != std::string::npos, "own output");
+	}
+}
+
+/** @brief Multithreading test program
+ */
+int main(int argc, char * const argv[])
+{
+	{
+		CRiCPPBridge ri;
+		ri.errorHandler(ri.errorPrint());
+		if ( argc > 1 ) {
+			RtString path = argv[1];
+			ri.control("searchpath", "renderer", &path, RI_NULL);
+		}
+
+		for ( int round = 0; round < 8; ++round ) {
+			std::thread first(render, std::ref(ri), 1, 4);
+			std::thread second(render, std::ref(ri), 2, 4);
+			first.join();
+			second.join();
+		}
+
+		std::thread::id abandonedId;
+		std::thread abandoned([&ri, &abandonedId]() {
+			abandonedId = std::this_thread::get_id();
+			std::string path;
+			check(beginContext(ri, path) != illContextHandle, "context of the abandoned thread");
+		});
+		abandoned.join();
+
+		for ( int round = 0; round < 8; ++round ) {
+			std::thread next([&ri, &abandonedId]() {
+				if ( std::this_thread::get_id() == abandonedId )
+					check(ri.getContext() == illContextHandle, "no context inherited from a finished thread");
+				render(ri, 3, 1);
+			});
+			next.join();
+		}
+
+		check(ri.getContext() == illContextHandle, "no context in the main thread");
+	}
+
+	for ( std::vector<std::string>::iterator i = tempFiles.begin(); i != tempFiles.end(); ++i ) {
+		if ( !i->empty() )
+			remove(i->c_str());
+	}
+
+	if ( failures ) {
+		std::cerr << "testthreads: " << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "testthreads: ok" << std::endl;
+	return 0;
+}
@@ -42,8 +42,24 @@
 #include <unistd.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <cstring>
+#include <vector>
+
 using namespace RiCPP;
 
+static std::atomic<unsigned long> s_envGeneration(0);
+
+unsigned long CEnv::generation()
+{
+	return s_envGeneration;
+}
+
+void CEnv::changed()
+{
+	++s_envGeneration;
+}
+
 /** @brief Mac and Linux implementation to get an environment variable.
  *
  * Uses the standard function getenv() to acces the environment variables,
@@ -112,4 +128,32 @@ std::string &CEnv::getPath(std::string &path, bool convertPath)
 	return convertPath ? CFilepathConverter::convertListToInternal(path) : path;
 }
 
+/** @brief Mac and Linux implementation to create a temporary file.
+ *
+ * Creates the file with mkstemps() in $TMPDIR or P_tmpdir.
+ */
+const char *CEnv::createTempFile(std::string &tmpPath, const char *prefix, const char *extension)
+{
+	tmpPath = "";
+
+	std::string pattern;
+	if ( get(pattern, "TMPDIR", false).empty() )
+		pattern = P_tmpdir;
+	if ( pattern.empty() || pattern[pattern.size()-1] != '/' )
+		pattern += '/';
+	pattern += noNullStr(prefix);
+	pattern += "XXXXXX";
+	pattern += noNullStr(extension);
+
+	std::vector<char> buf(pattern.begin(), pattern.end());
+	buf.push_back(0);
+	int fd = mkstemps(&buf[0], (int)strlen(noNullStr(extension)));
+	if ( fd < 0 )
+		return 0;
+	close(fd);
+
+	tmpPath = &buf[0];
+	return tmpPath.c_str();
+}
+
 #endif // !_WIN32
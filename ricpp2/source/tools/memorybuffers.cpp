@@ -0,0 +1,117 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file memorybuffers.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Implementation of the registry of named memory buffers
+ */
+
+#include "ricpp/tools/memorybuffers.h"
+
+#include <sstream>
+
+using namespace RiCPP;
+
+std::mutex &CMemoryBuffers::mutex()
+{
+	static std::mutex registryMutex;
+	return registryMutex;
+}
+
+std::map<std::string, CMemoryBuffers::TypeData> &CMemoryBuffers::buffers()
+{
+	static std::map<std::string, TypeData> registry;
+	return registry;
+}
+
+std::string CMemoryBuffers::bufferName(const char *name)
+{
+	std::string str(noNullStr(name));
+	if ( str.size() >= 7 ) {
+		std::string scheme(str.substr(0, 7));
+		for ( std::string::iterator i = scheme.begin(); i != scheme.end(); ++i )
+			asciiToUpper(*i);
+		if ( scheme == "MEMORY:" )
+			str.erase(0, 7);
+	}
+	std::string::size_type pos = str.find_first_not_of('/');
+	return pos == std::string::npos ? std::string() : str.substr(pos);
+}
+
+bool CMemoryBuffers::registerBuffer(const char *name, const char *data, std::streamsize size)
+{
+	std::string key(bufferName(name));
+	if ( key.empty() || size < 0 || (!data && size) )
+		return false;
+	TypeData buffer(new CData(data, size));
+	std::lock_guard<std::mutex> lock(mutex());
+	buffers()[key] = buffer;
+	return true;
+}
+
+bool CMemoryBuffers::registerBuffer(const char *name, std::vector<char> &data)
+{
+	std::string key(bufferName(name));
+	if ( key.empty() )
+		return false;
+	TypeData buffer(new CData(data));
+	std::lock_guard<std::mutex> lock(mutex());
+	buffers()[key] = buffer;
+	return true;
+}
+
+bool CMemoryBuffers::unregisterBuffer(const char *name)
+{
+	std::string key(bufferName(name));
+	TypeData buffer; // Released after unlocking
+	std::lock_guard<std::mutex> lock(mutex());
+	std::map<std::string, TypeData>::iterator i = buffers().find(key);
+	if ( i == buffers().end() )
+		return false;
+	buffer.swap(i->second);
+	buffers().erase(i);
+	return true;
+}
+
+CMemoryBuffers::TypeData CMemoryBuffers::find(const char *name)
+{
+	std::string key(bufferName(name));
+	std::lock_guard<std::mutex> lock(mutex());
+	std::map<std::string, TypeData>::const_iterator i = buffers().find(key);
+	if ( i == buffers().end() )
+		return TypeData();
+	return i->second;
+}
+
+std::string CMemoryBuffers::uniqueName(const char *prefix)
+{
+	static unsigned long counter = 0;
+	std::lock_guard<std::mutex> lock(mutex());
+	for (;;) {
+		std::ostringstream name;
+		name << noNullStr(prefix) << "-" << ++counter;
+		if ( buffers().find(name.str()) == buffers().end() )
+			return name.str();
+	}
+}
@@ -0,0 +1,241 @@
+// RICPP - RenderMan(R) Interface CPP Language Binding
+//
+//     RenderMan(R) is a registered trademark of Pixar
+// The RenderMan(R) Interface Procedures and Protocol are:
+//         Copyright 1988, 1989, 2000, 2005 Pixar
+//                 All rights Reservered
+//
+// Copyright (c) of RiCPP 2007, Andreas Pidde
+// Contact: andreas@pidde.de
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** @file tracer.cpp
+ *  @author Andreas Pidde (andreas@pidde.de)
+ *  @brief Implementation of the runtime enabled tracing, written as Chrome trace (JSON).
+ */
+
+#include "ricpp/tools/tracer.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace RiCPP;
+
+std::atomic<bool> CTracer::m_enabled(false);
+
+/** @brief Holds the buffer of the current thread, retires it when the thread exits.
+ */
+struct SThreadBufferHolder {
+	CTracer *m_tracer;                ///< Tracer of the buffer.
+	CTracer::SThreadBuffer *m_buffer; ///< Buffer of the thread, 0 if the thread did not record an event.
+	inline ~SThreadBufferHolder()
+	{
+		if ( m_tracer && m_buffer )
+			m_tracer->retire(*m_buffer);
+	}
+};
+
+/** @brief Buffer of the current thread.
+ */
+static thread_local SThreadBufferHolder t_threadBuffer = { 0, 0 };
+
+
+CTracer &RiCPP::ricppTracer()
+{
+	static CTracer tracer;
+	return tracer;
+}
+
+
+CTracer::CTracer()
+{
+	m_capacity = TRACE_DEFAULT_CAPACITY;
+}
+
+
+CTracer::~CTracer()
+{
+	std::vector<SThreadBuffer *>::iterator i;
+	for ( i = m_buffers.begin(); i != m_buffers.end(); ++i ) {
+		delete (*i);
+	}
+	m_buffers.clear();
+}
+
+
+CTracer::SThreadBuffer &CTracer::threadBuffer()
+{
+	if ( !t_threadBuffer.m_buffer ) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		SThreadBuffer *buf = 0;
+		std::vector<SThreadBuffer *>::iterator i;
+		for ( i = m_buffers.begin(); i != m_buffers.end(); ++i ) {
+			if ( (*i)->m_retired ) {
+				// Events of the former thread are kept until overwritten
+				buf = *i;
+				break;
+			}
+		}
+		if ( !buf ) {
+			buf = new SThreadBuffer;
+			buf->m_count = 0;
+			buf->m_cleared = 0;
+			buf->m_events.resize(m_capacity);
+			m_buffers.push_back(buf);
+			buf->m_threadId = (unsigned long)m_buffers.size();
+		}
+		buf->m_retired = false;
+		t_threadBuffer.m_tracer = this;
+		t_threadBuffer.m_buffer = buf;
+	}
+	return *t_threadBuffer.m_buffer;
+}
+
+
+void CTracer::retire(SThreadBuffer &buf)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	buf.m_retired = true;
+}
+
+
+void CTracer::record(char phase, const char *aName, const char *aDetail)
+{
+	SThreadBuffer &buf = threadBuffer();
+	unsigned long long n = buf.m_count.load(std::memory_order_relaxed);
+	STraceEvent &ev = buf.m_events[(size_t)(n % buf.m_events.size())];
+	ev.m_time = now();
+	ev.m_name = aName;
+	ev.m_phase = phase;
+	if ( aDetail ) {
+		strncpy(ev.m_detail, aDetail, TRACE_DETAIL_SIZE-1);
+		ev.m_detail[TRACE_DETAIL_SIZE-1] = 0;
+	} else {
+		ev.m_detail[0] = 0;
+	}
+	buf.m_count.store(n+1, std::memory_order_release);
+}
+
+
+void CTracer::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<SThreadBuffer *>::iterator i;
+	for ( i = m_buffers.begin(); i != m_buffers.end(); ++i ) {
+		(*i)->m_cleared = (*i)->m_count.load(std::memory_order_acquire);
+	}
+}
+
+
+/** @brief Writes a string as JSON string (with quotes).
+ */
+static void writeJSONString(std::ostream &out, const char *str)
+{
+	out << '"';
+	for ( ; str && *str; ++str ) {
+		unsigned char c = (unsigned char)*str;
+		if ( c == '"' || c == '\\' ) {
+			out << '\\' << (char)c;
+		} else if ( c < 0x20 || c >= 0x7f ) {
+			// Control and non ASCII (e.g. latin-1) characters
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (unsigned int)c << std::dec << std::setfill(' ');
+		} else {
+			out << (char)c;
+		}
+	}
+	out << '"';
+}
+
+
+void CTracer::writeChrome(std::ostream &out)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// The first event of the trace is time 0
+	std::vector<unsigned long long> counts(m_buffers.size());
+	std::vector<unsigned long long> firsts(m_buffers.size());
+	unsigned long long startTime = 0;
+	bool hasStart = false;
+	size_t b;
+	for ( b = 0; b < m_buffers.size(); ++b ) {
+		SThreadBuffer &buf = *m_buffers[b];
+		counts[b] = buf.m_count.load(std::memory_order_acquire);
+		firsts[b] = buf.m_cleared;
+		if ( counts[b] - firsts[b] > buf.m_events.size() )
+			firsts[b] = counts[b] - buf.m_events.size();
+		if ( firsts[b] < counts[b] ) {
+			unsigned long long t = buf.m_events[(size_t)(firsts[b] % buf.m_events.size())].m_time;
+			if ( !hasStart || t < startTime ) {
+				startTime = t;
+				hasStart = true;
+			}
+		}
+	}
+
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	out << std::fixed << std::setprecision(3);
+	for ( b = 0; b < m_buffers.size(); ++b ) {
+		SThreadBuffer &buf = *m_buffers[b];
+		out << (first ? "\n" : ",\n");
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buf.m_threadId
+		    << ",\"args\":{\"name\":\"thread " << buf.m_threadId << "\"}}";
+
+		// End events of begins overwritten in the ring are skipped
+		unsigned long depth = 0;
+		for ( unsigned long long n = firsts[b]; n < counts[b]; ++n ) {
+			const STraceEvent &ev = buf.m_events[(size_t)(n % buf.m_events.size())];
+			if ( ev.m_phase == 'E' ) {
+				if ( !depth )
+					continue;
+				--depth;
+			} else {
+				++depth;
+			}
+			out << ",\n{\"name\":";
+			writeJSONString(out, ev.m_name);
+			out << ",\"cat\":\"ricpp\",\"ph\":\"" << ev.m_phase << "\",\"pid\":1,\"tid\":" << buf.m_threadId
+			    << ",\"ts\":" << (double)(ev.m_time - startTime) / 1000.0;
+			if ( ev.m_detail[0] ) {
+				out << ",\"args\":{\"detail\":";
+				writeJSONString(out, ev.m_detail);
+				out << "}";
+			}
+			out << "}";
+		}
+	}
+	out << "\n]}\n";
+	out << std::defaultfloat;
+}
+
+
+bool CTracer::write(const std::string &aFilename)
+{
+	if ( aFilename == "-" ) {
+		writeChrome(std::cerr);
+		std::cerr.flush();
+		return true;
+	}
+
+	std::ofstream out(aFilename.c_str(), std::ios_base::out|std::ios_base::trunc);
+	if ( !out )
+		return false;
+	writeChrome(out);
+	return out.good();
+}
@@ -32,9 +32,22 @@
 
 #include <windows.h>
 #include <cstdlib>
+#include <atomic>
 
 using namespace RiCPP;
 
+static std::atomic<unsigned long> s_envGeneration(0);
+
+unsigned long CEnv::generation()
+{
+	return s_envGeneration;
+}
+
+void CEnv::changed()
+{
+	++s_envGeneration;
+}
+
 /** @brief Win32 implementation to get an environment variable.
  *
  * Uses the Win32 function getenv_s() to access the environment variables,
@@ -214,4 +227,34 @@ std::string &CEnv::getProgDir(std::string &prog, bool convertPath)
 	prog = convertPath ? internalPath : path;
 	return prog;
 }
+
+/** @brief Win32 implementation to create a temporary file.
+ *
+ * Creates the file with GetTempFileNameA() in the directory returned by
+ * GetTempPathA(), the file is renamed to get the extension. Only the first
+ * three characters of the prefix are used.
+ */
+const char *CEnv::createTempFile(std::string &tmpPath, const char *prefix, const char *extension)
+{
+	tmpPath = "";
+
+	char dir[MAX_PATH+1] = { 0 };
+	DWORD len = GetTempPathA(sizeof(dir), dir);
+	if ( len == 0 || len > MAX_PATH )
+		return 0;
+
+	char name[MAX_PATH+1] = { 0 };
+	if ( GetTempFileNameA(dir, prefix ? prefix : "", 0, name) == 0 )
+		return 0;
+	tmpPath = name;
+
+	if ( extension && *extension ) {
+		std::string renamed(tmpPath);
+		renamed += extension;
+		// Fails if a file with that name exists, the name without extension is used then
+		if ( MoveFileA(tmpPath.c_str(), renamed.c_str()) )
+			tmpPath = renamed;
+	}
+	return tmpPath.c_str();
+}
 #endif // _WIN32